@@ -0,0 +1,294 @@
+/*
+    * Benchmark of FeatureExtractor against the LOAM feature extraction it replaced in FeatureExtraction, on synthetic
+    * scans laid out as CloudInfo. The reference below is the former code, except that its sub-region sort includes
+    * the last point, which the former code left out of the sort. Both must then produce the same corner and surface
+    * clouds, in the same order; the benchmark fails if they differ.
+    *
+    * usage: lio_sam_benchFeatureExtractor [numRings] [numColumns] [numRepeats] [numThreads]
+    */
+#include "featureExtractor.hpp"
+#include "voxelFilter.hpp"
+
+#include <pcl/point_types.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+typedef pcl::PointXYZI PointType;
+
+static const float edgeThreshold = 1.0;
+static const float surfThreshold = 0.1;
+static const float surfLeafSize = 0.4;
+
+struct Scan
+{
+    pcl::PointCloud<PointType>::Ptr cloud;
+    std::vector<float> range;
+    std::vector<int32_t> column;
+    std::vector<int32_t> startRingIndex;
+    std::vector<int32_t> endRingIndex;
+};
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+// rings hitting a ground plane and boxes in front of walls, with range noise and dropped returns,
+// extracted ring by ring as imageProjection does
+static Scan makeScan(int numRings, int numColumns)
+{
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> noise(-0.02, 0.02), unit(0, 1);
+    Scan scan;
+    scan.cloud.reset(new pcl::PointCloud<PointType>());
+    scan.startRingIndex.resize(numRings);
+    scan.endRingIndex.resize(numRings);
+    int count = 0;
+    for (int ring = 0; ring < numRings; ++ring)
+    {
+        scan.startRingIndex[ring] = count - 1 + 5;
+        float elevation = (-25.0f + 40.0f * ring / std::max(numRings - 1, 1)) * M_PI / 180;
+        for (int column = 0; column < numColumns; ++column)
+        {
+            if (unit(generator) < 0.05)
+                continue;
+            float azimuth = 2 * M_PI * column / numColumns;
+            float range = 30 + 10 * std::sin(3 * azimuth);
+            if ((column / 40) % 5 == 0)
+                range = 8 + (column % 40) * 0.05f; // a box, its sides are edges and occlude the wall
+            if (elevation < 0)
+                range = std::min(range, 1.8f / -std::sin(elevation));
+            range += noise(generator);
+            PointType p;
+            p.x = range * std::cos(elevation) * std::cos(azimuth);
+            p.y = range * std::cos(elevation) * std::sin(azimuth);
+            p.z = range * std::sin(elevation);
+            p.intensity = ring;
+            scan.cloud->push_back(p);
+            scan.range.push_back(range);
+            scan.column.push_back(column);
+            ++count;
+        }
+        scan.endRingIndex[ring] = count - 1 - 5;
+    }
+    return scan;
+}
+
+struct smoothness_t
+{
+    float value;
+    size_t ind;
+};
+
+struct by_value
+{
+    bool operator()(smoothness_t const &left, smoothness_t const &right) {
+        return left.value < right.value;
+    }
+};
+
+// the former FeatureExtraction::calculateSmoothness, markOccludedPoints and extractFeatures
+class ReferenceExtraction
+{
+public:
+
+    void extract(const Scan& scan, pcl::PointCloud<PointType>& cornerCloud, pcl::PointCloud<PointType>& surfaceCloud)
+    {
+        const pcl::PointCloud<PointType>& extractedCloud = *scan.cloud;
+        int cloudSize = extractedCloud.size();
+        cloudSmoothness.assign(cloudSize, smoothness_t{0, 0});
+        cloudCurvature.assign(cloudSize, 0);
+        cloudNeighborPicked.assign(cloudSize, 0);
+        cloudLabel.assign(cloudSize, 0);
+        for (int i = 0; i < cloudSize; i++)
+            cloudSmoothness[i].ind = i;
+        downSizeFilter.setLeafSize(surfLeafSize, surfLeafSize, surfLeafSize);
+
+        for (int i = 5; i < cloudSize - 5; i++)
+        {
+            float diffRange = scan.range[i-5] + scan.range[i-4] + scan.range[i-3] + scan.range[i-2] + scan.range[i-1]
+                            - scan.range[i] * 10
+                            + scan.range[i+1] + scan.range[i+2] + scan.range[i+3] + scan.range[i+4] + scan.range[i+5];
+            cloudCurvature[i] = diffRange*diffRange;
+            cloudSmoothness[i].value = cloudCurvature[i];
+        }
+
+        for (int i = 5; i < cloudSize - 6; ++i)
+        {
+            float depth1 = scan.range[i];
+            float depth2 = scan.range[i+1];
+            int columnDiff = std::abs(int(scan.column[i+1] - scan.column[i]));
+            if (columnDiff < 10){
+                if (depth1 - depth2 > 0.3){
+                    for (int l = -5; l <= 0; l++)
+                        cloudNeighborPicked[i + l] = 1;
+                }else if (depth2 - depth1 > 0.3){
+                    for (int l = 1; l <= 6; l++)
+                        cloudNeighborPicked[i + l] = 1;
+                }
+            }
+            float diff1 = std::abs(float(scan.range[i-1] - scan.range[i]));
+            float diff2 = std::abs(float(scan.range[i+1] - scan.range[i]));
+            if (diff1 > 0.02 * scan.range[i] && diff2 > 0.02 * scan.range[i])
+                cloudNeighborPicked[i] = 1;
+        }
+
+        cornerCloud.clear();
+        surfaceCloud.clear();
+        pcl::PointCloud<PointType>::Ptr surfaceCloudScan(new pcl::PointCloud<PointType>());
+        pcl::PointCloud<PointType> surfaceCloudScanDS;
+        int numRings = scan.startRingIndex.size();
+        for (int i = 0; i < numRings; i++)
+        {
+            surfaceCloudScan->clear();
+            for (int j = 0; j < 6; j++)
+            {
+                int sp = (scan.startRingIndex[i] * (6 - j) + scan.endRingIndex[i] * j) / 6;
+                int ep = (scan.startRingIndex[i] * (5 - j) + scan.endRingIndex[i] * (j + 1)) / 6 - 1;
+                if (sp >= ep)
+                    continue;
+
+                std::sort(cloudSmoothness.begin()+sp, cloudSmoothness.begin()+ep+1, by_value());
+
+                int largestPickedNum = 0;
+                for (int k = ep; k >= sp; k--)
+                {
+                    int ind = cloudSmoothness[k].ind;
+                    if (cloudNeighborPicked[ind] == 0 && cloudCurvature[ind] > edgeThreshold)
+                    {
+                        largestPickedNum++;
+                        if (largestPickedNum <= 20){
+                            cloudLabel[ind] = 1;
+                            cornerCloud.push_back(extractedCloud.points[ind]);
+                        } else {
+                            break;
+                        }
+                        markNeighbors(ind, scan.column);
+                    }
+                }
+
+                for (int k = sp; k <= ep; k++)
+                {
+                    int ind = cloudSmoothness[k].ind;
+                    if (cloudNeighborPicked[ind] == 0 && cloudCurvature[ind] < surfThreshold)
+                    {
+                        cloudLabel[ind] = -1;
+                        markNeighbors(ind, scan.column);
+                    }
+                }
+
+                for (int k = sp; k <= ep; k++)
+                {
+                    if (cloudLabel[k] <= 0)
+                        surfaceCloudScan->push_back(extractedCloud.points[k]);
+                }
+            }
+
+            downSizeFilter.setInputCloud(surfaceCloudScan);
+            downSizeFilter.filter(surfaceCloudScanDS);
+            surfaceCloud += surfaceCloudScanDS;
+        }
+    }
+
+private:
+
+    void markNeighbors(int ind, const std::vector<int32_t>& column)
+    {
+        cloudNeighborPicked[ind] = 1;
+        for (int l = 1; l <= 5; l++)
+        {
+            if (std::abs(int(column[ind + l] - column[ind + l - 1])) > 10)
+                break;
+            cloudNeighborPicked[ind + l] = 1;
+        }
+        for (int l = -1; l >= -5; l--)
+        {
+            if (ind + l < 0 || std::abs(int(column[ind + l] - column[ind + l + 1])) > 10)
+                break;
+            cloudNeighborPicked[ind + l] = 1;
+        }
+    }
+
+    std::vector<smoothness_t> cloudSmoothness;
+    std::vector<float> cloudCurvature;
+    std::vector<int> cloudNeighborPicked;
+    std::vector<int> cloudLabel;
+    VoxelFilter<PointType> downSizeFilter;
+};
+
+static bool sameCloud(const char* name, const pcl::PointCloud<PointType>& a, const pcl::PointCloud<PointType>& b)
+{
+    if (a.size() != b.size())
+    {
+        printf("different number of %s points: %zu and %zu\n", name, a.size(), b.size());
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        if (a.points[i].x != b.points[i].x || a.points[i].y != b.points[i].y || a.points[i].z != b.points[i].z ||
+            a.points[i].intensity != b.points[i].intensity)
+        {
+            printf("%s point %zu differs\n", name, i);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    int numRings = argc > 1 ? atoi(argv[1]) : 64;
+    int numColumns = argc > 2 ? atoi(argv[2]) : 1800;
+    int numRepeats = argc > 3 ? atoi(argv[3]) : 50;
+    int numThreads = argc > 4 ? atoi(argv[4]) : 4;
+
+    Scan scan = makeScan(numRings, numColumns);
+
+    ReferenceExtraction reference;
+    FeatureExtractor<PointType> serialExtractor, parallelExtractor;
+    serialExtractor.setParams(numRings, edgeThreshold, surfThreshold, surfLeafSize, 1);
+    parallelExtractor.setParams(numRings, edgeThreshold, surfThreshold, surfLeafSize, numThreads);
+
+    pcl::PointCloud<PointType> referenceCorner, referenceSurface, serialCorner, serialSurface, parallelCorner, parallelSurface;
+    std::vector<double> referenceMs, serialMs, parallelMs;
+    for (int repeat = 0; repeat < numRepeats; ++repeat)
+    {
+        auto start = std::chrono::steady_clock::now();
+        reference.extract(scan, referenceCorner, referenceSurface);
+        referenceMs.push_back(elapsedMs(start));
+
+        start = std::chrono::steady_clock::now();
+        serialExtractor.extract(*scan.cloud, scan.range.data(), scan.column.data(), scan.startRingIndex.data(),
+                                scan.endRingIndex.data(), serialCorner, serialSurface);
+        serialMs.push_back(elapsedMs(start));
+
+        start = std::chrono::steady_clock::now();
+        parallelExtractor.extract(*scan.cloud, scan.range.data(), scan.column.data(), scan.startRingIndex.data(),
+                                  scan.endRingIndex.data(), parallelCorner, parallelSurface);
+        parallelMs.push_back(elapsedMs(start));
+    }
+
+    printf("%zu points in %d rings, %zu corners, %zu surface points, median of %d runs\n", scan.cloud->size(), numRings,
+           referenceCorner.size(), referenceSurface.size(), numRepeats);
+    printf("former extraction:           %8.3f ms\n", median(referenceMs));
+    printf("FeatureExtractor, 1 thread:  %8.3f ms\n", median(serialMs));
+    printf("FeatureExtractor, %d threads: %8.3f ms\n", numThreads, median(parallelMs));
+
+    bool ok = sameCloud("corner", referenceCorner, serialCorner) && sameCloud("surface", referenceSurface, serialSurface) &&
+              sameCloud("corner", serialCorner, parallelCorner) && sameCloud("surface", serialSurface, parallelSurface);
+    printf(ok ? "outputs match\n" : "outputs differ\n");
+    return ok ? 0 : 1;
+}
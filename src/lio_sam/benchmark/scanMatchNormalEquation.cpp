@@ -0,0 +1,116 @@
+/*
+    * Benchmark of the scan-to-map normal equation, before and after it was accumulated per thread.
+    * "stored" is the previous scheme: each residual is kept, then the N x 6 Jacobian and the N x 1 residuals
+    * are filled in a serial pass, and AtA = At * A and AtB = At * B are multiplied out. (It used cv::Mat;
+    * Eigen is used here, which is faster than cv::Mat, so the speed-up measured here is a lower bound.)
+    * "accumulated" folds each residual into a per-thread 6 x 6 system, summed by an OpenMP reduction.
+    * Both are solved the same way, and their solutions are checked to agree.
+    *
+    * usage: lio_sam_benchScanMatch [numResiduals] [numRepeats] [numThreads]
+    */
+#include "scanMatchNormalEquation.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+struct Point
+{
+    float x, y, z, intensity;
+};
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+int main(int argc, char** argv)
+{
+    int numResiduals = argc > 1 ? atoi(argv[1]) : 20000;
+    int numRepeats = argc > 2 ? atoi(argv[2]) : 50;
+    int numThreads = argc > 3 ? atoi(argv[3]) : 4;
+
+    // points within 50 m, unit normals, and residuals of a few centimeters
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> position(-50, 50), direction(-1, 1), residual(-0.05, 0.05);
+    std::vector<Point> points(numResiduals), coeffs(numResiduals);
+    for (int i = 0; i < numResiduals; ++i)
+    {
+        points[i] = {position(generator), position(generator), position(generator) * 0.1f, 0};
+        Eigen::Vector3f normal(direction(generator), direction(generator), direction(generator));
+        normal.normalize();
+        coeffs[i] = {normal.x(), normal.y(), normal.z(), residual(generator)};
+    }
+    float transform[6] = {0.02, -0.01, 1.3, 10, -4, 0.5};
+    ScanMatchJacobian jacobian(transform);
+
+    std::vector<double> storedMs, accumulatedMs;
+    Eigen::Matrix<float, 6, 1> storedX, accumulatedX;
+    for (int repeat = 0; repeat < numRepeats; ++repeat)
+    {
+        auto start = std::chrono::steady_clock::now();
+        {
+            // per-point holders filled in parallel, as by cornerOptimization and surfOptimization
+            std::vector<Point> oriVec(numResiduals), coeffVec(numResiduals);
+            std::vector<char> flag(numResiduals);
+            #pragma omp parallel for num_threads(numThreads)
+            for (int i = 0; i < numResiduals; ++i)
+            {
+                oriVec[i] = points[i];
+                coeffVec[i] = coeffs[i];
+                flag[i] = true;
+            }
+            // serial combine, then the dense matrices
+            std::vector<Point> laserCloudOri, coeffSel;
+            for (int i = 0; i < numResiduals; ++i)
+            {
+                if (flag[i])
+                {
+                    laserCloudOri.push_back(oriVec[i]);
+                    coeffSel.push_back(coeffVec[i]);
+                }
+            }
+            int num = laserCloudOri.size();
+            Eigen::MatrixXf matA(num, 6), matB(num, 1);
+            for (int i = 0; i < num; ++i)
+            {
+                matA.row(i) = jacobian.row(laserCloudOri[i], coeffSel[i]).transpose();
+                matB(i, 0) = -coeffSel[i].intensity;
+            }
+            Eigen::MatrixXf matAt = matA.transpose();
+            Eigen::Matrix<float, 6, 6> matAtA = matAt * matA;
+            Eigen::Matrix<float, 6, 1> matAtB = matAt * matB;
+            storedX = matAtA.colPivHouseholderQr().solve(matAtB);
+        }
+        storedMs.push_back(elapsedMs(start));
+
+        start = std::chrono::steady_clock::now();
+        {
+            ScanMatchNormalEquation equation;
+            #pragma omp parallel for num_threads(numThreads) reduction(+ : equation)
+            for (int i = 0; i < numResiduals; ++i)
+                equation.add(jacobian, points[i], coeffs[i]);
+            accumulatedX = equation.AtA.colPivHouseholderQr().solve(equation.AtB);
+        }
+        accumulatedMs.push_back(elapsedMs(start));
+    }
+
+    float difference = (storedX - accumulatedX).norm() / std::max(storedX.norm(), 1e-12f);
+    printf("%d residuals, %d threads, median of %d runs\n", numResiduals, numThreads, numRepeats);
+    printf("stored:      %8.3f ms\n", median(storedMs));
+    printf("accumulated: %8.3f ms\n", median(accumulatedMs));
+    printf("speed-up:    %8.2fx\n", median(storedMs) / median(accumulatedMs));
+    printf("relative difference of the solutions: %g\n", difference);
+    return difference < 1e-3 ? 0 : 1;
+}
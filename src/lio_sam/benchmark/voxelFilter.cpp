@@ -0,0 +1,147 @@
+/*
+    * Benchmark of VoxelFilter against pcl::VoxelGrid, on a synthetic lidar scan.
+    * Both bucket points by floor(p / leafSize), so they must produce the same voxels with the same centroids,
+    * up to float rounding; only the order of the output points differs. The scan has a few non-finite points,
+    * which both must skip. The outputs are sorted by voxel and compared, and the benchmark fails if they differ.
+    *
+    * usage: lio_sam_benchVoxelFilter [numPoints] [leafSize] [numRepeats] [numThreads]
+    */
+#include "voxelFilter.hpp"
+
+#include <pcl/point_types.h>
+#include <pcl/filters/voxel_grid.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+#include <vector>
+
+typedef pcl::PointXYZI PointType;
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+// rings of a spinning lidar hitting a ground plane and walls, with range noise and a few NaN and
+// infinite returns
+static pcl::PointCloud<PointType>::Ptr makeScan(int numPoints)
+{
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> noise(-0.02, 0.02), wall(5, 60), intensity(0, 255);
+    pcl::PointCloud<PointType>::Ptr cloud(new pcl::PointCloud<PointType>());
+    const int numRings = 64;
+    int columns = std::max(numPoints / numRings, 1);
+    for (int ring = 0; ring < numRings; ++ring)
+    {
+        float elevation = (-25.0f + 40.0f * ring / (numRings - 1)) * M_PI / 180;
+        for (int column = 0; column < columns; ++column)
+        {
+            float azimuth = 2 * M_PI * column / columns;
+            float range = elevation < 0 ? std::min(1.8f / -std::sin(elevation), 80.0f) : wall(generator);
+            range += noise(generator);
+            PointType p;
+            p.x = range * std::cos(elevation) * std::cos(azimuth);
+            p.y = range * std::cos(elevation) * std::sin(azimuth);
+            p.z = range * std::sin(elevation);
+            p.intensity = intensity(generator);
+            if (column % 97 == 0)
+                p.x = p.y = p.z = NAN;
+            else if (column % 101 == 0)
+                p.z = INFINITY;
+            cloud->push_back(p);
+        }
+    }
+    cloud->is_dense = false;
+    return cloud;
+}
+
+static std::vector<std::tuple<int, int, int, const PointType*>> byVoxel(const pcl::PointCloud<PointType>& cloud, float leafSize)
+{
+    std::vector<std::tuple<int, int, int, const PointType*>> voxels;
+    for (const auto& p : cloud.points)
+    {
+        VoxelKey key = toVoxelKey(p.x, p.y, p.z, 1.0 / leafSize);
+        voxels.emplace_back(key.x, key.y, key.z, &p);
+    }
+    std::sort(voxels.begin(), voxels.end());
+    return voxels;
+}
+
+static bool sameVoxels(const pcl::PointCloud<PointType>& a, const pcl::PointCloud<PointType>& b, float leafSize)
+{
+    if (a.size() != b.size())
+    {
+        printf("different number of voxels: %zu and %zu\n", a.size(), b.size());
+        return false;
+    }
+
+    auto voxelsA = byVoxel(a, leafSize);
+    auto voxelsB = byVoxel(b, leafSize);
+    float maxDifference = 0;
+    for (size_t i = 0; i < voxelsA.size(); ++i)
+    {
+        const PointType& pa = *std::get<3>(voxelsA[i]);
+        const PointType& pb = *std::get<3>(voxelsB[i]);
+        maxDifference = std::max({maxDifference, std::fabs(pa.x - pb.x), std::fabs(pa.y - pb.y),
+                                  std::fabs(pa.z - pb.z), std::fabs(pa.intensity - pb.intensity) / 255});
+    }
+    printf("largest difference of the centroids: %g\n", maxDifference);
+    return maxDifference < 1e-3;
+}
+
+int main(int argc, char** argv)
+{
+    int numPoints = argc > 1 ? atoi(argv[1]) : 120000;
+    float leafSize = argc > 2 ? atof(argv[2]) : 0.4;
+    int numRepeats = argc > 3 ? atoi(argv[3]) : 50;
+    int numThreads = argc > 4 ? atoi(argv[4]) : 4;
+
+    pcl::PointCloud<PointType>::Ptr scan = makeScan(numPoints);
+
+    pcl::VoxelGrid<PointType> voxelGrid;
+    voxelGrid.setLeafSize(leafSize, leafSize, leafSize);
+    VoxelFilter<PointType> voxelFilter;
+    voxelFilter.setLeafSize(leafSize, leafSize, leafSize);
+
+    pcl::PointCloud<PointType> gridOutput, serialOutput, parallelOutput;
+    std::vector<double> gridMs, serialMs, parallelMs;
+    for (int repeat = 0; repeat < numRepeats; ++repeat)
+    {
+        auto start = std::chrono::steady_clock::now();
+        voxelGrid.setInputCloud(scan);
+        voxelGrid.filter(gridOutput);
+        gridMs.push_back(elapsedMs(start));
+
+        start = std::chrono::steady_clock::now();
+        voxelFilter.setNumThreads(1);
+        voxelFilter.setInputCloud(scan);
+        voxelFilter.filter(serialOutput);
+        serialMs.push_back(elapsedMs(start));
+
+        start = std::chrono::steady_clock::now();
+        voxelFilter.setNumThreads(numThreads);
+        voxelFilter.setInputCloud(scan);
+        voxelFilter.filter(parallelOutput);
+        parallelMs.push_back(elapsedMs(start));
+    }
+
+    printf("%zu points, leaf %.2f m, %zu voxels, median of %d runs\n", scan->size(), leafSize, gridOutput.size(), numRepeats);
+    printf("pcl::VoxelGrid:          %8.3f ms\n", median(gridMs));
+    printf("VoxelFilter, 1 thread:   %8.3f ms\n", median(serialMs));
+    printf("VoxelFilter, %d threads:  %8.3f ms\n", numThreads, median(parallelMs));
+
+    bool ok = sameVoxels(gridOutput, serialOutput, leafSize) && sameVoxels(serialOutput, parallelOutput, leafSize);
+    printf(ok ? "outputs match\n" : "outputs differ\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#ifndef _CLOUD_CHANNEL_LIDAR_ODOMETRY_H_
+#define _CLOUD_CHANNEL_LIDAR_ODOMETRY_H_
+
+#include <pcl/point_cloud.h>
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+/*
+    * Hands point clouds between nodes of the same process without serializing them into PointCloud2.
+    * A publisher puts a cloud under the name of the message field and the stamp of the message, for the given
+    * number of subscribers; each subscriber takes it back once, and the entry is dropped after the last one.
+    * Clouds are shared and must not be changed once put. Only the latest clouds are kept, so that a message
+    * dropped by a subscriber queue does not keep its cloud alive.
+    */
+template <typename PointT>
+class CloudChannel
+{
+public:
+
+    typedef typename pcl::PointCloud<PointT>::ConstPtr CloudConstPtr;
+
+    static CloudChannel& instance()
+    {
+        static CloudChannel channel;
+        return channel;
+    }
+
+    void put(const std::string& field, int64_t stamp, const CloudConstPtr& cloud, size_t numTakers)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        entries.push_back(Entry{field, stamp, cloud, numTakers});
+        while (entries.size() > MAX_ENTRIES)
+            entries.pop_front();
+    }
+
+    // returns nullptr if there is no such cloud, or if it was already taken by all its subscribers
+    CloudConstPtr take(const std::string& field, int64_t stamp)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+        {
+            if (it->stamp != stamp || it->field != field)
+                continue;
+
+            CloudConstPtr cloud = it->cloud;
+            if (--it->numTakers == 0)
+                entries.erase(it);
+            return cloud;
+        }
+        return nullptr;
+    }
+
+private:
+
+    static constexpr size_t MAX_ENTRIES = 32;
+
+    struct Entry
+    {
+        std::string field;
+        int64_t stamp;
+        CloudConstPtr cloud;
+        size_t numTakers;
+    };
+
+    std::mutex mtx;
+    std::deque<Entry> entries;
+};
+
+#endif
@@ -0,0 +1,280 @@
+#pragma once
+#ifndef _FEATURE_EXTRACTOR_LIDAR_ODOMETRY_H_
+#define _FEATURE_EXTRACTOR_LIDAR_ODOMETRY_H_
+
+#include "voxelFilter.hpp"
+
+#include <pcl/point_cloud.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+/*
+    * LOAM edge and surface extraction on the deskewed cloud of one scan, ordered ring by ring as in CloudInfo.
+    * Curvature and occlusion are computed in flat loops over the range array, which vectorise. Each ring is then
+    * processed by one thread into its own buffers, merged in ring order, so the result does not depend on the
+    * number of threads. The edges of a sub-region come from a heap of the candidates above edgeThreshold, since
+    * at most 20 are taken. The flat points below surfThreshold are not sorted either: see markFlatNeighbors.
+    * All the buffers are kept between scans.
+    */
+template <typename PointT>
+class FeatureExtractor
+{
+public:
+
+    FeatureExtractor()
+    : edgeThreshold(1.0), surfThreshold(0.1), numThreads(1)
+    {
+        setParams(16, 1.0, 0.1, 0.4, 1);
+    }
+
+    void setParams(int numRings, float edgeThresh, float surfThresh, float surfLeafSize, int threads)
+    {
+        edgeThreshold = edgeThresh;
+        surfThreshold = surfThresh;
+        numThreads = std::max(threads, 1);
+
+        ringCorner.resize(numRings);
+        ringSurface.resize(numRings);
+        ringSurfaceDS.resize(numRings);
+        ringCandidates.resize(numRings);
+        ringFilters.resize(numRings);
+        for (int i = 0; i < numRings; ++i)
+        {
+            ringCorner[i].reset(new pcl::PointCloud<PointT>());
+            ringSurface[i].reset(new pcl::PointCloud<PointT>());
+            ringSurfaceDS[i].reset(new pcl::PointCloud<PointT>());
+            ringFilters[i].setLeafSize(surfLeafSize, surfLeafSize, surfLeafSize);
+        }
+    }
+
+    // range and column hold one value per point, startRingIndex and endRingIndex one value per ring
+    void extract(const pcl::PointCloud<PointT>& cloud, const float* range, const int32_t* column,
+                 const int32_t* startRingIndex, const int32_t* endRingIndex,
+                 pcl::PointCloud<PointT>& cornerCloud, pcl::PointCloud<PointT>& surfaceCloud)
+    {
+        int cloudSize = cloud.size();
+        if ((int)curvature.size() < cloudSize)
+        {
+            curvature.resize(cloudSize);
+            neighborPicked.resize(cloudSize);
+            label.resize(cloudSize);
+            flatState.resize(cloudSize);
+        }
+        std::fill(curvature.begin(), curvature.begin() + cloudSize, 0.0f);
+        std::fill(neighborPicked.begin(), neighborPicked.begin() + cloudSize, 0);
+        std::fill(label.begin(), label.begin() + cloudSize, 0);
+        std::fill(flatState.begin(), flatState.begin() + cloudSize, FLAT_UNKNOWN);
+
+        calculateSmoothness(range, cloudSize);
+        markOccludedPoints(range, column, cloudSize);
+
+        int numRings = ringCorner.size();
+        #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+        for (int i = 0; i < numRings; ++i)
+            extractRing(i, cloud, column, startRingIndex[i], endRingIndex[i]);
+
+        cornerCloud.clear();
+        surfaceCloud.clear();
+        for (int i = 0; i < numRings; ++i)
+        {
+            cornerCloud += *ringCorner[i];
+            surfaceCloud += *ringSurfaceDS[i];
+        }
+    }
+
+private:
+
+    void calculateSmoothness(const float* range, int cloudSize)
+    {
+        float* curv = curvature.data();
+        #pragma omp simd
+        for (int i = 5; i < cloudSize - 5; i++)
+        {
+            float diffRange = range[i-5] + range[i-4] + range[i-3] + range[i-2] + range[i-1]
+                            - range[i] * 10
+                            + range[i+1] + range[i+2] + range[i+3] + range[i+4] + range[i+5];
+            curv[i] = diffRange * diffRange;
+        }
+    }
+
+    void markOccludedPoints(const float* range, const int32_t* column, int cloudSize)
+    {
+        uint8_t* picked = neighborPicked.data();
+
+        // occluded points, rare enough for a scalar loop
+        for (int i = 5; i < cloudSize - 6; ++i)
+        {
+            if (std::abs(column[i+1] - column[i]) >= 10)
+                continue;
+            // 10 pixel diff in range image
+            if (range[i] - range[i+1] > 0.3)
+                std::fill(picked + i - 5, picked + i + 1, 1);
+            else if (range[i+1] - range[i] > 0.3)
+                std::fill(picked + i + 1, picked + i + 7, 1);
+        }
+
+        // parallel beam
+        #pragma omp simd
+        for (int i = 5; i < cloudSize - 6; ++i)
+        {
+            float diff1 = std::abs(range[i-1] - range[i]);
+            float diff2 = std::abs(range[i+1] - range[i]);
+            picked[i] |= (diff1 > 0.02f * range[i] && diff2 > 0.02f * range[i]);
+        }
+    }
+
+    // the neighbours outside [startInd, endInd] are never read by this ring, and belong to the next or previous one
+    void markNeighbors(int ind, const int32_t* column, int startInd, int endInd)
+    {
+        neighborPicked[ind] = 1;
+        for (int l = 1; l <= 5; l++)
+        {
+            if (ind + l > endInd || std::abs(column[ind + l] - column[ind + l - 1]) > 10)
+                break;
+            neighborPicked[ind + l] = 1;
+        }
+        for (int l = -1; l >= -5; l--)
+        {
+            if (ind + l < startInd || std::abs(column[ind + l] - column[ind + l + 1]) > 10)
+                break;
+            neighborPicked[ind + l] = 1;
+        }
+    }
+
+    // whether the points of columns a and b, at most 5 apart, are marked as each other's neighbours
+    static bool sameSurface(int a, int b, const int32_t* column)
+    {
+        if (a > b)
+            std::swap(a, b);
+        for (int k = a; k < b; k++)
+        {
+            if (std::abs(column[k + 1] - column[k]) > 10)
+                return false;
+        }
+        return true;
+    }
+
+    // LOAM labels the flat points of a sub-region by increasing curvature, a flat point being skipped once a
+    // labelled one marked it as its neighbour. Whether a point is labelled only depends on the flat points of lower
+    // curvature within 5 points, so it is resolved for the points that matter, instead of sorting the sub-region
+    bool isFlatLabelled(int ind, int sp, int ep, const int32_t* column)
+    {
+        if (flatState[ind] != FLAT_UNKNOWN)
+            return flatState[ind] == FLAT_LABELLED;
+
+        bool labelled = neighborPicked[ind] == 0 && curvature[ind] < surfThreshold;
+        for (int k = std::max(ind - 5, sp); labelled && k <= std::min(ind + 5, ep); k++)
+        {
+            bool before = curvature[k] < curvature[ind] || (curvature[k] == curvature[ind] && k < ind);
+            if (before && sameSurface(k, ind, column) && isFlatLabelled(k, sp, ep, column))
+                labelled = false;
+        }
+        flatState[ind] = labelled ? FLAT_LABELLED : FLAT_SKIPPED;
+        return labelled;
+    }
+
+    // the neighbours marked by the flat points of [sp, ep] are only read again past ep, by the edges of the next
+    // sub-region, up to endInd
+    void markFlatNeighbors(int sp, int ep, int endInd, const int32_t* column)
+    {
+        for (int ind = std::max(ep - 4, sp); ind <= ep; ind++)
+        {
+            if (!isFlatLabelled(ind, sp, ep, column))
+                continue;
+            for (int l = 1; l <= 5; l++)
+            {
+                if (ind + l > endInd || std::abs(column[ind + l] - column[ind + l - 1]) > 10)
+                    break;
+                if (ind + l > ep)
+                    neighborPicked[ind + l] = 1;
+            }
+        }
+    }
+
+    // neighborPicked is only read and written within [startInd, endInd], which the rings do not share, so the rings
+    // can run concurrently. The points of a ring outside it, 5 at either end, are never picked
+    void extractRing(int ring, const pcl::PointCloud<PointT>& cloud, const int32_t* column, int startInd, int endInd)
+    {
+        pcl::PointCloud<PointT>& corner = *ringCorner[ring];
+        pcl::PointCloud<PointT>& surface = *ringSurface[ring];
+        std::vector<int>& candidates = ringCandidates[ring];
+        corner.clear();
+        surface.clear();
+        ringSurfaceDS[ring]->clear();
+
+        auto byCurvature = [this](int a, int b){ return curvature[a] < curvature[b]; };
+
+        for (int j = 0; j < 6; j++)
+        {
+            int sp = (startInd * (6 - j) + endInd * j) / 6;
+            int ep = (startInd * (5 - j) + endInd * (j + 1)) / 6 - 1;
+
+            if (sp >= ep)
+                continue;
+
+            // edges, largest curvature first
+            candidates.clear();
+            for (int k = sp; k <= ep; k++)
+            {
+                if (curvature[k] > edgeThreshold)
+                    candidates.push_back(k);
+            }
+            std::make_heap(candidates.begin(), candidates.end(), byCurvature);
+
+            int largestPickedNum = 0;
+            while (!candidates.empty() && largestPickedNum < 20)
+            {
+                std::pop_heap(candidates.begin(), candidates.end(), byCurvature);
+                int ind = candidates.back();
+                candidates.pop_back();
+                if (neighborPicked[ind] != 0)
+                    continue;
+
+                largestPickedNum++;
+                label[ind] = 1;
+                corner.push_back(cloud.points[ind]);
+                markNeighbors(ind, column, startInd, endInd);
+            }
+
+            // the neighbours of flat points keep the edges of the next sub-region away from them
+            markFlatNeighbors(sp, ep, endInd, column);
+
+            // everything that is not an edge is kept as surface, then downsampled
+            for (int k = sp; k <= ep; k++)
+            {
+                if (label[k] <= 0)
+                    surface.push_back(cloud.points[k]);
+            }
+        }
+
+        if (surface.empty())
+            return;
+        ringFilters[ring].setInputCloud(ringSurface[ring]);
+        ringFilters[ring].filter(*ringSurfaceDS[ring]);
+    }
+
+    float edgeThreshold;
+    float surfThreshold;
+    int numThreads;
+
+    std::vector<float> curvature;
+    std::vector<uint8_t> neighborPicked;
+    std::vector<int8_t> label;
+    std::vector<int8_t> flatState;
+
+    static constexpr int8_t FLAT_UNKNOWN = 0;
+    static constexpr int8_t FLAT_LABELLED = 1;
+    static constexpr int8_t FLAT_SKIPPED = 2;
+
+    std::vector<typename pcl::PointCloud<PointT>::Ptr> ringCorner;
+    std::vector<typename pcl::PointCloud<PointT>::Ptr> ringSurface;
+    std::vector<typename pcl::PointCloud<PointT>::Ptr> ringSurfaceDS;
+    std::vector<std::vector<int>> ringCandidates;
+    std::vector<VoxelFilter<PointT>> ringFilters;
+};
+
+#endif
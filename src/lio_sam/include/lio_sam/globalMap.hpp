@@ -0,0 +1,260 @@
+#pragma once
+#ifndef _GLOBAL_MAP_LIDAR_ODOMETRY_H_
+#define _GLOBAL_MAP_LIDAR_ODOMETRY_H_
+
+#include "voxelMap.hpp"
+
+#include <pcl/point_cloud.h>
+
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+
+#include <cmath>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+/*
+    * Downsampled global map for visualization, kept in tiles of tileSize x tileSize meters and updated
+    * incrementally. A key frame is visualized if it is the first one in its cell of poseDensity, like the key
+    * pose downsampling it replaces, and its points are merged once into the tiles they fall in, one centroid per
+    * leaf of leafSize. When the key poses are corrected, only the key frames that moved by more than half a leaf
+    * (or 0.01 rad) are moved, and only the tiles they touch are rebuilt.
+    */
+template <typename PointT>
+class GlobalMapCache
+{
+public:
+
+    typedef std::vector<Eigen::Affine3f, Eigen::aligned_allocator<Eigen::Affine3f>> PoseVector;
+
+    GlobalMapCache()
+    {
+        setParams(50.0, 10.0, 1.0);
+    }
+
+    void setParams(float tileSize, float poseDensity, float leafSize)
+    {
+        invTileSize = 1.0 / tileSize;
+        invPoseDensity = 1.0 / poseDensity;
+        invLeafSize = 1.0 / leafSize;
+        moveTolerance = leafSize * 0.5;
+        clear();
+    }
+
+    void clear()
+    {
+        keyFrames.clear();
+        tiles.clear();
+        poseCells.clear();
+    }
+
+    /*
+        * poses holds the pose of every key frame, in order. With posesCorrected, all of them are compared to the
+        * pose each key frame was inserted with, otherwise only the new ones are read. cloud(i, cloud) fills the
+        * points of key frame i in its body frame. Returns the number of tiles changed.
+        */
+    template <typename CloudFunction>
+    int update(const PoseVector& poses, bool posesCorrected, CloudFunction getCloud)
+    {
+        std::map<int, bool> toInsert; // key frame, true to add it, false to rebuild some of its tiles
+        int numOld = keyFrames.size();
+
+        if (posesCorrected)
+        {
+            // the visualized key frames are chosen again on the corrected poses
+            poseCells.clear();
+            for (int i = 0; i < numOld; ++i)
+            {
+                KeyFrame& keyFrame = keyFrames[i];
+                bool moved = hasMoved(keyFrame.pose, poses[i]);
+                bool visualized = poseCells.emplace(poseCell(poses[i]), i).second;
+                if (keyFrame.visualized && (moved || !visualized))
+                    remove(i);
+                if (moved)
+                    keyFrame.pose = poses[i];
+                if (visualized && (moved || !keyFrame.visualized))
+                    toInsert[i] = true;
+                keyFrame.visualized = visualized;
+            }
+        }
+
+        for (int i = numOld; i < (int)poses.size(); ++i)
+        {
+            KeyFrame keyFrame;
+            keyFrame.pose = poses[i];
+            keyFrame.visualized = poseCells.emplace(poseCell(poses[i]), i).second;
+            keyFrames.push_back(keyFrame);
+            if (keyFrame.visualized)
+                toInsert[i] = true;
+        }
+
+        // tiles that lost a key frame are rebuilt from the others, each of them transformed once
+        for (auto& it : tiles)
+        {
+            if (it.second.rebuild)
+            {
+                it.second.leaves.clear();
+                for (int keyInd : it.second.keyFrames)
+                    toInsert.emplace(keyInd, false);
+            }
+        }
+
+        pcl::PointCloud<PointT> cloud;
+        for (const auto& it : toInsert)
+        {
+            KeyFrame& keyFrame = keyFrames[it.first];
+            getCloud(it.first, cloud);
+            for (const auto& p : cloud.points)
+            {
+                Eigen::Vector3f point = keyFrame.pose * p.getVector3fMap();
+                VoxelKey tileKey = toTileKey(point);
+                auto tile = tiles.find(tileKey);
+                if (it.second)
+                {
+                    if (tile == tiles.end())
+                        tile = tiles.emplace(tileKey, Tile()).first;
+                    if (tile->second.keyFrames.insert(it.first).second)
+                        keyFrame.tiles.push_back(tileKey);
+                }
+                else if (tile == tiles.end() || tile->second.rebuild == false)
+                {
+                    continue;
+                }
+
+                Leaf& leaf = tile->second.leaves[toVoxelKey(point.x(), point.y(), point.z(), invLeafSize)];
+                leaf.x += point.x();
+                leaf.y += point.y();
+                leaf.z += point.z();
+                leaf.intensity += p.intensity;
+                leaf.num++;
+                tile->second.changed = true;
+            }
+        }
+
+        int numChanged = 0;
+        for (auto it = tiles.begin(); it != tiles.end(); )
+        {
+            Tile& tile = it->second;
+            if (tile.rebuild || tile.changed)
+            {
+                tile.rebuild = false;
+                tile.changed = false;
+                numChanged++;
+                if (tile.keyFrames.empty())
+                {
+                    it = tiles.erase(it);
+                    continue;
+                }
+                makeCloud(tile);
+            }
+            ++it;
+        }
+        return numChanged;
+    }
+
+    // concatenates the tiles that intersect the ball of radius around center
+    void getCloud(const Eigen::Vector3f& center, float radius, pcl::PointCloud<PointT>& cloud) const
+    {
+        cloud.clear();
+        float tileSize = 1.0 / invTileSize;
+        for (const auto& it : tiles)
+        {
+            float dx = std::max(std::fabs(center.x() - (it.first.x + 0.5f) * tileSize) - tileSize * 0.5f, 0.0f);
+            float dy = std::max(std::fabs(center.y() - (it.first.y + 0.5f) * tileSize) - tileSize * 0.5f, 0.0f);
+            if (dx * dx + dy * dy <= radius * radius)
+                cloud += it.second.cloud;
+        }
+    }
+
+    int numTiles() const
+    {
+        return tiles.size();
+    }
+
+private:
+
+    struct Leaf
+    {
+        float x = 0, y = 0, z = 0, intensity = 0;
+        int num = 0;
+    };
+
+    struct Tile
+    {
+        std::set<int> keyFrames;
+        std::unordered_map<VoxelKey, Leaf, VoxelKeyHash> leaves;
+        pcl::PointCloud<PointT> cloud;
+        bool rebuild = false; // lost a key frame, the leaves are computed again
+        bool changed = false;
+    };
+
+    struct KeyFrame
+    {
+        Eigen::Affine3f pose;
+        bool visualized = false;
+        std::vector<VoxelKey> tiles;
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+    bool hasMoved(const Eigen::Affine3f& from, const Eigen::Affine3f& to) const
+    {
+        if ((from.translation() - to.translation()).norm() > moveTolerance)
+            return true;
+        return Eigen::AngleAxisf(from.linear().transpose() * to.linear()).angle() > 0.01;
+    }
+
+    VoxelKey poseCell(const Eigen::Affine3f& pose) const
+    {
+        return toVoxelKey(pose.translation().x(), pose.translation().y(), pose.translation().z(), invPoseDensity);
+    }
+
+    VoxelKey toTileKey(const Eigen::Vector3f& point) const
+    {
+        VoxelKey key;
+        key.x = (int)std::floor(point.x() * invTileSize);
+        key.y = (int)std::floor(point.y() * invTileSize);
+        key.z = 0;
+        return key;
+    }
+
+    void remove(int keyInd)
+    {
+        KeyFrame& keyFrame = keyFrames[keyInd];
+        for (const auto& tileKey : keyFrame.tiles)
+        {
+            Tile& tile = tiles[tileKey];
+            tile.keyFrames.erase(keyInd);
+            tile.rebuild = true;
+        }
+        keyFrame.tiles.clear();
+    }
+
+    static void makeCloud(Tile& tile)
+    {
+        tile.cloud.clear();
+        tile.cloud.reserve(tile.leaves.size());
+        for (const auto& it : tile.leaves)
+        {
+            const Leaf& leaf = it.second;
+            float inv = 1.0f / leaf.num;
+            PointT p;
+            p.x = leaf.x * inv;
+            p.y = leaf.y * inv;
+            p.z = leaf.z * inv;
+            p.intensity = leaf.intensity * inv;
+            tile.cloud.push_back(p);
+        }
+    }
+
+    float invTileSize;
+    float invPoseDensity;
+    float invLeafSize;
+    float moveTolerance;
+    std::vector<KeyFrame, Eigen::aligned_allocator<KeyFrame>> keyFrames;
+    std::unordered_map<VoxelKey, Tile, VoxelKeyHash> tiles;
+    std::unordered_map<VoxelKey, int, VoxelKeyHash> poseCells; // visualized key frame of each cell of poseDensity
+};
+
+#endif
@@ -0,0 +1,395 @@
+#pragma once
+#ifndef _KEY_FRAME_STORE_LIDAR_ODOMETRY_H_
+#define _KEY_FRAME_STORE_LIDAR_ODOMETRY_H_
+
+#include <pcl/point_cloud.h>
+#include <rclcpp/rclcpp.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+    * LRU cache of key frame clouds transformed into the map frame, bounded by the number of key frames.
+    * The least recently used key frame is dropped when full, instead of clearing the whole cache.
+    */
+template <typename PointT>
+class TransformedCloudCache
+{
+public:
+
+    typedef std::pair<pcl::PointCloud<PointT>, pcl::PointCloud<PointT>> CloudPair;
+
+    explicit TransformedCloudCache(size_t capacity = 1000)
+    : capacity(capacity)
+    {
+    }
+
+    void setCapacity(size_t newCapacity)
+    {
+        capacity = std::max<size_t>(newCapacity, 1);
+        shrink();
+    }
+
+    size_t size() const
+    {
+        return index.size();
+    }
+
+    void clear()
+    {
+        entries.clear();
+        index.clear();
+    }
+
+    // returns nullptr if not cached. The pointer is valid until the next insert() or clear()
+    const CloudPair* find(int keyInd)
+    {
+        auto it = index.find(keyInd);
+        if (it == index.end())
+            return nullptr;
+
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->second;
+    }
+
+    const CloudPair* insert(int keyInd, CloudPair&& clouds)
+    {
+        auto it = index.find(keyInd);
+        if (it != index.end())
+        {
+            it->second->second = std::move(clouds);
+            entries.splice(entries.begin(), entries, it->second);
+        }
+        else
+        {
+            entries.emplace_front(keyInd, std::move(clouds));
+            index[keyInd] = entries.begin();
+            shrink();
+        }
+        return &entries.front().second;
+    }
+
+private:
+
+    void shrink()
+    {
+        while (index.size() > capacity)
+        {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+
+    size_t capacity;
+    std::list<std::pair<int, CloudPair>> entries; // most recently used first
+    std::unordered_map<int, typename std::list<std::pair<int, CloudPair>>::iterator> index;
+};
+
+/*
+    * Storage of the corner and surf clouds of all key frames, in the body frame.
+    * At most maxResident key frames are kept in memory; the least recently used ones are spilled to
+    * one file each under spillDirectory and memory-mapped back on access. Key frame clouds never change
+    * once added, so a key frame is written at most once. prefetch() loads spilled key frames
+    * in a background thread, ahead of the access. maxResident <= 0 keeps everything in memory.
+    * Key frames added with addFromSource() are read by the source function on first access instead,
+    * e.g. from a resumed session, and are dropped rather than spilled.
+    * A spilled key frame which cannot be read back is reported, not replaced by empty clouds.
+    * All the methods are thread safe.
+    */
+template <typename PointT>
+class KeyFrameStore
+{
+public:
+
+    typedef typename pcl::PointCloud<PointT>::Ptr CloudPtr;
+    typedef std::function<bool(int keyInd, pcl::PointCloud<PointT>& corner, pcl::PointCloud<PointT>& surf)> Source;
+
+    KeyFrameStore()
+    : maxResident(0), numResident(0), stopPrefetch(false)
+    {
+    }
+
+    ~KeyFrameStore()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopPrefetch = true;
+        }
+        prefetchCond.notify_all();
+        if (prefetchThread.joinable())
+            prefetchThread.join();
+    }
+
+    void setParams(int maxResidentFrames, const std::string& spillDirectory)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        maxResident = maxResidentFrames;
+        directory = spillDirectory;
+        if (maxResident > 0)
+        {
+            std::error_code error;
+            std::filesystem::create_directories(directory, error);
+            if (error)
+                RCLCPP_ERROR(rclcpp::get_logger("keyFrameStore"), "Failed to create the key frame spill directory %s: %s",
+                             directory.c_str(), error.message().c_str());
+            if (!prefetchThread.joinable())
+                prefetchThread = std::thread(&KeyFrameStore::prefetchLoop, this);
+        }
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return frames.size();
+    }
+
+    int add(const CloudPtr& corner, const CloudPtr& surf)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        frames.emplace_back();
+        Frame& frame = frames.back();
+        frame.corner = corner;
+        frame.surf = surf;
+        frame.spilled = false;
+        frame.fromSource = false;
+        makeResident((int)frames.size() - 1);
+        return (int)frames.size() - 1;
+    }
+
+    // the source must stay valid as long as the store, it may be called by the prefetch thread
+    void setSource(const Source& keyFrameSource)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        source = keyFrameSource;
+    }
+
+    // adds a key frame that is not in memory, to be read by the source
+    int addFromSource()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        frames.emplace_back();
+        Frame& frame = frames.back();
+        frame.spilled = false;
+        frame.fromSource = true;
+        return (int)frames.size() - 1;
+    }
+
+    // returns false, leaving the clouds unset, if the key frame was spilled and cannot be read back
+    bool get(int keyInd, CloudPtr& corner, CloudPtr& surf)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!load(keyInd))
+            return false;
+        corner = frames[keyInd].corner;
+        surf = frames[keyInd].surf;
+        return true;
+    }
+
+    // queue the key frames to be loaded in the background, if spilled
+    void prefetch(const std::vector<int>& keyInds)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (maxResident <= 0)
+                return;
+            for (int keyInd : keyInds)
+            {
+                if (keyInd >= 0 && keyInd < (int)frames.size() && !frames[keyInd].corner)
+                    prefetchQueue.push_back(keyInd);
+            }
+        }
+        prefetchCond.notify_one();
+    }
+
+private:
+
+    struct Frame
+    {
+        CloudPtr corner;
+        CloudPtr surf;
+        bool spilled;
+        bool fromSource;
+        std::list<int>::iterator lru;
+    };
+
+    std::string fileName(int keyInd) const
+    {
+        return directory + "/" + std::to_string(keyInd) + ".bin";
+    }
+
+    // called with mtx locked
+    void makeResident(int keyInd)
+    {
+        Frame& frame = frames[keyInd];
+        lruList.push_front(keyInd);
+        frame.lru = lruList.begin();
+        numResident++;
+
+        while (maxResident > 0 && numResident > maxResident)
+        {
+            int oldest = lruList.back();
+            if (!spill(oldest))
+                break;
+        }
+    }
+
+    // called with mtx locked
+    bool spill(int keyInd)
+    {
+        Frame& frame = frames[keyInd];
+        if (!frame.spilled && !frame.fromSource)
+        {
+            FILE* fp = fopen(fileName(keyInd).c_str(), "wb");
+            if (fp == NULL)
+                return false;
+
+            uint64_t num[2] = {frame.corner->size(), frame.surf->size()};
+            bool ok = fwrite(num, sizeof(num), 1, fp) == 1;
+            ok = ok && fwrite(frame.corner->points.data(), sizeof(PointT), num[0], fp) == num[0];
+            ok = ok && fwrite(frame.surf->points.data(), sizeof(PointT), num[1], fp) == num[1];
+            ok = (fclose(fp) == 0) && ok;
+            if (!ok)
+                return false;
+            frame.spilled = true;
+        }
+
+        frame.corner.reset();
+        frame.surf.reset();
+        lruList.erase(frame.lru);
+        numResident--;
+        return true;
+    }
+
+    // called with mtx locked
+    bool load(int keyInd)
+    {
+        Frame& frame = frames[keyInd];
+        if (frame.corner)
+        {
+            lruList.splice(lruList.begin(), lruList, frame.lru);
+            return true;
+        }
+
+        CloudPtr corner(new pcl::PointCloud<PointT>());
+        CloudPtr surf(new pcl::PointCloud<PointT>());
+        if (frame.fromSource)
+        {
+            if (!source || !source(keyInd, *corner, *surf))
+            {
+                RCLCPP_ERROR(rclcpp::get_logger("keyFrameStore"), "Failed to read key frame %d from its source", keyInd);
+                return false;
+            }
+        }
+        else if (!readSpilled(fileName(keyInd), *corner, *surf))
+        {
+            RCLCPP_ERROR(rclcpp::get_logger("keyFrameStore"), "Failed to read spilled key frame %d from %s",
+                         keyInd, fileName(keyInd).c_str());
+            return false;
+        }
+
+        frame.corner = corner;
+        frame.surf = surf;
+        makeResident(keyInd);
+        return true;
+    }
+
+    static bool readSpilled(const std::string& name, pcl::PointCloud<PointT>& corner, pcl::PointCloud<PointT>& surf)
+    {
+        int fd = open(name.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)(2 * sizeof(uint64_t)))
+        {
+            close(fd);
+            return false;
+        }
+
+        void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED)
+            return false;
+
+        const uint64_t* num = (const uint64_t*)addr;
+        bool ok = (size_t)st.st_size == 2 * sizeof(uint64_t) + (num[0] + num[1]) * sizeof(PointT);
+        if (ok)
+        {
+            const PointT* points = (const PointT*)(num + 2);
+            corner.points.assign(points, points + num[0]);
+            surf.points.assign(points + num[0], points + num[0] + num[1]);
+            corner.width = corner.points.size();
+            corner.height = 1;
+            surf.width = surf.points.size();
+            surf.height = 1;
+        }
+
+        munmap(addr, st.st_size);
+        return ok;
+    }
+
+    void prefetchLoop()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true)
+        {
+            prefetchCond.wait(lock, [this]{ return stopPrefetch || !prefetchQueue.empty(); });
+            if (stopPrefetch)
+                return;
+
+            int keyInd = prefetchQueue.front();
+            prefetchQueue.pop_front();
+            if (frames[keyInd].corner)
+                continue;
+
+            // read the file without holding the lock, so that the mapping thread is not blocked
+            std::string name = fileName(keyInd);
+            bool fromSource = frames[keyInd].fromSource;
+            Source frameSource = source;
+            lock.unlock();
+            CloudPtr corner(new pcl::PointCloud<PointT>());
+            CloudPtr surf(new pcl::PointCloud<PointT>());
+            bool ok = fromSource ? frameSource && frameSource(keyInd, *corner, *surf) : readSpilled(name, *corner, *surf);
+            lock.lock();
+
+            if (ok && !frames[keyInd].corner)
+            {
+                frames[keyInd].corner = corner;
+                frames[keyInd].surf = surf;
+                makeResident(keyInd);
+            }
+        }
+    }
+
+    mutable std::mutex mtx;
+    std::deque<Frame> frames; // deque, so that references stay valid on add()
+    std::list<int> lruList; // resident key frames, most recently used first
+    int maxResident;
+    int numResident;
+    std::string directory;
+    Source source;
+
+    std::thread prefetchThread;
+    std::condition_variable prefetchCond;
+    std::deque<int> prefetchQueue;
+    bool stopPrefetch;
+};
+
+#endif
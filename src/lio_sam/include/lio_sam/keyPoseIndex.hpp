@@ -0,0 +1,210 @@
+#pragma once
+#ifndef _KEY_POSE_INDEX_LIDAR_ODOMETRY_H_
+#define _KEY_POSE_INDEX_LIDAR_ODOMETRY_H_
+
+#include "voxelMap.hpp"
+
+#include <pcl/point_cloud.h>
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+    * Spatial index of the key poses, in a hash grid of cellSize, maintained as key poses are added and corrected,
+    * instead of a kd-tree rebuilt over all of them for each search. The point of key pose i has index i.
+    * Searches can run from several threads while the mapping thread adds or updates poses.
+    */
+template <typename PointT>
+class KeyPoseIndex
+{
+public:
+
+    KeyPoseIndex()
+    {
+        setParams(10.0);
+    }
+
+    void setParams(float cellSize)
+    {
+        std::unique_lock<std::shared_timed_mutex> lock(mtx);
+        invCellSize = 1.0 / cellSize;
+        cells.clear();
+        points.clear();
+    }
+
+    void clear()
+    {
+        std::unique_lock<std::shared_timed_mutex> lock(mtx);
+        cells.clear();
+        points.clear();
+    }
+
+    int size() const
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(mtx);
+        return points.size();
+    }
+
+    void add(const PointT& point)
+    {
+        std::unique_lock<std::shared_timed_mutex> lock(mtx);
+        cells[cellOf(point)].push_back(points.size());
+        points.push_back(point);
+    }
+
+    // bulk update after a pose correction, poses[i] is the new pose of key pose i. Key poses past the end of
+    // the index are added. Only the ones which changed cell are moved
+    void update(const pcl::PointCloud<PointT>& poses)
+    {
+        std::unique_lock<std::shared_timed_mutex> lock(mtx);
+        for (int i = 0; i < (int)poses.size(); ++i)
+        {
+            if (i == (int)points.size())
+            {
+                cells[cellOf(poses.points[i])].push_back(i);
+                points.push_back(poses.points[i]);
+                continue;
+            }
+
+            VoxelKey from = cellOf(points[i]);
+            VoxelKey to = cellOf(poses.points[i]);
+            points[i] = poses.points[i];
+            if (from == to)
+                continue;
+
+            std::vector<int>& fromCell = cells[from];
+            fromCell.erase(std::find(fromCell.begin(), fromCell.end(), i));
+            if (fromCell.empty())
+                cells.erase(from);
+            cells[to].push_back(i);
+        }
+    }
+
+    // same contract as KdTreeFLANN::radiusSearch, neighbours sorted by distance
+    int radiusSearch(const PointT& point, float radius, std::vector<int>& indices, std::vector<float>& sqDistances) const
+    {
+        std::vector<std::pair<float, int>> found;
+        {
+            std::shared_lock<std::shared_timed_mutex> lock(mtx);
+            int r = (int)std::ceil(radius * invCellSize);
+            float sqRadius = radius * radius;
+            VoxelKey c = cellOf(point);
+            VoxelKey key;
+            for (key.x = c.x - r; key.x <= c.x + r; ++key.x)
+            for (key.y = c.y - r; key.y <= c.y + r; ++key.y)
+            for (key.z = c.z - r; key.z <= c.z + r; ++key.z)
+            {
+                auto it = cells.find(key);
+                if (it == cells.end())
+                    continue;
+                for (int i : it->second)
+                {
+                    float d = sqDistance(points[i], point);
+                    if (d <= sqRadius)
+                        found.emplace_back(d, i);
+                }
+            }
+        }
+
+        std::sort(found.begin(), found.end());
+        return copyResult(found, indices, sqDistances);
+    }
+
+    // same contract as KdTreeFLANN::nearestKSearch. The cells are searched in growing shells around the query,
+    // until the k-th neighbour is closer than the next shell
+    int nearestKSearch(const PointT& point, int k, std::vector<int>& indices, std::vector<float>& sqDistances) const
+    {
+        std::vector<std::pair<float, int>> found;
+        {
+            std::shared_lock<std::shared_timed_mutex> lock(mtx);
+            k = std::min(k, (int)points.size());
+            if (k <= 0)
+                return copyResult(found, indices, sqDistances);
+
+            // beyond maxShell, a linear scan of the cells is cheaper than the shells
+            VoxelKey c = cellOf(point);
+            int maxShell = (int)std::cbrt((double)cells.size()) + 1;
+            for (int shell = 0; ; ++shell)
+            {
+                if (shell > maxShell)
+                {
+                    found.clear();
+                    for (int i = 0; i < (int)points.size(); ++i)
+                        found.emplace_back(sqDistance(points[i], point), i);
+                    std::partial_sort(found.begin(), found.begin() + k, found.end());
+                    found.resize(k);
+                    break;
+                }
+
+                searchShell(c, shell, point, found);
+                if ((int)found.size() < k)
+                    continue;
+
+                // points out of this shell are at least shell cells away
+                std::partial_sort(found.begin(), found.begin() + k, found.end());
+                float shellDistance = shell / invCellSize;
+                if (found[k-1].first <= shellDistance * shellDistance)
+                {
+                    found.resize(k);
+                    break;
+                }
+            }
+        }
+
+        return copyResult(found, indices, sqDistances);
+    }
+
+private:
+
+    VoxelKey cellOf(const PointT& point) const
+    {
+        return toVoxelKey(point.x, point.y, point.z, invCellSize);
+    }
+
+    static float sqDistance(const PointT& p1, const PointT& p2)
+    {
+        return (p1.x-p2.x)*(p1.x-p2.x) + (p1.y-p2.y)*(p1.y-p2.y) + (p1.z-p2.z)*(p1.z-p2.z);
+    }
+
+    // the cells at Chebyshev distance shell from c
+    void searchShell(const VoxelKey& c, int shell, const PointT& point, std::vector<std::pair<float, int>>& found) const
+    {
+        VoxelKey key;
+        for (key.x = c.x - shell; key.x <= c.x + shell; ++key.x)
+        for (key.y = c.y - shell; key.y <= c.y + shell; ++key.y)
+        for (key.z = c.z - shell; key.z <= c.z + shell; ++key.z)
+        {
+            if (std::abs(key.x - c.x) != shell && std::abs(key.y - c.y) != shell && std::abs(key.z - c.z) != shell)
+                continue;
+            auto it = cells.find(key);
+            if (it == cells.end())
+                continue;
+            for (int i : it->second)
+                found.emplace_back(sqDistance(points[i], point), i);
+        }
+    }
+
+    static int copyResult(const std::vector<std::pair<float, int>>& found, std::vector<int>& indices, std::vector<float>& sqDistances)
+    {
+        indices.resize(found.size());
+        sqDistances.resize(found.size());
+        for (size_t i = 0; i < found.size(); ++i)
+        {
+            sqDistances[i] = found[i].first;
+            indices[i] = found[i].second;
+        }
+        return found.size();
+    }
+
+    mutable std::shared_timed_mutex mtx;
+    float invCellSize;
+    std::vector<PointT> points;
+    std::unordered_map<VoxelKey, std::vector<int>, VoxelKeyHash> cells;
+};
+
+#endif
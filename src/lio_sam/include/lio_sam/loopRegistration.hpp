@@ -0,0 +1,214 @@
+#pragma once
+#ifndef _LOOP_REGISTRATION_LIDAR_ODOMETRY_H_
+#define _LOOP_REGISTRATION_LIDAR_ODOMETRY_H_
+
+#include <pcl/point_cloud.h>
+#include <pcl/kdtree/kdtree_flann.h>
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+struct PointToPlaneNormalEquation
+{
+    Eigen::Matrix<double, 6, 6> JtJ = Eigen::Matrix<double, 6, 6>::Zero();
+    Eigen::Matrix<double, 6, 1> Jtr = Eigen::Matrix<double, 6, 1>::Zero();
+    int num = 0;
+
+    PointToPlaneNormalEquation& operator+=(const PointToPlaneNormalEquation& other)
+    {
+        JtJ += other.JtJ;
+        Jtr += other.Jtr;
+        num += other.num;
+        return *this;
+    }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+#pragma omp declare reduction(+ : PointToPlaneNormalEquation : omp_out += omp_in) initializer(omp_priv = PointToPlaneNormalEquation())
+
+/*
+    * Point-to-plane ICP for loop closure verification. A target is prepared once, with its kd-tree and the plane of
+    * each point fitted on its 5 nearest neighbours, and can be shared by several alignments running in parallel.
+    * The fitness score is the same as pcl::IterativeClosestPoint::getFitnessScore: the mean squared distance of the
+    * aligned source points to their nearest target point.
+    */
+template <typename PointT>
+class PointToPlaneICP
+{
+public:
+
+    struct Target
+    {
+        typename pcl::PointCloud<PointT>::Ptr cloud;
+        pcl::KdTreeFLANN<PointT> kdtree;
+        std::vector<Eigen::Vector4f, Eigen::aligned_allocator<Eigen::Vector4f>> planes; // normal and offset, zero if no plane
+    };
+    typedef std::shared_ptr<const Target> TargetPtr;
+
+    struct Result
+    {
+        bool converged = false;
+        float fitness = std::numeric_limits<float>::max();
+        Eigen::Affine3f transform = Eigen::Affine3f::Identity();
+    };
+
+    PointToPlaneICP()
+    : maxCorrespondenceDistance(1.0), maxIterations(30), transformationEpsilon(1e-6)
+    {
+    }
+
+    void setMaxCorrespondenceDistance(float distance)
+    {
+        maxCorrespondenceDistance = distance;
+    }
+
+    void setMaximumIterations(int iterations)
+    {
+        maxIterations = iterations;
+    }
+
+    void setTransformationEpsilon(double epsilon)
+    {
+        transformationEpsilon = epsilon;
+    }
+
+    static TargetPtr makeTarget(const typename pcl::PointCloud<PointT>::Ptr& cloud, int numThreads)
+    {
+        std::shared_ptr<Target> target(new Target());
+        target->cloud = cloud;
+        target->kdtree.setInputCloud(cloud);
+        target->planes.resize(cloud->size());
+
+        int cloudSize = cloud->size();
+        #pragma omp parallel for num_threads(numThreads)
+        for (int i = 0; i < cloudSize; ++i)
+        {
+            std::vector<int> pointSearchInd;
+            std::vector<float> pointSearchSqDis;
+            target->planes[i].setZero();
+            if (target->kdtree.nearestKSearch(cloud->points[i], 5, pointSearchInd, pointSearchSqDis) < 5)
+                continue;
+
+            Eigen::Matrix<float, 5, 3> matA0;
+            Eigen::Matrix<float, 5, 1> matB0 = Eigen::Matrix<float, 5, 1>::Constant(-1);
+            for (int j = 0; j < 5; j++)
+                matA0.row(j) = cloud->points[pointSearchInd[j]].getVector3fMap().transpose();
+
+            Eigen::Vector3f normal = matA0.colPivHouseholderQr().solve(matB0);
+            float norm = normal.norm();
+            if (!std::isfinite(norm) || norm == 0)
+                continue;
+            Eigen::Vector4f plane(normal(0) / norm, normal(1) / norm, normal(2) / norm, 1 / norm);
+
+            bool planeValid = true;
+            for (int j = 0; j < 5; j++)
+            {
+                if (std::fabs(plane.head<3>().dot(matA0.row(j).transpose()) + plane(3)) > 0.2)
+                {
+                    planeValid = false;
+                    break;
+                }
+            }
+            if (planeValid)
+                target->planes[i] = plane;
+        }
+        return target;
+    }
+
+    Result align(const pcl::PointCloud<PointT>& source, const TargetPtr& target, const Eigen::Affine3f& guess, int numThreads) const
+    {
+        Result result;
+        Eigen::Affine3d transform = guess.cast<double>();
+        int sourceSize = source.size();
+        float maxSqDistance = maxCorrespondenceDistance * maxCorrespondenceDistance;
+
+        for (int iter = 0; iter < maxIterations; ++iter)
+        {
+            PointToPlaneNormalEquation equation;
+            #pragma omp parallel for num_threads(numThreads) reduction(+ : equation)
+            for (int i = 0; i < sourceSize; ++i)
+            {
+                std::vector<int> pointSearchInd(1);
+                std::vector<float> pointSearchSqDis(1);
+                Eigen::Vector3d p = transform * source.points[i].getVector3fMap().template cast<double>();
+                PointT query;
+                query.x = p(0);
+                query.y = p(1);
+                query.z = p(2);
+                if (target->kdtree.nearestKSearch(query, 1, pointSearchInd, pointSearchSqDis) < 1 ||
+                    pointSearchSqDis[0] > maxSqDistance)
+                    continue;
+
+                const Eigen::Vector4f& plane = target->planes[pointSearchInd[0]];
+                if (plane.head<3>().isZero())
+                    continue;
+
+                // residual of the point to the plane, for a rotation and translation applied after the transform
+                Eigen::Vector3d normal = plane.head<3>().cast<double>();
+                double residual = normal.dot(p) + plane(3);
+                Eigen::Matrix<double, 6, 1> J;
+                J.head<3>() = p.cross(normal);
+                J.tail<3>() = normal;
+                equation.JtJ += J * J.transpose();
+                equation.Jtr += J * residual;
+                equation.num++;
+            }
+
+            if (equation.num < 6)
+                return result;
+
+            Eigen::Matrix<double, 6, 1> delta = equation.JtJ.ldlt().solve(-equation.Jtr);
+            if (!delta.allFinite())
+                return result;
+
+            Eigen::Affine3d update = Eigen::Affine3d::Identity();
+            double angle = delta.head<3>().norm();
+            if (angle > 0)
+                update.linear() = Eigen::AngleAxisd(angle, delta.head<3>() / angle).toRotationMatrix();
+            update.translation() = delta.tail<3>();
+            transform = update * transform;
+
+            if (delta.squaredNorm() < transformationEpsilon)
+                break;
+        }
+
+        result.converged = true;
+        result.transform = transform.cast<float>();
+        result.fitness = fitnessScore(source, *target, result.transform, numThreads);
+        return result;
+    }
+
+private:
+
+    static float fitnessScore(const pcl::PointCloud<PointT>& source, const Target& target, const Eigen::Affine3f& transform, int numThreads)
+    {
+        int sourceSize = source.size();
+        double sumSqDistance = 0;
+        int num = 0;
+        #pragma omp parallel for num_threads(numThreads) reduction(+ : sumSqDistance, num)
+        for (int i = 0; i < sourceSize; ++i)
+        {
+            std::vector<int> pointSearchInd(1);
+            std::vector<float> pointSearchSqDis(1);
+            PointT query = source.points[i];
+            query.getVector3fMap() = transform * source.points[i].getVector3fMap();
+            if (target.kdtree.nearestKSearch(query, 1, pointSearchInd, pointSearchSqDis) < 1)
+                continue;
+            sumSqDistance += pointSearchSqDis[0];
+            num++;
+        }
+        return num > 0 ? sumSqDistance / num : std::numeric_limits<float>::max();
+    }
+
+    float maxCorrespondenceDistance;
+    int maxIterations;
+    double transformationEpsilon;
+};
+
+#endif
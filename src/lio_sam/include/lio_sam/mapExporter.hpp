@@ -0,0 +1,344 @@
+#pragma once
+#ifndef _MAP_EXPORTER_LIDAR_ODOMETRY_H_
+#define _MAP_EXPORTER_LIDAR_ODOMETRY_H_
+
+#include "voxelMap.hpp"
+
+#include <pcl/point_cloud.h>
+#include <pcl/common/io.h>
+#include <pcl/io/pcd_io.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+    * Streams map frame clouds into spatial tiles, and writes each tile as a binary pcd file.
+    * With resolution > 0, points are averaged per voxel, like pcl::VoxelGrid does. Only maxResidentTiles
+    * tiles are kept in memory; the least recently touched one is appended to a spill file and merged back
+    * when the tile is written, so that memory is bounded whatever the size of the map.
+    * With tileSize > 0, tiles are written to <prefix>/<x>_<y>_<z>.pcd, and listed in <prefix>/index.txt with
+    * their bounds and number of points. With tileSize <= 0, the map is still accumulated in tiles of
+    * singleFileTileSize, spilled under <prefix>.tiles, and the tiles are streamed one after the other into
+    * <prefix>.pcd, so that the single file mode is bounded in memory too.
+    */
+template <typename PointT>
+class MapExporter
+{
+public:
+
+    static constexpr float singleFileTileSize = 100.0; // meters
+
+    MapExporter(const std::string& prefix, float resolution, float tileSize, int maxResidentTiles)
+    : prefix(prefix), resolution(resolution), tileSize(tileSize),
+      maxResidentTiles(std::max(maxResidentTiles, 1)), touchCount(0), numWritten(0)
+    {
+        invResolution = resolution > 0 ? 1.0 / resolution : 0;
+        invTileSize = 1.0 / (tileSize > 0 ? tileSize : singleFileTileSize);
+        tileDirectory = tileSize > 0 ? prefix : prefix + ".tiles";
+        std::error_code error;
+        std::filesystem::create_directories(tileDirectory, error);
+    }
+
+    void add(const pcl::PointCloud<PointT>& cloud)
+    {
+        Tile* tile = nullptr;
+        VoxelKey tileKey = {0, 0, 0};
+        for (const auto& point : cloud.points)
+        {
+            VoxelKey key = tileKeyOf(point);
+            if (tile == nullptr || !(key == tileKey))
+            {
+                tileKey = key;
+                tile = &touch(tileKey);
+            }
+
+            if (resolution > 0)
+            {
+                Voxel& voxel = tile->voxels[toVoxelKey(point.x, point.y, point.z, invResolution)];
+                voxel.x += point.x;
+                voxel.y += point.y;
+                voxel.z += point.z;
+                voxel.intensity += point.intensity;
+                voxel.num++;
+            }
+            else
+            {
+                tile->points.push_back(point);
+            }
+        }
+    }
+
+    // write all the tiles and the index, returns false if any file failed to be written
+    bool finish()
+    {
+        if (tileSize <= 0)
+            return finishSingleFile();
+
+        std::ofstream index(prefix + "/index.txt");
+        index << "# tile_x tile_y tile_z min_x min_y min_z max_x max_y max_z num_points file" << std::endl;
+        bool ok = index.good();
+
+        for (auto& it : tiles)
+        {
+            const VoxelKey& key = it.first;
+            pcl::PointCloud<PointT> cloud;
+            takeTile(key, it.second, cloud);
+
+            std::string name = tileName(key) + ".pcd";
+            if (cloud.empty() == false)
+                ok = (pcl::io::savePCDFileBinary(prefix + "/" + name, cloud) == 0) && ok;
+            numWritten += cloud.size();
+
+            index << key.x << " " << key.y << " " << key.z << " "
+                  << key.x * tileSize << " " << key.y * tileSize << " " << key.z * tileSize << " "
+                  << (key.x + 1) * tileSize << " " << (key.y + 1) * tileSize << " " << (key.z + 1) * tileSize << " "
+                  << cloud.size() << " " << name << std::endl;
+        }
+
+        tiles.clear();
+        return ok && index.good();
+    }
+
+    size_t numTiles() const
+    {
+        return tiles.size();
+    }
+
+    size_t numPointsWritten() const
+    {
+        return numWritten;
+    }
+
+private:
+
+    struct Voxel
+    {
+        float x = 0, y = 0, z = 0, intensity = 0;
+        int num = 0;
+    };
+
+    struct SpilledVoxel
+    {
+        VoxelKey key;
+        Voxel voxel;
+    };
+
+    struct Tile
+    {
+        std::unordered_map<VoxelKey, Voxel, VoxelKeyHash> voxels;
+        std::vector<PointT> points;
+        size_t lastTouch = 0;
+        bool resident = true;
+        bool spilled = false;
+    };
+
+    VoxelKey tileKeyOf(const PointT& point) const
+    {
+        return toVoxelKey(point.x, point.y, point.z, invTileSize);
+    }
+
+    std::string tileName(const VoxelKey& key) const
+    {
+        return std::to_string(key.x) + "_" + std::to_string(key.y) + "_" + std::to_string(key.z);
+    }
+
+    std::string spillName(const VoxelKey& key) const
+    {
+        return tileDirectory + "/" + tileName(key) + ".spill";
+    }
+
+    // merges back the spilled part of a tile, and releases its memory
+    void takeTile(const VoxelKey& key, Tile& tile, pcl::PointCloud<PointT>& cloud)
+    {
+        readSpilled(key, tile);
+        toCloud(tile, cloud);
+        tile = Tile();
+    }
+
+    // streams the tiles one at a time into the data section of a binary pcd, written behind its header
+    // once the number of points is known
+    bool finishSingleFile()
+    {
+        std::vector<pcl::PCLPointField> fields;
+        pcl::getFields<PointT>(fields);
+        fields.erase(std::remove_if(fields.begin(), fields.end(),
+                                    [](const pcl::PCLPointField& field) { return field.name == "_"; }),
+                     fields.end());
+
+        std::string dataName = tileDirectory + "/data.bin";
+        FILE* data = fopen(dataName.c_str(), "wb");
+        bool ok = data != NULL;
+        size_t numPoints = 0;
+        std::vector<char> packed;
+        for (auto& it : tiles)
+        {
+            pcl::PointCloud<PointT> cloud;
+            takeTile(it.first, it.second, cloud);
+            if (!ok || cloud.empty())
+                continue;
+
+            packed.clear();
+            for (const auto& point : cloud.points)
+            {
+                for (const auto& field : fields)
+                {
+                    const char* begin = reinterpret_cast<const char*>(&point) + field.offset;
+                    packed.insert(packed.end(), begin, begin + pcl::getFieldSize(field.datatype) * field.count);
+                }
+            }
+            ok = fwrite(packed.data(), 1, packed.size(), data) == packed.size();
+            numPoints += cloud.size();
+        }
+        tiles.clear();
+        ok = data != NULL && (fclose(data) == 0) && ok;
+
+        if (ok && numPoints > 0)
+        {
+            pcl::PointCloud<PointT> header;
+            header.width = numPoints;
+            header.height = 1;
+            std::ofstream file(prefix + ".pcd", std::ios::binary | std::ios::trunc);
+            std::ifstream in(dataName, std::ios::binary);
+            file << pcl::PCDWriter::generateHeader<PointT>(header, numPoints) << "DATA binary\n";
+            file << in.rdbuf();
+            ok = file.good();
+            numWritten += numPoints;
+        }
+
+        std::error_code error;
+        std::filesystem::remove_all(tileDirectory, error);
+        return ok;
+    }
+
+    Tile& touch(const VoxelKey& key)
+    {
+        auto it = tiles.find(key);
+        if (it == tiles.end())
+        {
+            it = tiles.emplace(key, Tile()).first;
+            residentKeys.push_back(key);
+        }
+        else if (it->second.resident == false)
+        {
+            it->second.resident = true;
+            residentKeys.push_back(key);
+        }
+        it->second.lastTouch = ++touchCount;
+
+        if ((int)residentKeys.size() > maxResidentTiles)
+            evictOldest(key);
+        return it->second;
+    }
+
+    void evictOldest(const VoxelKey& keep)
+    {
+        int oldest = -1;
+        for (int i = 0; i < (int)residentKeys.size(); ++i)
+        {
+            if (residentKeys[i] == keep)
+                continue;
+            if (oldest < 0 || tiles[residentKeys[i]].lastTouch < tiles[residentKeys[oldest]].lastTouch)
+                oldest = i;
+        }
+        if (oldest < 0)
+            return;
+
+        VoxelKey key = residentKeys[oldest];
+        residentKeys.erase(residentKeys.begin() + oldest);
+
+        Tile& tile = tiles[key];
+        FILE* fp = fopen(spillName(key).c_str(), "ab");
+        if (fp != NULL)
+        {
+            for (const auto& voxel : tile.voxels)
+            {
+                SpilledVoxel record = {voxel.first, voxel.second};
+                fwrite(&record, sizeof(record), 1, fp);
+            }
+            if (tile.points.empty() == false)
+                fwrite(tile.points.data(), sizeof(PointT), tile.points.size(), fp);
+            fclose(fp);
+            tile.spilled = true;
+            tile.voxels = std::unordered_map<VoxelKey, Voxel, VoxelKeyHash>();
+            tile.points = std::vector<PointT>();
+        }
+        tile.resident = false;
+    }
+
+    void readSpilled(const VoxelKey& key, Tile& tile)
+    {
+        if (tile.spilled == false)
+            return;
+
+        std::string name = spillName(key);
+        FILE* fp = fopen(name.c_str(), "rb");
+        if (fp == NULL)
+            return;
+
+        if (resolution > 0)
+        {
+            SpilledVoxel record;
+            while (fread(&record, sizeof(record), 1, fp) == 1)
+            {
+                Voxel& voxel = tile.voxels[record.key];
+                voxel.x += record.voxel.x;
+                voxel.y += record.voxel.y;
+                voxel.z += record.voxel.z;
+                voxel.intensity += record.voxel.intensity;
+                voxel.num += record.voxel.num;
+            }
+        }
+        else
+        {
+            PointT point;
+            while (fread(&point, sizeof(PointT), 1, fp) == 1)
+                tile.points.push_back(point);
+        }
+        fclose(fp);
+        remove(name.c_str());
+    }
+
+    void toCloud(Tile& tile, pcl::PointCloud<PointT>& cloud) const
+    {
+        if (resolution <= 0)
+        {
+            cloud.points.swap(tile.points);
+        }
+        else
+        {
+            cloud.points.reserve(tile.voxels.size());
+            for (const auto& it : tile.voxels)
+            {
+                const Voxel& voxel = it.second;
+                PointT point;
+                point.x = voxel.x / voxel.num;
+                point.y = voxel.y / voxel.num;
+                point.z = voxel.z / voxel.num;
+                point.intensity = voxel.intensity / voxel.num;
+                cloud.points.push_back(point);
+            }
+        }
+        cloud.width = cloud.points.size();
+        cloud.height = 1;
+        cloud.is_dense = true;
+    }
+
+    std::string prefix;
+    std::string tileDirectory;
+    float resolution;
+    float invResolution;
+    float tileSize;
+    float invTileSize;
+    int maxResidentTiles;
+    size_t touchCount;
+    size_t numWritten;
+    std::unordered_map<VoxelKey, Tile, VoxelKeyHash> tiles;
+    std::vector<VoxelKey> residentKeys;
+};
+
+#endif
@@ -0,0 +1,204 @@
+#pragma once
+#ifndef _SCAN_CONTEXT_LIDAR_ODOMETRY_H_
+#define _SCAN_CONTEXT_LIDAR_ODOMETRY_H_
+
+#include <pcl/point_cloud.h>
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+/*
+    * Scan Context place descriptor (Kim and Kim, IROS 2018): the max height of the points in a polar grid of
+    * numRings x numSectors bins around the sensor, one per key frame. Loop candidates are proposed by the
+    * ring key, the rotation invariant mean of each ring, then ranked by the column-shifted cosine distance
+    * of the descriptors, which also gives the yaw from the query scan to the candidate. A scan that is not
+    * a key frame can be queried too, e.g. to relocalize in a loaded map.
+    */
+template <typename PointT>
+class ScanContext
+{
+public:
+
+    struct Candidate
+    {
+        int keyInd;
+        float distance;
+        float yaw;
+    };
+
+    ScanContext()
+    {
+        setParams(20, 60, 80.0, 2.0);
+    }
+
+    // sensorHeight is added to z, so that the ground is above zero, the value of empty bins
+    void setParams(int rings, int sectors, float maxRadius, float sensorHeight)
+    {
+        numRings = rings;
+        numSectors = sectors;
+        maxRange = maxRadius;
+        heightOffset = sensorHeight;
+        clear();
+    }
+
+    void clear()
+    {
+        descriptions.clear();
+    }
+
+    int size() const
+    {
+        return (int)descriptions.size();
+    }
+
+    // describe the next key frame, from its cloud in the sensor frame
+    void add(const pcl::PointCloud<PointT>& cloud)
+    {
+        descriptions.push_back(describe(cloud));
+    }
+
+    // best matches of key frame keyInd among the key frames [0, maxCandidateInd], closest first
+    std::vector<Candidate> query(int keyInd, int maxCandidateInd, int numRingKeyCandidates, float maxDistance, int numThreads) const
+    {
+        if (keyInd < 0 || keyInd >= size())
+            return std::vector<Candidate>();
+        return query(descriptions[keyInd], maxCandidateInd, numRingKeyCandidates, maxDistance, numThreads);
+    }
+
+    // best matches of a scan in the sensor frame among all the key frames, closest first
+    std::vector<Candidate> query(const pcl::PointCloud<PointT>& cloud, int numRingKeyCandidates, float maxDistance, int numThreads) const
+    {
+        return query(describe(cloud), size() - 1, numRingKeyCandidates, maxDistance, numThreads);
+    }
+
+private:
+
+    struct Description
+    {
+        Eigen::MatrixXf descriptor;
+        Eigen::VectorXf ringKey;
+        Eigen::VectorXf sectorKey;
+    };
+
+    Description describe(const pcl::PointCloud<PointT>& cloud) const
+    {
+        Eigen::MatrixXf desc = Eigen::MatrixXf::Zero(numRings, numSectors);
+        for (const auto& p : cloud.points)
+        {
+            float range = std::sqrt(p.x * p.x + p.y * p.y);
+            if (range >= maxRange || range < 1e-3)
+                continue;
+
+            float angle = std::atan2(p.y, p.x);
+            if (angle < 0)
+                angle += 2 * M_PI;
+            int ring = std::min((int)(range / maxRange * numRings), numRings - 1);
+            int sector = std::min((int)(angle / (2 * M_PI) * numSectors), numSectors - 1);
+            desc(ring, sector) = std::max(desc(ring, sector), p.z + heightOffset);
+        }
+
+        Description description;
+        description.ringKey = desc.rowwise().mean();
+        description.sectorKey = desc.colwise().mean().transpose();
+        description.descriptor = desc;
+        return description;
+    }
+
+    std::vector<Candidate> query(const Description& description, int maxCandidateInd, int numRingKeyCandidates, float maxDistance, int numThreads) const
+    {
+        std::vector<Candidate> candidates;
+        maxCandidateInd = std::min(maxCandidateInd, size() - 1);
+        if (maxCandidateInd < 0)
+            return candidates;
+
+        // ring key distances, to keep only a few descriptors to compare
+        std::vector<std::pair<float, int>> ringDistances(maxCandidateInd + 1);
+        #pragma omp parallel for num_threads(numThreads)
+        for (int i = 0; i <= maxCandidateInd; ++i)
+            ringDistances[i] = std::make_pair((descriptions[i].ringKey - description.ringKey).squaredNorm(), i);
+
+        int numKept = std::min(numRingKeyCandidates, maxCandidateInd + 1);
+        std::partial_sort(ringDistances.begin(), ringDistances.begin() + numKept, ringDistances.end());
+
+        candidates.resize(numKept);
+        #pragma omp parallel for num_threads(numThreads)
+        for (int i = 0; i < numKept; ++i)
+        {
+            Candidate& candidate = candidates[i];
+            candidate.keyInd = ringDistances[i].second;
+            int shift = 0;
+            candidate.distance = distance(description, descriptions[candidate.keyInd], &shift);
+            candidate.yaw = shift * 2 * M_PI / numSectors;
+        }
+
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                        [maxDistance](const Candidate& c){ return c.distance > maxDistance; }),
+                         candidates.end());
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Candidate& a, const Candidate& b){ return a.distance < b.distance; });
+        return candidates;
+    }
+
+    // column-shifted cosine distance in [0, 1]; column j of the query matches column j + shift of the candidate
+    float distance(const Description& query, const Description& candidate, int* bestShift) const
+    {
+        const Eigen::MatrixXf& a = query.descriptor;
+        const Eigen::MatrixXf& b = candidate.descriptor;
+
+        // coarse alignment with the sector keys, refined around it with the full descriptors
+        int coarseShift = 0;
+        float bestKeyDistance = std::numeric_limits<float>::max();
+        for (int shift = 0; shift < numSectors; ++shift)
+        {
+            float d = 0;
+            for (int j = 0; j < numSectors; ++j)
+            {
+                float diff = query.sectorKey(j) - candidate.sectorKey((j + shift) % numSectors);
+                d += diff * diff;
+            }
+            if (d < bestKeyDistance)
+            {
+                bestKeyDistance = d;
+                coarseShift = shift;
+            }
+        }
+
+        int searchRadius = std::max(numSectors / 10, 1);
+        float bestDistance = 1;
+        *bestShift = coarseShift;
+        for (int s = -searchRadius; s <= searchRadius; ++s)
+        {
+            int shift = ((coarseShift + s) % numSectors + numSectors) % numSectors;
+            float similarity = 0;
+            int numColumns = 0;
+            for (int j = 0; j < numSectors; ++j)
+            {
+                float normA = a.col(j).norm();
+                float normB = b.col((j + shift) % numSectors).norm();
+                if (normA == 0 || normB == 0)
+                    continue;
+                similarity += a.col(j).dot(b.col((j + shift) % numSectors)) / (normA * normB);
+                numColumns++;
+            }
+            float d = numColumns > 0 ? 1 - similarity / numColumns : 1;
+            if (d < bestDistance)
+            {
+                bestDistance = d;
+                *bestShift = shift;
+            }
+        }
+        return bestDistance;
+    }
+
+    int numRings;
+    int numSectors;
+    float maxRange;
+    float heightOffset;
+    std::vector<Description> descriptions;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#pragma once
+#ifndef _SCAN_MATCH_NORMAL_EQUATION_LIDAR_ODOMETRY_H_
+#define _SCAN_MATCH_NORMAL_EQUATION_LIDAR_ODOMETRY_H_
+
+#include <Eigen/Dense>
+
+#include <cmath>
+
+/*
+    * Rows of the Jacobian of scan-to-map optimization, evaluated at the rotation of transformTobeMapped
+    * (roll, pitch, yaw, x, y, z). This optimization is from the original loam_velodyne by Ji Zhang, and works
+    * in the camera frame:
+    * lidar <- camera      ---     camera <- lidar
+    * x = z                ---     x = y
+    * y = x                ---     y = z
+    * z = y                ---     z = x
+    * roll = yaw           ---     roll = pitch
+    * pitch = roll         ---     pitch = yaw
+    * yaw = pitch          ---     yaw = roll
+    */
+struct ScanMatchJacobian
+{
+    float srx = 0, crx = 1, sry = 0, cry = 1, srz = 0, crz = 1; // sin and cos of the rotation, in camera frame
+
+    ScanMatchJacobian() = default;
+
+    explicit ScanMatchJacobian(const float transform[6])
+    {
+        // lidar -> camera
+        srx = std::sin(transform[1]);
+        crx = std::cos(transform[1]);
+        sry = std::sin(transform[2]);
+        cry = std::cos(transform[2]);
+        srz = std::sin(transform[0]);
+        crz = std::cos(transform[0]);
+    }
+
+    // the row of a point in lidar frame, and of the coefficients (normal) of its residual
+    template <typename PointT>
+    Eigen::Matrix<float, 6, 1> row(const PointT& pointLidar, const PointT& coeffLidar) const
+    {
+        // lidar -> camera
+        const float px = pointLidar.y, py = pointLidar.z, pz = pointLidar.x;
+        const float cx = coeffLidar.y, cy = coeffLidar.z, cz = coeffLidar.x;
+        // in camera
+        float arx = (crx*sry*srz*px + crx*crz*sry*py - srx*sry*pz) * cx
+                  + (-srx*srz*px - crz*srx*py - crx*pz) * cy
+                  + (crx*cry*srz*px + crx*cry*crz*py - cry*srx*pz) * cz;
+
+        float ary = ((cry*srx*srz - crz*sry)*px 
+                  + (sry*srz + cry*crz*srx)*py + crx*cry*pz) * cx
+                  + ((-cry*crz - srx*sry*srz)*px 
+                  + (cry*srz - crz*srx*sry)*py - crx*sry*pz) * cz;
+
+        float arz = ((crz*srx*sry - cry*srz)*px + (-cry*crz-srx*sry*srz)*py)*cx
+                  + (crx*crz*px - crx*srz*py) * cy
+                  + ((sry*srz + cry*crz*srx)*px + (crz*sry-cry*srx*srz)*py)*cz;
+
+        // camera -> lidar
+        Eigen::Matrix<float, 6, 1> rowA;
+        rowA << arz, arx, ary, cz, cx, cy;
+        return rowA;
+    }
+};
+
+/*
+    * Normal equation AtA * x = AtB of one Gauss-Newton step of scan-to-map optimization,
+    * accumulated point by point so that the Jacobian matrix is never stored
+    */
+struct ScanMatchNormalEquation
+{
+    Eigen::Matrix<float, 6, 6> AtA = Eigen::Matrix<float, 6, 6>::Zero();
+    Eigen::Matrix<float, 6, 1> AtB = Eigen::Matrix<float, 6, 1>::Zero();
+    int num = 0;
+
+    template <typename PointT>
+    void add(const ScanMatchJacobian& jacobian, const PointT& pointLidar, const PointT& coeffLidar)
+    {
+        Eigen::Matrix<float, 6, 1> rowA = jacobian.row(pointLidar, coeffLidar);
+        AtA.noalias() += rowA * rowA.transpose();
+        AtB.noalias() -= rowA * coeffLidar.intensity;
+        num++;
+    }
+
+    ScanMatchNormalEquation& operator+=(const ScanMatchNormalEquation& other)
+    {
+        AtA += other.AtA;
+        AtB += other.AtB;
+        num += other.num;
+        return *this;
+    }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+// per-thread normal equations are summed at the end of the parallel loops
+#pragma omp declare reduction(+ : ScanMatchNormalEquation : omp_out += omp_in) initializer(omp_priv = ScanMatchNormalEquation())
+
+#endif
@@ -0,0 +1,612 @@
+#pragma once
+#ifndef _SESSION_STORE_LIDAR_ODOMETRY_H_
+#define _SESSION_STORE_LIDAR_ODOMETRY_H_
+
+#include <pcl/point_cloud.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SessionPose
+{
+    double time;
+    float pose[6]; // roll, pitch, yaw, x, y, z, like transformTobeMapped
+};
+
+struct SessionFactor
+{
+    enum Kind : uint32_t { PRIOR = 0, BETWEEN = 1, GPS = 2 };
+
+    uint32_t kind;
+    int32_t key1;
+    int32_t key2;       // BETWEEN only
+    double value[6];    // pose as roll, pitch, yaw, x, y, z, or the x, y, z position for GPS
+    double variances[6];
+};
+
+/*
+    * Mapping session kept in one append-only file, so that mapping can resume after the node stops or crashes.
+    * The file is a header followed by records, each with its size and checksum: key frames (pose and feature
+    * clouds, quantized to 16 bits per coordinate), the poses changed by each correction, and the factors added
+    * to the graph. open() memory-maps an existing file, indexes the valid records and drops a torn record at the
+    * end, then the new records are appended by a background thread. A record is complete in the file once
+    * written, which survives a crash of the process, not of the machine. Once the pose records outweigh the
+    * others, the file is rewritten with a single pose snapshot, and replaced by a rename, so that its size stays
+    * linear in the number of key frames. The key frames of the loaded file stay mapped, and are decoded on demand.
+    */
+template <typename PointT>
+class SessionStore
+{
+public:
+
+    SessionStore()
+    : mapped(NULL), mappedSize(0), fileOpen(false), poseLogBytes(0), otherLogBytes(0), fd(-1), fileEnd(0),
+      stopWriter(false)
+    {
+    }
+
+    ~SessionStore()
+    {
+        close();
+    }
+
+    bool isOpen() const
+    {
+        return fileOpen;
+    }
+
+    // loads the records of an existing file, creates it otherwise
+    bool open(const std::string& fileName)
+    {
+        close();
+        size_t validSize = load(fileName);
+
+        // read back when the file is compacted
+        fd = ::open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+            return false;
+        filePath = fileName;
+        FileHeader header;
+        if (validSize == 0)
+        {
+            keptRecords.clear();
+            if (ftruncate(fd, 0) != 0 || ::write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header))
+            {
+                close();
+                return false;
+            }
+            validSize = sizeof(header);
+        }
+        else if (ftruncate(fd, validSize) != 0 || pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+                 lseek(fd, validSize, SEEK_SET) != (off_t)validSize)
+        {
+            // the header is written again, for a file of an older version
+            close();
+            return false;
+        }
+        fileEnd = validSize;
+
+        fileOpen = true;
+        stopWriter = false;
+        writerThread = std::thread(&SessionStore::writerLoop, this);
+        return true;
+    }
+
+    // waits for the queued records to be written
+    void close()
+    {
+        if (writerThread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                stopWriter = true;
+            }
+            writerCond.notify_all();
+            writerThread.join();
+        }
+        fileOpen = false;
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+        releaseLoaded();
+        loggedPoses.clear();
+        keptRecords.clear();
+        poseLogBytes = 0;
+        otherLogBytes = 0;
+    }
+
+    // loaded session, the poses include the corrections written after the key frames
+    int numKeyFrames() const
+    {
+        return keyFrameRecords.size();
+    }
+
+    const SessionPose& pose(int keyInd) const
+    {
+        return poses[keyInd];
+    }
+
+    const std::vector<SessionFactor>& factors() const
+    {
+        return loadedFactors;
+    }
+
+    // thread safe, the loaded file stays mapped until close()
+    bool loadKeyFrame(int keyInd, pcl::PointCloud<PointT>& corner, pcl::PointCloud<PointT>& surf) const
+    {
+        if (mapped == NULL || keyInd < 0 || keyInd >= (int)keyFrameRecords.size())
+            return false;
+        const char* data = (const char*)mapped + keyFrameRecords[keyInd] + sizeof(int32_t) + sizeof(SessionPose);
+        data = decodeCloud(data, corner);
+        decodeCloud(data, surf);
+        return true;
+    }
+
+    void addKeyFrame(int keyInd, const SessionPose& pose, const pcl::PointCloud<PointT>& corner, const pcl::PointCloud<PointT>& surf)
+    {
+        std::vector<char> payload;
+        payload.reserve(sizeof(int32_t) + sizeof(SessionPose) + 2 * sizeof(CloudHeader)
+                        + (corner.size() + surf.size()) * sizeof(PackedPoint));
+        int32_t index = keyInd;
+        append(payload, &index, sizeof(index));
+        append(payload, &pose, sizeof(pose));
+        encodeCloud(corner, payload);
+        encodeCloud(surf, payload);
+        if (keyInd >= (int)loggedPoses.size())
+            loggedPoses.resize(keyInd + 1);
+        loggedPoses[keyInd] = pose;
+        otherLogBytes += sizeof(RecordHeader) + payload.size();
+        queue(KEY_FRAME, payload);
+    }
+
+    // logs the poses of the key frames that differ from the ones logged, after a correction
+    void updatePoses(const std::vector<SessionPose>& newPoses)
+    {
+        std::vector<char> payload;
+        uint32_t num = 0;
+        append(payload, &num, sizeof(num));
+        int numPoses = std::min(newPoses.size(), loggedPoses.size());
+        for (int i = 0; i < numPoses; ++i)
+        {
+            if (memcmp(&newPoses[i], &loggedPoses[i], sizeof(SessionPose)) == 0)
+                continue;
+            loggedPoses[i] = newPoses[i];
+            PoseUpdate update;
+            update.keyInd = i;
+            update.reserved = 0;
+            update.pose = newPoses[i];
+            append(payload, &update, sizeof(update));
+            num++;
+        }
+        if (num == 0)
+            return;
+        memcpy(payload.data(), &num, sizeof(num));
+
+        poseLogBytes += sizeof(RecordHeader) + payload.size();
+        if (poseLogBytes <= otherLogBytes)
+        {
+            queue(POSE_UPDATES, payload);
+            return;
+        }
+
+        // all the poses in one record, which replaces the others when the file is rewritten
+        payload.clear();
+        num = loggedPoses.size();
+        append(payload, &num, sizeof(num));
+        append(payload, loggedPoses.data(), num * sizeof(SessionPose));
+        poseLogBytes = sizeof(RecordHeader) + payload.size();
+        queue(POSES, payload, true);
+    }
+
+    void addFactor(const SessionFactor& factor)
+    {
+        std::vector<char> payload;
+        append(payload, &factor, sizeof(factor));
+        otherLogBytes += sizeof(RecordHeader) + payload.size();
+        queue(FACTOR, payload);
+    }
+
+private:
+
+    // POSES replaces the poses of the first key frames, POSE_UPDATES the poses of the given key frames
+    enum RecordType : uint32_t { KEY_FRAME = 1, POSES = 2, FACTOR = 3, POSE_UPDATES = 4 };
+
+    struct FileHeader
+    {
+        char magic[8] = {'L', 'I', 'O', 'S', 'A', 'M', 'S', 'S'};
+        uint32_t version = 2;
+        uint32_t reserved = 0;
+    };
+
+    struct PoseUpdate
+    {
+        int32_t keyInd;
+        uint32_t reserved;
+        SessionPose pose;
+    };
+
+    struct RecordExtent
+    {
+        size_t offset; // of the record header
+        size_t size;   // with the record header
+    };
+
+    struct WriteJob
+    {
+        std::vector<char> record;
+        bool compact; // rewrite the file without the pose records, then append this one
+    };
+
+    struct RecordHeader
+    {
+        uint32_t type;
+        uint32_t size;     // payload bytes
+        uint32_t checksum; // of the payload
+        uint32_t reserved;
+    };
+
+    struct CloudHeader
+    {
+        uint32_t num;
+        float scale; // meters per unit of the quantized coordinates
+    };
+
+    struct PackedPoint
+    {
+        int16_t x, y, z;
+        uint16_t intensity;
+    };
+
+    static uint32_t checksum(const char* data, size_t size)
+    {
+        // FNV-1a
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; ++i)
+            hash = (hash ^ (uint8_t)data[i]) * 16777619u;
+        return hash;
+    }
+
+    static void append(std::vector<char>& buffer, const void* data, size_t size)
+    {
+        const char* bytes = (const char*)data;
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+
+    static void encodeCloud(const pcl::PointCloud<PointT>& cloud, std::vector<char>& buffer)
+    {
+        float maxCoord = 0;
+        for (const auto& p : cloud.points)
+            maxCoord = std::max(maxCoord, std::max(std::fabs(p.x), std::max(std::fabs(p.y), std::fabs(p.z))));
+
+        CloudHeader header;
+        header.num = cloud.size();
+        header.scale = std::max(maxCoord / 32767.0f, 1e-5f);
+        append(buffer, &header, sizeof(header));
+
+        size_t offset = buffer.size();
+        buffer.resize(offset + cloud.size() * sizeof(PackedPoint));
+        PackedPoint* packed = (PackedPoint*)(buffer.data() + offset);
+        float inv = 1.0f / header.scale;
+        for (size_t i = 0; i < cloud.size(); ++i)
+        {
+            const PointT& p = cloud.points[i];
+            packed[i].x = (int16_t)std::lround(std::max(std::min(p.x * inv, 32767.0f), -32767.0f));
+            packed[i].y = (int16_t)std::lround(std::max(std::min(p.y * inv, 32767.0f), -32767.0f));
+            packed[i].z = (int16_t)std::lround(std::max(std::min(p.z * inv, 32767.0f), -32767.0f));
+            packed[i].intensity = (uint16_t)std::lround(std::max(std::min((float)p.intensity, 65535.0f), 0.0f));
+        }
+    }
+
+    static const char* decodeCloud(const char* data, pcl::PointCloud<PointT>& cloud)
+    {
+        CloudHeader header;
+        memcpy(&header, data, sizeof(header));
+        data += sizeof(header);
+
+        cloud.clear();
+        cloud.points.resize(header.num);
+        for (uint32_t i = 0; i < header.num; ++i)
+        {
+            PackedPoint packed;
+            memcpy(&packed, data + i * sizeof(PackedPoint), sizeof(PackedPoint));
+            PointT& p = cloud.points[i];
+            p.x = packed.x * header.scale;
+            p.y = packed.y * header.scale;
+            p.z = packed.z * header.scale;
+            p.intensity = packed.intensity;
+        }
+        cloud.width = cloud.points.size();
+        cloud.height = 1;
+        cloud.is_dense = true;
+        return data + header.num * sizeof(PackedPoint);
+    }
+
+    /*
+        * indexes the valid records of the file and returns their end, 0 if there is no valid file. The factors
+        * of a key frame are written before it, the ones after the last key frame or pose snapshot are dropped
+        */
+    size_t load(const std::string& fileName)
+    {
+        int readFd = ::open(fileName.c_str(), O_RDONLY);
+        if (readFd < 0)
+            return 0;
+
+        struct stat st;
+        if (fstat(readFd, &st) != 0 || st.st_size < (off_t)sizeof(FileHeader))
+        {
+            ::close(readFd);
+            return 0;
+        }
+        void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, readFd, 0);
+        ::close(readFd);
+        if (addr == MAP_FAILED)
+            return 0;
+        mapped = addr;
+        mappedSize = st.st_size;
+
+        const char* data = (const char*)mapped;
+        FileHeader expected;
+        FileHeader found;
+        memcpy(&found, data, sizeof(found));
+        if (memcmp(found.magic, expected.magic, sizeof(expected.magic)) != 0 || found.version < 1 || found.version > expected.version)
+        {
+            releaseLoaded();
+            return 0;
+        }
+
+        size_t offset = sizeof(FileHeader);
+        size_t validSize = offset;
+        size_t numFactors = 0;
+        size_t numKept = 0;
+        size_t validPoseLogBytes = 0, validOtherLogBytes = 0;
+        keptRecords.clear();
+        while (offset + sizeof(RecordHeader) <= mappedSize)
+        {
+            RecordHeader header;
+            memcpy(&header, data + offset, sizeof(header));
+            size_t payload = offset + sizeof(RecordHeader);
+            if (header.size > mappedSize - payload || checksum(data + payload, header.size) != header.checksum)
+                break;
+            if (!indexRecord(header, payload))
+                break;
+            size_t recordSize = sizeof(RecordHeader) + header.size;
+            if (header.type == POSES || header.type == POSE_UPDATES)
+            {
+                poseLogBytes += recordSize;
+            }
+            else
+            {
+                keptRecords.push_back(RecordExtent{offset, recordSize});
+                otherLogBytes += recordSize;
+            }
+            offset = payload + header.size;
+            if (header.type != FACTOR)
+            {
+                validSize = offset;
+                numFactors = loadedFactors.size();
+                numKept = keptRecords.size();
+                validPoseLogBytes = poseLogBytes;
+                validOtherLogBytes = otherLogBytes;
+            }
+        }
+        loadedFactors.resize(numFactors);
+        keptRecords.resize(numKept);
+        poseLogBytes = validPoseLogBytes;
+        otherLogBytes = validOtherLogBytes;
+        loggedPoses = poses;
+        return validSize;
+    }
+
+    void releaseLoaded()
+    {
+        if (mapped != NULL)
+            munmap(mapped, mappedSize);
+        mapped = NULL;
+        mappedSize = 0;
+        keyFrameRecords.clear();
+        poses.clear();
+        loadedFactors.clear();
+    }
+
+    bool indexRecord(const RecordHeader& header, size_t payload)
+    {
+        const char* data = (const char*)mapped + payload;
+        if (header.type == KEY_FRAME)
+        {
+            int32_t keyInd;
+            if (header.size < sizeof(keyInd) + sizeof(SessionPose))
+                return false;
+            memcpy(&keyInd, data, sizeof(keyInd));
+            if (keyInd != (int)keyFrameRecords.size())
+                return false;
+            SessionPose pose;
+            memcpy(&pose, data + sizeof(keyInd), sizeof(pose));
+            keyFrameRecords.push_back(payload);
+            poses.push_back(pose);
+        }
+        else if (header.type == POSES)
+        {
+            uint32_t num;
+            if (header.size < sizeof(num))
+                return false;
+            memcpy(&num, data, sizeof(num));
+            if (header.size != sizeof(num) + num * sizeof(SessionPose) || num > poses.size())
+                return false;
+            memcpy(poses.data(), data + sizeof(num), num * sizeof(SessionPose));
+        }
+        else if (header.type == POSE_UPDATES)
+        {
+            uint32_t num;
+            if (header.size < sizeof(num))
+                return false;
+            memcpy(&num, data, sizeof(num));
+            if (header.size != sizeof(num) + num * sizeof(PoseUpdate))
+                return false;
+            for (uint32_t i = 0; i < num; ++i)
+            {
+                PoseUpdate update;
+                memcpy(&update, data + sizeof(num) + i * sizeof(PoseUpdate), sizeof(update));
+                if (update.keyInd < 0 || update.keyInd >= (int)poses.size())
+                    return false;
+                poses[update.keyInd] = update.pose;
+            }
+        }
+        else if (header.type == FACTOR)
+        {
+            if (header.size != sizeof(SessionFactor))
+                return false;
+            SessionFactor factor;
+            memcpy(&factor, data, sizeof(factor));
+            loadedFactors.push_back(factor);
+        }
+        return true;
+    }
+
+    void queue(RecordType type, const std::vector<char>& payload, bool compact = false)
+    {
+        if (!fileOpen)
+            return;
+
+        RecordHeader header;
+        header.type = type;
+        header.size = payload.size();
+        header.checksum = checksum(payload.data(), payload.size());
+        header.reserved = 0;
+
+        std::vector<char> record;
+        record.reserve(sizeof(header) + payload.size());
+        append(record, &header, sizeof(header));
+        record.insert(record.end(), payload.begin(), payload.end());
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            writeQueue.push_back(WriteJob{std::move(record), compact});
+        }
+        writerCond.notify_one();
+    }
+
+    static bool writeAll(int fileFd, const char* data, size_t size)
+    {
+        size_t written = 0;
+        while (written < size)
+        {
+            ssize_t n = ::write(fileFd, data + written, size - written);
+            if (n <= 0)
+                return false;
+            written += n;
+        }
+        return true;
+    }
+
+    /*
+        * called by the writer thread: copies the key frame and factor records to a new file, in order, followed by
+        * the pose snapshot, then renames it over the session. The file is synced before the rename, so that the
+        * session is never replaced by a file that is not complete
+        */
+    bool compact(const std::vector<char>& snapshot)
+    {
+        std::string tmpPath = filePath + ".tmp";
+        int newFd = ::open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (newFd < 0)
+            return false;
+
+        FileHeader header;
+        bool ok = writeAll(newFd, (const char*)&header, sizeof(header));
+        std::vector<RecordExtent> newRecords;
+        newRecords.reserve(keptRecords.size());
+        size_t newEnd = sizeof(header);
+        std::vector<char> buffer;
+        for (size_t i = 0; ok && i < keptRecords.size(); ++i)
+        {
+            const RecordExtent& extent = keptRecords[i];
+            buffer.resize(extent.size);
+            ok = pread(fd, buffer.data(), extent.size, extent.offset) == (ssize_t)extent.size &&
+                 writeAll(newFd, buffer.data(), extent.size);
+            newRecords.push_back(RecordExtent{newEnd, extent.size});
+            newEnd += extent.size;
+        }
+        ok = ok && writeAll(newFd, snapshot.data(), snapshot.size()) && fsync(newFd) == 0 &&
+             rename(tmpPath.c_str(), filePath.c_str()) == 0;
+        if (!ok)
+        {
+            ::close(newFd);
+            unlink(tmpPath.c_str());
+            return false;
+        }
+
+        ::close(fd);
+        fd = newFd;
+        fileEnd = newEnd + snapshot.size();
+        keptRecords.swap(newRecords);
+        return true;
+    }
+
+    void writerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true)
+        {
+            writerCond.wait(lock, [this]{ return stopWriter || !writeQueue.empty(); });
+            if (writeQueue.empty())
+                return;
+
+            WriteJob job = std::move(writeQueue.front());
+            writeQueue.pop_front();
+            lock.unlock();
+            // the snapshot is appended to the current file if it cannot be rewritten
+            if (!job.compact || !compact(job.record))
+            {
+                RecordHeader header;
+                memcpy(&header, job.record.data(), sizeof(header));
+                if (writeAll(fd, job.record.data(), job.record.size()))
+                {
+                    if (header.type != POSES && header.type != POSE_UPDATES)
+                        keptRecords.push_back(RecordExtent{fileEnd, job.record.size()});
+                    fileEnd += job.record.size();
+                }
+            }
+            lock.lock();
+        }
+    }
+
+    void* mapped;
+    size_t mappedSize;
+    std::vector<size_t> keyFrameRecords; // payload offsets in the mapped file
+    std::vector<SessionPose> poses;
+    std::vector<SessionFactor> loadedFactors;
+
+    // by the caller
+    bool fileOpen; // fd is replaced by the writer thread when the file is compacted
+    std::vector<SessionPose> loggedPoses; // as the file will be loaded
+    size_t poseLogBytes;  // of the pose records in the file, once written
+    size_t otherLogBytes; // of the other records
+
+    // by the writer thread, once running
+    int fd;
+    std::string filePath;
+    std::vector<RecordExtent> keptRecords; // key frame and factor records of the file, in order
+    size_t fileEnd;
+
+    std::mutex mtx;
+    std::condition_variable writerCond;
+    std::deque<WriteJob> writeQueue;
+    bool stopWriter;
+    std::thread writerThread;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+#ifndef _SPSC_RING_LIDAR_ODOMETRY_H_
+#define _SPSC_RING_LIDAR_ODOMETRY_H_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/*
+    * Bounded lock-free queue between one producer thread and one consumer thread. The capacity is rounded up to
+    * a power of two. push fails instead of blocking when the queue is full, so the producer never waits on the
+    * consumer. The head and tail live on their own cache lines.
+    */
+template <typename T>
+class SpscRing
+{
+public:
+
+    explicit SpscRing(size_t minCapacity)
+    {
+        size_t capacity = 1;
+        while (capacity < minCapacity)
+            capacity <<= 1;
+        buffer.resize(capacity);
+        mask = capacity - 1;
+    }
+
+    size_t capacity() const
+    {
+        return buffer.size();
+    }
+
+    // producer only
+    bool push(const T& value)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - cachedTail == buffer.size())
+        {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h - cachedTail == buffer.size())
+                return false;
+        }
+        buffer[h & mask] = value;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only
+    bool pop(T& value)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == cachedHead)
+        {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t == cachedHead)
+                return false;
+        }
+        value = buffer[t & mask];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+
+    std::vector<T> buffer;
+    size_t mask;
+
+    alignas(64) std::atomic<size_t> head{0};
+    size_t cachedTail = 0; // producer's copy of tail
+    alignas(64) std::atomic<size_t> tail{0};
+    size_t cachedHead = 0; // consumer's copy of head
+};
+
+#endif
@@ -34,6 +34,8 @@
 #include <pcl/filters/crop_box.h>
 #include <pcl_conversions/pcl_conversions.h>
 
+#include "cloudChannel.hpp"
+
 #include <tf2/LinearMath/Quaternion.h>
 #include <tf2_ros/transform_listener.h>
 #include <tf2_ros/transform_broadcaster.h>
@@ -90,12 +92,15 @@ public:
     // Save pcd
     bool savePCD;
     string savePCDDirectory;
+    float saveMapTileSize;
+    int saveMapMaxResidentTiles;
 
     // Lidar Sensor Configuration
     SensorType sensor = SensorType::OUSTER;
     int N_SCAN;
     int Horizon_SCAN;
     int downsampleRate;
+    bool useOrganizedCloud;
     float lidarMinRange;
     float lidarMaxRange;
 
@@ -106,6 +111,7 @@ public:
     float imuGyrBiasN;
     float imuGravity;
     float imuRPYWeight;
+    float imuOdometryRate;
     vector<double> extRotV;
     vector<double> extRPYV;
     vector<double> extTransV;
@@ -131,12 +137,22 @@ public:
     // CPU Params
     int numberOfCores;
     double mappingProcessInterval;
+    bool synchronousMode;
 
     // Surrounding map
     float surroundingkeyframeAddingDistThreshold;
     float surroundingkeyframeAddingAngleThreshold;
     float surroundingKeyframeDensity;
     float surroundingKeyframeSearchRadius;
+    bool  useIncrementalLocalMap;
+    float localMapVoxelSize;
+    int   localMapVoxelCapacity;
+    int   keyFrameCacheSize;
+    int   keyFrameMaxResident;
+    string keyFrameSpillDirectory;
+    bool  useFixedLagSmoother;
+    int   smootherLag;
+    string sessionDirectory;
 
     // Loop closure
     bool  loopClosureEnableFlag;
@@ -146,11 +162,15 @@ public:
     float historyKeyframeSearchTimeDiff;
     int   historyKeyframeSearchNum;
     float historyKeyframeFitnessScore;
+    bool  useScanContext;
+    float scanContextDistThreshold;
+    int   scanContextNumCandidates;
 
     // global map visualization radius
     float globalMapVisualizationSearchRadius;
     float globalMapVisualizationPoseDensity;
     float globalMapVisualizationLeafSize;
+    float globalMapVisualizationTileSize;
 
     ParamServer(std::string node_name, const rclcpp::NodeOptions & options) : Node(node_name, options)
     {
@@ -185,6 +205,10 @@ public:
         get_parameter("savePCD", savePCD);
         declare_parameter("savePCDDirectory", "/Downloads/LOAM/");
         get_parameter("savePCDDirectory", savePCDDirectory);
+        declare_parameter("saveMapTileSize", 0.0);
+        get_parameter("saveMapTileSize", saveMapTileSize);
+        declare_parameter("saveMapMaxResidentTiles", 64);
+        get_parameter("saveMapMaxResidentTiles", saveMapMaxResidentTiles);
 
         std::string sensorStr;
         declare_parameter("sensor", "ouster");
@@ -215,6 +239,8 @@ public:
         get_parameter("Horizon_SCAN", Horizon_SCAN);
         declare_parameter("downsampleRate", 1);
         get_parameter("downsampleRate", downsampleRate);
+        declare_parameter("useOrganizedCloud", false);
+        get_parameter("useOrganizedCloud", useOrganizedCloud);
         declare_parameter("lidarMinRange", 5.5);
         get_parameter("lidarMinRange", lidarMinRange);
         declare_parameter("lidarMaxRange", 1000.0);
@@ -232,6 +258,8 @@ public:
         get_parameter("imuGravity", imuGravity);
         declare_parameter("imuRPYWeight", 0.01);
         get_parameter("imuRPYWeight", imuRPYWeight);
+        declare_parameter("imuOdometryRate", 0.0);
+        get_parameter("imuOdometryRate", imuOdometryRate);
 
         double ida[] = { 1.0,  0.0,  0.0,
                          0.0,  1.0,  0.0,
@@ -276,6 +304,8 @@ public:
         get_parameter("numberOfCores", numberOfCores);
         declare_parameter("mappingProcessInterval", 0.15);
         get_parameter("mappingProcessInterval", mappingProcessInterval);
+        declare_parameter("synchronousMode", false);
+        get_parameter("synchronousMode", synchronousMode);
 
         declare_parameter("surroundingkeyframeAddingDistThreshold", 1.0);
         get_parameter("surroundingkeyframeAddingDistThreshold", surroundingkeyframeAddingDistThreshold);
@@ -285,6 +315,24 @@ public:
         get_parameter("surroundingKeyframeDensity", surroundingKeyframeDensity);
         declare_parameter("surroundingKeyframeSearchRadius", 50.0);
         get_parameter("surroundingKeyframeSearchRadius", surroundingKeyframeSearchRadius);
+        declare_parameter("useIncrementalLocalMap", false);
+        get_parameter("useIncrementalLocalMap", useIncrementalLocalMap);
+        declare_parameter("localMapVoxelSize", 1.0);
+        get_parameter("localMapVoxelSize", localMapVoxelSize);
+        declare_parameter("localMapVoxelCapacity", 20);
+        get_parameter("localMapVoxelCapacity", localMapVoxelCapacity);
+        declare_parameter("keyFrameCacheSize", 1000);
+        get_parameter("keyFrameCacheSize", keyFrameCacheSize);
+        declare_parameter("keyFrameMaxResident", 0);
+        get_parameter("keyFrameMaxResident", keyFrameMaxResident);
+        declare_parameter("keyFrameSpillDirectory", "/Downloads/LOAM_keyframes/");
+        get_parameter("keyFrameSpillDirectory", keyFrameSpillDirectory);
+        declare_parameter("useFixedLagSmoother", false);
+        get_parameter("useFixedLagSmoother", useFixedLagSmoother);
+        declare_parameter("smootherLag", 200);
+        get_parameter("smootherLag", smootherLag);
+        declare_parameter("sessionDirectory", "");
+        get_parameter("sessionDirectory", sessionDirectory);
 
         declare_parameter("loopClosureEnableFlag", true);
         get_parameter("loopClosureEnableFlag", loopClosureEnableFlag);
@@ -300,6 +348,12 @@ public:
         get_parameter("historyKeyframeSearchNum", historyKeyframeSearchNum);
         declare_parameter("historyKeyframeFitnessScore", 0.3);
         get_parameter("historyKeyframeFitnessScore", historyKeyframeFitnessScore);
+        declare_parameter("useScanContext", false);
+        get_parameter("useScanContext", useScanContext);
+        declare_parameter("scanContextDistThreshold", 0.2);
+        get_parameter("scanContextDistThreshold", scanContextDistThreshold);
+        declare_parameter("scanContextNumCandidates", 3);
+        get_parameter("scanContextNumCandidates", scanContextNumCandidates);
 
         declare_parameter("globalMapVisualizationSearchRadius", 1000.0);
         get_parameter("globalMapVisualizationSearchRadius", globalMapVisualizationSearchRadius);
@@ -307,6 +361,8 @@ public:
         get_parameter("globalMapVisualizationPoseDensity", globalMapVisualizationPoseDensity);
         declare_parameter("globalMapVisualizationLeafSize", 1.0);
         get_parameter("globalMapVisualizationLeafSize", globalMapVisualizationLeafSize);
+        declare_parameter("globalMapVisualizationTileSize", 50.0);
+        get_parameter("globalMapVisualizationTileSize", globalMapVisualizationTileSize);
 
         usleep(100);
     }
@@ -345,15 +401,73 @@ public:
 };
 
 
-sensor_msgs::msg::PointCloud2 publishCloud(rclcpp::Publisher<sensor_msgs::msg::PointCloud2>::SharedPtr thisPub, pcl::PointCloud<PointType>::Ptr thisCloud, rclcpp::Time thisStamp, std::string thisFrame)
+inline void publishCloud(rclcpp::Publisher<sensor_msgs::msg::PointCloud2>::SharedPtr thisPub, pcl::PointCloud<PointType>::ConstPtr thisCloud, rclcpp::Time thisStamp, std::string thisFrame)
 {
+    if (thisPub->get_subscription_count() == 0)
+        return;
     sensor_msgs::msg::PointCloud2 tempCloud;
     pcl::toROSMsg(*thisCloud, tempCloud);
     tempCloud.header.stamp = thisStamp;
     tempCloud.header.frame_id = thisFrame;
-    if (thisPub->get_subscription_count() != 0)
-        thisPub->publish(tempCloud);
-    return tempCloud;
+    thisPub->publish(tempCloud);
+}
+
+/*
+    * Fills the PointCloud2 field of a CloudInfo about to be published by cloudInfoPub. When every subscriber is in
+    * this process, the cloud itself is handed over through CloudChannel, and the field only gets a header, without
+    * point fields; returns true then, and the cloud must not be changed anymore. Otherwise the cloud is serialized
+    * into the field.
+    */
+inline bool packCloud(const rclcpp::PublisherBase& cloudInfoPub, const std::string& field, const pcl::PointCloud<PointType>::ConstPtr& thisCloud,
+                      sensor_msgs::msg::PointCloud2& cloudMsg, rclcpp::Time thisStamp, std::string thisFrame)
+{
+    size_t numSubscribers = cloudInfoPub.get_subscription_count();
+    size_t numIntraProcess = cloudInfoPub.get_intra_process_subscription_count();
+    bool handOver = numSubscribers > 0 && numIntraProcess == numSubscribers;
+    if (handOver)
+    {
+        cloudMsg = sensor_msgs::msg::PointCloud2();
+        CloudChannel<PointType>::instance().put(field, thisStamp.nanoseconds(), thisCloud, numIntraProcess);
+    }
+    else
+    {
+        pcl::toROSMsg(*thisCloud, cloudMsg);
+    }
+    cloudMsg.header.stamp = thisStamp;
+    cloudMsg.header.frame_id = thisFrame;
+    return handOver;
+}
+
+// as above, for a cloud reused from scan to scan: it is replaced by a new one if handed over
+inline void packCloud(const rclcpp::PublisherBase& cloudInfoPub, const std::string& field, pcl::PointCloud<PointType>::Ptr& thisCloud,
+                      sensor_msgs::msg::PointCloud2& cloudMsg, rclcpp::Time thisStamp, std::string thisFrame)
+{
+    if (packCloud(cloudInfoPub, field, pcl::PointCloud<PointType>::ConstPtr(thisCloud), cloudMsg, thisStamp, thisFrame))
+    {
+        pcl::PointCloud<PointType>::Ptr newCloud(new pcl::PointCloud<PointType>());
+        newCloud->reserve(thisCloud->size());
+        thisCloud = newCloud;
+    }
+}
+
+/*
+    * The cloud of a CloudInfo field filled by packCloud: the one handed over through CloudChannel, or cloud with
+    * the field deserialized into it.
+    */
+inline pcl::PointCloud<PointType>::ConstPtr unpackCloud(const std::string& field, const sensor_msgs::msg::PointCloud2& cloudMsg,
+                                                        const pcl::PointCloud<PointType>::Ptr& cloud)
+{
+    if (cloudMsg.fields.empty())
+    {
+        auto handedOver = CloudChannel<PointType>::instance().take(field, rclcpp::Time(cloudMsg.header.stamp).nanoseconds());
+        if (handedOver)
+            return handedOver;
+        RCLCPP_ERROR(rclcpp::get_logger("lio_sam"), "The %s cloud handed over in process is missing", field.c_str());
+        cloud->clear();
+        return cloud;
+    }
+    pcl::fromROSMsg(cloudMsg, *cloud);
+    return cloud;
 }
 
 template<typename T>
@@ -395,18 +509,18 @@ void imuRPY2rosRPY(sensor_msgs::msg::Imu *thisImuMsg, T *rosRoll, T *rosPitch, T
 }
 
 
-float pointDistance(PointType p)
+inline float pointDistance(PointType p)
 {
     return sqrt(p.x*p.x + p.y*p.y + p.z*p.z);
 }
 
 
-float pointDistance(PointType p1, PointType p2)
+inline float pointDistance(PointType p1, PointType p2)
 {
     return sqrt((p1.x-p2.x)*(p1.x-p2.x) + (p1.y-p2.y)*(p1.y-p2.y) + (p1.z-p2.z)*(p1.z-p2.z));
 }
 
-rmw_qos_profile_t qos_profile{
+static rmw_qos_profile_t qos_profile{
     RMW_QOS_POLICY_HISTORY_KEEP_LAST,
     1,
     RMW_QOS_POLICY_RELIABILITY_BEST_EFFORT,
@@ -418,14 +532,14 @@ rmw_qos_profile_t qos_profile{
     false
 };
 
-auto qos = rclcpp::QoS(
+static auto qos = rclcpp::QoS(
     rclcpp::QoSInitialization(
         qos_profile.history,
         qos_profile.depth
     ),
     qos_profile);
 
-rmw_qos_profile_t qos_profile_imu{
+static rmw_qos_profile_t qos_profile_imu{
     RMW_QOS_POLICY_HISTORY_KEEP_LAST,
     2000,
     RMW_QOS_POLICY_RELIABILITY_BEST_EFFORT,
@@ -437,14 +551,14 @@ rmw_qos_profile_t qos_profile_imu{
     false
 };
 
-auto qos_imu = rclcpp::QoS(
+static auto qos_imu = rclcpp::QoS(
     rclcpp::QoSInitialization(
         qos_profile_imu.history,
         qos_profile_imu.depth
     ),
     qos_profile_imu);
 
-rmw_qos_profile_t qos_profile_lidar{
+static rmw_qos_profile_t qos_profile_lidar{
     RMW_QOS_POLICY_HISTORY_KEEP_LAST,
     5,
     RMW_QOS_POLICY_RELIABILITY_BEST_EFFORT,
@@ -456,7 +570,7 @@ rmw_qos_profile_t qos_profile_lidar{
     false
 };
 
-auto qos_lidar = rclcpp::QoS(
+static auto qos_lidar = rclcpp::QoS(
     rclcpp::QoSInitialization(
         qos_profile_lidar.history,
         qos_profile_lidar.depth
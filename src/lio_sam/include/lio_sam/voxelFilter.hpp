@@ -0,0 +1,163 @@
+#pragma once
+#ifndef _VOXEL_FILTER_LIDAR_ODOMETRY_H_
+#define _VOXEL_FILTER_LIDAR_ODOMETRY_H_
+
+#include "voxelMap.hpp"
+
+#include <pcl/point_cloud.h>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+enum class VoxelFilterPolicy
+{
+    CENTROID,    // x, y, z and intensity averaged per voxel, like pcl::VoxelGrid
+    FIRST_POINT  // first point of each voxel in input order, unchanged
+};
+
+/*
+    * Drop-in replacement of pcl::VoxelGrid, bucketing points in a hash grid instead of sorting them.
+    * Large clouds are split in chunks reduced in parallel, and merged in input order, so the voxels and
+    * their order do not depend on the number of threads; the centroids only up to float rounding, as the
+    * chunk sums are added in a different order. The hash maps are kept between calls to avoid allocations.
+    * Points come out in the order their voxels are first hit, not in voxel index order as pcl::VoxelGrid.
+    * Points with a non-finite coordinate are skipped, as pcl::VoxelGrid does.
+    */
+template <typename PointT>
+class VoxelFilter
+{
+public:
+
+    VoxelFilter()
+    : invLeafSize{1, 1, 1}, policy(VoxelFilterPolicy::CENTROID), numThreads(1)
+    {
+    }
+
+    void setLeafSize(float lx, float ly, float lz)
+    {
+        invLeafSize[0] = 1.0 / lx;
+        invLeafSize[1] = 1.0 / ly;
+        invLeafSize[2] = 1.0 / lz;
+    }
+
+    void setPolicy(VoxelFilterPolicy newPolicy)
+    {
+        policy = newPolicy;
+    }
+
+    void setNumThreads(int threads)
+    {
+        numThreads = std::max(threads, 1);
+    }
+
+    void setInputCloud(const typename pcl::PointCloud<PointT>::ConstPtr& cloud)
+    {
+        input = cloud;
+    }
+
+    void filter(pcl::PointCloud<PointT>& output)
+    {
+        const auto& points = input->points;
+        int numPoints = points.size();
+
+        // no point in threading small clouds
+        int numChunks = std::min(numThreads, std::max(numPoints / MIN_POINTS_PER_CHUNK, 1));
+        if ((int)scratch.size() < numChunks)
+            scratch.resize(numChunks);
+
+        #pragma omp parallel for num_threads(numChunks) if (numChunks > 1)
+        for (int c = 0; c < numChunks; ++c)
+        {
+            VoxelTable& table = scratch[c];
+            table.clear();
+
+            int end = (int)((long)numPoints * (c + 1) / numChunks);
+            for (int i = (int)((long)numPoints * c / numChunks); i < end; ++i)
+            {
+                const PointT& p = points[i];
+                if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z))
+                    continue;
+                Voxel& voxel = table[VoxelKey{(int)std::floor(p.x * invLeafSize[0]),
+                                              (int)std::floor(p.y * invLeafSize[1]),
+                                              (int)std::floor(p.z * invLeafSize[2])}];
+                if (voxel.num == 0)
+                    voxel.first = i;
+                voxel.num++;
+                if (policy == VoxelFilterPolicy::CENTROID)
+                {
+                    voxel.x += p.x;
+                    voxel.y += p.y;
+                    voxel.z += p.z;
+                    voxel.intensity += p.intensity;
+                }
+            }
+        }
+
+        // merge the chunks in input order
+        VoxelTable& merged = scratch[0];
+        for (int c = 1; c < numChunks; ++c)
+        {
+            for (const auto& it : scratch[c])
+            {
+                Voxel& voxel = merged[it.first];
+                if (voxel.num == 0)
+                    voxel.first = it.second.first;
+                voxel.num += it.second.num;
+                voxel.x += it.second.x;
+                voxel.y += it.second.y;
+                voxel.z += it.second.z;
+                voxel.intensity += it.second.intensity;
+            }
+        }
+
+        // sort the voxels by their first point, so that the output follows the input order
+        order.clear();
+        order.reserve(merged.size());
+        for (const auto& it : merged)
+            order.push_back(&it.second);
+        std::sort(order.begin(), order.end(), [](const Voxel* a, const Voxel* b){ return a->first < b->first; });
+
+        output.clear();
+        output.reserve(order.size());
+        for (const Voxel* voxel : order)
+        {
+            PointT p = points[voxel->first];
+            if (policy == VoxelFilterPolicy::CENTROID)
+            {
+                float inv = 1.0f / voxel->num;
+                p.x = voxel->x * inv;
+                p.y = voxel->y * inv;
+                p.z = voxel->z * inv;
+                p.intensity = voxel->intensity * inv;
+            }
+            output.push_back(p);
+        }
+        output.width = output.points.size();
+        output.height = 1;
+        output.is_dense = true;
+    }
+
+private:
+
+    static constexpr int MIN_POINTS_PER_CHUNK = 8192;
+
+    struct Voxel
+    {
+        float x = 0, y = 0, z = 0, intensity = 0;
+        int num = 0;
+        int first = 0;
+    };
+
+    typedef std::unordered_map<VoxelKey, Voxel, VoxelKeyHash> VoxelTable;
+
+    typename pcl::PointCloud<PointT>::ConstPtr input;
+    float invLeafSize[3];
+    VoxelFilterPolicy policy;
+    int numThreads;
+    std::vector<VoxelTable> scratch;
+    std::vector<const Voxel*> order;
+};
+
+#endif
@@ -0,0 +1,197 @@
+#pragma once
+#ifndef _VOXEL_MAP_LIDAR_ODOMETRY_H_
+#define _VOXEL_MAP_LIDAR_ODOMETRY_H_
+
+#include <pcl/point_cloud.h>
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <unordered_map>
+
+/*
+    * Integer coordinate of a voxel, shared by all the voxel hash structures
+    */
+struct VoxelKey
+{
+    int x;
+    int y;
+    int z;
+
+    bool operator==(const VoxelKey& other) const
+    {
+        return x == other.x && y == other.y && z == other.z;
+    }
+};
+
+struct VoxelKeyHash
+{
+    size_t operator()(const VoxelKey& key) const
+    {
+        return ((size_t)key.x * 73856093) ^ ((size_t)key.y * 19349663) ^ ((size_t)key.z * 83492791);
+    }
+};
+
+inline VoxelKey toVoxelKey(float x, float y, float z, float invResolution)
+{
+    VoxelKey key;
+    key.x = (int)std::floor(x * invResolution);
+    key.y = (int)std::floor(y * invResolution);
+    key.z = (int)std::floor(z * invResolution);
+    return key;
+}
+
+/*
+    * Local map for scan-to-map matching, kept in a voxel hash map and updated incrementally.
+    * Each voxel keeps at most maxPointsPerVoxel points, which are at least minPointDist apart,
+    * so inserting a key frame twice does not grow the map. Neighbours are searched in place in the
+    * 27 voxels around the query point, which is exact for neighbours within one voxel size.
+    */
+template <typename PointT>
+class VoxelMap
+{
+public:
+
+    VoxelMap()
+    {
+        setParams(1.0, 20, 0.0);
+    }
+
+    void setParams(float voxelSize, int maxPoints, float minPointDist)
+    {
+        resolution = voxelSize;
+        invResolution = 1.0 / voxelSize;
+        maxPointsPerVoxel = maxPoints;
+        minPointSqDist = minPointDist * minPointDist;
+        clear();
+    }
+
+    void clear()
+    {
+        voxels.clear();
+        numPoints = 0;
+    }
+
+    size_t size() const
+    {
+        return numPoints;
+    }
+
+    void insert(const pcl::PointCloud<PointT>& cloud)
+    {
+        for (const auto& point : cloud.points)
+            insertPoint(point);
+    }
+
+    void insertPoint(const PointT& point)
+    {
+        std::vector<PointT>& voxel = voxels[toVoxelKey(point.x, point.y, point.z, invResolution)];
+        if ((int)voxel.size() >= maxPointsPerVoxel)
+            return;
+
+        for (const auto& p : voxel)
+        {
+            if (sqDistance(p, point) < minPointSqDist)
+                return;
+        }
+
+        if (voxel.empty())
+            voxel.reserve(maxPointsPerVoxel);
+        voxel.push_back(point);
+        numPoints++;
+    }
+
+    // drop the voxels out of the cube of half size radius around center
+    void removeFarVoxels(const PointT& center, float radius)
+    {
+        VoxelKey c = toVoxelKey(center.x, center.y, center.z, invResolution);
+        int r = (int)std::ceil(radius * invResolution);
+
+        for (auto it = voxels.begin(); it != voxels.end(); )
+        {
+            const VoxelKey& k = it->first;
+            if (std::abs(k.x - c.x) > r || std::abs(k.y - c.y) > r || std::abs(k.z - c.z) > r)
+            {
+                numPoints -= it->second.size();
+                it = voxels.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    // same contract as KdTreeFLANN::nearestKSearch, except that neighbours are returned by value
+    // and that fewer than k neighbours may be found. Safe to call from multiple threads.
+    int nearestKSearch(const PointT& point, int k, std::vector<PointT>& nearPoints, std::vector<float>& nearSqDis) const
+    {
+        nearPoints.clear();
+        nearSqDis.clear();
+
+        VoxelKey c = toVoxelKey(point.x, point.y, point.z, invResolution);
+        VoxelKey key;
+        for (key.x = c.x - 1; key.x <= c.x + 1; ++key.x)
+        for (key.y = c.y - 1; key.y <= c.y + 1; ++key.y)
+        for (key.z = c.z - 1; key.z <= c.z + 1; ++key.z)
+        {
+            auto it = voxels.find(key);
+            if (it == voxels.end())
+                continue;
+
+            for (const auto& p : it->second)
+            {
+                float d = sqDistance(p, point);
+                if ((int)nearSqDis.size() == k && d >= nearSqDis.back())
+                    continue;
+
+                // insertion into the sorted k nearest
+                int j = (int)nearSqDis.size();
+                if (j < k)
+                {
+                    nearSqDis.push_back(d);
+                    nearPoints.push_back(p);
+                }
+                else
+                {
+                    j = k - 1;
+                }
+                for (; j > 0 && nearSqDis[j - 1] > d; --j)
+                {
+                    nearSqDis[j] = nearSqDis[j - 1];
+                    nearPoints[j] = nearPoints[j - 1];
+                }
+                nearSqDis[j] = d;
+                nearPoints[j] = p;
+            }
+        }
+
+        return (int)nearSqDis.size();
+    }
+
+    void getCloud(pcl::PointCloud<PointT>& cloud) const
+    {
+        cloud.clear();
+        cloud.reserve(numPoints);
+        for (const auto& voxel : voxels)
+            for (const auto& p : voxel.second)
+                cloud.push_back(p);
+    }
+
+private:
+
+    static float sqDistance(const PointT& p1, const PointT& p2)
+    {
+        return (p1.x-p2.x)*(p1.x-p2.x) + (p1.y-p2.y)*(p1.y-p2.y) + (p1.z-p2.z)*(p1.z-p2.z);
+    }
+
+    float resolution;
+    float invResolution;
+    int maxPointsPerVoxel;
+    float minPointSqDist;
+    size_t numPoints;
+    std::unordered_map<VoxelKey, std::vector<PointT>, VoxelKeyHash> voxels;
+};
+
+#endif
@@ -2,8 +2,10 @@ import os
 from ament_index_python.packages import get_package_share_directory
 from launch import LaunchDescription
 from launch.actions import DeclareLaunchArgument
+from launch.conditions import IfCondition, UnlessCondition
 from launch.substitutions import LaunchConfiguration, Command
-from launch_ros.actions import Node
+from launch_ros.actions import Node, ComposableNodeContainer
+from launch_ros.descriptions import ComposableNode
 
 
 def generate_launch_description():
@@ -19,10 +21,44 @@ def generate_launch_description():
             share_dir, 'config', 'params.yaml'),
         description='FPath to the ROS2 parameters file to use.')
 
+    use_composition = LaunchConfiguration('use_composition')
+    composition_declare = DeclareLaunchArgument(
+        'use_composition',
+        default_value='false',
+        description='Run the LIO-SAM nodes as components of one process, with intra-process communication.')
+
+    lio_sam_nodes = [
+        ('lio_sam_imuPreintegration', 'IMUPreintegration'),
+        ('lio_sam_transformFusion', 'TransformFusion'),
+        ('lio_sam_imageProjection', 'ImageProjection'),
+        ('lio_sam_featureExtraction', 'FeatureExtraction'),
+        ('lio_sam_mapOptimization', 'mapOptimization'),
+    ]
+
+    lio_sam_container = ComposableNodeContainer(
+        name='lio_sam_container',
+        namespace='',
+        package='rclcpp_components',
+        executable='component_container_mt',
+        composable_node_descriptions=[
+            ComposableNode(
+                package='lio_sam',
+                plugin=plugin,
+                name=name,
+                parameters=[parameter_file],
+                extra_arguments=[{'use_intra_process_comms': True}])
+            for name, plugin in lio_sam_nodes
+        ],
+        condition=IfCondition(use_composition),
+        output='screen'
+    )
+
     print("urdf_file_name : {}".format(xacro_path))
 
     return LaunchDescription([
         params_declare,
+        composition_declare,
+        lio_sam_container,
         Node(
             package='tf2_ros',
             executable='static_transform_publisher',
@@ -44,6 +80,7 @@ def generate_launch_description():
             executable='lio_sam_imuPreintegration',
             name='lio_sam_imuPreintegration',
             parameters=[parameter_file],
+            condition=UnlessCondition(use_composition),
             output='screen'
         ),
         Node(
@@ -51,6 +88,7 @@ def generate_launch_description():
             executable='lio_sam_imageProjection',
             name='lio_sam_imageProjection',
             parameters=[parameter_file],
+            condition=UnlessCondition(use_composition),
             output='screen'
         ),
         Node(
@@ -58,6 +96,7 @@ def generate_launch_description():
             executable='lio_sam_featureExtraction',
             name='lio_sam_featureExtraction',
             parameters=[parameter_file],
+            condition=UnlessCondition(use_composition),
             output='screen'
         ),
         Node(
@@ -65,6 +104,7 @@ def generate_launch_description():
             executable='lio_sam_mapOptimization',
             name='lio_sam_mapOptimization',
             parameters=[parameter_file],
+            condition=UnlessCondition(use_composition),
             output='screen'
         ),
         Node(
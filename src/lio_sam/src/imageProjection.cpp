@@ -57,7 +57,7 @@ private:
     rclcpp::CallbackGroup::SharedPtr callbackGroupOdom;
     std::deque<nav_msgs::msg::Odometry> odomQueue;
 
-    std::deque<sensor_msgs::msg::PointCloud2> cloudQueue;
+    std::deque<sensor_msgs::msg::PointCloud2> cloudQueue; // messages are moved in, not copied
     sensor_msgs::msg::PointCloud2 currentCloudMsg;
 
     double *imuTime = new double[queueLength];
@@ -90,6 +90,10 @@ private:
 
     vector<int> columnIdnCountVec;
 
+    bool organizedInput = false; // the current cloud is organized as the range image, see useOrganizedCloud
+    std::vector<Eigen::Affine3f, Eigen::aligned_allocator<Eigen::Affine3f>> columnTransBt;
+    std::vector<bool> columnDeskewed;
+
 
 public:
     ImageProjection(const rclcpp::NodeOptions & options) :
@@ -142,15 +146,24 @@ public:
 
         fullCloud->points.resize(N_SCAN*Horizon_SCAN);
 
-        cloudInfo.start_ring_index.assign(N_SCAN, 0);
-        cloudInfo.end_ring_index.assign(N_SCAN, 0);
-
-        cloudInfo.point_col_ind.assign(N_SCAN*Horizon_SCAN, 0);
-        cloudInfo.point_range.assign(N_SCAN*Horizon_SCAN, 0);
+        resetCloudInfo();
 
         resetParameters();
     }
 
+    void resetCloudInfo()
+    {
+        // the arrays are moved out with the published message; the point arrays are filled by cloudExtraction,
+        // from a reservation of the size of the last scan, instead of being zero-filled for the whole range image
+        cloudInfo.start_ring_index.resize(N_SCAN);
+        cloudInfo.end_ring_index.resize(N_SCAN);
+
+        cloudInfo.point_col_ind.clear();
+        cloudInfo.point_col_ind.reserve(extractedCloud->points.capacity());
+        cloudInfo.point_range.clear();
+        cloudInfo.point_range.reserve(extractedCloud->points.capacity());
+    }
+
     void resetParameters()
     {
         laserCloudIn->clear();
@@ -205,7 +218,7 @@ public:
         odomQueue.push_back(*odometryMsg);
     }
 
-    void cloudHandler(const sensor_msgs::msg::PointCloud2::SharedPtr laserCloudMsg)
+    void cloudHandler(sensor_msgs::msg::PointCloud2::UniquePtr laserCloudMsg)
     {
         if (!cachePointCloud(laserCloudMsg))
             return;
@@ -222,10 +235,10 @@ public:
         resetParameters();
     }
 
-    bool cachePointCloud(const sensor_msgs::msg::PointCloud2::SharedPtr& laserCloudMsg)
+    bool cachePointCloud(sensor_msgs::msg::PointCloud2::UniquePtr& laserCloudMsg)
     {
         // cache point cloud
-        cloudQueue.push_back(*laserCloudMsg);
+        cloudQueue.push_back(std::move(*laserCloudMsg));
         if (cloudQueue.size() <= 2)
             return false;
 
@@ -241,6 +254,8 @@ public:
             // Convert to Velodyne format
             pcl::moveFromROSMsg(currentCloudMsg, *tmpOusterCloudIn);
             laserCloudIn->points.resize(tmpOusterCloudIn->size());
+            laserCloudIn->width = tmpOusterCloudIn->width;
+            laserCloudIn->height = tmpOusterCloudIn->height;
             laserCloudIn->is_dense = tmpOusterCloudIn->is_dense;
             for (size_t i = 0; i < tmpOusterCloudIn->size(); i++)
             {
@@ -263,14 +278,28 @@ public:
         // get timestamp
         cloudHeader = currentCloudMsg.header;
         timeScanCur = stamp2Sec(cloudHeader.stamp);
-        timeScanEnd = timeScanCur + laserCloudIn->points.back().time;
     
+        // organized clouds keep their NaN points, to keep the layout of the range image
+        organizedInput = useOrganizedCloud &&
+                         (int)laserCloudIn->height == N_SCAN && (int)laserCloudIn->width == Horizon_SCAN;
+
         // remove Nan
         vector<int> indices;
-        pcl::removeNaNFromPointCloud(*laserCloudIn, *laserCloudIn, indices);
+        if (!organizedInput)
+            pcl::removeNaNFromPointCloud(*laserCloudIn, *laserCloudIn, indices);
+
+        // the scan ends at its latest valid point; the last points of an organized cloud
+        // can be NaN returns, with no time
+        float timeLastPoint = 0;
+        for (const auto& point : laserCloudIn->points)
+        {
+            if (std::isfinite(point.x) && std::isfinite(point.y) && std::isfinite(point.z))
+                timeLastPoint = std::max(timeLastPoint, point.time);
+        }
+        timeScanEnd = timeScanCur + timeLastPoint;
 
         // check dense flag
-        if (laserCloudIn->is_dense == false)
+        if (laserCloudIn->is_dense == false && !organizedInput)
         {
             RCLCPP_ERROR(get_logger(), "Point cloud is not in dense format, please remove NaN points first!");
             rclcpp::shutdown();
@@ -555,8 +584,94 @@ public:
         return newPoint;
     }
 
+    void projectOrganizedPointCloud()
+    {
+        const auto& points = laserCloudIn->points;
+        bool deskew = !(deskewFlag == -1 || cloudInfo.imu_available == false);
+
+        if (deskew)
+        {
+            // all the points of a column are fired at the same time, so compute one transform per column,
+            // at the time of its first valid point
+            columnTransBt.resize(Horizon_SCAN);
+            columnDeskewed.assign(Horizon_SCAN, false);
+            float timeStart = FLT_MAX;
+            for (int j = 0; j < Horizon_SCAN; ++j)
+            {
+                for (int i = 0; i < N_SCAN; ++i)
+                {
+                    const auto& p = points[j + i * Horizon_SCAN];
+                    if (std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z))
+                    {
+                        float rotXCur, rotYCur, rotZCur, posXCur, posYCur, posZCur;
+                        findRotation(timeScanCur + p.time, &rotXCur, &rotYCur, &rotZCur);
+                        findPosition(p.time, &posXCur, &posYCur, &posZCur);
+                        columnTransBt[j] = pcl::getTransformation(posXCur, posYCur, posZCur, rotXCur, rotYCur, rotZCur);
+                        columnDeskewed[j] = true;
+
+                        // points are transformed to the start of the scan
+                        if (p.time < timeStart)
+                        {
+                            timeStart = p.time;
+                            transStartInverse = columnTransBt[j].inverse();
+                        }
+                        break;
+                    }
+                }
+            }
+            for (int j = 0; j < Horizon_SCAN; ++j)
+            {
+                if (columnDeskewed[j])
+                    columnTransBt[j] = transStartInverse * columnTransBt[j];
+            }
+        }
+
+        // range image projection, rows in parallel
+        #pragma omp parallel for num_threads(numberOfCores)
+        for (int rowIdn = 0; rowIdn < N_SCAN; ++rowIdn)
+        {
+            if (rowIdn % downsampleRate != 0)
+                continue;
+
+            for (int columnIdn = 0; columnIdn < Horizon_SCAN; ++columnIdn)
+            {
+                int index = columnIdn + rowIdn * Horizon_SCAN;
+                const auto& p = points[index];
+                if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z))
+                    continue;
+
+                PointType thisPoint;
+                thisPoint.x = p.x;
+                thisPoint.y = p.y;
+                thisPoint.z = p.z;
+                thisPoint.intensity = p.intensity;
+
+                float range = pointDistance(thisPoint);
+                if (range < lidarMinRange || range > lidarMaxRange)
+                    continue;
+
+                if (deskew && columnDeskewed[columnIdn])
+                {
+                    const Eigen::Affine3f& transBt = columnTransBt[columnIdn];
+                    thisPoint.x = transBt(0,0) * p.x + transBt(0,1) * p.y + transBt(0,2) * p.z + transBt(0,3);
+                    thisPoint.y = transBt(1,0) * p.x + transBt(1,1) * p.y + transBt(1,2) * p.z + transBt(1,3);
+                    thisPoint.z = transBt(2,0) * p.x + transBt(2,1) * p.y + transBt(2,2) * p.z + transBt(2,3);
+                }
+
+                rangeMat.at<float>(rowIdn, columnIdn) = range;
+                fullCloud->points[index] = thisPoint;
+            }
+        }
+    }
+
     void projectPointCloud()
     {
+        if (organizedInput)
+        {
+            projectOrganizedPointCloud();
+            return;
+        }
+
         int cloudSize = laserCloudIn->points.size();
         // range image projection
         for (int i = 0; i < cloudSize; ++i)
@@ -630,9 +745,9 @@ public:
                 if (rangeMat.at<float>(i,j) != FLT_MAX)
                 {
                     // mark the points' column index for marking occlusion later
-                    cloudInfo.point_col_ind[count] = j;
+                    cloudInfo.point_col_ind.push_back(j);
                     // save range info
-                    cloudInfo.point_range[count] = rangeMat.at<float>(i,j);
+                    cloudInfo.point_range.push_back(rangeMat.at<float>(i,j));
                     // save extracted cloud
                     extractedCloud->push_back(fullCloud->points[j + i*Horizon_SCAN]);
                     // size of extracted cloud
@@ -646,11 +761,18 @@ public:
     void publishClouds()
     {
         cloudInfo.header = cloudHeader;
-        cloudInfo.cloud_deskewed  = publishCloud(pubExtractedCloud, extractedCloud, cloudHeader.stamp, lidarFrame);
-        pubLaserCloudInfo->publish(cloudInfo);
+        publishCloud(pubExtractedCloud, extractedCloud, cloudHeader.stamp, lidarFrame);
+        packCloud(*pubLaserCloudInfo, "cloud_deskewed", extractedCloud, cloudInfo.cloud_deskewed, cloudHeader.stamp, lidarFrame);
+        // move the cloud info out, so that it is passed by pointer with intra-process communication
+        pubLaserCloudInfo->publish(std::make_unique<lio_sam::msg::CloudInfo>(std::move(cloudInfo)));
+        resetCloudInfo();
     }
 };
 
+#ifdef LIO_SAM_COMPONENTS
+#include "rclcpp_components/register_node_macro.hpp"
+RCLCPP_COMPONENTS_REGISTER_NODE(ImageProjection)
+#else
 int main(int argc, char** argv)
 {
     rclcpp::init(argc, argv);
@@ -669,3 +791,4 @@ int main(int argc, char** argv)
     rclcpp::shutdown();
     return 0;
 }
+#endif
@@ -1,4 +1,5 @@
 #include "utility.hpp"
+#include "spscRing.hpp"
 
 #include <gtsam/geometry/Rot3.h>
 #include <gtsam/geometry/Pose3.h>
@@ -169,11 +170,32 @@ public:
     }
 };
 
+/*
+    * The imu thread (imuHandler) and the optimization thread (odometryHandler) share no lock. Raw samples go to the
+    * optimization through a lock-free ring, and each optimization result comes back as a snapshot that the imu
+    * thread applies before its next sample, re-propagating the samples it has queued since the correction time.
+    * The imu odometry is integrated at every sample, and published at imuOdometryRate.
+    */
 class IMUPreintegration : public ParamServer
 {
 public:
 
-    std::mutex mtx;
+    struct ImuSample
+    {
+        double time;
+        gtsam::Vector3 acc;
+        gtsam::Vector3 gyr;
+    };
+
+    struct Correction
+    {
+        double time = -1;
+        bool valid = false;    // state and bias are optimized, otherwise the imu odometry stops until the next one
+        bool restart = false;  // the optimization was initialized at time
+        int overflows = 0;     // ring overflows handled by this restart
+        gtsam::NavState state;
+        gtsam::imuBias::ConstantBias bias;
+    };
 
     rclcpp::Subscription<sensor_msgs::msg::Imu>::SharedPtr subImu;
     rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr subOdometry;
@@ -195,8 +217,20 @@ public:
     gtsam::PreintegratedImuMeasurements *imuIntegratorOpt_;
     gtsam::PreintegratedImuMeasurements *imuIntegratorImu_;
 
-    std::deque<sensor_msgs::msg::Imu> imuQueOpt;
-    std::deque<sensor_msgs::msg::Imu> imuQueImu;
+    // imu thread to optimization thread
+    SpscRing<ImuSample> imuRing{4096};
+    std::atomic<int> imuOverflows{0};
+    bool feedingOptimization = true;
+
+    // optimization thread to imu thread
+    std::mutex correctionMtx;
+    Correction correction;
+    std::atomic<int> correctionVersion{0};
+    int correctionVersionSeen = 0;
+
+    std::deque<ImuSample> imuQueOpt; // optimization thread
+    std::deque<ImuSample> imuQueImu; // imu thread
+    int overflowsSeen = 0;
 
     gtsam::Pose3 prevPose_;
     gtsam::Vector3 prevVel_;
@@ -209,6 +243,7 @@ public:
     bool doneFirstOpt = false;
     double lastImuT_imu = -1;
     double lastImuT_opt = -1;
+    double lastOdometryT = -1;
 
     gtsam::ISAM2 optimizer;
     gtsam::NonlinearFactorGraph graphFactors;
@@ -278,19 +313,38 @@ public:
 
     void resetParams()
     {
-        lastImuT_imu = -1;
-        doneFirstOpt = false;
         systemInitialized = false;
+        publishCorrection(Correction());
     }
 
-    void odometryHandler(const nav_msgs::msg::Odometry::SharedPtr odomMsg)
+    void publishCorrection(const Correction& latest)
     {
-        std::lock_guard<std::mutex> lock(mtx);
+        std::lock_guard<std::mutex> lock(correctionMtx);
+        correction = latest;
+        correctionVersion.fetch_add(1, std::memory_order_release);
+    }
 
+    void odometryHandler(const nav_msgs::msg::Odometry::SharedPtr odomMsg)
+    {
         double currentCorrectionTime = stamp2Sec(odomMsg->header.stamp);
 
+        ImuSample sample;
+        while (imuRing.pop(sample))
+            imuQueOpt.push_back(sample);
+
+        // the imu thread stopped feeding the ring when it was full, restart here and it sends the samples again from now
+        int overflows = imuOverflows.load();
+        bool overflowed = overflows != overflowsSeen;
+        if (overflowed)
+        {
+            overflowsSeen = overflows;
+            while (!imuQueOpt.empty() && imuQueOpt.back().time >= currentCorrectionTime - delta_t)
+                imuQueOpt.pop_back();
+            systemInitialized = false;
+        }
+
         // make sure we have imu data to integrate
-        if (imuQueOpt.empty())
+        if (imuQueOpt.empty() && !overflowed)
             return;
 
         float p_x = odomMsg->pose.pose.position.x;
@@ -312,9 +366,9 @@ public:
             // pop old IMU message
             while (!imuQueOpt.empty())
             {
-                if (stamp2Sec(imuQueOpt.front().header.stamp) < currentCorrectionTime - delta_t)
+                if (imuQueOpt.front().time < currentCorrectionTime - delta_t)
                 {
-                    lastImuT_opt = stamp2Sec(imuQueOpt.front().header.stamp);
+                    lastImuT_opt = imuQueOpt.front().time;
                     imuQueOpt.pop_front();
                 }
                 else
@@ -346,6 +400,12 @@ public:
             
             key = 1;
             systemInitialized = true;
+
+            Correction restart;
+            restart.time = currentCorrectionTime;
+            restart.restart = true;
+            restart.overflows = overflowsSeen;
+            publishCorrection(restart);
             return;
         }
 
@@ -385,15 +445,13 @@ public:
         while (!imuQueOpt.empty())
         {
             // pop and integrate imu data that is between two optimizations
-            sensor_msgs::msg::Imu *thisImu = &imuQueOpt.front();
-            double imuTime = stamp2Sec(thisImu->header.stamp);
+            const ImuSample& thisImu = imuQueOpt.front();
+            double imuTime = thisImu.time;
             if (imuTime < currentCorrectionTime - delta_t)
             {
                 double dt = (lastImuT_opt < 0) ? (1.0 / 500.0) : (imuTime - lastImuT_opt);
-                imuIntegratorOpt_->integrateMeasurement(
-                        gtsam::Vector3(thisImu->linear_acceleration.x, thisImu->linear_acceleration.y, thisImu->linear_acceleration.z),
-                        gtsam::Vector3(thisImu->angular_velocity.x,    thisImu->angular_velocity.y,    thisImu->angular_velocity.z), dt);
-                
+                imuIntegratorOpt_->integrateMeasurement(thisImu.acc, thisImu.gyr, dt);
+
                 lastImuT_opt = imuTime;
                 imuQueOpt.pop_front();
             }
@@ -437,36 +495,15 @@ public:
         }
 
 
-        // 2. after optiization, re-propagate imu odometry preintegration
-        prevStateOdom = prevState_;
-        prevBiasOdom  = prevBias_;
-        // first pop imu message older than current correction data
-        double lastImuQT = -1;
-        while (!imuQueImu.empty() && stamp2Sec(imuQueImu.front().header.stamp) < currentCorrectionTime - delta_t)
-        {
-            lastImuQT = stamp2Sec(imuQueImu.front().header.stamp);
-            imuQueImu.pop_front();
-        }
-        // repropogate
-        if (!imuQueImu.empty())
-        {
-            // reset bias use the newly optimized bias
-            imuIntegratorImu_->resetIntegrationAndSetBias(prevBiasOdom);
-            // integrate imu message from the beginning of this optimization
-            for (int i = 0; i < (int)imuQueImu.size(); ++i)
-            {
-                sensor_msgs::msg::Imu *thisImu = &imuQueImu[i];
-                double imuTime = stamp2Sec(thisImu->header.stamp);
-                double dt = (lastImuQT < 0) ? (1.0 / 500.0) :(imuTime - lastImuQT);
-
-                imuIntegratorImu_->integrateMeasurement(gtsam::Vector3(thisImu->linear_acceleration.x, thisImu->linear_acceleration.y, thisImu->linear_acceleration.z),
-                                                        gtsam::Vector3(thisImu->angular_velocity.x,    thisImu->angular_velocity.y,    thisImu->angular_velocity.z), dt);
-                lastImuQT = imuTime;
-            }
-        }
+        // 2. hand the result to the imu thread, which re-propagates the imu odometry from it
+        Correction optimized;
+        optimized.time = currentCorrectionTime;
+        optimized.valid = true;
+        optimized.state = prevState_;
+        optimized.bias = prevBias_;
+        publishCorrection(optimized);
 
         ++key;
-        doneFirstOpt = true;
     }
 
     bool failureDetection(const gtsam::Vector3& velCur, const gtsam::imuBias::ConstantBias& biasCur)
@@ -489,32 +526,103 @@ public:
         return false;
     }
 
+    void applyCorrection()
+    {
+        Correction latest;
+        {
+            std::lock_guard<std::mutex> lock(correctionMtx);
+            latest = correction;
+            correctionVersionSeen = correctionVersion.load(std::memory_order_relaxed);
+        }
+
+        // after an overflow, send the samples the optimization needs from its restart
+        if (latest.restart && !feedingOptimization && latest.overflows == imuOverflows.load())
+        {
+            feedingOptimization = true;
+            for (const auto& thisImu : imuQueImu)
+            {
+                if (thisImu.time >= latest.time - delta_t && !imuRing.push(thisImu))
+                {
+                    feedingOptimization = false;
+                    imuOverflows.fetch_add(1);
+                    break;
+                }
+            }
+        }
+
+        if (latest.valid == false)
+        {
+            lastImuT_imu = -1;
+            doneFirstOpt = false;
+            return;
+        }
+
+        prevStateOdom = latest.state;
+        prevBiasOdom  = latest.bias;
+        // first pop imu message older than current correction data
+        double lastImuQT = -1;
+        while (!imuQueImu.empty() && imuQueImu.front().time < latest.time - delta_t)
+        {
+            lastImuQT = imuQueImu.front().time;
+            imuQueImu.pop_front();
+        }
+        // repropogate
+        if (!imuQueImu.empty())
+        {
+            // reset bias use the newly optimized bias
+            imuIntegratorImu_->resetIntegrationAndSetBias(prevBiasOdom);
+            // integrate imu message from the beginning of this optimization
+            for (const auto& thisImu : imuQueImu)
+            {
+                double dt = (lastImuQT < 0) ? (1.0 / 500.0) :(thisImu.time - lastImuQT);
+                imuIntegratorImu_->integrateMeasurement(thisImu.acc, thisImu.gyr, dt);
+                lastImuQT = thisImu.time;
+            }
+        }
+        doneFirstOpt = true;
+    }
+
     void imuHandler(const sensor_msgs::msg::Imu::SharedPtr imu_raw)
     {
-        std::lock_guard<std::mutex> lock(mtx);
+        ImuSample thisImu;
+        thisImu.time = stamp2Sec(imu_raw->header.stamp);
+        thisImu.acc = extRot * gtsam::Vector3(imu_raw->linear_acceleration.x, imu_raw->linear_acceleration.y, imu_raw->linear_acceleration.z);
+        thisImu.gyr = extRot * gtsam::Vector3(imu_raw->angular_velocity.x, imu_raw->angular_velocity.y, imu_raw->angular_velocity.z);
 
-        sensor_msgs::msg::Imu thisImu = imuConverter(*imu_raw);
+        // a new optimization re-propagates the samples queued so far, so it goes before this one
+        if (correctionVersion.load(std::memory_order_acquire) != correctionVersionSeen)
+            applyCorrection();
 
-        imuQueOpt.push_back(thisImu);
         imuQueImu.push_back(thisImu);
+        if (feedingOptimization && !imuRing.push(thisImu))
+        {
+            // the optimization is not keeping up, or no lidar odometry yet, it restarts at the next one
+            feedingOptimization = false;
+            imuOverflows.fetch_add(1);
+            if (doneFirstOpt)
+                RCLCPP_WARN(get_logger(), "IMU queue full, reset IMU-preintegration!");
+        }
 
         if (doneFirstOpt == false)
             return;
 
-        double imuTime = stamp2Sec(thisImu.header.stamp);
+        double imuTime = thisImu.time;
         double dt = (lastImuT_imu < 0) ? (1.0 / 500.0) : (imuTime - lastImuT_imu);
         lastImuT_imu = imuTime;
 
         // integrate this single imu message
-        imuIntegratorImu_->integrateMeasurement(gtsam::Vector3(thisImu.linear_acceleration.x, thisImu.linear_acceleration.y, thisImu.linear_acceleration.z),
-                                                gtsam::Vector3(thisImu.angular_velocity.x,    thisImu.angular_velocity.y,    thisImu.angular_velocity.z), dt);
+        imuIntegratorImu_->integrateMeasurement(thisImu.acc, thisImu.gyr, dt);
+
+        if (imuOdometryRate > 0 && imuTime - lastOdometryT < 1.0 / imuOdometryRate)
+            return;
+        lastOdometryT = imuTime;
 
         // predict odometry
         gtsam::NavState currentState = imuIntegratorImu_->predict(prevStateOdom, prevBiasOdom);
 
         // publish odometry
         auto odometry = nav_msgs::msg::Odometry();
-        odometry.header.stamp = thisImu.header.stamp;
+        odometry.header.stamp = imu_raw->header.stamp;
         odometry.header.frame_id = odometryFrame;
         odometry.child_frame_id = "odom_imu";
 
@@ -533,14 +641,19 @@ public:
         odometry.twist.twist.linear.x = currentState.velocity().x();
         odometry.twist.twist.linear.y = currentState.velocity().y();
         odometry.twist.twist.linear.z = currentState.velocity().z();
-        odometry.twist.twist.angular.x = thisImu.angular_velocity.x + prevBiasOdom.gyroscope().x();
-        odometry.twist.twist.angular.y = thisImu.angular_velocity.y + prevBiasOdom.gyroscope().y();
-        odometry.twist.twist.angular.z = thisImu.angular_velocity.z + prevBiasOdom.gyroscope().z();
+        odometry.twist.twist.angular.x = thisImu.gyr.x() + prevBiasOdom.gyroscope().x();
+        odometry.twist.twist.angular.y = thisImu.gyr.y() + prevBiasOdom.gyroscope().y();
+        odometry.twist.twist.angular.z = thisImu.gyr.z() + prevBiasOdom.gyroscope().z();
         pubImuOdometry->publish(odometry);
     }
 };
 
 
+#ifdef LIO_SAM_COMPONENTS
+#include "rclcpp_components/register_node_macro.hpp"
+RCLCPP_COMPONENTS_REGISTER_NODE(IMUPreintegration)
+RCLCPP_COMPONENTS_REGISTER_NODE(TransformFusion)
+#else
 int main(int argc, char** argv)
 {   
     rclcpp::init(argc, argv);
@@ -561,3 +674,4 @@ int main(int argc, char** argv)
     rclcpp::shutdown();
     return 0;
 }
+#endif
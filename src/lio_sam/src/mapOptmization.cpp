@@ -1,4 +1,14 @@
 #include "utility.hpp"
+#include "voxelMap.hpp"
+#include "voxelFilter.hpp"
+#include "keyFrameStore.hpp"
+#include "mapExporter.hpp"
+#include "scanContext.hpp"
+#include "loopRegistration.hpp"
+#include "globalMap.hpp"
+#include "keyPoseIndex.hpp"
+#include "sessionStore.hpp"
+#include "scanMatchNormalEquation.hpp"
 #include "lio_sam/msg/cloud_info.hpp"
 #include "lio_sam/srv/save_map.hpp"
 #include <gtsam/geometry/Rot3.h>
@@ -16,6 +26,15 @@
 
 #include <gtsam/nonlinear/ISAM2.h>
 
+#include <Eigen/Dense>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <list>
+#include <set>
+
 using namespace gtsam;
 
 using symbol_shorthand::X; // Pose3 (x,y,z,r,p,y)
@@ -58,6 +77,7 @@ public:
     ISAM2 *isam;
     Values isamCurrentEstimate;
     Eigen::MatrixXd poseCovariance;
+    std::set<Key> activeKeys; // key poses in isam when useFixedLagSmoother, the others are frozen
 
     rclcpp::Publisher<sensor_msgs::msg::PointCloud2>::SharedPtr pubLaserCloudSurround;
     rclcpp::Publisher<nav_msgs::msg::Odometry>::SharedPtr pubLaserOdometryGlobal;
@@ -80,30 +100,26 @@ public:
     std::deque<nav_msgs::msg::Odometry> gpsQueue;
     lio_sam::msg::CloudInfo cloudInfo;
 
-    vector<pcl::PointCloud<PointType>::Ptr> cornerCloudKeyFrames;
-    vector<pcl::PointCloud<PointType>::Ptr> surfCloudKeyFrames;
+    SessionStore<PointType> session; // key frames and factors logged to sessionDirectory, before keyFrames which reads it
+    KeyFrameStore<PointType> keyFrames; // corner and surf clouds of the key frames, in body frame
+    bool sessionResumed = false;
     
     pcl::PointCloud<PointType>::Ptr cloudKeyPoses3D;
     pcl::PointCloud<PointTypePose>::Ptr cloudKeyPoses6D;
     pcl::PointCloud<PointType>::Ptr copy_cloudKeyPoses3D;
     pcl::PointCloud<PointTypePose>::Ptr copy_cloudKeyPoses6D;
 
-    pcl::PointCloud<PointType>::Ptr laserCloudCornerLast; // corner feature set from odoOptimization
-    pcl::PointCloud<PointType>::Ptr laserCloudSurfLast; // surf feature set from odoOptimization
+    pcl::PointCloud<PointType>::ConstPtr laserCloudCornerLast; // corner feature set from odoOptimization
+    pcl::PointCloud<PointType>::ConstPtr laserCloudSurfLast; // surf feature set from odoOptimization
+    pcl::PointCloud<PointType>::ConstPtr laserCloudDeskewed; // deskewed scan, for the registered raw cloud
+    pcl::PointCloud<PointType>::Ptr deserializedCorner, deserializedSurf, deserializedDeskewed; // when not handed over
     pcl::PointCloud<PointType>::Ptr laserCloudCornerLastDS; // downsampled corner feature set from odoOptimization
     pcl::PointCloud<PointType>::Ptr laserCloudSurfLastDS; // downsampled surf feature set from odoOptimization
 
-    pcl::PointCloud<PointType>::Ptr laserCloudOri;
-    pcl::PointCloud<PointType>::Ptr coeffSel;
-
-    std::vector<PointType> laserCloudOriCornerVec; // corner point holder for parallel computation
-    std::vector<PointType> coeffSelCornerVec;
-    std::vector<bool> laserCloudOriCornerFlag;
-    std::vector<PointType> laserCloudOriSurfVec; // surf point holder for parallel computation
-    std::vector<PointType> coeffSelSurfVec;
-    std::vector<bool> laserCloudOriSurfFlag;
+    ScanMatchNormalEquation normalEquation; // accumulated by corner and surf optimization, solved by LMOptimization
+    ScanMatchJacobian scanMatchJacobian; // at the rotation of transformTobeMapped
 
-    map<int, pair<pcl::PointCloud<PointType>, pcl::PointCloud<PointType>>> laserCloudMapContainer;
+    TransformedCloudCache<PointType> laserCloudMapContainer;
     pcl::PointCloud<PointType>::Ptr laserCloudCornerFromMap;
     pcl::PointCloud<PointType>::Ptr laserCloudSurfFromMap;
     pcl::PointCloud<PointType>::Ptr laserCloudCornerFromMapDS;
@@ -112,13 +128,16 @@ public:
     pcl::KdTreeFLANN<PointType>::Ptr kdtreeCornerFromMap;
     pcl::KdTreeFLANN<PointType>::Ptr kdtreeSurfFromMap;
 
-    pcl::KdTreeFLANN<PointType>::Ptr kdtreeSurroundingKeyPoses;
-    pcl::KdTreeFLANN<PointType>::Ptr kdtreeHistoryKeyPoses;
+    VoxelMap<PointType> localCornerMap; // incremental local map, replaces the kd-trees if useIncrementalLocalMap
+    VoxelMap<PointType> localSurfMap;
+    set<int> localMapKeyFrames;
 
-    pcl::VoxelGrid<PointType> downSizeFilterCorner;
-    pcl::VoxelGrid<PointType> downSizeFilterSurf;
-    pcl::VoxelGrid<PointType> downSizeFilterICP;
-    pcl::VoxelGrid<PointType> downSizeFilterSurroundingKeyPoses; // for surrounding key poses of scan-to-map optimization
+    KeyPoseIndex<PointType> keyPoseIndex; // cloudKeyPoses3D, searched by the mapping and loop closure threads
+
+    VoxelFilter<PointType> downSizeFilterCorner;
+    VoxelFilter<PointType> downSizeFilterSurf;
+    VoxelFilter<PointType> downSizeFilterICP;
+    VoxelFilter<PointType> downSizeFilterSurroundingKeyPoses; // for surrounding key poses of scan-to-map optimization
 
     rclcpp::Time timeLaserInfoStamp;
     double timeLaserInfoCur;
@@ -142,6 +161,27 @@ public:
     vector<gtsam::Pose3> loopPoseQueue;
     vector<gtsam::noiseModel::Diagonal::shared_ptr> loopNoiseQueue;
     deque<std_msgs::msg::Float64MultiArray> loopInfoVec;
+    double timeLastLoopClosure; // lidar time of the last synchronous loop closure
+
+    struct LoopCandidate
+    {
+        int keyPre;
+        Eigen::Affine3f guess; // initial alignment of the current key frame, or scan to relocalize, onto the candidate, in the map frame
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+    int keyPosesVersion = 0; // incremented when the key poses are corrected
+    int copiedKeyPosesVersion = -1;
+    ScanContext<PointType> scanContext;
+    std::mutex mtxScanContext; // queried by the mapping thread to relocalize a resumed session
+    PointToPlaneICP<PointType> loopIcp;
+    struct LoopTarget
+    {
+        PointToPlaneICP<PointType>::TargetPtr target;
+        int numKeyFrames; // size of copy_cloudKeyPoses6D when built
+        std::list<int>::iterator lru;
+    };
+    map<int, LoopTarget> loopTargets; // loop closure targets by key frame, built from copy_cloudKeyPoses6D
+    std::list<int> loopTargetsLru; // most recently used first
 
     nav_msgs::msg::Path globalPath;
 
@@ -151,6 +191,18 @@ public:
 
     std::unique_ptr<tf2_ros::TransformBroadcaster> br;
 
+    std::thread loopThread;
+    std::thread visualizeMapThread;
+    std::atomic<bool> running{true}; // cleared by the destructor, so that both threads return
+    std::mutex runningMtx;
+    std::condition_variable runningCv;
+
+    GlobalMapCache<PointType> globalMapCache; // for global map visualization, only used by visualizeMapThread
+    int globalMapKeyFrames = 0;
+    int globalMapPosesVersion = 0;
+    VoxelKey globalMapCenterTile{0, 0, 0};
+    sensor_msgs::msg::PointCloud2 globalMapMsg;
+
     mapOptimization(const rclcpp::NodeOptions & options) : ParamServer("lio_sam_mapOptimization", options)
     {
         ISAM2Params parameters;
@@ -176,6 +228,7 @@ public:
             "lio_loop/loop_closure_detection", qos,
             std::bind(&mapOptimization::loopInfoHandler, this, std::placeholders::_1));
 
+        // blocks the executor thread until the maps are written, so that the key frames do not change meanwhile
         auto saveMapService = [this](const std::shared_ptr<rmw_request_id_t> request_header, const std::shared_ptr<lio_sam::srv::SaveMap::Request> req, std::shared_ptr<lio_sam::srv::SaveMap::Response> res) -> void {
             (void)request_header;
             string saveMapDirectory;
@@ -190,46 +243,52 @@ public:
             // save key frame transformations
             pcl::io::savePCDFileBinary(saveMapDirectory + "/trajectory.pcd", *cloudKeyPoses3D);
             pcl::io::savePCDFileBinary(saveMapDirectory + "/transformations.pcd", *cloudKeyPoses6D);
-            // extract global point cloud map
-            pcl::PointCloud<PointType>::Ptr globalCornerCloud(new pcl::PointCloud<PointType>());
-            pcl::PointCloud<PointType>::Ptr globalCornerCloudDS(new pcl::PointCloud<PointType>());
-            pcl::PointCloud<PointType>::Ptr globalSurfCloud(new pcl::PointCloud<PointType>());
-            pcl::PointCloud<PointType>::Ptr globalSurfCloudDS(new pcl::PointCloud<PointType>());
-            pcl::PointCloud<PointType>::Ptr globalMapCloud(new pcl::PointCloud<PointType>());
-            for (int i = 0; i < (int)cloudKeyPoses3D->size(); i++) 
-            {
-                *globalCornerCloud += *transformPointCloud(cornerCloudKeyFrames[i],  &cloudKeyPoses6D->points[i]);
-                *globalSurfCloud   += *transformPointCloud(surfCloudKeyFrames[i],    &cloudKeyPoses6D->points[i]);
-                cout << "\r" << std::flush << "Processing feature cloud " << i << " of " << cloudKeyPoses6D->size() << " ...";
-            }
             if(req->resolution != 0)
+               cout << "\nSave resolution: " << req->resolution << endl;
+            // stream the key frames into the maps, the global map is not down-sampled
+            MapExporter<PointType> cornerMap(saveMapDirectory + "/CornerMap", req->resolution, saveMapTileSize, saveMapMaxResidentTiles);
+            MapExporter<PointType> surfMap(saveMapDirectory + "/SurfMap", req->resolution, saveMapTileSize, saveMapMaxResidentTiles);
+            MapExporter<PointType> globalMap(saveMapDirectory + "/GlobalMap", 0, saveMapTileSize, saveMapMaxResidentTiles);
+            int numKeyFrames = cloudKeyPoses3D->size();
+            int batchSize = numberOfCores * 4;
+            vector<pcl::PointCloud<PointType>::Ptr> cornerBatch(batchSize), surfBatch(batchSize);
+            int numMissing = 0;
+            for (int start = 0; start < numKeyFrames; start += batchSize)
             {
-               cout << "\n\nSave resolution: " << req->resolution << endl;
-               // down-sample and save corner cloud
-               downSizeFilterCorner.setInputCloud(globalCornerCloud);
-               downSizeFilterCorner.setLeafSize(req->resolution, req->resolution, req->resolution);
-               downSizeFilterCorner.filter(*globalCornerCloudDS);
-               pcl::io::savePCDFileBinary(saveMapDirectory + "/CornerMap.pcd", *globalCornerCloudDS);
-               // down-sample and save surf cloud
-               downSizeFilterSurf.setInputCloud(globalSurfCloud);
-               downSizeFilterSurf.setLeafSize(req->resolution, req->resolution, req->resolution);
-               downSizeFilterSurf.filter(*globalSurfCloudDS);
-               pcl::io::savePCDFileBinary(saveMapDirectory + "/SurfMap.pcd", *globalSurfCloudDS);
-            }
-            else
-            {
-            // save corner cloud
-               pcl::io::savePCDFileBinary(saveMapDirectory + "/CornerMap.pcd", *globalCornerCloud);
-               // save surf cloud
-               pcl::io::savePCDFileBinary(saveMapDirectory + "/SurfMap.pcd", *globalSurfCloud);
+                // transform a batch of key frames in parallel, then accumulate them
+                int end = std::min(start + batchSize, numKeyFrames);
+                #pragma omp parallel for num_threads(numberOfCores) reduction(+:numMissing)
+                for (int i = start; i < end; ++i)
+                {
+                    pcl::PointCloud<PointType>::Ptr corner, surf;
+                    if (!keyFrames.get(i, corner, surf))
+                    {
+                        cornerBatch[i - start].reset();
+                        numMissing++;
+                        continue;
+                    }
+                    cornerBatch[i - start] = transformPointCloud(corner,  &cloudKeyPoses6D->points[i]);
+                    surfBatch[i - start]   = transformPointCloud(surf,    &cloudKeyPoses6D->points[i]);
+                }
+                for (int i = start; i < end; ++i)
+                {
+                    if (!cornerBatch[i - start])
+                        continue;
+                    cornerMap.add(*cornerBatch[i - start]);
+                    surfMap.add(*surfBatch[i - start]);
+                    globalMap.add(*cornerBatch[i - start]);
+                    globalMap.add(*surfBatch[i - start]);
+                }
+                cout << "\r" << std::flush << "Processing feature cloud " << end << " of " << numKeyFrames
+                     << " (" << (100 * end / numKeyFrames) << "%) ...";
             }
-            // save global point cloud map
-            *globalMapCloud += *globalCornerCloud;
-            *globalMapCloud += *globalSurfCloud;
-            int ret = pcl::io::savePCDFileBinary(saveMapDirectory + "/GlobalMap.pcd", *globalMapCloud);
-            res->success = ret == 0;
-            downSizeFilterCorner.setLeafSize(mappingCornerLeafSize, mappingCornerLeafSize, mappingCornerLeafSize);
-            downSizeFilterSurf.setLeafSize(mappingSurfLeafSize, mappingSurfLeafSize, mappingSurfLeafSize);
+            cout << "\nWriting map files ..." << endl;
+            bool ok = cornerMap.finish();
+            ok = surfMap.finish() && ok;
+            ok = globalMap.finish() && ok;
+            if (numMissing > 0)
+                RCLCPP_ERROR(get_logger(), "%d key frames could not be read, the saved map is incomplete", numMissing);
+            res->success = ok && numMissing == 0;
             cout << "****************************************************" << endl;
             cout << "Saving map to pcd files completed\n" << endl;
             return;
@@ -248,8 +307,34 @@ public:
         downSizeFilterSurf.setLeafSize(mappingSurfLeafSize, mappingSurfLeafSize, mappingSurfLeafSize);
         downSizeFilterICP.setLeafSize(mappingSurfLeafSize, mappingSurfLeafSize, mappingSurfLeafSize);
         downSizeFilterSurroundingKeyPoses.setLeafSize(surroundingKeyframeDensity, surroundingKeyframeDensity, surroundingKeyframeDensity); // for surrounding key poses of scan-to-map optimization
+        downSizeFilterCorner.setNumThreads(numberOfCores);
+        downSizeFilterSurf.setNumThreads(numberOfCores);
+        downSizeFilterICP.setNumThreads(numberOfCores);
+
+        loopIcp.setMaxCorrespondenceDistance(historyKeyframeSearchRadius*2);
+        loopIcp.setMaximumIterations(100);
+        loopIcp.setTransformationEpsilon(1e-6);
+
+        // neighbours are searched within 1 meter, so voxels must be no smaller than that
+        localMapVoxelSize = max(localMapVoxelSize, 1.0f);
+        localCornerMap.setParams(localMapVoxelSize, localMapVoxelCapacity, mappingCornerLeafSize);
+        localSurfMap.setParams(localMapVoxelSize, localMapVoxelCapacity, mappingSurfLeafSize);
+
+        laserCloudMapContainer.setCapacity(keyFrameCacheSize);
+        keyPoseIndex.setParams(max(surroundingKeyframeSearchRadius * 0.5f, 1.0f));
+        globalMapCache.setParams(globalMapVisualizationTileSize, globalMapVisualizationPoseDensity, globalMapVisualizationLeafSize);
+        if (keyFrameMaxResident > 0)
+            keyFrames.setParams(keyFrameMaxResident, std::getenv("HOME") + keyFrameSpillDirectory);
 
         allocateMemory();
+
+        if (!sessionDirectory.empty())
+            resumeSession();
+
+        // started here rather than in main, so that the node also runs as a component
+        if (synchronousMode == false)
+            loopThread = std::thread(&mapOptimization::loopClosureThread, this);
+        visualizeMapThread = std::thread(&mapOptimization::visualizeGlobalMapThread, this);
     }
 
     void allocateMemory()
@@ -259,27 +344,16 @@ public:
         copy_cloudKeyPoses3D.reset(new pcl::PointCloud<PointType>());
         copy_cloudKeyPoses6D.reset(new pcl::PointCloud<PointTypePose>());
 
-        kdtreeSurroundingKeyPoses.reset(new pcl::KdTreeFLANN<PointType>());
-        kdtreeHistoryKeyPoses.reset(new pcl::KdTreeFLANN<PointType>());
 
-        laserCloudCornerLast.reset(new pcl::PointCloud<PointType>()); // corner feature set from odoOptimization
-        laserCloudSurfLast.reset(new pcl::PointCloud<PointType>()); // surf feature set from odoOptimization
+        deserializedCorner.reset(new pcl::PointCloud<PointType>());
+        deserializedSurf.reset(new pcl::PointCloud<PointType>());
+        deserializedDeskewed.reset(new pcl::PointCloud<PointType>());
+        laserCloudCornerLast = deserializedCorner; // corner feature set from odoOptimization
+        laserCloudSurfLast = deserializedSurf; // surf feature set from odoOptimization
+        laserCloudDeskewed = deserializedDeskewed;
         laserCloudCornerLastDS.reset(new pcl::PointCloud<PointType>()); // downsampled corner featuer set from odoOptimization
         laserCloudSurfLastDS.reset(new pcl::PointCloud<PointType>()); // downsampled surf featuer set from odoOptimization
 
-        laserCloudOri.reset(new pcl::PointCloud<PointType>());
-        coeffSel.reset(new pcl::PointCloud<PointType>());
-
-        laserCloudOriCornerVec.resize(N_SCAN * Horizon_SCAN);
-        coeffSelCornerVec.resize(N_SCAN * Horizon_SCAN);
-        laserCloudOriCornerFlag.resize(N_SCAN * Horizon_SCAN);
-        laserCloudOriSurfVec.resize(N_SCAN * Horizon_SCAN);
-        coeffSelSurfVec.resize(N_SCAN * Horizon_SCAN);
-        laserCloudOriSurfFlag.resize(N_SCAN * Horizon_SCAN);
-
-        std::fill(laserCloudOriCornerFlag.begin(), laserCloudOriCornerFlag.end(), false);
-        std::fill(laserCloudOriSurfFlag.begin(), laserCloudOriSurfFlag.end(), false);
-
         laserCloudCornerFromMap.reset(new pcl::PointCloud<PointType>());
         laserCloudSurfFromMap.reset(new pcl::PointCloud<PointType>());
         laserCloudCornerFromMapDS.reset(new pcl::PointCloud<PointType>());
@@ -293,42 +367,189 @@ public:
         }
 
         matP.setZero();
+
+        timeLastLoopClosure = -1;
     }
 
-    void laserCloudInfoHandler(const lio_sam::msg::CloudInfo::SharedPtr msgIn)
+    // loads the session logged in sessionDirectory, if any, and logs the new key frames and factors after it.
+    // The loaded key frames are read from the session file when used; the first scan is relocalized against them
+    void resumeSession()
+    {
+        string directory = std::getenv("HOME") + sessionDirectory;
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error || !session.open(directory + "/session.bin"))
+        {
+            RCLCPP_ERROR(get_logger(), "Cannot open the session in %s, it is not logged.", directory.c_str());
+            return;
+        }
+
+        int numKeyFrames = session.numKeyFrames();
+        if (numKeyFrames == 0)
+            return;
+
+        keyFrames.setSource([this](int keyInd, pcl::PointCloud<PointType>& corner, pcl::PointCloud<PointType>& surf)
+        {
+            return session.loadKeyFrame(keyInd, corner, surf);
+        });
+        for (int i = 0; i < numKeyFrames; ++i)
+        {
+            SessionPose sessionPose = session.pose(i);
+            PointTypePose thisPose6D;
+            thisPose6D.roll  = sessionPose.pose[0];
+            thisPose6D.pitch = sessionPose.pose[1];
+            thisPose6D.yaw   = sessionPose.pose[2];
+            thisPose6D.x = sessionPose.pose[3];
+            thisPose6D.y = sessionPose.pose[4];
+            thisPose6D.z = sessionPose.pose[5];
+            thisPose6D.intensity = i;
+            thisPose6D.time = sessionPose.time;
+
+            PointType thisPose3D;
+            thisPose3D.x = thisPose6D.x;
+            thisPose3D.y = thisPose6D.y;
+            thisPose3D.z = thisPose6D.z;
+            thisPose3D.intensity = i;
+            cloudKeyPoses3D->push_back(thisPose3D);
+            cloudKeyPoses6D->push_back(thisPose6D);
+            keyPoseIndex.add(thisPose3D);
+
+            keyFrames.addFromSource();
+
+            // described now, for the relocalization, one key frame at a time
+            if (useScanContext == true)
+            {
+                pcl::PointCloud<PointType> corner, surf;
+                session.loadKeyFrame(i, corner, surf);
+                corner += surf;
+                scanContext.add(corner);
+            }
+
+            initialEstimate.insert(i, pclPointTogtsamPose3(thisPose6D));
+            updatePath(thisPose6D);
+        }
+
+        for (const SessionFactor& factor : session.factors())
+        {
+            gtsam::Vector variances = Eigen::Map<const Eigen::Matrix<double, 6, 1>>(factor.variances);
+            if (factor.kind == SessionFactor::PRIOR)
+            {
+                gtSAMgraph.add(PriorFactor<Pose3>(factor.key1, sessionToPose3(factor.value), noiseModel::Diagonal::Variances(variances)));
+            }
+            else if (factor.kind == SessionFactor::BETWEEN)
+            {
+                gtSAMgraph.add(BetweenFactor<Pose3>(factor.key1, factor.key2, sessionToPose3(factor.value), noiseModel::Diagonal::Variances(variances)));
+                if (factor.key1 != factor.key2 + 1 && factor.key2 != factor.key1 + 1)
+                    loopIndexContainer[factor.key1] = factor.key2;
+            }
+            else if (factor.kind == SessionFactor::GPS)
+            {
+                gtSAMgraph.add(gtsam::GPSFactor(factor.key1, gtsam::Point3(factor.value[0], factor.value[1], factor.value[2]),
+                                                noiseModel::Diagonal::Variances(variances.head<3>())));
+            }
+        }
+
+        updateIsam();
+        gtSAMgraph.resize(0);
+        initialEstimate.clear();
+        isamCurrentEstimate = isam->calculateEstimate();
+        poseCovariance = isam->marginalCovariance(numKeyFrames - 1);
+
+        const PointTypePose& lastPose = cloudKeyPoses6D->back();
+        transformTobeMapped[0] = lastPose.roll;
+        transformTobeMapped[1] = lastPose.pitch;
+        transformTobeMapped[2] = lastPose.yaw;
+        transformTobeMapped[3] = lastPose.x;
+        transformTobeMapped[4] = lastPose.y;
+        transformTobeMapped[5] = lastPose.z;
+        sessionResumed = true;
+
+        RCLCPP_INFO(get_logger(), "Resumed the session in %s with %d key frames.", directory.c_str(), numKeyFrames);
+    }
+
+    gtsam::Pose3 sessionToPose3(const double value[6])
+    {
+        return gtsam::Pose3(gtsam::Rot3::RzRyRx(value[0], value[1], value[2]), gtsam::Point3(value[3], value[4], value[5]));
+    }
+
+    void addSessionFactor(SessionFactor::Kind kind, int key1, int key2, const gtsam::Pose3& pose, const gtsam::Vector& variances)
+    {
+        if (!session.isOpen())
+            return;
+
+        SessionFactor factor;
+        factor.kind = kind;
+        factor.key1 = key1;
+        factor.key2 = key2;
+        factor.value[0] = pose.rotation().roll();
+        factor.value[1] = pose.rotation().pitch();
+        factor.value[2] = pose.rotation().yaw();
+        factor.value[3] = pose.translation().x();
+        factor.value[4] = pose.translation().y();
+        factor.value[5] = pose.translation().z();
+        for (int i = 0; i < 6; ++i)
+            factor.variances[i] = i < variances.size() ? variances(i) : 0;
+        session.addFactor(factor);
+    }
+
+    ~mapOptimization()
+    {
+        // both threads run until rclcpp shuts down or the component is unloaded
+        {
+            std::lock_guard<std::mutex> lock(runningMtx);
+            running = false;
+        }
+        runningCv.notify_all();
+        if (loopThread.joinable())
+            loopThread.join();
+        if (visualizeMapThread.joinable())
+            visualizeMapThread.join();
+    }
+
+    void laserCloudInfoHandler(lio_sam::msg::CloudInfo::UniquePtr msgIn)
     {
         // extract time stamp
         timeLaserInfoStamp = msgIn->header.stamp;
         timeLaserInfoCur = stamp2Sec(msgIn->header.stamp);
 
         // extract info and feature cloud
-        cloudInfo = *msgIn;
-        pcl::fromROSMsg(msgIn->cloud_corner,  *laserCloudCornerLast);
-        pcl::fromROSMsg(msgIn->cloud_surface, *laserCloudSurfLast);
-
-        std::lock_guard<std::mutex> lock(mtx);
+        laserCloudCornerLast = unpackCloud("cloud_corner",  msgIn->cloud_corner,  deserializedCorner);
+        laserCloudSurfLast   = unpackCloud("cloud_surface", msgIn->cloud_surface, deserializedSurf);
+        // the deskewed cloud is only deserialized when it is published
+        if (msgIn->cloud_deskewed.fields.empty())
+            laserCloudDeskewed = unpackCloud("cloud_deskewed", msgIn->cloud_deskewed, deserializedDeskewed);
+        else
+            laserCloudDeskewed = nullptr;
+        cloudInfo = std::move(*msgIn);
 
-        static double timeLastProcessing = -1;
-        if (timeLaserInfoCur - timeLastProcessing >= mappingProcessInterval)
         {
-            timeLastProcessing = timeLaserInfoCur;
+            std::lock_guard<std::mutex> lock(mtx);
+
+            static double timeLastProcessing = -1;
+            if (timeLaserInfoCur - timeLastProcessing >= mappingProcessInterval)
+            {
+                timeLastProcessing = timeLaserInfoCur;
 
-            updateInitialGuess();
+                updateInitialGuess();
 
-            extractSurroundingKeyFrames();
+                extractSurroundingKeyFrames();
 
-            downsampleCurrentScan();
+                downsampleCurrentScan();
 
-            scan2MapOptimization();
+                scan2MapOptimization();
 
-            saveKeyFramesAndFactor();
+                saveKeyFramesAndFactor();
 
-            correctPoses();
+                correctPoses();
 
-            publishOdometry();
+                publishOdometry();
 
-            publishFrames();
+                publishFrames();
+            }
         }
+
+        if (synchronousMode == true)
+            synchronousLoopClosure();
     }
 
     void gpsHandler(const nav_msgs::msg::Odometry::SharedPtr gpsMsg)
@@ -399,11 +620,17 @@ public:
         return thisPose6D;
     }
 
+    // sleeps for the given period, returns false as soon as the node is stopping
+    bool sleepWhileRunning(double period)
+    {
+        std::unique_lock<std::mutex> lock(runningMtx);
+        runningCv.wait_for(lock, std::chrono::duration<double>(period), [this]{ return !running; });
+        return running && rclcpp::ok();
+    }
+
     void visualizeGlobalMapThread()
     {
-        rclcpp::Rate rate(0.2);
-        while (rclcpp::ok()){
-            rate.sleep();
+        while (sleepWhileRunning(5.0)){
             publishGlobalMap();
         }
         if (savePCD == false)
@@ -421,8 +648,11 @@ public:
         pcl::PointCloud<PointType>::Ptr globalSurfCloudDS(new pcl::PointCloud<PointType>());
         pcl::PointCloud<PointType>::Ptr globalMapCloud(new pcl::PointCloud<PointType>());
         for (int i = 0; i < (int)cloudKeyPoses3D->size(); i++) {
-            *globalCornerCloud += *transformPointCloud(cornerCloudKeyFrames[i],  &cloudKeyPoses6D->points[i]);
-            *globalSurfCloud   += *transformPointCloud(surfCloudKeyFrames[i],    &cloudKeyPoses6D->points[i]);
+            pcl::PointCloud<PointType>::Ptr corner, surf;
+            if (!keyFrames.get(i, corner, surf))
+                continue;
+            *globalCornerCloud += *transformPointCloud(corner,  &cloudKeyPoses6D->points[i]);
+            *globalSurfCloud   += *transformPointCloud(surf,    &cloudKeyPoses6D->points[i]);
             cout << "\r" << std::flush << "Processing feature cloud " << i << " of " << cloudKeyPoses6D->size() << " ...";
         }
         downSizeFilterCorner.setInputCloud(globalCornerCloud);
@@ -443,51 +673,49 @@ public:
         if (pubLaserCloudSurround->get_subscription_count() == 0)
             return;
 
-        if (cloudKeyPoses3D->points.empty() == true)
-            return;
-
-        pcl::KdTreeFLANN<PointType>::Ptr kdtreeGlobalMap(new pcl::KdTreeFLANN<PointType>());;
-        pcl::PointCloud<PointType>::Ptr globalMapKeyPoses(new pcl::PointCloud<PointType>());
-        pcl::PointCloud<PointType>::Ptr globalMapKeyPosesDS(new pcl::PointCloud<PointType>());
-        pcl::PointCloud<PointType>::Ptr globalMapKeyFrames(new pcl::PointCloud<PointType>());
-        pcl::PointCloud<PointType>::Ptr globalMapKeyFramesDS(new pcl::PointCloud<PointType>());
-
-        // kd-tree to find near key frames to visualize
-        std::vector<int> pointSearchIndGlobalMap;
-        std::vector<float> pointSearchSqDisGlobalMap;
-        // search near key frames to visualize
+        // poses of the new key frames, or of all of them after a correction
+        GlobalMapCache<PointType>::PoseVector poses;
+        bool posesCorrected;
+        Eigen::Vector3f center;
         mtx.lock();
-        kdtreeGlobalMap->setInputCloud(cloudKeyPoses3D);
-        kdtreeGlobalMap->radiusSearch(cloudKeyPoses3D->back(), globalMapVisualizationSearchRadius, pointSearchIndGlobalMap, pointSearchSqDisGlobalMap, 0);
+        int numKeyFrames = cloudKeyPoses6D->size();
+        posesCorrected = globalMapPosesVersion != keyPosesVersion;
+        globalMapPosesVersion = keyPosesVersion;
+        poses.resize(numKeyFrames);
+        for (int i = posesCorrected ? 0 : globalMapKeyFrames; i < numKeyFrames; ++i)
+            poses[i] = pclPointToAffine3f(cloudKeyPoses6D->points[i]);
+        if (numKeyFrames > 0)
+            center = cloudKeyPoses3D->back().getVector3fMap();
         mtx.unlock();
 
-        for (int i = 0; i < (int)pointSearchIndGlobalMap.size(); ++i)
-            globalMapKeyPoses->push_back(cloudKeyPoses3D->points[pointSearchIndGlobalMap[i]]);
-        // downsample near selected key frames
-        pcl::VoxelGrid<PointType> downSizeFilterGlobalMapKeyPoses; // for global map visualization
-        downSizeFilterGlobalMapKeyPoses.setLeafSize(globalMapVisualizationPoseDensity, globalMapVisualizationPoseDensity, globalMapVisualizationPoseDensity); // for global map visualization
-        downSizeFilterGlobalMapKeyPoses.setInputCloud(globalMapKeyPoses);
-        downSizeFilterGlobalMapKeyPoses.filter(*globalMapKeyPosesDS);
-        for(auto& pt : globalMapKeyPosesDS->points)
+        if (numKeyFrames == 0)
+            return;
+        globalMapKeyFrames = numKeyFrames;
+
+        // only the tiles touched by new or moved key frames are computed again
+        int numChanged = globalMapCache.update(poses, posesCorrected, [this](int keyInd, pcl::PointCloud<PointType>& cloud)
         {
-            kdtreeGlobalMap->nearestKSearch(pt, 1, pointSearchIndGlobalMap, pointSearchSqDisGlobalMap);
-            pt.intensity = cloudKeyPoses3D->points[pointSearchIndGlobalMap[0]].intensity;
-        }
+            pcl::PointCloud<PointType>::Ptr corner, surf;
+            if (!keyFrames.get(keyInd, corner, surf))
+            {
+                cloud.clear();
+                return;
+            }
+            cloud = *corner;
+            cloud += *surf;
+        });
 
-        // extract visualized and downsampled key frames
-        for (int i = 0; i < (int)globalMapKeyPosesDS->size(); ++i){
-            if (pointDistance(globalMapKeyPosesDS->points[i], cloudKeyPoses3D->back()) > globalMapVisualizationSearchRadius)
-                continue;
-            int thisKeyInd = (int)globalMapKeyPosesDS->points[i].intensity;
-            *globalMapKeyFrames += *transformPointCloud(cornerCloudKeyFrames[thisKeyInd],  &cloudKeyPoses6D->points[thisKeyInd]);
-            *globalMapKeyFrames += *transformPointCloud(surfCloudKeyFrames[thisKeyInd],    &cloudKeyPoses6D->points[thisKeyInd]);
+        VoxelKey centerTile = toVoxelKey(center.x(), center.y(), 0, 1.0 / globalMapVisualizationTileSize);
+        if (numChanged > 0 || !(centerTile == globalMapCenterTile))
+        {
+            globalMapCenterTile = centerTile;
+            pcl::PointCloud<PointType>::Ptr globalMapCloud(new pcl::PointCloud<PointType>());
+            globalMapCache.getCloud(center, globalMapVisualizationSearchRadius, *globalMapCloud);
+            pcl::toROSMsg(*globalMapCloud, globalMapMsg);
+            globalMapMsg.header.frame_id = odometryFrame;
         }
-        // downsample visualized points
-        pcl::VoxelGrid<PointType> downSizeFilterGlobalMapKeyFrames; // for global map visualization
-        downSizeFilterGlobalMapKeyFrames.setLeafSize(globalMapVisualizationLeafSize, globalMapVisualizationLeafSize, globalMapVisualizationLeafSize); // for global map visualization
-        downSizeFilterGlobalMapKeyFrames.setInputCloud(globalMapKeyFrames);
-        downSizeFilterGlobalMapKeyFrames.filter(*globalMapKeyFramesDS);
-        publishCloud(pubLaserCloudSurround, globalMapKeyFramesDS, timeLaserInfoStamp, odometryFrame);
+        globalMapMsg.header.stamp = timeLaserInfoStamp;
+        pubLaserCloudSurround->publish(globalMapMsg);
     }
 
 
@@ -506,15 +734,27 @@ public:
         if (loopClosureEnableFlag == false)
             return;
 
-        rclcpp::Rate rate(loopClosureFrequency);
-        while (rclcpp::ok())
+        while (sleepWhileRunning(1.0 / loopClosureFrequency))
         {
-            rate.sleep();
             performLoopClosure();
             visualizeLoopClosure();
         }
     }
 
+    // same as loopClosureThread, paced by the lidar time, so that a replay gives the same loops whatever its speed
+    void synchronousLoopClosure()
+    {
+        if (loopClosureEnableFlag == false)
+            return;
+
+        if (timeLaserInfoCur - timeLastLoopClosure < 1.0 / loopClosureFrequency)
+            return;
+        timeLastLoopClosure = timeLaserInfoCur;
+
+        performLoopClosure();
+        visualizeLoopClosure();
+    }
+
     void loopInfoHandler(const std_msgs::msg::Float64MultiArray::SharedPtr loopMsg)
     {
         std::lock_guard<std::mutex> lock(mtxLoopInfo);
@@ -532,59 +772,83 @@ public:
         if (cloudKeyPoses3D->points.empty() == true)
             return;
 
+        // copy the new key poses only, unless they were corrected since the last copy
         mtx.lock();
-        *copy_cloudKeyPoses3D = *cloudKeyPoses3D;
-        *copy_cloudKeyPoses6D = *cloudKeyPoses6D;
+        if (copiedKeyPosesVersion != keyPosesVersion)
+        {
+            *copy_cloudKeyPoses3D = *cloudKeyPoses3D;
+            *copy_cloudKeyPoses6D = *cloudKeyPoses6D;
+            copiedKeyPosesVersion = keyPosesVersion;
+            loopTargets.clear();
+            loopTargetsLru.clear();
+        }
+        else
+        {
+            for (int i = copy_cloudKeyPoses3D->size(); i < (int)cloudKeyPoses3D->size(); ++i)
+            {
+                copy_cloudKeyPoses3D->push_back(cloudKeyPoses3D->points[i]);
+                copy_cloudKeyPoses6D->push_back(cloudKeyPoses6D->points[i]);
+            }
+        }
         mtx.unlock();
 
         // find keys
-        int loopKeyCur;
+        int loopKeyCur = copy_cloudKeyPoses3D->size() - 1;
         int loopKeyPre;
-        if (detectLoopClosureExternal(&loopKeyCur, &loopKeyPre) == false)
-            if (detectLoopClosureDistance(&loopKeyCur, &loopKeyPre) == false)
-                return;
+        std::vector<LoopCandidate, Eigen::aligned_allocator<LoopCandidate>> candidates;
+        if (detectLoopClosureExternal(&loopKeyCur, &loopKeyPre) == true ||
+            detectLoopClosureDistance(&loopKeyCur, &loopKeyPre) == true)
+            candidates.push_back(LoopCandidate{loopKeyPre, Eigen::Affine3f::Identity()});
+        if (useScanContext == true)
+            detectLoopClosureScanContext(loopKeyCur, candidates);
+        if (candidates.empty())
+            return;
 
         // extract cloud
         pcl::PointCloud<PointType>::Ptr cureKeyframeCloud(new pcl::PointCloud<PointType>());
-        pcl::PointCloud<PointType>::Ptr prevKeyframeCloud(new pcl::PointCloud<PointType>());
+        loopFindNearKeyframes(cureKeyframeCloud, loopKeyCur, 0);
+        if (cureKeyframeCloud->size() < 300)
+            return;
+
+        int numCandidates = candidates.size();
+        std::vector<PointToPlaneICP<PointType>::TargetPtr> targets(numCandidates);
+        for (int i = 0; i < numCandidates; ++i)
+            targets[i] = loopTarget(candidates[i].keyPre);
+
+        // candidates are verified in parallel, one thread each, or with all the threads if alone
+        std::vector<PointToPlaneICP<PointType>::Result, Eigen::aligned_allocator<PointToPlaneICP<PointType>::Result>> results(numCandidates);
+        #pragma omp parallel for num_threads(numberOfCores) schedule(dynamic) if (numCandidates > 1)
+        for (int i = 0; i < numCandidates; ++i)
         {
-            loopFindNearKeyframes(cureKeyframeCloud, loopKeyCur, 0);
-            loopFindNearKeyframes(prevKeyframeCloud, loopKeyPre, historyKeyframeSearchNum);
-            if (cureKeyframeCloud->size() < 300 || prevKeyframeCloud->size() < 1000)
-                return;
-            if (pubHistoryKeyFrames->get_subscription_count() != 0)
-                publishCloud(pubHistoryKeyFrames, prevKeyframeCloud, timeLaserInfoStamp, odometryFrame);
+            if (targets[i])
+                results[i] = loopIcp.align(*cureKeyframeCloud, targets[i], candidates[i].guess, numCandidates > 1 ? 1 : numberOfCores);
         }
 
-        // ICP Settings
-        static pcl::IterativeClosestPoint<PointType, PointType> icp;
-        icp.setMaxCorrespondenceDistance(historyKeyframeSearchRadius*2);
-        icp.setMaximumIterations(100);
-        icp.setTransformationEpsilon(1e-6);
-        icp.setEuclideanFitnessEpsilon(1e-6);
-        icp.setRANSACIterations(0);
-
-        // Align clouds
-        icp.setInputSource(cureKeyframeCloud);
-        icp.setInputTarget(prevKeyframeCloud);
-        pcl::PointCloud<PointType>::Ptr unused_result(new pcl::PointCloud<PointType>());
-        icp.align(*unused_result);
-
-        if (icp.hasConverged() == false || icp.getFitnessScore() > historyKeyframeFitnessScore)
+        int best = -1;
+        for (int i = 0; i < numCandidates; ++i)
+        {
+            if (results[i].converged && (best < 0 || results[i].fitness < results[best].fitness))
+                best = i;
+        }
+        if (best < 0 || results[best].fitness > historyKeyframeFitnessScore)
             return;
+        loopKeyPre = candidates[best].keyPre;
+
+        if (pubHistoryKeyFrames->get_subscription_count() != 0)
+            publishCloud(pubHistoryKeyFrames, targets[best]->cloud, timeLaserInfoStamp, odometryFrame);
 
         // publish corrected cloud
         if (pubIcpKeyFrames->get_subscription_count() != 0)
         {
             pcl::PointCloud<PointType>::Ptr closed_cloud(new pcl::PointCloud<PointType>());
-            pcl::transformPointCloud(*cureKeyframeCloud, *closed_cloud, icp.getFinalTransformation());
+            pcl::transformPointCloud(*cureKeyframeCloud, *closed_cloud, results[best].transform);
             publishCloud(pubIcpKeyFrames, closed_cloud, timeLaserInfoStamp, odometryFrame);
         }
 
         // Get pose transformation
         float x, y, z, roll, pitch, yaw;
         Eigen::Affine3f correctionLidarFrame;
-        correctionLidarFrame = icp.getFinalTransformation();
+        correctionLidarFrame = results[best].transform;
         // transform from world origin to wrong pose
         Eigen::Affine3f tWrong = pclPointToAffine3f(copy_cloudKeyPoses6D->points[loopKeyCur]);
         // transform from world origin to corrected pose
@@ -593,7 +857,7 @@ public:
         gtsam::Pose3 poseFrom = Pose3(Rot3::RzRyRx(roll, pitch, yaw), Point3(x, y, z));
         gtsam::Pose3 poseTo = pclPointTogtsamPose3(copy_cloudKeyPoses6D->points[loopKeyPre]);
         gtsam::Vector Vector6(6);
-        float noiseScore = icp.getFitnessScore();
+        float noiseScore = results[best].fitness;
         Vector6 << noiseScore, noiseScore, noiseScore, noiseScore, noiseScore, noiseScore;
         noiseModel::Diagonal::shared_ptr constraintNoise = noiseModel::Diagonal::Variances(Vector6);
 
@@ -618,16 +882,14 @@ public:
         if (it != loopIndexContainer.end())
             return false;
 
-        // find the closest history key frame
+        // find the closest history key frame. The index may already hold key poses newer than the copy
         std::vector<int> pointSearchIndLoop;
         std::vector<float> pointSearchSqDisLoop;
-        kdtreeHistoryKeyPoses->setInputCloud(copy_cloudKeyPoses3D);
-        kdtreeHistoryKeyPoses->radiusSearch(copy_cloudKeyPoses3D->back(), historyKeyframeSearchRadius, pointSearchIndLoop, pointSearchSqDisLoop, 0);
-        
+        keyPoseIndex.radiusSearch(copy_cloudKeyPoses3D->back(), historyKeyframeSearchRadius, pointSearchIndLoop, pointSearchSqDisLoop);
         for (int i = 0; i < (int)pointSearchIndLoop.size(); ++i)
         {
             int id = pointSearchIndLoop[i];
-            if (abs(copy_cloudKeyPoses6D->points[id].time - timeLaserInfoCur) > historyKeyframeSearchTimeDiff)
+            if (id < loopKeyCur && abs(copy_cloudKeyPoses6D->points[id].time - timeLaserInfoCur) > historyKeyframeSearchTimeDiff)
             {
                 loopKeyPre = id;
                 break;
@@ -643,6 +905,81 @@ public:
         return true;
     }
 
+    void detectLoopClosureScanContext(int loopKeyCur, std::vector<LoopCandidate, Eigen::aligned_allocator<LoopCandidate>>& candidates)
+    {
+        std::unique_lock<std::mutex> lock(mtxScanContext);
+        // describe the new key frames, in their own lidar frame
+        while (scanContext.size() < (int)copy_cloudKeyPoses6D->size())
+        {
+            int keyInd = scanContext.size();
+            pcl::PointCloud<PointType> keyFrameCloud;
+            pcl::PointCloud<PointType>::Ptr corner, surf;
+            if (keyFrames.get(keyInd, corner, surf))
+            {
+                keyFrameCloud = *corner;
+                keyFrameCloud += *surf;
+            }
+            scanContext.add(keyFrameCloud);
+        }
+
+        if (loopIndexContainer.find(loopKeyCur) != loopIndexContainer.end())
+            return;
+
+        // key frames too recent are not candidates
+        int maxCandidateInd = loopKeyCur;
+        double timeCur = copy_cloudKeyPoses6D->points[loopKeyCur].time;
+        while (maxCandidateInd >= 0 && timeCur - copy_cloudKeyPoses6D->points[maxCandidateInd].time <= historyKeyframeSearchTimeDiff)
+            --maxCandidateInd;
+
+        std::vector<ScanContext<PointType>::Candidate> matches = scanContext.query(loopKeyCur, maxCandidateInd, 10, scanContextDistThreshold, numberOfCores);
+        lock.unlock();
+        if ((int)matches.size() > scanContextNumCandidates)
+            matches.resize(scanContextNumCandidates);
+
+        // the descriptor gives the yaw from the current key frame to the candidate, the position is left to ICP
+        Eigen::Affine3f poseCur = pclPointToAffine3f(copy_cloudKeyPoses6D->points[loopKeyCur]);
+        for (const auto& match : matches)
+        {
+            Eigen::Affine3f posePre = pclPointToAffine3f(copy_cloudKeyPoses6D->points[match.keyInd]);
+            Eigen::Affine3f guess = posePre * Eigen::AngleAxisf(match.yaw, Eigen::Vector3f::UnitZ()) * poseCur.inverse();
+            candidates.push_back(LoopCandidate{match.keyInd, guess});
+        }
+    }
+
+    // history key frames around keyPre in the map frame, with their kd-tree and planes, kept until the poses are corrected
+    // or until new key frames join the neighbourhood; the 16 most recently used are kept
+    PointToPlaneICP<PointType>::TargetPtr loopTarget(int keyPre)
+    {
+        int numKeyFrames = copy_cloudKeyPoses6D->size();
+        int neighbourhoodEnd = std::min(keyPre + historyKeyframeSearchNum + 1, numKeyFrames);
+        auto it = loopTargets.find(keyPre);
+        if (it != loopTargets.end())
+        {
+            if (it->second.numKeyFrames >= neighbourhoodEnd)
+            {
+                loopTargetsLru.splice(loopTargetsLru.begin(), loopTargetsLru, it->second.lru);
+                return it->second.target;
+            }
+            loopTargetsLru.erase(it->second.lru);
+            loopTargets.erase(it);
+        }
+
+        pcl::PointCloud<PointType>::Ptr prevKeyframeCloud(new pcl::PointCloud<PointType>());
+        loopFindNearKeyframes(prevKeyframeCloud, keyPre, historyKeyframeSearchNum);
+        PointToPlaneICP<PointType>::TargetPtr target;
+        if (prevKeyframeCloud->size() >= 1000)
+            target = PointToPlaneICP<PointType>::makeTarget(prevKeyframeCloud, numberOfCores);
+
+        if (loopTargets.size() >= 16)
+        {
+            loopTargets.erase(loopTargetsLru.back());
+            loopTargetsLru.pop_back();
+        }
+        loopTargetsLru.push_front(keyPre);
+        loopTargets[keyPre] = LoopTarget{target, numKeyFrames, loopTargetsLru.begin()};
+        return target;
+    }
+
     bool detectLoopClosureExternal(int *latestID, int *closestID)
     {
         // this function is not used yet, please ignore it
@@ -698,17 +1035,27 @@ public:
     }
 
     void loopFindNearKeyframes(pcl::PointCloud<PointType>::Ptr& nearKeyframes, const int& key, const int& searchNum)
+    {
+        findNearKeyframes(*copy_cloudKeyPoses6D, downSizeFilterICP, nearKeyframes, key, searchNum);
+    }
+
+    // key frames [key - searchNum, key + searchNum] in the map frame given by keyPoses, downsampled by downSizeFilter
+    void findNearKeyframes(pcl::PointCloud<PointTypePose>& keyPoses, VoxelFilter<PointType>& downSizeFilter,
+                           pcl::PointCloud<PointType>::Ptr& nearKeyframes, int key, int searchNum)
     {
         // extract near keyframes
         nearKeyframes->clear();
-        int cloudSize = copy_cloudKeyPoses6D->size();
+        int cloudSize = keyPoses.size();
         for (int i = -searchNum; i <= searchNum; ++i)
         {
             int keyNear = key + i;
             if (keyNear < 0 || keyNear >= cloudSize )
                 continue;
-            *nearKeyframes += *transformPointCloud(cornerCloudKeyFrames[keyNear], &copy_cloudKeyPoses6D->points[keyNear]);
-            *nearKeyframes += *transformPointCloud(surfCloudKeyFrames[keyNear],   &copy_cloudKeyPoses6D->points[keyNear]);
+            pcl::PointCloud<PointType>::Ptr corner, surf;
+            if (!keyFrames.get(keyNear, corner, surf))
+                continue;
+            *nearKeyframes += *transformPointCloud(corner, &keyPoses.points[keyNear]);
+            *nearKeyframes += *transformPointCloud(surf,   &keyPoses.points[keyNear]);
         }
 
         if (nearKeyframes->empty())
@@ -716,11 +1063,84 @@ public:
 
         // downsample near keyframes
         pcl::PointCloud<PointType>::Ptr cloud_temp(new pcl::PointCloud<PointType>());
-        downSizeFilterICP.setInputCloud(nearKeyframes);
-        downSizeFilterICP.filter(*cloud_temp);
+        downSizeFilter.setInputCloud(nearKeyframes);
+        downSizeFilter.filter(*cloud_temp);
         *nearKeyframes = *cloud_temp;
     }
 
+    /*
+        * pose of the first scan of a resumed session in the loaded map: the scan is aligned by ICP on the key frames
+        * around the last key pose, where mapping stopped, and around its Scan Context matches, which also find it
+        * elsewhere in the map. The best alignment within historyKeyframeFitnessScore is kept, the last key pose
+        * otherwise. Runs in the mapping thread, with its own filter since the loop closure thread is running
+        */
+    void relocalize()
+    {
+        pcl::PointCloud<PointType>::Ptr scanCloud(new pcl::PointCloud<PointType>());
+        *scanCloud += *laserCloudCornerLast;
+        *scanCloud += *laserCloudSurfLast;
+
+        int lastKey = cloudKeyPoses6D->size() - 1;
+        std::vector<LoopCandidate, Eigen::aligned_allocator<LoopCandidate>> candidates;
+        candidates.push_back(LoopCandidate{lastKey, pclPointToAffine3f(cloudKeyPoses6D->points[lastKey])});
+        if (useScanContext == true)
+        {
+            std::vector<ScanContext<PointType>::Candidate> matches;
+            {
+                std::lock_guard<std::mutex> lock(mtxScanContext);
+                matches = scanContext.query(*scanCloud, 10, scanContextDistThreshold, numberOfCores);
+            }
+            if ((int)matches.size() > scanContextNumCandidates)
+                matches.resize(scanContextNumCandidates);
+            // the scan is in the sensor frame, its pose is the one of the match turned by the yaw
+            for (const auto& match : matches)
+            {
+                Eigen::Affine3f posePre = pclPointToAffine3f(cloudKeyPoses6D->points[match.keyInd]);
+                candidates.push_back(LoopCandidate{match.keyInd, posePre * Eigen::AngleAxisf(match.yaw, Eigen::Vector3f::UnitZ())});
+            }
+        }
+
+        VoxelFilter<PointType> downSizeFilter;
+        downSizeFilter.setLeafSize(mappingSurfLeafSize, mappingSurfLeafSize, mappingSurfLeafSize);
+        downSizeFilter.setNumThreads(numberOfCores);
+        pcl::PointCloud<PointType>::Ptr scanCloudDS(new pcl::PointCloud<PointType>());
+        downSizeFilter.setInputCloud(scanCloud);
+        downSizeFilter.filter(*scanCloudDS);
+
+        int best = -1;
+        PointToPlaneICP<PointType>::Result bestResult;
+        for (int i = 0; i < (int)candidates.size(); ++i)
+        {
+            pcl::PointCloud<PointType>::Ptr targetCloud(new pcl::PointCloud<PointType>());
+            findNearKeyframes(*cloudKeyPoses6D, downSizeFilter, targetCloud, candidates[i].keyPre, historyKeyframeSearchNum);
+            if (targetCloud->size() < 1000)
+                continue;
+            PointToPlaneICP<PointType>::Result result = loopIcp.align(*scanCloudDS, PointToPlaneICP<PointType>::makeTarget(targetCloud, numberOfCores),
+                                                                      candidates[i].guess, numberOfCores);
+            if (result.converged && result.fitness < bestResult.fitness)
+            {
+                best = i;
+                bestResult = result;
+            }
+        }
+
+        if (best < 0 || bestResult.fitness > historyKeyframeFitnessScore)
+        {
+            RCLCPP_WARN(get_logger(), "The first scan was not found in the resumed session, mapping goes on from the last key pose.");
+            return;
+        }
+
+        float x, y, z, roll, pitch, yaw;
+        pcl::getTranslationAndEulerAngles(bestResult.transform, x, y, z, roll, pitch, yaw);
+        transformTobeMapped[0] = roll;
+        transformTobeMapped[1] = pitch;
+        transformTobeMapped[2] = yaw;
+        transformTobeMapped[3] = x;
+        transformTobeMapped[4] = y;
+        transformTobeMapped[5] = z;
+        RCLCPP_INFO(get_logger(), "Relocalized in the resumed session near key frame %d, fitness %f.", candidates[best].keyPre, bestResult.fitness);
+    }
+
     void visualizeLoopClosure()
     {
         if (loopIndexContainer.empty())
@@ -790,6 +1210,16 @@ public:
         incrementalOdometryAffineFront = trans2Affine3f(transformTobeMapped);
 
         static Eigen::Affine3f lastImuTransformation;
+        // a resumed session starts again where the first scan is found in the loaded map
+        if (sessionResumed == true)
+        {
+            sessionResumed = false;
+            relocalize();
+            incrementalOdometryAffineFront = trans2Affine3f(transformTobeMapped);
+            lastImuTransformation = pcl::getTransformation(0, 0, 0, cloudInfo.imu_roll_init, cloudInfo.imu_pitch_init, cloudInfo.imu_yaw_init); // save imu before return;
+            return;
+        }
+
         // initialization
         if (cloudKeyPoses3D->points.empty())
         {
@@ -869,19 +1299,21 @@ public:
         std::vector<float> pointSearchSqDis;
 
         // extract all the nearby key poses and downsample them
-        kdtreeSurroundingKeyPoses->setInputCloud(cloudKeyPoses3D); // create kd-tree
-        kdtreeSurroundingKeyPoses->radiusSearch(cloudKeyPoses3D->back(), (double)surroundingKeyframeSearchRadius, pointSearchInd, pointSearchSqDis);
+        keyPoseIndex.radiusSearch(cloudKeyPoses3D->back(), surroundingKeyframeSearchRadius, pointSearchInd, pointSearchSqDis);
         for (int i = 0; i < (int)pointSearchInd.size(); ++i)
         {
             int id = pointSearchInd[i];
             surroundingKeyPoses->push_back(cloudKeyPoses3D->points[id]);
         }
 
+        if (keyFrameMaxResident > 0)
+            prefetchKeyFramesAhead();
+
         downSizeFilterSurroundingKeyPoses.setInputCloud(surroundingKeyPoses);
         downSizeFilterSurroundingKeyPoses.filter(*surroundingKeyPosesDS);
         for(auto& pt : surroundingKeyPosesDS->points)
         {
-            kdtreeSurroundingKeyPoses->nearestKSearch(pt, 1, pointSearchInd, pointSearchSqDis);
+            keyPoseIndex.nearestKSearch(pt, 1, pointSearchInd, pointSearchSqDis);
             pt.intensity = cloudKeyPoses3D->points[pointSearchInd[0]].intensity;
         }
 
@@ -895,7 +1327,78 @@ public:
                 break;
         }
 
-        extractCloud(surroundingKeyPosesDS);
+        if (useIncrementalLocalMap)
+            updateLocalMap(surroundingKeyPosesDS);
+        else
+            extractCloud(surroundingKeyPosesDS);
+    }
+
+    void prefetchKeyFramesAhead()
+    {
+        // load the spilled key frames around where the robot heads to, before they are needed
+        int numPoses = cloudKeyPoses3D->size();
+        if (numPoses < 2)
+            return;
+
+        const PointType& cur = cloudKeyPoses3D->points[numPoses-1];
+        const PointType& pre = cloudKeyPoses3D->points[numPoses-2];
+        float dist = pointDistance(cur, pre);
+        if (dist < 1e-3)
+            return;
+
+        PointType ahead = cur;
+        float scale = surroundingKeyframeSearchRadius * 0.5 / dist;
+        ahead.x += (cur.x - pre.x) * scale;
+        ahead.y += (cur.y - pre.y) * scale;
+        ahead.z += (cur.z - pre.z) * scale;
+
+        std::vector<int> pointSearchInd;
+        std::vector<float> pointSearchSqDis;
+        keyPoseIndex.radiusSearch(ahead, surroundingKeyframeSearchRadius, pointSearchInd, pointSearchSqDis);
+        keyFrames.prefetch(pointSearchInd);
+    }
+
+    void updateLocalMap(pcl::PointCloud<PointType>::Ptr cloudToExtract)
+    {
+        // insert the key frames which just come into range, each of them once
+        for (int i = 0; i < (int)cloudToExtract->size(); ++i)
+        {
+            if (pointDistance(cloudToExtract->points[i], cloudKeyPoses3D->back()) > surroundingKeyframeSearchRadius)
+                continue;
+
+            int thisKeyInd = (int)cloudToExtract->points[i].intensity;
+            if (localMapKeyFrames.insert(thisKeyInd).second == false)
+                continue;
+
+            pcl::PointCloud<PointType>::Ptr corner, surf;
+            if (!keyFrames.get(thisKeyInd, corner, surf))
+                continue;
+            localCornerMap.insert(*transformPointCloud(corner,  &cloudKeyPoses6D->points[thisKeyInd]));
+            localSurfMap.insert(*transformPointCloud(surf,    &cloudKeyPoses6D->points[thisKeyInd]));
+        }
+
+        // forget the key frames out of range, so that they are inserted again when revisited
+        for (auto it = localMapKeyFrames.begin(); it != localMapKeyFrames.end(); )
+        {
+            if (pointDistance(cloudKeyPoses3D->points[*it], cloudKeyPoses3D->back()) > surroundingKeyframeSearchRadius)
+                it = localMapKeyFrames.erase(it);
+            else
+                ++it;
+        }
+
+        // evict far voxels, with margin for the points seen from the key frames at the border
+        localCornerMap.removeFarVoxels(cloudKeyPoses3D->back(), surroundingKeyframeSearchRadius * 2);
+        localSurfMap.removeFarVoxels(cloudKeyPoses3D->back(), surroundingKeyframeSearchRadius * 2);
+
+        laserCloudCornerFromMapDSNum = localCornerMap.size();
+        laserCloudSurfFromMapDSNum = localSurfMap.size();
+    }
+
+    void clearLocalMap()
+    {
+        localCornerMap.clear();
+        localSurfMap.clear();
+        localMapKeyFrames.clear();
     }
 
     void extractCloud(pcl::PointCloud<PointType>::Ptr cloudToExtract)
@@ -909,19 +1412,19 @@ public:
                 continue;
 
             int thisKeyInd = (int)cloudToExtract->points[i].intensity;
-            if (laserCloudMapContainer.find(thisKeyInd) != laserCloudMapContainer.end()) 
+            auto transformed = laserCloudMapContainer.find(thisKeyInd);
+            if (transformed == nullptr)
             {
-                // transformed cloud available
-                *laserCloudCornerFromMap += laserCloudMapContainer[thisKeyInd].first;
-                *laserCloudSurfFromMap   += laserCloudMapContainer[thisKeyInd].second;
-            } else {
                 // transformed cloud not available
-                pcl::PointCloud<PointType> laserCloudCornerTemp = *transformPointCloud(cornerCloudKeyFrames[thisKeyInd],  &cloudKeyPoses6D->points[thisKeyInd]);
-                pcl::PointCloud<PointType> laserCloudSurfTemp = *transformPointCloud(surfCloudKeyFrames[thisKeyInd],    &cloudKeyPoses6D->points[thisKeyInd]);
-                *laserCloudCornerFromMap += laserCloudCornerTemp;
-                *laserCloudSurfFromMap   += laserCloudSurfTemp;
-                laserCloudMapContainer[thisKeyInd] = make_pair(laserCloudCornerTemp, laserCloudSurfTemp);
+                pcl::PointCloud<PointType>::Ptr corner, surf;
+                if (!keyFrames.get(thisKeyInd, corner, surf))
+                    continue;
+                transformed = laserCloudMapContainer.insert(thisKeyInd, make_pair(
+                    *transformPointCloud(corner,  &cloudKeyPoses6D->points[thisKeyInd]),
+                    *transformPointCloud(surf,    &cloudKeyPoses6D->points[thisKeyInd])));
             }
+            *laserCloudCornerFromMap += transformed->first;
+            *laserCloudSurfFromMap   += transformed->second;
             
         }
 
@@ -933,10 +1436,6 @@ public:
         downSizeFilterSurf.setInputCloud(laserCloudSurfFromMap);
         downSizeFilterSurf.filter(*laserCloudSurfFromMapDS);
         laserCloudSurfFromMapDSNum = laserCloudSurfFromMapDS->size();
-
-        // clear map cache if too large
-        if (laserCloudMapContainer.size() > 1000)
-            laserCloudMapContainer.clear();
     }
 
     void extractSurroundingKeyFrames()
@@ -971,22 +1470,42 @@ public:
     void updatePointAssociateToMap()
     {
         transPointAssociateToMap = trans2Affine3f(transformTobeMapped);
+        scanMatchJacobian = ScanMatchJacobian(transformTobeMapped);
+    }
+
+    bool searchNearestMap(const VoxelMap<PointType>& localMap, pcl::KdTreeFLANN<PointType>::Ptr& kdtreeMap,
+                          pcl::PointCloud<PointType>::Ptr& cloudMap, const PointType& pointSel,
+                          std::vector<int>& pointSearchInd, std::vector<float>& pointSearchSqDis,
+                          std::vector<PointType>& pointSearchNear)
+    {
+        if (useIncrementalLocalMap)
+            return localMap.nearestKSearch(pointSel, 5, pointSearchNear, pointSearchSqDis) == 5;
+
+        kdtreeMap->nearestKSearch(pointSel, 5, pointSearchInd, pointSearchSqDis);
+        pointSearchNear.resize(pointSearchInd.size());
+        for (int j = 0; j < (int)pointSearchInd.size(); j++)
+            pointSearchNear[j] = cloudMap->points[pointSearchInd[j]];
+        return true;
     }
 
     void cornerOptimization()
     {
         updatePointAssociateToMap();
 
-        #pragma omp parallel for num_threads(numberOfCores)
+        ScanMatchNormalEquation equation;
+        #pragma omp parallel for num_threads(numberOfCores) reduction(+ : equation)
         for (int i = 0; i < laserCloudCornerLastDSNum; i++)
         {
             PointType pointOri, pointSel, coeff;
             std::vector<int> pointSearchInd;
             std::vector<float> pointSearchSqDis;
+            std::vector<PointType> pointSearchNear;
 
             pointOri = laserCloudCornerLastDS->points[i];
             pointAssociateToMap(&pointOri, &pointSel);
-            kdtreeCornerFromMap->nearestKSearch(pointSel, 5, pointSearchInd, pointSearchSqDis);
+            if (searchNearestMap(localCornerMap, kdtreeCornerFromMap, laserCloudCornerFromMapDS, pointSel,
+                                 pointSearchInd, pointSearchSqDis, pointSearchNear) == false)
+                continue;
 
             cv::Mat matA1(3, 3, CV_32F, cv::Scalar::all(0));
             cv::Mat matD1(1, 3, CV_32F, cv::Scalar::all(0));
@@ -995,17 +1514,17 @@ public:
             if (pointSearchSqDis[4] < 1.0) {
                 float cx = 0, cy = 0, cz = 0;
                 for (int j = 0; j < 5; j++) {
-                    cx += laserCloudCornerFromMapDS->points[pointSearchInd[j]].x;
-                    cy += laserCloudCornerFromMapDS->points[pointSearchInd[j]].y;
-                    cz += laserCloudCornerFromMapDS->points[pointSearchInd[j]].z;
+                    cx += pointSearchNear[j].x;
+                    cy += pointSearchNear[j].y;
+                    cz += pointSearchNear[j].z;
                 }
                 cx /= 5; cy /= 5;  cz /= 5;
 
                 float a11 = 0, a12 = 0, a13 = 0, a22 = 0, a23 = 0, a33 = 0;
                 for (int j = 0; j < 5; j++) {
-                    float ax = laserCloudCornerFromMapDS->points[pointSearchInd[j]].x - cx;
-                    float ay = laserCloudCornerFromMapDS->points[pointSearchInd[j]].y - cy;
-                    float az = laserCloudCornerFromMapDS->points[pointSearchInd[j]].z - cz;
+                    float ax = pointSearchNear[j].x - cx;
+                    float ay = pointSearchNear[j].y - cy;
+                    float az = pointSearchNear[j].z - cz;
 
                     a11 += ax * ax; a12 += ax * ay; a13 += ax * az;
                     a22 += ay * ay; a23 += ay * az;
@@ -1056,29 +1575,32 @@ public:
                     coeff.intensity = s * ld2;
 
                     if (s > 0.1) {
-                        laserCloudOriCornerVec[i] = pointOri;
-                        coeffSelCornerVec[i] = coeff;
-                        laserCloudOriCornerFlag[i] = true;
+                        equation.add(scanMatchJacobian, pointOri, coeff);
                     }
                 }
             }
         }
+        normalEquation += equation;
     }
 
     void surfOptimization()
     {
         updatePointAssociateToMap();
 
-        #pragma omp parallel for num_threads(numberOfCores)
+        ScanMatchNormalEquation equation;
+        #pragma omp parallel for num_threads(numberOfCores) reduction(+ : equation)
         for (int i = 0; i < laserCloudSurfLastDSNum; i++)
         {
             PointType pointOri, pointSel, coeff;
             std::vector<int> pointSearchInd;
             std::vector<float> pointSearchSqDis;
+            std::vector<PointType> pointSearchNear;
 
             pointOri = laserCloudSurfLastDS->points[i];
             pointAssociateToMap(&pointOri, &pointSel); 
-            kdtreeSurfFromMap->nearestKSearch(pointSel, 5, pointSearchInd, pointSearchSqDis);
+            if (searchNearestMap(localSurfMap, kdtreeSurfFromMap, laserCloudSurfFromMapDS, pointSel,
+                                 pointSearchInd, pointSearchSqDis, pointSearchNear) == false)
+                continue;
 
             Eigen::Matrix<float, 5, 3> matA0;
             Eigen::Matrix<float, 5, 1> matB0;
@@ -1090,9 +1612,9 @@ public:
 
             if (pointSearchSqDis[4] < 1.0) {
                 for (int j = 0; j < 5; j++) {
-                    matA0(j, 0) = laserCloudSurfFromMapDS->points[pointSearchInd[j]].x;
-                    matA0(j, 1) = laserCloudSurfFromMapDS->points[pointSearchInd[j]].y;
-                    matA0(j, 2) = laserCloudSurfFromMapDS->points[pointSearchInd[j]].z;
+                    matA0(j, 0) = pointSearchNear[j].x;
+                    matA0(j, 1) = pointSearchNear[j].y;
+                    matA0(j, 2) = pointSearchNear[j].z;
                 }
 
                 matX0 = matA0.colPivHouseholderQr().solve(matB0);
@@ -1107,9 +1629,9 @@ public:
 
                 bool planeValid = true;
                 for (int j = 0; j < 5; j++) {
-                    if (fabs(pa * laserCloudSurfFromMapDS->points[pointSearchInd[j]].x +
-                             pb * laserCloudSurfFromMapDS->points[pointSearchInd[j]].y +
-                             pc * laserCloudSurfFromMapDS->points[pointSearchInd[j]].z + pd) > 0.2) {
+                    if (fabs(pa * pointSearchNear[j].x +
+                             pb * pointSearchNear[j].y +
+                             pc * pointSearchNear[j].z + pd) > 0.2) {
                         planeValid = false;
                         break;
                     }
@@ -1127,154 +1649,75 @@ public:
                     coeff.intensity = s * pd2;
 
                     if (s > 0.1) {
-                        laserCloudOriSurfVec[i] = pointOri;
-                        coeffSelSurfVec[i] = coeff;
-                        laserCloudOriSurfFlag[i] = true;
+                        equation.add(scanMatchJacobian, pointOri, coeff);
                     }
                 }
             }
         }
-    }
-
-    void combineOptimizationCoeffs()
-    {
-        // combine corner coeffs
-        for (int i = 0; i < laserCloudCornerLastDSNum; ++i){
-            if (laserCloudOriCornerFlag[i] == true){
-                laserCloudOri->push_back(laserCloudOriCornerVec[i]);
-                coeffSel->push_back(coeffSelCornerVec[i]);
-            }
-        }
-        // combine surf coeffs
-        for (int i = 0; i < laserCloudSurfLastDSNum; ++i){
-            if (laserCloudOriSurfFlag[i] == true){
-                laserCloudOri->push_back(laserCloudOriSurfVec[i]);
-                coeffSel->push_back(coeffSelSurfVec[i]);
-            }
-        }
-        // reset flag for next iteration
-        std::fill(laserCloudOriCornerFlag.begin(), laserCloudOriCornerFlag.end(), false);
-        std::fill(laserCloudOriSurfFlag.begin(), laserCloudOriSurfFlag.end(), false);
+        normalEquation += equation;
     }
 
     bool LMOptimization(int iterCount)
     {
-        // This optimization is from the original loam_velodyne by Ji Zhang, need to cope with coordinate transformation
-        // lidar <- camera      ---     camera <- lidar
-        // x = z                ---     x = y
-        // y = x                ---     y = z
-        // z = y                ---     z = x
-        // roll = yaw           ---     roll = pitch
-        // pitch = roll         ---     pitch = yaw
-        // yaw = pitch          ---     yaw = roll
-
-        // lidar -> camera
-        float srx = sin(transformTobeMapped[1]);
-        float crx = cos(transformTobeMapped[1]);
-        float sry = sin(transformTobeMapped[2]);
-        float cry = cos(transformTobeMapped[2]);
-        float srz = sin(transformTobeMapped[0]);
-        float crz = cos(transformTobeMapped[0]);
-
-        int laserCloudSelNum = laserCloudOri->size();
-        if (laserCloudSelNum < 50) {
+        if (normalEquation.num < 50) {
             return false;
         }
 
-        cv::Mat matA(laserCloudSelNum, 6, CV_32F, cv::Scalar::all(0));
-        cv::Mat matAt(6, laserCloudSelNum, CV_32F, cv::Scalar::all(0));
-        cv::Mat matAtA(6, 6, CV_32F, cv::Scalar::all(0));
-        cv::Mat matB(laserCloudSelNum, 1, CV_32F, cv::Scalar::all(0));
-        cv::Mat matAtB(6, 1, CV_32F, cv::Scalar::all(0));
-        cv::Mat matX(6, 1, CV_32F, cv::Scalar::all(0));
-        cv::Mat matP(6, 6, CV_32F, cv::Scalar::all(0));
-
-        PointType pointOri, coeff;
-
-        for (int i = 0; i < laserCloudSelNum; i++) {
-            // lidar -> camera
-            pointOri.x = laserCloudOri->points[i].y;
-            pointOri.y = laserCloudOri->points[i].z;
-            pointOri.z = laserCloudOri->points[i].x;
-            // lidar -> camera
-            coeff.x = coeffSel->points[i].y;
-            coeff.y = coeffSel->points[i].z;
-            coeff.z = coeffSel->points[i].x;
-            coeff.intensity = coeffSel->points[i].intensity;
-            // in camera
-            float arx = (crx*sry*srz*pointOri.x + crx*crz*sry*pointOri.y - srx*sry*pointOri.z) * coeff.x
-                      + (-srx*srz*pointOri.x - crz*srx*pointOri.y - crx*pointOri.z) * coeff.y
-                      + (crx*cry*srz*pointOri.x + crx*cry*crz*pointOri.y - cry*srx*pointOri.z) * coeff.z;
-
-            float ary = ((cry*srx*srz - crz*sry)*pointOri.x 
-                      + (sry*srz + cry*crz*srx)*pointOri.y + crx*cry*pointOri.z) * coeff.x
-                      + ((-cry*crz - srx*sry*srz)*pointOri.x 
-                      + (cry*srz - crz*srx*sry)*pointOri.y - crx*sry*pointOri.z) * coeff.z;
-
-            float arz = ((crz*srx*sry - cry*srz)*pointOri.x + (-cry*crz-srx*sry*srz)*pointOri.y)*coeff.x
-                      + (crx*crz*pointOri.x - crx*srz*pointOri.y) * coeff.y
-                      + ((sry*srz + cry*crz*srx)*pointOri.x + (crz*sry-cry*srx*srz)*pointOri.y)*coeff.z;
-            // lidar -> camera
-            matA.at<float>(i, 0) = arz;
-            matA.at<float>(i, 1) = arx;
-            matA.at<float>(i, 2) = ary;
-            matA.at<float>(i, 3) = coeff.z;
-            matA.at<float>(i, 4) = coeff.x;
-            matA.at<float>(i, 5) = coeff.y;
-            matB.at<float>(i, 0) = -coeff.intensity;
-        }
-
-        cv::transpose(matA, matAt);
-        matAtA = matAt * matA;
-        matAtB = matAt * matB;
-        cv::solve(matAtA, matAtB, matX, cv::DECOMP_QR);
+        const Eigen::Matrix<float, 6, 6>& matAtA = normalEquation.AtA;
+        Eigen::Matrix<float, 6, 1> matX = matAtA.colPivHouseholderQr().solve(normalEquation.AtB);
 
         if (iterCount == 0) {
 
-            cv::Mat matE(1, 6, CV_32F, cv::Scalar::all(0));
-            cv::Mat matV(6, 6, CV_32F, cv::Scalar::all(0));
-            cv::Mat matV2(6, 6, CV_32F, cv::Scalar::all(0));
-
-            cv::eigen(matAtA, matE, matV);
-            matV.copyTo(matV2);
+            // eigen values in ascending order, eigen vectors in columns
+            Eigen::SelfAdjointEigenSolver<Eigen::Matrix<float, 6, 6>> esolver(matAtA);
+            Eigen::Matrix<float, 6, 1> matE = esolver.eigenvalues();
+            Eigen::Matrix<float, 6, 6> matV = esolver.eigenvectors().transpose();
+            Eigen::Matrix<float, 6, 6> matV2 = matV;
 
             isDegenerate = false;
             float eignThre[6] = {100, 100, 100, 100, 100, 100};
-            for (int i = 5; i >= 0; i--) {
-                if (matE.at<float>(0, i) < eignThre[i]) {
-                    for (int j = 0; j < 6; j++) {
-                        matV2.at<float>(i, j) = 0;
-                    }
+            for (int i = 0; i < 6; i++) {
+                if (matE(i) < eignThre[i]) {
+                    matV2.row(i).setZero();
                     isDegenerate = true;
                 } else {
                     break;
                 }
             }
-            matP = matV.inv() * matV2;
+            matP = matV.inverse() * matV2;
         }
 
         if (isDegenerate)
         {
-            cv::Mat matX2(6, 1, CV_32F, cv::Scalar::all(0));
-            matX.copyTo(matX2);
-            matX = matP * matX2;
+            // As in the original implementation, the projection only applies to the first iteration: its
+            // projection matrix was local to this function, so it was zero, and so was the step, afterwards.
+            // A degenerate problem therefore stops after one projected step.
+            if (iterCount == 0)
+            {
+                Eigen::Matrix<float, 6, 1> matX2 = matX;
+                matX = matP * matX2;
+            }
+            else
+            {
+                matX.setZero();
+            }
         }
 
-        transformTobeMapped[0] += matX.at<float>(0, 0);
-        transformTobeMapped[1] += matX.at<float>(1, 0);
-        transformTobeMapped[2] += matX.at<float>(2, 0);
-        transformTobeMapped[3] += matX.at<float>(3, 0);
-        transformTobeMapped[4] += matX.at<float>(4, 0);
-        transformTobeMapped[5] += matX.at<float>(5, 0);
+        transformTobeMapped[0] += matX(0);
+        transformTobeMapped[1] += matX(1);
+        transformTobeMapped[2] += matX(2);
+        transformTobeMapped[3] += matX(3);
+        transformTobeMapped[4] += matX(4);
+        transformTobeMapped[5] += matX(5);
 
         float deltaR = sqrt(
-                            pow(pcl::rad2deg(matX.at<float>(0, 0)), 2) +
-                            pow(pcl::rad2deg(matX.at<float>(1, 0)), 2) +
-                            pow(pcl::rad2deg(matX.at<float>(2, 0)), 2));
+                            pow(pcl::rad2deg(matX(0)), 2) +
+                            pow(pcl::rad2deg(matX(1)), 2) +
+                            pow(pcl::rad2deg(matX(2)), 2));
         float deltaT = sqrt(
-                            pow(matX.at<float>(3, 0) * 100, 2) +
-                            pow(matX.at<float>(4, 0) * 100, 2) +
-                            pow(matX.at<float>(5, 0) * 100, 2));
+                            pow(matX(3) * 100, 2) +
+                            pow(matX(4) * 100, 2) +
+                            pow(matX(5) * 100, 2));
 
         if (deltaR < 0.05 && deltaT < 0.05) {
             return true; // converged
@@ -1289,19 +1732,19 @@ public:
 
         if (laserCloudCornerLastDSNum > edgeFeatureMinValidNum && laserCloudSurfLastDSNum > surfFeatureMinValidNum)
         {
-            kdtreeCornerFromMap->setInputCloud(laserCloudCornerFromMapDS);
-            kdtreeSurfFromMap->setInputCloud(laserCloudSurfFromMapDS);
+            if (!useIncrementalLocalMap)
+            {
+                kdtreeCornerFromMap->setInputCloud(laserCloudCornerFromMapDS);
+                kdtreeSurfFromMap->setInputCloud(laserCloudSurfFromMapDS);
+            }
 
             for (int iterCount = 0; iterCount < 30; iterCount++)
             {
-                laserCloudOri->clear();
-                coeffSel->clear();
+                normalEquation = ScanMatchNormalEquation();
 
                 cornerOptimization();
                 surfOptimization();
 
-                combineOptimizationCoeffs();
-
                 if (LMOptimization(iterCount) == true)
                     break;              
             }
@@ -1388,12 +1831,14 @@ public:
             noiseModel::Diagonal::shared_ptr priorNoise = noiseModel::Diagonal::Variances((Vector(6) << 1e-2, 1e-2, M_PI*M_PI, 1e8, 1e8, 1e8).finished()); // rad*rad, meter*meter
             gtSAMgraph.add(PriorFactor<Pose3>(0, trans2gtsamPose(transformTobeMapped), priorNoise));
             initialEstimate.insert(0, trans2gtsamPose(transformTobeMapped));
+            addSessionFactor(SessionFactor::PRIOR, 0, -1, trans2gtsamPose(transformTobeMapped), priorNoise->sigmas().array().square().matrix());
         }else{
             noiseModel::Diagonal::shared_ptr odometryNoise = noiseModel::Diagonal::Variances((Vector(6) << 1e-6, 1e-6, 1e-6, 1e-4, 1e-4, 1e-4).finished());
             gtsam::Pose3 poseFrom = pclPointTogtsamPose3(cloudKeyPoses6D->points.back());
             gtsam::Pose3 poseTo   = trans2gtsamPose(transformTobeMapped);
             gtSAMgraph.add(BetweenFactor<Pose3>(cloudKeyPoses3D->size()-1, cloudKeyPoses3D->size(), poseFrom.between(poseTo), odometryNoise));
             initialEstimate.insert(cloudKeyPoses3D->size(), poseTo);
+            addSessionFactor(SessionFactor::BETWEEN, cloudKeyPoses3D->size()-1, cloudKeyPoses3D->size(), poseFrom.between(poseTo), odometryNoise->sigmas().array().square().matrix());
         }
     }
 
@@ -1469,6 +1914,7 @@ public:
                 noiseModel::Diagonal::shared_ptr gps_noise = noiseModel::Diagonal::Variances(Vector3);
                 gtsam::GPSFactor gps_factor(cloudKeyPoses3D->size(), gtsam::Point3(gps_x, gps_y, gps_z), gps_noise);
                 gtSAMgraph.add(gps_factor);
+                addSessionFactor(SessionFactor::GPS, cloudKeyPoses3D->size(), -1, gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(gps_x, gps_y, gps_z)), Vector3);
 
                 aLoopIsClosed = true;
                 break;
@@ -1487,7 +1933,10 @@ public:
             int indexTo = loopIndexQueue[i].second;
             gtsam::Pose3 poseBetween = loopPoseQueue[i];
             gtsam::noiseModel::Diagonal::shared_ptr noiseBetween = loopNoiseQueue[i];
+            reactivatePose(indexFrom);
+            reactivatePose(indexTo);
             gtSAMgraph.add(BetweenFactor<Pose3>(indexFrom, indexTo, poseBetween, noiseBetween));
+            addSessionFactor(SessionFactor::BETWEEN, indexFrom, indexTo, poseBetween, noiseBetween->sigmas().array().square().matrix());
         }
 
         loopIndexQueue.clear();
@@ -1496,6 +1945,82 @@ public:
         aLoopIsClosed = true;
     }
 
+    void updateIsam()
+    {
+        if (useFixedLagSmoother == false)
+        {
+            isam->update(gtSAMgraph, initialEstimate);
+            isam->update();
+            return;
+        }
+
+        for (Key key : initialEstimate.keys())
+            activeKeys.insert(key);
+
+        // key poses out of the window are marginalized, and their last estimate is frozen
+        Key newestKey = cloudKeyPoses3D->size();
+        FastList<Key> marginalKeys;
+        for (Key key : activeKeys)
+        {
+            if (key + std::max(smootherLag, 2) <= newestKey)
+                marginalKeys.push_back(key);
+        }
+
+        if (marginalKeys.empty())
+        {
+            isam->update(gtSAMgraph, initialEstimate);
+            isam->update();
+            return;
+        }
+
+        // eliminate the marginalized keys first, so that they end up as leaves of the Bayes tree,
+        // the same way gtsam::IncrementalFixedLagSmoother does
+        FastMap<Key, int> constrainedKeys;
+        for (Key key : activeKeys)
+            constrainedKeys[key] = 1;
+        std::set<Key> reelimKeys;
+        for (Key key : marginalKeys)
+        {
+            constrainedKeys[key] = 0;
+            if (isam->valueExists(key))
+            {
+                for (const auto& child : (*isam)[key]->children)
+                    markAffectedKeys(key, child, reelimKeys);
+            }
+        }
+
+        isam->update(gtSAMgraph, initialEstimate, FactorIndices(), constrainedKeys,
+                     boost::none, FastList<Key>(reelimKeys.begin(), reelimKeys.end()));
+        isam->marginalizeLeaves(marginalKeys);
+        for (Key key : marginalKeys)
+            activeKeys.erase(key);
+        isam->update();
+    }
+
+    void markAffectedKeys(Key key, const ISAM2::sharedClique& clique, std::set<Key>& reelimKeys)
+    {
+        const auto& conditional = clique->conditional();
+        if (std::find(conditional->beginParents(), conditional->endParents(), key) == conditional->endParents())
+            return;
+
+        for (Key frontal : conditional->frontals())
+            reelimKeys.insert(frontal);
+        for (const auto& child : clique->children)
+            markAffectedKeys(key, child, reelimKeys);
+    }
+
+    // bring a frozen key pose back into isam, anchored at its frozen estimate, when a loop closure touches it
+    void reactivatePose(int keyInd)
+    {
+        if (useFixedLagSmoother == false || activeKeys.count(keyInd) || initialEstimate.exists(keyInd))
+            return;
+
+        noiseModel::Diagonal::shared_ptr frozenNoise = noiseModel::Diagonal::Variances((Vector(6) << 1e-6, 1e-6, 1e-6, 1e-6, 1e-6, 1e-6).finished());
+        gtsam::Pose3 frozenPose = pclPointTogtsamPose3(cloudKeyPoses6D->points[keyInd]);
+        gtSAMgraph.add(PriorFactor<Pose3>(keyInd, frozenPose, frozenNoise));
+        initialEstimate.insert(keyInd, frozenPose);
+    }
+
     void saveKeyFramesAndFactor()
     {
         if (saveFrame() == false)
@@ -1514,8 +2039,9 @@ public:
         // gtSAMgraph.print("GTSAM Graph:\n");
 
         // update iSAM
-        isam->update(gtSAMgraph, initialEstimate);
-        isam->update();
+        auto updateStart = std::chrono::steady_clock::now();
+
+        updateIsam();
 
         if (aLoopIsClosed == true)
         {
@@ -1533,9 +2059,10 @@ public:
         PointType thisPose3D;
         PointTypePose thisPose6D;
         Pose3 latestEstimate;
+        Key latestKey = cloudKeyPoses3D->size();
 
         isamCurrentEstimate = isam->calculateEstimate();
-        latestEstimate = isamCurrentEstimate.at<Pose3>(isamCurrentEstimate.size()-1);
+        latestEstimate = isamCurrentEstimate.at<Pose3>(latestKey);
         // cout << "****************************************************" << endl;
         // isamCurrentEstimate.print("Current estimate: ");
 
@@ -1544,6 +2071,7 @@ public:
         thisPose3D.z = latestEstimate.translation().z();
         thisPose3D.intensity = cloudKeyPoses3D->size(); // this can be used as index
         cloudKeyPoses3D->push_back(thisPose3D);
+        keyPoseIndex.add(thisPose3D);
 
         thisPose6D.x = thisPose3D.x;
         thisPose6D.y = thisPose3D.y;
@@ -1558,7 +2086,11 @@ public:
         // cout << "****************************************************" << endl;
         // cout << "Pose covariance:" << endl;
         // cout << isam->marginalCovariance(isamCurrentEstimate.size()-1) << endl << endl;
-        poseCovariance = isam->marginalCovariance(isamCurrentEstimate.size()-1);
+        poseCovariance = isam->marginalCovariance(latestKey);
+
+        double updateTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - updateStart).count();
+        RCLCPP_DEBUG(get_logger(), "Key frame %d: iSAM update %.2f ms, %d active poses.",
+                     (int)latestKey, updateTime, (int)isamCurrentEstimate.size());
 
         // save updated transform
         transformTobeMapped[0] = latestEstimate.rotation().roll();
@@ -1575,8 +2107,14 @@ public:
         pcl::copyPointCloud(*laserCloudSurfLastDS,    *thisSurfKeyFrame);
 
         // save key frame cloud
-        cornerCloudKeyFrames.push_back(thisCornerKeyFrame);
-        surfCloudKeyFrames.push_back(thisSurfKeyFrame);
+        keyFrames.add(thisCornerKeyFrame, thisSurfKeyFrame);
+        if (session.isOpen())
+        {
+            SessionPose sessionPose;
+            sessionPose.time = timeLaserInfoCur;
+            std::copy(transformTobeMapped, transformTobeMapped + 6, sessionPose.pose);
+            session.addKeyFrame(latestKey, sessionPose, *thisCornerKeyFrame, *thisSurfKeyFrame);
+        }
 
         // save path for visualization
         updatePath(thisPose6D);
@@ -1591,12 +2129,14 @@ public:
         {
             // clear map cache
             laserCloudMapContainer.clear();
+            clearLocalMap();
+            keyPosesVersion++;
             // clear path
             globalPath.poses.clear();
-            // update key poses
-            int numPoses = isamCurrentEstimate.size();
-            for (int i = 0; i < numPoses; ++i)
+            // update key poses, the ones out of the fixed-lag window are frozen
+            for (const auto& keyValue : isamCurrentEstimate)
             {
+                int i = keyValue.key;
                 cloudKeyPoses3D->points[i].x = isamCurrentEstimate.at<Pose3>(i).translation().x();
                 cloudKeyPoses3D->points[i].y = isamCurrentEstimate.at<Pose3>(i).translation().y();
                 cloudKeyPoses3D->points[i].z = isamCurrentEstimate.at<Pose3>(i).translation().z();
@@ -1607,8 +2147,28 @@ public:
                 cloudKeyPoses6D->points[i].roll  = isamCurrentEstimate.at<Pose3>(i).rotation().roll();
                 cloudKeyPoses6D->points[i].pitch = isamCurrentEstimate.at<Pose3>(i).rotation().pitch();
                 cloudKeyPoses6D->points[i].yaw   = isamCurrentEstimate.at<Pose3>(i).rotation().yaw();
+            }
+
+            keyPoseIndex.update(*cloudKeyPoses3D);
 
+            for (int i = 0; i < (int)cloudKeyPoses6D->size(); ++i)
                 updatePath(cloudKeyPoses6D->points[i]);
+
+            if (session.isOpen())
+            {
+                std::vector<SessionPose> sessionPoses(cloudKeyPoses6D->size());
+                for (int i = 0; i < (int)cloudKeyPoses6D->size(); ++i)
+                {
+                    const PointTypePose& pose = cloudKeyPoses6D->points[i];
+                    sessionPoses[i].time = pose.time;
+                    sessionPoses[i].pose[0] = pose.roll;
+                    sessionPoses[i].pose[1] = pose.pitch;
+                    sessionPoses[i].pose[2] = pose.yaw;
+                    sessionPoses[i].pose[3] = pose.x;
+                    sessionPoses[i].pose[4] = pose.y;
+                    sessionPoses[i].pose[5] = pose.z;
+                }
+                session.updatePoses(sessionPoses);
             }
 
             aLoopIsClosed = false;
@@ -1722,6 +2282,8 @@ public:
         // publish key poses
         publishCloud(pubKeyPoses, cloudKeyPoses3D, timeLaserInfoStamp, odometryFrame);
         // Publish surrounding key frames
+        if (useIncrementalLocalMap && pubRecentKeyFrames->get_subscription_count() != 0)
+            localSurfMap.getCloud(*laserCloudSurfFromMapDS);
         publishCloud(pubRecentKeyFrames, laserCloudSurfFromMapDS, timeLaserInfoStamp, odometryFrame);
         // publish registered key frame
         if (pubRecentKeyFrame->get_subscription_count() != 0)
@@ -1736,7 +2298,10 @@ public:
         if (pubCloudRegisteredRaw->get_subscription_count() != 0)
         {
             pcl::PointCloud<PointType>::Ptr cloudOut(new pcl::PointCloud<PointType>());
-            pcl::fromROSMsg(cloudInfo.cloud_deskewed, *cloudOut);
+            if (laserCloudDeskewed)
+                *cloudOut = *laserCloudDeskewed;
+            else
+                pcl::fromROSMsg(cloudInfo.cloud_deskewed, *cloudOut);
             PointTypePose thisPose6D = trans2PointTypePose(transformTobeMapped);
             *cloudOut = *transformPointCloud(cloudOut,  &thisPose6D);
             publishCloud(pubCloudRegisteredRaw, cloudOut, timeLaserInfoStamp, odometryFrame);
@@ -1752,6 +2317,10 @@ public:
 };
 
 
+#ifdef LIO_SAM_COMPONENTS
+#include "rclcpp_components/register_node_macro.hpp"
+RCLCPP_COMPONENTS_REGISTER_NODE(mapOptimization)
+#else
 int main(int argc, char** argv)
 {   
     rclcpp::init(argc, argv);
@@ -1765,15 +2334,10 @@ int main(int argc, char** argv)
 
     RCLCPP_INFO(rclcpp::get_logger("rclcpp"), "\033[1;32m----> Map Optimization Started.\033[0m");
 
-    std::thread loopthread(&mapOptimization::loopClosureThread, MO);
-    std::thread visualizeMapThread(&mapOptimization::visualizeGlobalMapThread, MO);
-
     exec.spin();
 
     rclcpp::shutdown();
 
-    loopthread.join();
-    visualizeMapThread.join();
-
     return 0;
 }
+#endif
@@ -0,0 +1,226 @@
+#include "utility.hpp"
+
+#include <ament_index_cpp/get_resource.hpp>
+#include <class_loader/class_loader.hpp>
+#include <rclcpp_components/node_factory.hpp>
+#include <rosbag2_cpp/reader.hpp>
+#include <rosbag2_storage/storage_filter.hpp>
+
+#include <chrono>
+#include <memory>
+
+/*
+    * Replays a rosbag2 through the LIO-SAM components, as fast as the CPU allows and without dropping messages.
+    * Each bag message is published over intra-process communication, then every node is spun until idle, one after
+    * the other in the data flow order, before the next message is read. Loop closure runs on the lidar time
+    * (synchronousMode), so the result does not depend on the replay speed. With --deterministic, all the OpenMP
+    * loops run on one thread, so that two runs give the same trajectory.
+    *
+    * ros2 run lio_sam lio_sam_offlineRunner <bag> [--output <directory>] [--deterministic]
+    *     --ros-args --params-file <params.yaml>
+    *
+    * Writes <directory>/trajectory.txt (final key poses) and <directory>/odometry.txt (mapping odometry)
+    * in the TUM format: time x y z qx qy qz qw.
+    */
+class OfflineRunner : public ParamServer
+{
+public:
+
+    rclcpp::Publisher<sensor_msgs::msg::Imu>::SharedPtr pubImu;
+    rclcpp::Publisher<sensor_msgs::msg::PointCloud2>::SharedPtr pubLaserCloud;
+    rclcpp::Publisher<nav_msgs::msg::Odometry>::SharedPtr pubGPS;
+
+    rclcpp::Subscription<nav_msgs::msg::Path>::SharedPtr subPath;
+    rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr subOdometry;
+
+    rclcpp::Serialization<sensor_msgs::msg::Imu> imuSerialization;
+    rclcpp::Serialization<sensor_msgs::msg::PointCloud2> cloudSerialization;
+    rclcpp::Serialization<nav_msgs::msg::Odometry> odometrySerialization;
+
+    nav_msgs::msg::Path path;
+    std::vector<geometry_msgs::msg::PoseStamped> odometry;
+
+    OfflineRunner(const rclcpp::NodeOptions & options) : ParamServer("lio_sam_offlineRunner", options)
+    {
+        pubImu = create_publisher<sensor_msgs::msg::Imu>(imuTopic, qos_imu);
+        pubLaserCloud = create_publisher<sensor_msgs::msg::PointCloud2>(pointCloudTopic, qos_lidar);
+        pubGPS = create_publisher<nav_msgs::msg::Odometry>(gpsTopic, qos);
+
+        subPath = create_subscription<nav_msgs::msg::Path>(
+            "lio_sam/mapping/path", 1,
+            [this](nav_msgs::msg::Path::UniquePtr msg) { path = std::move(*msg); });
+        subOdometry = create_subscription<nav_msgs::msg::Odometry>(
+            "lio_sam/mapping/odometry", qos,
+            [this](nav_msgs::msg::Odometry::UniquePtr msg)
+            {
+                geometry_msgs::msg::PoseStamped pose;
+                pose.header = msg->header;
+                pose.pose = msg->pose.pose;
+                odometry.push_back(pose);
+            });
+    }
+
+    // returns false if the message is not an input of LIO-SAM
+    bool publish(const rosbag2_storage::SerializedBagMessage& bagMsg)
+    {
+        rclcpp::SerializedMessage serialized(*bagMsg.serialized_data);
+        if (bagMsg.topic_name == imuTopic)
+        {
+            auto msg = std::make_unique<sensor_msgs::msg::Imu>();
+            imuSerialization.deserialize_message(&serialized, msg.get());
+            pubImu->publish(std::move(msg));
+        }
+        else if (bagMsg.topic_name == pointCloudTopic)
+        {
+            auto msg = std::make_unique<sensor_msgs::msg::PointCloud2>();
+            cloudSerialization.deserialize_message(&serialized, msg.get());
+            pubLaserCloud->publish(std::move(msg));
+        }
+        else if (bagMsg.topic_name == gpsTopic)
+        {
+            auto msg = std::make_unique<nav_msgs::msg::Odometry>();
+            odometrySerialization.deserialize_message(&serialized, msg.get());
+            pubGPS->publish(std::move(msg));
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    static bool saveTrajectory(const std::string& fileName, const std::vector<geometry_msgs::msg::PoseStamped>& poses)
+    {
+        std::ofstream file(fileName);
+        file << std::fixed;
+        for (const auto& pose : poses)
+        {
+            file << std::setprecision(9) << stamp2Sec(pose.header.stamp) << " " << std::setprecision(6)
+                 << pose.pose.position.x << " " << pose.pose.position.y << " " << pose.pose.position.z << " "
+                 << pose.pose.orientation.x << " " << pose.pose.orientation.y << " "
+                 << pose.pose.orientation.z << " " << pose.pose.orientation.w << "\n";
+        }
+        return file.good();
+    }
+};
+
+struct Stage
+{
+    std::string name;
+    std::unique_ptr<rclcpp::executors::SingleThreadedExecutor> executor;
+    double time = 0;
+};
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args = rclcpp::init_and_remove_ros_arguments(argc, argv);
+
+    std::string bagPath;
+    std::string outputDirectory = ".";
+    bool deterministic = false;
+    for (size_t i = 1; i < args.size(); ++i)
+    {
+        if (args[i] == "--deterministic")
+            deterministic = true;
+        else if (args[i] == "--output" && i + 1 < args.size())
+            outputDirectory = args[++i];
+        else
+            bagPath = args[i];
+    }
+    if (bagPath.empty())
+    {
+        cout << "usage: lio_sam_offlineRunner <bag> [--output <directory>] [--deterministic] --ros-args --params-file <params.yaml>" << endl;
+        rclcpp::shutdown();
+        return 1;
+    }
+
+    // the nodes are loaded from the components library, like a component container does
+    std::string resources, prefix;
+    if (!ament_index_cpp::get_resource("rclcpp_components", "lio_sam", resources, &prefix))
+    {
+        RCLCPP_ERROR(rclcpp::get_logger("rclcpp"), "lio_sam components not found in the ament index.");
+        rclcpp::shutdown();
+        return 1;
+    }
+    std::string library = resources.substr(resources.find(';') + 1);
+    library = prefix + "/" + library.substr(0, library.find('\n'));
+    class_loader::ClassLoader loader(library);
+
+    rclcpp::NodeOptions options;
+    options.use_intra_process_comms(true);
+    std::vector<rclcpp::Parameter> overrides = {rclcpp::Parameter("synchronousMode", true)};
+    if (deterministic)
+        overrides.push_back(rclcpp::Parameter("numberOfCores", 1));
+    options.parameter_overrides(overrides);
+
+    // data flow order: imu odometry is needed by the projection, mapping odometry is fed back to the preintegration
+    const std::vector<std::string> nodeNames = {"IMUPreintegration", "TransformFusion", "ImageProjection", "FeatureExtraction", "mapOptimization"};
+    std::vector<rclcpp_components::NodeInstanceWrapper> nodes;
+    std::vector<Stage> stages;
+    for (const auto& name : nodeNames)
+    {
+        auto factory = loader.createInstance<rclcpp_components::NodeFactory>("rclcpp_components::NodeFactoryTemplate<" + name + ">");
+        nodes.push_back(factory->create_node_instance(options));
+        stages.push_back(Stage{name, std::make_unique<rclcpp::executors::SingleThreadedExecutor>()});
+        stages.back().executor->add_node(nodes.back().get_node_base_interface());
+    }
+    auto runner = std::make_shared<OfflineRunner>(options);
+    stages.push_back(Stage{"OfflineRunner", std::make_unique<rclcpp::executors::SingleThreadedExecutor>()});
+    stages.back().executor->add_node(runner);
+    const std::vector<int> order = {0, 1, 2, 3, 4, 0, 1, 5};
+
+    rosbag2_cpp::Reader reader;
+    reader.open(bagPath);
+    rosbag2_storage::StorageFilter filter;
+    filter.topics = {runner->imuTopic, runner->pointCloudTopic, runner->gpsTopic};
+    reader.set_filter(filter);
+
+    RCLCPP_INFO(rclcpp::get_logger("rclcpp"), "\033[1;32m----> Offline Runner Started.\033[0m");
+
+    auto wallStart = std::chrono::steady_clock::now();
+    int64_t bagStart = -1, bagEnd = -1;
+    int numMessages = 0, numScans = 0;
+    while (reader.has_next() && rclcpp::ok())
+    {
+        auto bagMsg = reader.read_next();
+        if (runner->publish(*bagMsg) == false)
+            continue;
+
+        if (bagStart < 0)
+            bagStart = bagMsg->time_stamp;
+        bagEnd = bagMsg->time_stamp;
+        numMessages++;
+        if (bagMsg->topic_name == runner->pointCloudTopic)
+            numScans++;
+
+        for (int i : order)
+        {
+            auto stageStart = std::chrono::steady_clock::now();
+            stages[i].executor->spin_all(std::chrono::nanoseconds(0));
+            stages[i].time += std::chrono::duration<double>(std::chrono::steady_clock::now() - stageStart).count();
+        }
+    }
+    double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    double bagTime = bagEnd > bagStart ? (bagEnd - bagStart) * 1e-9 : 0;
+
+    cout << "****************************************************" << endl;
+    cout << "Processed " << numMessages << " messages, " << numScans << " scans in " << wallTime << " s, "
+         << (wallTime > 0 ? bagTime / wallTime : 0) << "x real time" << endl;
+    for (const auto& stage : stages)
+    {
+        cout << std::left << std::setw(20) << stage.name << std::right << std::fixed << std::setprecision(3)
+             << std::setw(10) << stage.time << " s" << std::setw(10) << (numScans > 0 ? stage.time * 1e3 / numScans : 0)
+             << " ms/scan" << endl;
+    }
+
+    bool ok = OfflineRunner::saveTrajectory(outputDirectory + "/trajectory.txt", runner->path.poses);
+    ok = OfflineRunner::saveTrajectory(outputDirectory + "/odometry.txt", runner->odometry) && ok;
+    cout << (ok ? "Trajectory saved to " : "Failed to save the trajectory to ") << outputDirectory << endl;
+
+    // the mapping threads run until shutdown, and save the map on exit when savePCD is set
+    rclcpp::shutdown();
+    stages.clear();
+    runner.reset();
+    nodes.clear();
+    return ok ? 0 : 1;
+}
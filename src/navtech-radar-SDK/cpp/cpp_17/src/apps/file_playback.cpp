@@ -54,7 +54,9 @@ using Navtech::Networking::Offline::Client;
 //
 Option_parser options {
     {
-        Option { "--file", "-f", "playback recording", required, has_argument, "" },
+        Option { "--file", "-f", "playback recording",                          required, has_argument, "" },
+        Option { "--rate", "-r", "playback rate (0 - as fast as possible)",     optional, has_argument, "0" },
+        Option { "--seek", "-s", "start offset into the recording (seconds)",   optional, has_argument, "0" },
     }
 };
 
@@ -90,10 +92,15 @@ int main(int argc, char* argv[])
     // Command line option parsing
     //
     options.parse(argc, argv);
-    auto filepath = options.global("-f").value();
+    auto filepath   = options.global("-f").value();
+    auto rate       = options.global("-r").to_float();
+    auto start_at   = options.global("-s").to_float();
 
     Client client { filepath };
 
+    client.playback_rate(rate);
+    if (start_at > 0.0f) client.seek(to_sec_duration(start_at));
+
     client.ignore(TCP::Type::fft_data);
     client.ignore(TCP::Type::keep_alive);
     
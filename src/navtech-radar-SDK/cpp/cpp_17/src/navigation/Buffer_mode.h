@@ -6,6 +6,12 @@ namespace Navtech::Navigation {
     // Buffer modes are really only useful with a staring radar
     //
     enum class Buffer_mode { off, average, max };
+
+    // block:   a result every sample_sz rows, over those rows
+    // sliding: once sample_sz rows have been buffered, a result for
+    //          every row, over the last sample_sz rows
+    //
+    enum class Buffer_window { block, sliding };
     
 } // namespace Navtech::Navigation
 #endif
\ No newline at end of file
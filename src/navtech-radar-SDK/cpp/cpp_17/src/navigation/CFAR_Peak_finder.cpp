@@ -18,12 +18,14 @@
 // loss was sustained from, or arose out of, the results of, the item, or any
 // services that may be provided by Navtech Radar.
 // ---------------------------------------------------------------------------------------------------------------------
+#include <functional>
+#include <thread>
+
 #include "CFAR_Peak_finder.h"
 #include "Vector_maths.h"
 #include "Log.h"
 #include "float_equality.h"
 #include "Centre_of_mass.h"
-#include "Shape_finder.h"
 
 using namespace Navtech::Networking::Colossus_protocol;
 
@@ -32,6 +34,7 @@ namespace Navtech::Navigation {
     CFAR_Peak_finder::CFAR_Peak_finder() : 
        Active { "CFAR Peak Finder "}
     {
+        shape_engine.set_threads(std::min<std::size_t>(std::thread::hardware_concurrency(), max_shape_threads));
     }
 
     
@@ -61,10 +64,6 @@ namespace Navtech::Navigation {
         mode                    = subresolution_mode;
         peak_mode               = peak_type;
 
-        if (mode == Subresolution_mode::centre_of_mass_2d) {
-            rotation_data.resize(azimuth_samples);
-        }
-
         to_degrees = [this] (float a)  { 
             return fmod(a * 360.0f / static_cast<float>(azimuth_samples) + 360.0f, 360.0f); 
         };
@@ -87,6 +86,18 @@ namespace Navtech::Navigation {
     }
 
 
+    void CFAR_Peak_finder::on_start()
+    {
+        shape_finder.start();
+    }
+
+
+    void CFAR_Peak_finder::on_stop()
+    {
+        shape_finder.stop();
+    }
+
+
     void CFAR_Peak_finder::set_target_callback(std::function<void(const CFAR_Target&)> fn)
     {
         target_callback = std::move(fn);
@@ -107,6 +118,26 @@ namespace Navtech::Navigation {
 
     void CFAR_Peak_finder::process_data(Unit::Azimuth azi_idx, const std::vector<float>& cfar_data)
     {
+        // Shapes are found once per rotation. The first (partial) rotation
+        // is ignored; after that, the rotation just completed is handed over
+        // for shape finding and the next is buffered.
+        //
+        if (mode == Subresolution_mode::centre_of_mass_2d) {
+            if (azi_idx < last_azimuth) {
+                counter++;
+                if (counter >= 2) {
+                    find_shapes();
+                }
+            }
+
+            if (counter >= 1) {
+                buffer_row(azi_idx, cfar_data);
+            }
+
+            last_azimuth = azi_idx;
+            return;
+        }
+
         // It's possible for the data to be contoured
         //
         std::vector<float> resized_data { cfar_data };
@@ -115,9 +146,7 @@ namespace Navtech::Navigation {
         auto min_it = resized_data.cbegin() + minimum_bin;
         auto max_it = select_peak(min_it, resized_data.end());
 
-        // This is so rows aren't skipped, there's certainly a better way of doing this
-        //
-        if (Utility::essentially_equal(*max_it, 0.0f) && mode != Subresolution_mode::centre_of_mass_2d) return;
+        if (Utility::essentially_equal(*max_it, 0.0f)) return;
 
         auto forward_it = max_it;
         auto reverse_it = max_it;
@@ -155,29 +184,34 @@ namespace Navtech::Navigation {
                 }
                 break;
             case Subresolution_mode::centre_of_mass_2d:
-                if (azi_idx < last_azimuth) {
-                    counter++;
-                    if (counter >= 2) {
-                        find_shapes(rotation_data);
-                    }
-                }
+                break;
+        }
+    }
 
-                if (counter >= 1) {
-                    std::vector<Unit::dB> reduced_points(resized_data.size(), 0.0);
-                    auto peaks { 0 };
-                    for (auto i { minimum_bin }; i < resized_data.size(); i++) {
-                        if (Utility::essentially_equal(resized_data[i], 0.0f)) continue;
-                        reduced_points[i] = resized_data[i];
-                        peaks++;
-                        if (peaks >= max_peaks) break;
-                    }
-
-                    rotation_data[azi_idx] = reduced_points;
-                }
 
-                last_azimuth = azi_idx;
-                return;
+    void CFAR_Peak_finder::buffer_row(Unit::Azimuth azi_idx, const std::vector<float>& cfar_data)
+    {
+        auto& grid = rotations[filling];
+        if (grid.rows() != azimuth_samples) grid.resize(azimuth_samples);
+        if (azi_idx >= grid.rows()) return;
+
+        // Only the first max_peaks cells, from the minimum bin, are kept.
+        // (The data may be contoured.)
+        //
+        std::size_t first { std::min<std::size_t>(minimum_bin, cfar_data.size()) };
+        std::size_t last  { std::min<std::size_t>(range_in_bins, cfar_data.size()) };
+        std::size_t end   { first };
+
+        for (Unit::Bin peaks { 0 }; end < last && peaks < max_peaks; ++end) {
+            if (!Utility::essentially_equal(cfar_data[end], 0.0f)) ++peaks;
         }
+
+        if (first >= end) {
+            grid.clear_row(azi_idx);
+            return;
+        }
+
+        grid.set_row(azi_idx, cfar_data.data() + first, cfar_data.data() + end, first);
     }
 
 
@@ -304,19 +338,86 @@ namespace Navtech::Navigation {
     }
 
 
-    void CFAR_Peak_finder::find_shapes(const std::vector<std::vector<float>> rotation_data) {
+    void CFAR_Peak_finder::find_shapes()
+    {
+        // There are only two grids; if the previous rotation's shapes
+        // are still being found, wait for them.
+        //
+        send_shapes();
+
+        auto& full = rotations[filling];
+
+        filling = 1 - filling;
+        rotations[filling].clear();
+        ++rotation_count;
+
+        shape_finder.find_shapes(full, rotation_count);
+        extracting = true;
+    }
+
+
+    void CFAR_Peak_finder::on_shapes_found(std::uint32_t rotation)
+    {
+        // The shapes may already have been sent, if the next
+        // rotation was complete first.
+        //
+        if (rotation != rotation_count) return;
+        
+        send_shapes();
+    }
 
-        using namespace Navtech::Utility;
 
-        Shape_finder<float>    shape_finder { minimum_bin };
+    void CFAR_Peak_finder::send_shapes()
+    {
+        if (!extracting) return;
 
-        auto shape_centres = shape_finder.find_centres(rotation_data);
+        shape_finder.wait();
+        extracting = false;
 
-        for (auto& centre : shape_centres) {
-            send_target(
-                centre.first,
-                centre.second
-            );
+        for (auto& shape : shape_engine.shapes()) {
+            send_target(shape.col, shape.row);
         }
     }
+
+
+    // ------------------------------------------------------------------------
+    // Shape_finder
+    //
+    CFAR_Peak_finder::Shape_finder::Shape_finder(CFAR_Peak_finder& owner) :
+        Active      { "Shape finder" },
+        peak_finder { owner }
+    {
+    }
+
+
+    void CFAR_Peak_finder::Shape_finder::find_shapes(const Shape_extraction::Grid& grid, std::uint32_t rotation)
+    {
+        {
+            std::lock_guard lock { mtx };
+            busy = true;
+        }
+
+        async_call(&Shape_finder::on_find_shapes, this, std::cref(grid), rotation);
+    }
+
+
+    void CFAR_Peak_finder::Shape_finder::wait()
+    {
+        std::unique_lock lock { mtx };
+        found.wait(lock, [this] { return !busy; });
+    }
+
+
+    void CFAR_Peak_finder::Shape_finder::on_find_shapes(const Shape_extraction::Grid& grid, std::uint32_t rotation)
+    {
+        peak_finder.shape_engine.find_shapes(grid);
+
+        {
+            std::lock_guard lock { mtx };
+            busy = false;
+        }
+        found.notify_all();
+
+        peak_finder.async_call(&CFAR_Peak_finder::on_shapes_found, &peak_finder, rotation);
+    }
 } // namespace Navtech::Navigation
\ No newline at end of file
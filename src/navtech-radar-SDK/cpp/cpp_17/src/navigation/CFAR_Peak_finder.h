@@ -21,6 +21,9 @@
 #ifndef CFAR_PEAK_FINDER_H
 #define CFAR_PEAK_FINDER_H
 
+#include <array>
+#include <condition_variable>
+#include <mutex>
 #include <string_view>
 
 #include "Buffer_mode.h"
@@ -28,6 +31,7 @@
 #include "Units.h"
 #include "File_writer.h"
 #include "CFAR_algorithms.h"
+#include "Shape_extraction.h"
 #include "configurationdata.pb.h"
 // #include "Active.h"
 
@@ -67,6 +71,9 @@ namespace Navtech::Navigation {
             Unit::Azimuth               azimuth,
             const std::vector<float>&   cfar_data
         );
+
+        void on_start() override;
+        void on_stop() override;
         
     private:
         float           range_gain                      { 0.0f };
@@ -92,14 +99,45 @@ namespace Navtech::Navigation {
         std::function<Unit::Metre(float)>           to_metre        { nullptr };
         std::function<void(const CFAR_Target&)>     target_callback { nullptr };
 
-        std::vector<std::vector<float>>     rotation_data   { };
         std::uint16_t                       last_azimuth    { 0 };
         std::uint32_t                       counter         { 0 };
 
+        // Centre-of-mass 2D: one rotation is filled while the shapes of
+        // the previous rotation are found on another thread.
+        //
+        static constexpr std::size_t            max_shape_threads   { 4 };
+
+        // Finds the shapes of a full rotation on its own thread, which
+        // lasts as long as the peak finder, then hands them back to it.
+        //
+        class Shape_finder : public Navtech::Utility::Active {
+        public:
+            Shape_finder(CFAR_Peak_finder& owner);
+
+            void find_shapes(const Shape_extraction::Grid& grid, std::uint32_t rotation);
+            void wait();
+
+        private:
+            CFAR_Peak_finder&           peak_finder;
+            std::mutex                  mtx         { };
+            std::condition_variable     found       { };
+            bool                        busy        { false };
+
+            void on_find_shapes(const Shape_extraction::Grid& grid, std::uint32_t rotation);
+        };
+
+        std::array<Shape_extraction::Grid, 2>   rotations           { };
+        std::size_t                             filling             { 0 };
+        Shape_extraction::Engine                shape_engine        { };
+        std::uint32_t                           rotation_count      { 0 };
+        bool                                    extracting          { false };
+        Shape_finder                            shape_finder        { *this };
+
         void on_find_peaks(Unit::Azimuth azimuth, const std::vector<float>& cfar_data);
 
         void buffer_data(Unit::Azimuth azi_idx, const std::vector<float>& data);
         void process_data(Unit::Azimuth azi_idx, const std::vector<float>& data);
+        void buffer_row(Unit::Azimuth azi_idx, const std::vector<float>& data);
 
         std::vector<float>::const_iterator select_peak(
             std::vector<float>::const_iterator begin,
@@ -114,9 +152,9 @@ namespace Navtech::Navigation {
             Unit::Bin window_sz
         );
 
-        void find_shapes(
-            const std::vector<std::vector<float>> rotation_data
-        );
+        void find_shapes();
+        void on_shapes_found(std::uint32_t rotation);
+        void send_shapes();
 
    };
 
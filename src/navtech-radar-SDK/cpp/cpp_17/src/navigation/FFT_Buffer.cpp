@@ -19,24 +19,50 @@
 // services that may be provided by Navtech Radar.
 // ---------------------------------------------------------------------------------------------------------------------
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+
 #include "FFT_Buffer.h"
 
 namespace Navtech::Navigation {
 
-    FFT_Buffer::FFT_Buffer(Buffer_mode buffer_mode, std::size_t sample_sz) :
-        mode { buffer_mode },
-        samples { sample_sz },
-        bytes_to_floats { 
-            [this] (const std::vector<std::uint8_t>& fft_data) { return default_conversion(fft_data); }
+    namespace {
+
+        constexpr float db_per_count { 0.5f };
+        constexpr float ln_10_by_10  { 0.230258509f };  // dB to natural log of power
+
+        inline float to_power(float db) { return std::exp(db * ln_10_by_10); }
+
+        // Linear power of each 8-bit FFT value
+        //
+        const std::array<float, 256>& byte_to_power()
+        {
+            static const std::array<float, 256> table = [] {
+                std::array<float, 256> powers { };
+                for (std::size_t i { 0 }; i < powers.size(); ++i) {
+                    powers[i] = to_power(static_cast<float>(i) * db_per_count);
+                }
+                return powers;
+            }();
+
+            return table;
         }
-    {
 
+    } // namespace
+
+
+    FFT_Buffer::FFT_Buffer(Buffer_mode buffer_mode, std::size_t sample_sz, Buffer_window buffer_window) :
+        mode    { buffer_mode },
+        window  { buffer_window },
+        samples { std::max(sample_sz, std::size_t { 1 }) }
+    {
     }
 
 
     FFT_Buffer::FFT_Buffer(Buffer_mode buffer_mode, std::size_t sample_sz, FFT_Buffer::Conversion_func bytes_to_floats) :
         mode { buffer_mode },
-        samples { sample_sz },
+        samples { std::max(sample_sz, std::size_t { 1 }) },
         bytes_to_floats { bytes_to_floats }
     { }
 
@@ -48,7 +74,10 @@ namespace Navtech::Navigation {
         const std::vector<float>& fft_data
     )
     {
-        return buffer_data(fft_data);
+        std::vector<float> out(fft_data.size());
+
+        if (!process_fft(fft_data.data(), fft_data.data() + fft_data.size(), out.data())) return { };
+        return out;
     }
 
 
@@ -56,70 +85,226 @@ namespace Navtech::Navigation {
         const std::vector<std::uint8_t>& fft_data
     )
     {
-        return buffer_data(bytes_to_floats(fft_data));
+        std::vector<float> out(fft_data.size());
+
+        if (!process_fft(fft_data.data(), fft_data.data() + fft_data.size(), out.data())) return { };
+        return out;
+    }
+
+
+    bool FFT_Buffer::process_fft(const float* first, const float* last, float* out)
+    {
+        if (mode == Buffer_mode::off) {
+            std::copy(first, last, out);
+            return true;
+        }
+
+        to_row(first, last - first);
+        return buffer_row(out);
+    }
+
+
+    bool FFT_Buffer::process_fft(const std::uint8_t* first, const std::uint8_t* last, float* out)
+    {
+        if (bytes_to_floats) {
+            auto floats = bytes_to_floats(std::vector<std::uint8_t>(first, last));
+            return process_fft(floats.data(), floats.data() + floats.size(), out);
+        }
+
+        if (mode == Buffer_mode::off) {
+            std::transform(first, last, out, [](std::uint8_t f) { return f * db_per_count; });
+            return true;
+        }
+
+        to_row(first, last - first);
+        return buffer_row(out);
+    }
+
+
+    bool FFT_Buffer::process_fft(const std::uint8_t* first, const std::uint8_t* last, double* out)
+    {
+        if (bytes_to_floats) {
+            auto floats = bytes_to_floats(std::vector<std::uint8_t>(first, last));
+            if (mode == Buffer_mode::off) {
+                std::copy(floats.begin(), floats.end(), out);
+                return true;
+            }
+            to_row(floats.data(), floats.size());
+            return buffer_row(out);
+        }
+
+        if (mode == Buffer_mode::off) {
+            std::transform(first, last, out, [](std::uint8_t f) { return f * db_per_count; });
+            return true;
+        }
+
+        to_row(first, last - first);
+        return buffer_row(out);
+    }
+
+
+    void FFT_Buffer::clear()
+    {
+        num_rows = 0;
     }
 
 
     // -----------------------------------------------------------------------------------------------------------------
     // Private member functions
     //
-    std::vector<float> FFT_Buffer::default_conversion(const std::vector<std::uint8_t>& fft_data)
+    void FFT_Buffer::resize(std::size_t sz)
     {
-        std::vector<float> out (fft_data.size());
+        // Rows of a different size (for example, contoured data)
+        // cannot be combined with those already buffered.
+        //
+        if (sz == num_bins) return;
 
-        std::transform(fft_data.begin(), fft_data.end(), 
-                        out.begin(), 
-                        [] (std::uint8_t f) { return f * 0.5f; });
+        num_bins = sz;
+        num_rows = 0;
+        row.resize(sz);
 
-        return out;
+        if (mode == Buffer_mode::average) sums.resize(sz);
+        if (mode == Buffer_mode::max)     prefix_max.resize(sz);
+
+        if (window == Buffer_window::sliding) {
+            ring.resize(samples * sz);
+            if (mode == Buffer_mode::max) suffix_max.resize(samples * sz);
+        }
     }
 
 
-    std::optional<std::vector<float>> FFT_Buffer::buffer_data(
-        const std::vector<float>& fft_data
-    )
+    void FFT_Buffer::to_row(const float* first, std::size_t sz)
     {
-        std::vector<float> adjusted_data { };
-        switch (mode) {
-            case Buffer_mode::off:
-                // This case should be unreachable, but just in case:
-                //
-                return fft_data;
-                break;
-            case Buffer_mode::average:
-                buffered_data.emplace_back(fft_data.begin(), fft_data.end());
-
-                if (buffered_data.size() < samples) return { };
-
-                adjusted_data.resize(fft_data.size());
-
-                for (std::uint16_t bin { 0 }; bin < fft_data.size(); ++bin) {
-                    float total { 0.0f };
-                    for (auto& azimuth : buffered_data) {
-                        float value { static_cast<float>(azimuth[bin]) / 2.0f };
-                        total += std::pow(10.0f, value / 10.0f);
-                    }
-                    adjusted_data[bin] = std::log10(total / buffered_data.size()) * 10.0f;
-                }
+        resize(sz);
+
+        if (mode == Buffer_mode::average) {
+            std::transform(first, first + sz, row.begin(), to_power);
+        }
+        else {
+            std::copy(first, first + sz, row.begin());
+        }
+    }
+
+
+    void FFT_Buffer::to_row(const std::uint8_t* first, std::size_t sz)
+    {
+        resize(sz);
+
+        if (mode == Buffer_mode::average) {
+            auto& powers = byte_to_power();
+            std::transform(first, first + sz, row.begin(), [&powers](std::uint8_t f) { return powers[f]; });
+        }
+        else {
+            std::transform(first, first + sz, row.begin(), [](std::uint8_t f) { return f * db_per_count; });
+        }
+    }
 
-                buffered_data.clear();
-                
-                break;
-            case Buffer_mode::max:
-                float max { };
-
-                adjusted_data.resize(fft_data.size());
-                for (std::uint16_t bin = 0; bin < fft_data.size(); bin++) {
-                    for (std::size_t counter = 0; counter < buffered_data.size(); counter++) {
-                        float value { buffered_data[counter][bin] / 2.0f };
-                        if (value > max) { max = value; }
-                    }
-                    adjusted_data[bin] = max;
+
+    template <typename Out_Ty>
+    bool FFT_Buffer::buffer_row(Out_Ty* out)
+    {
+        return (mode == Buffer_mode::average) ? buffer_average(out) : buffer_max(out);
+    }
+
+
+    template <typename Out_Ty>
+    bool FFT_Buffer::buffer_average(Out_Ty* out)
+    {
+        auto position = num_rows % samples;
+
+        if (window == Buffer_window::sliding) {
+            auto slot = ring.data() + position * num_bins;
+
+            // Replace the oldest row
+            //
+            if (num_rows == 0) {
+                std::fill(sums.begin(), sums.end(), 0.0);
+            }
+            else if (num_rows >= samples) {
+                for (std::size_t bin { 0 }; bin < num_bins; ++bin) sums[bin] -= slot[bin];
+            }
+            for (std::size_t bin { 0 }; bin < num_bins; ++bin) sums[bin] += row[bin];
+            std::copy(row.begin(), row.end(), slot);
+            
+            if (position == samples - 1) {
+                std::fill(sums.begin(), sums.end(), 0.0);
+                for (std::size_t r { 0 }; r < samples; ++r) {
+                    auto stored = ring.data() + r * num_bins;
+                    for (std::size_t bin { 0 }; bin < num_bins; ++bin) sums[bin] += stored[bin];
                 }
+            }
+        }
+        else if (position == 0) {
+            std::copy(row.begin(), row.end(), sums.begin());
+        }
+        else {
+            for (std::size_t bin { 0 }; bin < num_bins; ++bin) sums[bin] += row[bin];
+        }
+
+        ++num_rows;
+
+        if (num_rows < samples) return false;
+        if (window == Buffer_window::block && position != samples - 1) return false;
+
+        auto scale = 1.0 / static_cast<double>(samples);
+        for (std::size_t bin { 0 }; bin < num_bins; ++bin) {
+            out[bin] = static_cast<Out_Ty>(std::log10(static_cast<float>(sums[bin] * scale)) * 10.0f);
+        }
+
+        return true;
+    }
+
+
+    template <typename Out_Ty>
+    bool FFT_Buffer::buffer_max(Out_Ty* out)
+    {
+        auto position = num_rows % samples;
+
+        if (position == 0) {
+            std::copy(row.begin(), row.end(), prefix_max.begin());
+        }
+        else {
+            for (std::size_t bin { 0 }; bin < num_bins; ++bin) prefix_max[bin] = std::max(prefix_max[bin], row[bin]);
+        }
+
+        ++num_rows;
+
+        if (window == Buffer_window::block) {
+            if (position != samples - 1) return false;
+
+            std::copy(prefix_max.begin(), prefix_max.end(), out);
+            return true;
+        }
+
+        std::copy(row.begin(), row.end(), ring.begin() + position * num_bins);
+
+        bool has_result { num_rows >= samples };
+
+        // The window is the rows after position in the previous block, and
+        // the rows of this block up to position.
+        //
+        if (has_result && position != samples - 1) {
+            auto suffix = suffix_max.data() + (position + 1) * num_bins;
+            for (std::size_t bin { 0 }; bin < num_bins; ++bin) out[bin] = std::max(prefix_max[bin], suffix[bin]);
+        }
+        else if (has_result) {
+            std::copy(prefix_max.begin(), prefix_max.end(), out);
+        }
+
+        // At the end of a block, compute its suffix maxima for the next
+        //
+        if (position == samples - 1) {
+            auto last = (samples - 1) * num_bins;
+            std::copy(ring.begin() + last, ring.end(), suffix_max.begin() + last);
 
-                break;
+            for (std::size_t r { samples - 1 }; r-- > 0; ) {
+                auto stored = ring.data() + r * num_bins;
+                auto into   = suffix_max.data() + r * num_bins;
+                auto next   = into + num_bins;
+                for (std::size_t bin { 0 }; bin < num_bins; ++bin) into[bin] = std::max(stored[bin], next[bin]);
+            }
         }
 
-        return adjusted_data;
+        return has_result;
     }
 } // namespace Navtech::Navigation
\ No newline at end of file
@@ -22,7 +22,6 @@
 // ---------------------------------------------------------------------------------------------------------------------
 
 #include <cstdint>
-#include <deque>
 #include <functional>
 #include <optional>
 #include <vector>
@@ -39,6 +38,15 @@
 //     For each azimuth, only the maximum value of each bin across all samples is taken.
 //
 // A row of FFT is returned if and only if the minimum number of samples has been reached.
+// With a block window, the buffer then starts collecting again; with a sliding window,
+// every subsequent row returns the result over the last sample_sz rows.
+//
+// Averaging is done in linear power units.  Rows are converted from dB once, as they
+// arrive (8-bit FFT through a lookup table), and running sums are kept, so that each row
+// costs O(bins) whatever the number of samples.  The sums of a sliding window are
+// recomputed from the stored rows each time the window wraps, so that rounding errors
+// cannot accumulate.  The sliding maximum combines the running maximum of the current
+// block of rows with the suffix maxima of the previous block.
 //
 // The averaging mode will work best with a staring radar, or a radar producing only a few azimuths of data.
 //
@@ -48,30 +56,54 @@ class FFT_Buffer {
 public:
     using Conversion_func   = std::function<std::vector<float>(const std::vector<std::uint8_t>&)>;
 
-    FFT_Buffer(Buffer_mode mode, std::size_t sample_sz);
+    FFT_Buffer() = default;
+    FFT_Buffer(Buffer_mode mode, std::size_t sample_sz, Buffer_window window = Buffer_window::block);
 
     // Overload, in case some other conversion function is desired
     //
     FFT_Buffer(Buffer_mode mode, std::size_t sample_sz, Conversion_func bytes_to_floats);
 
     // Process FFT...
-    // as floats
+    // as floats (dB)
     //
     std::optional<std::vector<float>> process_fft(const std::vector<float>& fft_data);
     // As raw bytes (with a simple conversion function)
     //
     std::optional<std::vector<float>> process_fft(const std::vector<std::uint8_t>& fft_data);
 
+    // Process FFT into a caller buffer of (last - first) values, in dB.
+    // Returns false, leaving out untouched, if no row is ready.
+    //
+    bool process_fft(const float* first, const float* last, float* out);
+    bool process_fft(const std::uint8_t* first, const std::uint8_t* last, float* out);
+    bool process_fft(const std::uint8_t* first, const std::uint8_t* last, double* out);
+
+    void clear();
+
 private:
     Buffer_mode                     mode             { Buffer_mode::off };
-    std::size_t                     samples          { };
-    std::deque<std::vector<float>>  buffered_data    { };
+    Buffer_window                   window           { Buffer_window::block };
+    std::size_t                     samples          { 1 };
+
+    // If not set, bytes are converted at 0.5dB per count
+    //
+    Conversion_func                 bytes_to_floats  { };
 
-    std::function<std::vector<float>(const std::vector<std::uint8_t>&)> bytes_to_floats { };
+    std::size_t                     num_bins         { 0 };
+    std::size_t                     num_rows         { 0 };     // Since the buffer was cleared
+    std::vector<float>              row              { };       // Incoming row; linear (average) or dB (max)
+    std::vector<float>              ring             { };       // Last sample_sz rows (sliding window only)
+    std::vector<double>             sums             { };       // Average
+    std::vector<float>              prefix_max       { };       // Max of the current block of rows
+    std::vector<float>              suffix_max       { };       // Max of rows [n, sample_sz) of the previous block
 
-    std::vector<float> default_conversion(const std::vector<std::uint8_t>& fft_data);
+    void resize(std::size_t sz);
+    void to_row(const float* first, std::size_t sz);
+    void to_row(const std::uint8_t* first, std::size_t sz);
 
-    std::optional<std::vector<float>> buffer_data(const std::vector<float>& fft_data);
+    template <typename Out_Ty> bool buffer_row(Out_Ty* out);
+    template <typename Out_Ty> bool buffer_average(Out_Ty* out);
+    template <typename Out_Ty> bool buffer_max(Out_Ty* out);
 };
 
 
@@ -56,40 +56,16 @@ namespace Navtech::Navigation {
     {
         if (fft_data.data.size() != configuration.range_in_bins) return; // We cannot operate on contoured data
 
-        std::vector<double> buffered_data { };
-
         if (buffer_mode != Buffer_mode::off) {
-            data_buffer.emplace_back(fft_data.data.begin(), fft_data.data.end());
-            
-            if (data_buffer.size() < buffer_length) return;
+            buffered_data.resize(fft_data.data.size());
 
-            buffered_data.resize(configuration.range_in_bins);
+            auto first = fft_data.data.data();
+            auto last  = first + fft_data.data.size();
             
-            if (buffer_mode == Buffer_mode::average) {
-                for (auto bin = 0; bin < configuration.range_in_bins; bin++) {
-                    auto total = 0.0f;
-                    for (std::uint32_t counter = 0; counter < data_buffer.size(); counter++) {
-                        float value { static_cast<float>(data_buffer[counter][bin]) / 2.0f };
-                        total += std::pow(10.0f, static_cast<float>(value / 10.0f));
-                    }
-                    buffered_data[bin] = std::log10(total / data_buffer.size()) * 10.0f;
-                }
-            }
-            else {
-                double max { };
-
-                for (std::int32_t bin = 0; bin < configuration.range_in_bins; bin++) {
-                    for (std::uint32_t counter = 0; counter < data_buffer.size(); counter++) {
-                        double value { data_buffer[counter][bin] / 2.0 };
-                        if (value > max) { max = value; }
-                    }
-                    buffered_data[bin] = max;
-                }
-            }
-            data_buffer.clear();
+            if (!fft_buffer.process_fft(first, last, buffered_data.data())) return;
         }
         else {
-            buffered_data = std::vector<double>(fft_data.data.begin(), fft_data.data.end());
+            buffered_data.assign(fft_data.data.begin(), fft_data.data.end());
         }
 
         find_peaks(
@@ -119,7 +95,7 @@ namespace Navtech::Navigation {
         bins_to_operate_on     = std::max(std::min(bins_to_operate_upon, max_bins_to_operate_on), min_bins_to_operate_on);
         min_bin_to_operate_on  = min_bin_to_operate_upon;
         buffer_mode            = mode;
-        buffer_length          = buf_length;
+        fft_buffer             = FFT_Buffer { mode, buf_length };
         max_peaks_per_azimuth  = max_peaks_per_azi;
     }
 
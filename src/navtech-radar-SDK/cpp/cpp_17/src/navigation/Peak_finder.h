@@ -24,11 +24,11 @@
 
 #include <atomic>
 #include <cstdint>
-#include <deque>
 #include <functional>
 #include <vector>
 
 #include "Buffer_mode.h"
+#include "FFT_Buffer.h"
 #include "navigation_defs.h"
 #include "Polar_target.h"
 
@@ -82,10 +82,10 @@ namespace Navtech::Navigation {
         std::uint16_t min_bin_to_operate_on { 50 };
         bool          awaiting_rise         { false };
 
-        std::deque<std::vector<double>> data_buffer { };
+        FFT_Buffer          fft_buffer    { };
+        std::vector<double> buffered_data { };
 
         Buffer_mode   buffer_mode           { Buffer_mode::off };
-        std::size_t   buffer_length         { 10 };
         std::uint32_t max_peaks_per_azimuth { 10 };
 
         Configuration_data                                  configuration          { };
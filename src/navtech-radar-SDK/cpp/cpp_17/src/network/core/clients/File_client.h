@@ -23,6 +23,8 @@
 
 #include <filesystem>
 #include <string_view>
+#include <type_traits>
+#include <variant>
 
 #include "Active.h"
 #include "Log.h"
@@ -49,8 +51,6 @@ namespace Navtech::Networking::Offline {
         using Traits            = Navtech::Networking::Offline::File_client_traits<protocol, transport, tls>;
         using Connection_Ty     = Navtech::Networking::Offline::Connection<protocol, transport, tls>;
         using Event_traits      = Navtech::Networking::Event_traits<protocol, transport, tls>;
-        using Stream_Ty         = typename Traits::Stream;
-        using Stream_ptr_Ty     = typename Traits::Stream_ptr;
         using Message_Ty        = typename Traits::Message;
         using ID_Ty             = typename Traits::ID;
         using Dispatcher_Ty     = typename Event_traits::Dispatcher;
@@ -62,6 +62,13 @@ namespace Navtech::Networking::Offline {
 
         void set_file_closed_handler(Event_handler& handler);
 
+        // Replay control.  These may be called before the file is
+        // opened, in which case they are applied once it is.
+        //
+        void playback_rate(double rate)                         { async_call(&File_client::set_rate, this, rate); }
+        void seek(const Time::Real_time::Observation& time)     { async_call(&File_client::seek_to<Time::Real_time::Observation>, this, time); }
+        void seek(const Time::Duration& from_start)             { async_call(&File_client::seek_to<Time::Duration>, this, from_start); }
+
     private:
         // External associations
         //
@@ -69,7 +76,18 @@ namespace Navtech::Networking::Offline {
         
         owner_of<Connection_Ty>     connection { };
         std::string                 filepath { };
-        Stream_ptr_Ty               stream_ptr { };
+
+        // Replay settings
+        //
+        using Position = std::variant<std::monostate, Time::Real_time::Observation, Time::Duration>;
+
+        double                      rate { as_fast_as_possible };
+        Position                    start_position { };
+
+        void set_rate(double new_rate);
+
+        template <typename Position_Ty>
+        void seek_to(Position_Ty position);
 
         // Active overrides
         //
@@ -126,8 +144,7 @@ namespace Navtech::Networking::Offline {
     template <Protocol protocol, Transport transport, TLS::Type tls>
     File_client<protocol, transport, tls>::File_client(File_client<protocol, transport, tls>::Dispatcher_Ty& event_dispatcher) :
         Active          { "File client" },
-        dispatcher      { associate_with(event_dispatcher) },
-        stream_ptr      { allocate_shared<Stream_Ty>() }
+        dispatcher      { associate_with(event_dispatcher) }
     {
     }
 
@@ -139,8 +156,7 @@ namespace Navtech::Networking::Offline {
     ) :
         Active          { "File client "},
         dispatcher      { associate_with(event_dispatcher) },
-        filepath        { filepath },
-        stream_ptr      { allocate_shared<Stream_Ty>() }
+        filepath        { filepath }
     {
     }
 
@@ -152,6 +168,24 @@ namespace Navtech::Networking::Offline {
     }
 
 
+    template <Protocol protocol, Transport transport, TLS::Type tls>
+    void File_client<protocol, transport, tls>::set_rate(double new_rate)
+    {
+        rate = new_rate;
+
+        if (connection) connection->playback_rate(rate);
+    }
+
+
+    template <Protocol protocol, Transport transport, TLS::Type tls>
+    template <typename Position_Ty>
+    void File_client<protocol, transport, tls>::seek_to(Position_Ty position)
+    {
+        if (connection) connection->seek(position);
+        else            start_position = position;
+    }
+
+
     template <Protocol protocol, Transport transport, TLS::Type  tls>
     void File_client<protocol, transport, tls>::on_start()
     {
@@ -213,14 +247,13 @@ namespace Navtech::Networking::Offline {
     template <Protocol protocol, Transport transport, TLS::Type tls>
     void File_client<protocol, transport, tls>::connect()
     {
-        try {
-            stream_ptr->open(filepath, std::ios_base::in | std::ios_base::binary);
-            post_event(open_ok);
-        }
-        catch (std::system_error&) {
+        if (format_from_filepath(filepath) == File_format::invalid) {
             syslog.error("File client - unable to open file");
             post_event(open_fail);
+            return;
         }
+
+        post_event(open_ok);
     }
 
 
@@ -229,7 +262,7 @@ namespace Navtech::Networking::Offline {
     {
         syslog.debug("File client - closing...");
 
-        connection->close();
+        if (connection) connection->close();
         finished = true;
     }
 
@@ -242,18 +275,29 @@ namespace Navtech::Networking::Offline {
 
             connection = allocate_owned<Connection_Ty>(
                 ID_Ty { 1 },
-                std::move(*stream_ptr),
+                filepath,
                 *dispatcher,
                 error_events,
                 format_from_filepath(filepath)
             );
 
+            connection->playback_rate(rate);
+            
+            std::visit(
+                [this](const auto& position)
+                {
+                    using Position_Ty = std::decay_t<decltype(position)>;
+                    if constexpr (!std::is_same_v<Position_Ty, std::monostate>) connection->seek(position);
+                },
+                start_position
+            );
+
             connection->open();
 
             post_event(open_ok);
         }
-        catch (std::system_error&) {
-            syslog.critical("File client - Unable to open file [" + filepath + "]");
+        catch (std::system_error& ex) {
+            syslog.critical("File client - Unable to open file [" + filepath + "] - " + ex.what());
             post_event(open_fail);
         }
     }
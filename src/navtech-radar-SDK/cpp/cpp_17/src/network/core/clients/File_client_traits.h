@@ -36,7 +36,6 @@ namespace Navtech::Networking::Offline {
         //
         using Connection_traits = Navtech::Networking::Connection_traits<Protocol::colossus, Transport::file, TLS::Type::none>;
         using Stream            = typename Connection_traits::Stream;
-        using Stream_ptr        = shared_owner<Stream>;
         using Message           = typename Connection_traits::Message;
         using ID                = typename Connection_traits::ID;
         using Protocol_traits   = typename Connection_traits::Protocol_traits;
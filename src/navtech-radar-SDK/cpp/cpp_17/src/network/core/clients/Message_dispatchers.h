@@ -67,6 +67,10 @@ namespace Navtech::Networking {
         void attach_to(Type_Ty type, const Handler& handler)  { async_call(&Message_dispatcher::attach_impl, this, type, handler); }
         void detach_from(Type_Ty type)                        { async_call(&Message_dispatcher::detach_impl, this, type); }
 
+        // Stop once every message already queued has been dispatched
+        //
+        void stop_when_drained()                              { async_call(&Message_dispatcher::stop, this); }
+
     protected:
         void on_stop() override;
 
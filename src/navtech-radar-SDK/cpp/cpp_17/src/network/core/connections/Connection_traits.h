@@ -36,6 +36,8 @@
 
 #include "Memory_types.h"
 
+#include "Recording_reader.h"
+
 
 namespace Navtech::Networking {
 
@@ -61,6 +63,11 @@ namespace Navtech::Networking {
         //
         static constexpr std::size_t max_buffer_size { 4196 };
 
+        // Incoming bytes are read in bulk into a buffer of this size;
+        // several messages may be received in one read.
+        //
+        static constexpr Unit::Kilobyte receive_buffer_size { 256_kB };
+
         // Functions
         //
         static void set_socket_options(Socket& socket)
@@ -130,6 +137,11 @@ namespace Navtech::Networking {
         //
         static constexpr Unit::Kilobyte max_buffer_size { 4_kB };
 
+        // Incoming bytes are read in bulk into a buffer of this size;
+        // several messages may be received in one read.
+        //
+        static constexpr Unit::Kilobyte receive_buffer_size { 256_kB };
+
         // Functions
         //
         static void set_socket_options(Socket& socket)
@@ -251,7 +263,7 @@ namespace Navtech::Networking {
     public:
         // Types
         //
-        using Stream            = std::ifstream; // TODO is this correct, at all?
+        using Stream            = Offline::Recording_reader;
         using Message_buffer    = std::vector<std::uint8_t>;
 
         using Protocol_traits   = Navtech::Networking::Protocol_traits<Protocol::colossus, Transport::tcp, TLS::Type::none>;
@@ -30,6 +30,7 @@
 #include "socket_exceptions.h"
 
 #include "Active.h"
+#include "Stream_buffer.h"
 #include "pointer_types.h"
 #include "Time_utils.h"
 #include "Log.h"
@@ -219,9 +220,15 @@ namespace Navtech::Networking::Messaging {
         void on_start() override;
         void on_stop()  override;
 
-        // Buffers for incoming data
+        // Buffers for incoming data.
+        // Bytes are read from the socket in bulk into rx_buffer; headers are
+        // validated in place and each complete message is copied out of it,
+        // so a read may deliver several messages (or part of one).
         //
-        Message incoming_msg { };
+        Utility::Stream_buffer rx_buffer    { Connection_traits::receive_buffer_size };
+        Message                incoming_msg { };
+
+        void receive_at_least(std::size_t num_bytes);
 
         // Finite State Machine implementation 
         // (Moore machine - behaviour in-state)
@@ -283,6 +290,7 @@ namespace Navtech::Networking::Messaging {
     {
         syslog.debug("Messaging receiver [" + std::to_string(id) + "] starting...");
 
+        rx_buffer.clear();
         enable();
 
         // Post an event to kick-start the state machine
@@ -309,7 +317,7 @@ namespace Navtech::Networking::Messaging {
         try {
             stopwatch.start();
             auto header_sz = Protocol_traits::header_size(incoming_msg);
-            auto header    = socket->receive(header_sz);
+            receive_at_least(header_sz);
             stopwatch.stop();
 
             // Since the receive call (above) is blocking, we may have
@@ -321,15 +329,13 @@ namespace Navtech::Networking::Messaging {
                 return;
             }
 
-            Protocol_traits::add_header(incoming_msg, std::move(header));
-
-            if (Protocol_traits::is_valid(incoming_msg)) {
+            if (Protocol_traits::is_valid_header(rx_buffer.begin())) {
                 post_event(valid_header);
             }
             else {
                 syslog.debug("Messaging receiver [" + std::to_string(id) + "] invalid header");
 
-                incoming_msg.relinquish();
+                rx_buffer.consume(header_sz);
                 post_event(invalid_header);
             } 
         }
@@ -358,12 +364,10 @@ namespace Navtech::Networking::Messaging {
         if (!socket->is_open()) post_event(error);
 
         try { 
-            auto payload_sz = Protocol_traits::payload_size(incoming_msg);
+            auto header_sz = Protocol_traits::header_size(incoming_msg);
+            auto msg_sz    = header_sz + Protocol_traits::payload_size(rx_buffer.begin());
             
-            if (payload_sz > 0) {
-                auto payload = socket->receive(payload_sz);
-                Protocol_traits::add_payload(incoming_msg, std::move(payload));
-            }
+            receive_at_least(msg_sz);
 
             // Since the receive call (above) is blocking, we may have
             // been disabled during the block (for example, by a failure
@@ -371,6 +375,12 @@ namespace Navtech::Networking::Messaging {
             //
             if (!enabled) return;
 
+            // The header and payload are contiguous in the receive buffer,
+            // so the message is built with a single copy
+            //
+            Protocol_traits::replace_data(incoming_msg, rx_buffer.begin(), msg_sz);
+            rx_buffer.consume(msg_sz);
+
             post_event(message_complete);
         }
         catch (client_shutdown&) {
@@ -390,6 +400,19 @@ namespace Navtech::Networking::Messaging {
     }
 
 
+    template <Protocol protocol, Transport transport, TLS::Type tls>
+    void Receiver<protocol, transport, tls>::receive_at_least(std::size_t num_bytes)
+    {
+        // Blocks only if fewer than num_bytes are already buffered; each read
+        // takes whatever the socket has available, up to the free space.
+        //
+        rx_buffer.fill(
+            num_bytes,
+            [this](std::uint8_t* into, std::size_t max_bytes) { return socket->receive_into(into, max_bytes); }
+        );
+    }
+
+
     template <Protocol protocol, Transport transport, TLS::Type tls>
     void Receiver<protocol, transport, tls>::dispatch()
     {
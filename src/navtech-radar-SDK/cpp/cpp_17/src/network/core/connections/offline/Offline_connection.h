@@ -22,18 +22,21 @@
 #define OFFLINE_CONNECTION_H
 
 #include <atomic>
+#include <algorithm>
+#include <string>
+#include <utility>
 
 #include "Connection_traits.h"
 #include "Event_traits.h"
 #include "Connection_error_events.h"
 #include "socket_exceptions.h"
 
-#include "Recording_metadata.h"
+#include "Recording_reader.h"
 
 #include "string_helpers.h"
 
 #include "Active.h"
-#include "Compression_utils.h"
+#include "Time_utils.h"
 #include "Log.h"
 
 
@@ -41,9 +44,11 @@ using Navtech::Utility::syslog;
 
 
 namespace Navtech::Networking::Offline {
-    
-    enum class File_format { colraw, radar, invalid };
 
+    // Messages are read through a Recording_reader (the file transport's 'stream'),
+    // which decodes ahead of the receiver on its own worker threads.  The receiver
+    // paces dispatch to the recording's FFT timestamps, scaled by the playback rate.
+    //
     template <Protocol protocol, Transport transport, TLS::Type tls>
     class Receiver : public Utility::Active {
     public:
@@ -60,13 +65,25 @@ namespace Navtech::Networking::Offline {
             Stream_Ty&          stream,
             ID_Ty               identity,
             Dispatcher_Ty&      protocol_event_dispatcher,
-            Error::Dispatcher&  error_event_dispatcher,
-            File_format         format
+            Error::Dispatcher&  error_event_dispatcher
         );
 
         void enable();
         void disable();
 
+        // A rate of 1.0 replays messages with their recorded timing, 2.0 at 
+        // twice the speed, and so on.  as_fast_as_possible dispatches each
+        // message as soon as it has been decoded.
+        //
+        void playback_rate(double rate)                         { async_call(&Receiver::set_rate, this, rate); }
+
+        // Continue from the first message at, or after, the given time (or 
+        // offset from the start of the recording).  Has no effect once the 
+        // end of the recording has been reached.
+        //
+        void seek(const Time::Real_time::Observation& time)     { async_call(&Receiver::seek_to<Time::Real_time::Observation>, this, time); }
+        void seek(const Time::Duration& from_start)             { async_call(&Receiver::seek_to<Time::Duration>, this, from_start); }
+
         std::uint64_t   bytes_read() { return total_read; }
 
     private:
@@ -80,32 +97,46 @@ namespace Navtech::Networking::Offline {
         //
         std::atomic<bool>   enabled { false };
         ID_Ty               id;
-        File_format         format { File_format::invalid };
 
         // Active class overrides
         //
         void on_start() override;
         void on_stop() override;
 
-        // File reading helpers
+        // Buffers for incoming data.  Event handlers only see a message by
+        // const reference, so once it has been dispatched its buffer is taken
+        // back, and handed to the reader in exchange for the next record.
         //
-        Colossus_protocol::TCP::Type    get_next_message_type();
-        std::uint8_t                    read_byte();
-        std::uint32_t                   read_uint32();
-        void                            increment_file_position(std::size_t bytes);
-        std::vector<std::uint8_t>       read_bytes(std::size_t bytes);
-
-        // Buffers for incoming data
+        Message             incoming_msg { };
+        Message_buffer_Ty   buffer { };
+        std::uint64_t       total_read { 0 };
+
+        // Replay timing.  Each message is due at the wall-clock time of the 
+        // first message paced (the anchor) plus its recorded offset from that
+        // message, divided by the rate.  Seeking, or changing the rate, 
+        // re-anchors on the next message.
         //
-        Message         incoming_msg { };
-        std::uint32_t   record_payload_sz { 0 };
-        std::uint64_t   total_read { 0 };
+        double                          rate            { as_fast_as_possible };
+        Time::Tick_type                 msg_time        { };
+        bool                            anchored        { false };
+        Time::Tick_type                 anchor_time     { };
+        Time::Monotonic::Observation    anchor_wall     { };
+
+        // Pacing waits in short slices, so that seeks, rate changes 
+        // and stop requests are not held up by a long gap in the recording
+        //
+        static constexpr Time::Duration max_wait { 10_msec };
+
+        void set_rate(double new_rate);
+
+        template <typename Position_Ty> 
+        void seek_to(Position_Ty position);
 
         // Finite State Machine implementation 
         // (Moore machine - behaviour in-state)
         //
-        enum State { initial, reading_meta, reading_record, decompressing, read_uncmprssd, dispatching, closing, num_states };
-        enum Event { error, go, read_meta, compressed, uncompressed, valid_message, invalid_message, dispatched, eof, num_events };
+        enum State { initial, reading, pacing, dispatching, closing, num_states };
+        enum Event { error, go, valid_message, invalid_message, tick, due, dispatched, seeked, eof, num_events };
 
         using Activity = void (Receiver::*)(void);
 
@@ -118,31 +149,26 @@ namespace Navtech::Networking::Offline {
 
         void post_event(Event e) { async_call(&Receiver::process_event, this, e); }
 
-        void read_metadata();
-        void process_radar_meta();
+        void start_reading();
         void read_record();
-        void decompress();
-        void read_message();
+        void pace();
         void dispatch();
         void end_of_file();
         void shutdown();
         void process_event(Event e);
 
         static constexpr State_cell state_machine[num_events][num_states] {
-        //                  Initial                                         Reading Metadata                            Read Record                                 Decompressing                               Read Uncompressed                           Dispatching     Closing
-        /* error        */ { { },                                           { closing, &Receiver::shutdown},            { closing, &Receiver::shutdown },           { closing, &Receiver::shutdown },           { closing, &Receiver::shutdown },           { },                                        { } },
-        /* go           */ { { reading_meta, &Receiver::read_metadata },    { },                                        { },                                        { },                                        { },                                        { },                                        { } },
-        /* Read meta    */ { {  },                                          { reading_record, &Receiver::read_record }, { },                                        { },                                        { },                                        { },                                        { } },
-        /* compressed   */ { { },                                           { },                                        { decompressing, &Receiver::decompress },   { },                                        { },                                        { },                                        { } },
-        /* uncompressed */ { { },                                           { },                                        { read_uncmprssd, &Receiver::read_message}, { },                                        { },                                        { },                                        { } },
-        /* valid msg    */ { { },                                           { },                                        { },                                        { dispatching, &Receiver::dispatch },       { dispatching, &Receiver::dispatch },       { },                                        { } },
-        /* invalid msg  */ { { },                                           { },                                        { },                                        { reading_record, &Receiver::read_record }, { reading_record, &Receiver::read_record }, { },                                        { } },
-        /* dispatched   */ { { },                                           { },                                        { },                                        { },                                        { },                                        { reading_record, &Receiver::read_record }, { } },
-        /* EOF          */ { { },                                           { },                                        { closing, &Receiver::end_of_file },        { },                                        { },                                        { closing, &Receiver::end_of_file },        { } }
+        //                  Initial                                         Reading                                     Pacing                                      Dispatching                                 Closing
+        /* error        */ { { },                                           { closing, &Receiver::shutdown },           { closing, &Receiver::shutdown },           { closing, &Receiver::shutdown },           { } },
+        /* go           */ { { reading, &Receiver::start_reading },         { },                                        { },                                        { },                                        { } },
+        /* valid msg    */ { { },                                           { pacing, &Receiver::pace },                { },                                        { },                                        { } },
+        /* invalid msg  */ { { },                                           { reading, &Receiver::read_record },        { },                                        { },                                        { } },
+        /* tick         */ { { },                                           { },                                        { pacing, &Receiver::pace },                { },                                        { } },
+        /* due          */ { { },                                           { },                                        { dispatching, &Receiver::dispatch },       { },                                        { } },
+        /* dispatched   */ { { },                                           { },                                        { },                                        { reading, &Receiver::read_record },        { } },
+        /* seeked       */ { { },                                           { },                                        { reading, &Receiver::read_record },        { },                                        { } },
+        /* EOF          */ { { },                                           { closing, &Receiver::end_of_file },        { },                                        { },                                        { } }
         };
-
-
-        Utility::Null::Stopwatch<100> stopwatch { };
     };
 
     template <Protocol protocol, Transport transport, TLS::Type tls>
@@ -150,15 +176,13 @@ namespace Navtech::Networking::Offline {
         Stream_Ty&          stream,
         ID_Ty               identity,
         Dispatcher_Ty&      protocol_event_dispatcher,
-        Error::Dispatcher&  error_event_dispatcher,
-        File_format         format
+        Error::Dispatcher&  error_event_dispatcher
     ) :
         Active              { "Receiver [" + std::to_string(identity) + "]" },
         stream              { associate_with(stream) },
         protocol_events     { associate_with(protocol_event_dispatcher) },
         error_events        { associate_with(error_event_dispatcher) },
-        id                  { identity },
-        format              { format }
+        id                  { identity }
     {
     }
 
@@ -186,101 +210,53 @@ namespace Navtech::Networking::Offline {
 
 
     template <Protocol protocol, Transport transport, TLS::Type tls>
-    std::uint8_t Receiver<protocol, transport, tls>::read_byte()
-    {
-        std::uint8_t out { 0 };
-        if (!enabled) return out;
-
-        stream->read(reinterpret_cast<char*>(&out), sizeof(std::uint8_t));
-        return out;
-    }
-
-    
-    template <Protocol protocol, Transport transport, TLS::Type tls>
-    std::uint32_t Receiver<protocol, transport, tls>::read_uint32()
+    void Receiver<protocol, transport, tls>::set_rate(double new_rate)
     {
-        std::uint32_t read { };
-        stream->read(reinterpret_cast<char*>(&read), sizeof(std::uint32_t));
-        total_read += read;
-        return read;
+        rate     = std::max(new_rate, as_fast_as_possible);
+        anchored = false;
     }
 
 
     template <Protocol protocol, Transport transport, TLS::Type tls>
-    void Receiver<protocol, transport, tls>::increment_file_position(std::size_t bytes)
+    template <typename Position_Ty>
+    void Receiver<protocol, transport, tls>::seek_to(Position_Ty position)
     {
-        stream->seekg(stream->tellg() + static_cast<std::streampos>(bytes));
-        total_read += bytes;
-    }   
+        if (current_state == closing) return;
 
+        stream->seek(position);
+        anchored = false;
 
-    template <Protocol protocol, Transport transport, TLS::Type tls>
-    std::vector<std::uint8_t> Receiver<protocol, transport, tls>::read_bytes(std::size_t bytes)
-    {
-        std::vector<std::uint8_t> message_buffer(bytes);
-        stream->read(reinterpret_cast<char*>(message_buffer.data()), bytes);
-        total_read += bytes;
-        return message_buffer;
-    }
+        syslog.debug(
+            "Offline receiver [" + std::to_string(id) + "] "
+            "seeking to record [" + std::to_string(stream->position()) + "]"
+        );
 
-    
-    template <Protocol protocol, Transport transport, TLS::Type tls>
-    void Receiver<protocol, transport, tls>::read_metadata()
-    {
-        try {
-            switch (format) {
-                case File_format::colraw:
-                    // Nothing to be done, no metadata stored
-                    //
-                    post_event(read_meta);
-                    break;
-                case File_format::radar:
-                    // Metadata should be ignored here
-                    //
-                    process_radar_meta();
-                    break;
-                case File_format::invalid:
-                    post_event(error);
-                    break;
-            }
-        }
-        catch (std::system_error& ex) {
-            syslog.debug("Offline receiver [" + std::to_string(id) + "] caught exception: " + ex.what());
+        // A message being held back for its due time is 
+        // now from the wrong part of the recording
+        //
+        if (current_state == pacing) {
+            buffer = incoming_msg.relinquish();
+            process_event(seeked);
         }
     }
 
 
     template <Protocol protocol, Transport transport, TLS::Type tls>
-    void Receiver<protocol, transport, tls>::process_radar_meta()
+    void Receiver<protocol, transport, tls>::start_reading()
     {
-        // Metadata format
-        // start_date   [8 bytes] | end data  [8 bytes] 
-        // start_ticks  [8 bytes] | end_ticks [8 bytes]
-        // ip_address   [4 bytes]
-        // The metadata size is the first 4 bytes of the file, 
-        // But it includes the size of the size data in itself
-        //
-        auto meta_size = Networking::to_uint32_host(read_uint32()) - sizeof(std::uint32_t);
-        
-        if (meta_size != Metadata::size()) {
-            syslog.error(
-                "Offline receiver [" + std::to_string(id) + "] - "
-                "The size of the file's metadata ["   + std::to_string(meta_size) + "] "
-                "does not match the expected value [" + std::to_string(Metadata::size()) + "]"
-            );
-            
+        if (!stream->is_open()) {
             post_event(error);
             return;
         }
-        
-        Metadata metadata { read_bytes(meta_size) };
-       
-        syslog.write(
-            "Offline receiver [" + std::to_string(id) + "] "
-            "Reading data from radar originally at [" + metadata.ip_address().to_string() + "]"
-        );
 
-        post_event(read_meta);
+        if (auto metadata = stream->metadata(); metadata.has_value()) {
+            syslog.write(
+                "Offline receiver [" + std::to_string(id) + "] "
+                "Reading data from radar originally at [" + metadata->ip_address().to_string() + "]"
+            );
+        }
+
+        read_record();
     }
 
 
@@ -288,55 +264,28 @@ namespace Navtech::Networking::Offline {
     void Receiver<protocol, transport, tls>::read_record()
     {
         if (!enabled) return;
-        if (!stream->is_open()) post_event(error);
         
         try {
-            std::uint8_t type_byte { 0 };
-
-            switch (format) {
-                case File_format::colraw:
-                    // Colraw record format:
-                    // Length (4 bytes) | Type (1 byte) | Top (4 bytes) | Bottom (4 bytes) | Message Data (<Length> bytes)
-                    //
-                    record_payload_sz = read_uint32();
-                    type_byte = read_byte();
-                    increment_file_position(2 * sizeof(std::uint32_t)); // Don't care about Top/Bottom
-                    break;
-
-                case File_format::radar:
-                    // Radar record format:
-                    // Type (1 byte) | Timestamp (8 bytes) | Length (4 bytes) | Message Data (<Length> bytes)
-                    //
-                    type_byte = read_byte();
-                    increment_file_position(2 * sizeof(std::uint32_t));
-                    record_payload_sz = Networking::to_uint32_host(read_uint32());
-                    break;
-
-                case File_format::invalid:
-                    post_event(error);
-                    return;
-            }
+            auto record = stream->position();
 
-            // Streams can't tell if they're at the end of the file 
-            // until they attempt to read past the end of it
-            //
-            if (stream->eof() || static_cast<int>(stream->tellg()) == -1) {
+            if (!stream->next(buffer)) {
                 post_event(eof);
                 return;
             }
-            
-            switch (type_byte) {
-                case 0:
-                    post_event(error);
-                    break;
-
-                case 255:
-                    post_event(compressed);
-                    break;
-
-                default:
-                    post_event(uncompressed);
-                    break;
+
+            msg_time    = stream->index()[record].time;
+            total_read += stream->index()[record].size;
+
+            Protocol_traits::replace_data(incoming_msg, std::move(buffer));
+
+            if (Protocol_traits::is_valid(incoming_msg)) {
+                post_event(valid_message);
+            }
+            else {
+                syslog.debug("Offline receiver [" + std::to_string(id) + "] invalid header");
+
+                buffer = incoming_msg.relinquish();
+                post_event(invalid_message);
             }
         }
         catch (std::exception& ex) {
@@ -348,101 +297,34 @@ namespace Navtech::Networking::Offline {
     }
 
 
-    template<Protocol protocol, Transport transport, TLS::Type tls>
-    void Receiver<protocol, transport, tls>::decompress()
-    {
-        using namespace Utility::Compression;
-
-        auto compressed_data = read_bytes(record_payload_sz);
-        std::vector<std::uint8_t> decompressed_data { };
-
-        switch (format) {
-            case File_format::colraw:
-                decompressed_data = GZIP::decompress(compressed_data);
-                break;
-
-            case File_format::radar:
-                decompressed_data = ZLIB::decompress(compressed_data);
-                break;
-
-            case File_format::invalid:
-                // Should NEVER get here, but just in case
-                //
-                post_event(error);
-                break;
-        }
-
-        total_read += static_cast<std::uint64_t>(decompressed_data.size());
-
-        // The first 13 bytes of the decompressed data is header information
-        // and can be discarded
-        //
-        decompressed_data.erase(decompressed_data.begin(), decompressed_data.begin() + 13);
-
-        Protocol_traits::replace_data(incoming_msg, decompressed_data);
-
-        if (Protocol_traits::is_valid(incoming_msg)) {
-            post_event(valid_message);
-        }
-        else {
-            syslog.debug("Offline receiver [" + std::to_string(id) + "] invalid header");
-
-            incoming_msg.relinquish();
-            post_event(invalid_message);
-        }
-        
-    }
-
-
     template <Protocol protocol, Transport transport, TLS::Type tls>
-    void Receiver<protocol, transport, tls>::read_message()
+    void Receiver<protocol, transport, tls>::pace()
     {
         if (!enabled) return;
-        if (!stream->is_open()) post_event(error);
-
-        try {
-            stopwatch.start();
-            // At this point, the file stream pointer should be at the 
-            // Beginning of the message itself
-            //
-            auto s [[maybe_unused]]  = static_cast<std::size_t>(stream->tellg());
-            auto message_as_bytes    = read_bytes(record_payload_sz);
-            auto s2 [[maybe_unused]] = static_cast<std::size_t>(stream->tellg());
-            stopwatch.stop();
-
-            // Since the receive call (above) is blocking, we may have
-            // been disabled during the block (for example, by a failure
-            // of the Sender). Don't continue if we've been disabled.
-            //
-            if (!enabled) {
-                syslog.debug("Offline receiver [" + std::to_string(id) + "] disabled after read");
-                return;
-            }
 
-            Protocol_traits::replace_data(incoming_msg, message_as_bytes);
+        if (rate == as_fast_as_possible) {
+            post_event(due);
+            return;
+        }
 
-            if (Protocol_traits::is_valid(incoming_msg)) {
-                post_event(valid_message);
-            }
-            else {
-                syslog.debug("Offline receiver [" + std::to_string(id) + "] invalid header");
+        auto now = Time::Monotonic::now();
 
-                incoming_msg.relinquish();
-                post_event(invalid_message);
-            } 
+        if (!anchored) {
+            anchored    = true;
+            anchor_time = msg_time;
+            anchor_wall = now;
         }
-        catch (client_shutdown&) {
-            syslog.debug("Offline receiver [" + std::to_string(id) + "] remote endpoint disconnected.");
 
-            disable();
-            post_event(error);
-        }
-        catch (std::system_error& e) {
-            syslog.debug("Offline receiver [" + std::to_string(id) + "] caught exception: " + e.what());
+        auto due_at    = anchor_wall + Time::Duration { msg_time - anchor_time } / rate;
+        auto remaining = due_at - now;
 
-            disable();
-            post_event(error);
+        if (remaining <= Time::Duration { }) {
+            post_event(due);
+            return;
         }
+
+        Time::Monotonic::sleep_for(std::min(remaining, max_wait));
+        post_event(tick);
     }
 
 
@@ -472,12 +354,10 @@ namespace Navtech::Networking::Offline {
         try {
             Protocol_traits::add_client_id(incoming_msg, id);
 
-            protocol_events->template notify<Event_traits::Received_message>(std::move(incoming_msg));
+            protocol_events->template notify<Event_traits::Received_message>(std::as_const(incoming_msg));
+            buffer = incoming_msg.relinquish();
 
-            if (stream->eof()) {
-                post_event(eof);
-            }
-            else post_event(dispatched);
+            post_event(dispatched);
         }
         catch (std::system_error& e) {
             syslog.debug("Offline receiver [" + std::to_string(id) + "] caught exception: " + e.what());
@@ -536,9 +416,12 @@ namespace Navtech::Networking::Offline {
         using ID_Ty             = typename Connection_traits::ID;
         using Dispatcher_Ty     = typename Event_traits::Dispatcher;
 
+        // Opens (and, if necessary, indexes) the recording.
+        // Throws std::system_error if the recording cannot be opened.
+        //
         Connection(
             ID_Ty               identifier, 
-            Stream_Ty&&         strm, 
+            const std::string&  filepath, 
             Dispatcher_Ty&      protocol_event_dispatcher,
             Error::Dispatcher&  error_event_dispatcher,
             File_format         file_format
@@ -560,6 +443,12 @@ namespace Navtech::Networking::Offline {
 
         ID_Ty id() const;
 
+        // Replay control; see Receiver
+        //
+        void playback_rate(double rate);
+        void seek(const Time::Real_time::Observation& time);
+        void seek(const Time::Duration& from_start);
+
     private:
         // External Associations
         //
@@ -586,17 +475,18 @@ namespace Navtech::Networking::Offline {
     template <Protocol protocol, Transport transport, TLS::Type tls>
     Connection<protocol, transport, tls>::Connection(
         Connection<protocol, transport, tls>::ID_Ty            identity, 
-        Connection<protocol, transport, tls>::Stream_Ty&&      strm,
+        const std::string&                                     filepath,
         Connection<protocol, transport, tls>::Dispatcher_Ty&   protocol_event_dispatcher,
         Error::Dispatcher&                                     error_event_dispatcher,
         File_format                                            format
     ) :
         protocol_events { associate_with(protocol_event_dispatcher) },
         error_events    { associate_with(error_event_dispatcher) },
-        stream          { std::move(strm) },
-        receiver        { stream, identity, protocol_event_dispatcher, error_event_dispatcher, format },
+        stream          { },
+        receiver        { stream, identity, protocol_event_dispatcher, error_event_dispatcher },
         ident           { identity }
     {
+        stream.open(filepath, format);
     }
 
 
@@ -631,17 +521,13 @@ namespace Navtech::Networking::Offline {
 
         error_events->detach_from<Error::Event::rx_error>(rx_error_handler);
 
-        try {
-            stream.close();
-        }
-        catch (...) {
-            // Don't care about errors, as closing file
-            //
-        }
-
         receiver.stop();
         receiver.join();
 
+        // The reader's worker threads must outlive the receiver
+        //
+        stream.close();
+
         // Diagnostics
         //
         syslog.debug(
@@ -683,5 +569,26 @@ namespace Navtech::Networking::Offline {
     {
         return ident;
     }
+
+
+    template <Protocol protocol, Transport transport, TLS::Type tls>
+    void Connection<protocol, transport, tls>::playback_rate(double rate)
+    {
+        receiver.playback_rate(rate);
+    }
+
+
+    template <Protocol protocol, Transport transport, TLS::Type tls>
+    void Connection<protocol, transport, tls>::seek(const Time::Real_time::Observation& time)
+    {
+        receiver.seek(time);
+    }
+
+
+    template <Protocol protocol, Transport transport, TLS::Type tls>
+    void Connection<protocol, transport, tls>::seek(const Time::Duration& from_start)
+    {
+        receiver.seek(from_start);
+    }
 } // namespace Navtech::Networking::Offline
 #endif
\ No newline at end of file
@@ -144,7 +144,7 @@ namespace Navtech::Networking {
             if (result == 0) throw client_shutdown { };
 
             bytes_in   += result;
-            insert_ptr += bytes_in;
+            insert_ptr += result;
             bytes_remaining = num_bytes - bytes_in;
 
             // Diagnostic tracking
@@ -201,6 +201,37 @@ namespace Navtech::Networking {
     }
 
 
+    size_t TCP_socket::receive_into(uint8_t* buffer, size_t max_bytes)
+    {
+        if (!is_open()) throw system_error { EBADF, system_category(), "TCP Socket receive into" };
+
+    #ifdef __linux__
+        auto result = ::recv(
+            native_handle(),
+            buffer,
+            max_bytes,
+            0
+        );
+    #elif _WIN32
+        auto result = ::recv(
+            native_handle(),
+            (char*)buffer,
+            static_cast<int>(max_bytes),
+            0
+        );
+    #endif
+
+        if (result < 0)  throw system_error    { last_error(), system_category(), "TCP Socket receive into" };
+        if (result == 0) throw client_shutdown { };
+
+        // Diagnostic tracking
+        //
+        bytes_read(result);
+
+        return static_cast<size_t>(result);
+    }
+
+
     // -------------------------------------------------------------------------
     // Connection interface
     //
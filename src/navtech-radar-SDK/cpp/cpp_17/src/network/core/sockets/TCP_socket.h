@@ -55,6 +55,12 @@ namespace Navtech::Networking {
         std::vector<std::uint8_t> receive_some(std::size_t max_bytes);
         std::vector<std::uint8_t> receive_some(std::size_t max_bytes, Read_mode mode);
 
+        // As receive_some, but into a buffer supplied by the caller, so
+        // that bytes can be read in bulk without an allocation.
+        // Returns the number of bytes actually received in this read.
+        //
+        std::size_t receive_into(std::uint8_t* buffer, std::size_t max_bytes);
+
         // Connection interface
         //
         void bind_to(const Endpoint& endpt);
@@ -102,6 +102,13 @@ namespace Navtech::Networking::CP_protocol {
         std::size_t payload_size() const;
         static constexpr std::size_t header_size() { return sizeof(Header); }
 
+        // Inspect a header before it has been copied into a message; for
+        // example, in a receive buffer.  header_start must reference at
+        // least header_size() bytes.
+        //
+        static bool        is_valid_header(Const_iterator header_start);
+        static std::size_t payload_size(Const_iterator header_start);
+
         // Access to a valid signature
         //
         static const Signature& valid_signature();
@@ -68,6 +68,11 @@ namespace Navtech::Networking {
             inout_msg.replace(std::move(in_buffer));
         }
 
+		static void replace_data(Message& inout_msg, Const_iterator in_start, std::size_t in_sz)
+		{
+			inout_msg.replace(in_start, in_sz);
+		}
+
         static void add_header(Message& inout_msg, const Buffer& in_buffer)
 		{
 			inout_msg.replace(in_buffer);
@@ -138,6 +143,16 @@ namespace Navtech::Networking {
 			return in_msg.is_valid();
 		}
 
+		static bool is_valid_header(Const_iterator in_header)
+		{
+			return Message::is_valid_header(in_header);
+		}
+
+		static std::size_t payload_size(Const_iterator in_header)
+		{
+			return Message::payload_size(in_header);
+		}
+
         static Pointer dyn_alloc()
 		{
 			return allocate_shared<Message>();
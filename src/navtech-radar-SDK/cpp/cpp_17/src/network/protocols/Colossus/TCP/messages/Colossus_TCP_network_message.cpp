@@ -231,13 +231,23 @@ namespace Navtech::Networking::Colossus_protocol::TCP {
 
     bool Message::is_valid() const
     {
-        if (data.empty()) return false;
+        if (data.size() < header_size()) return false;
+
+        return is_valid_header(data.data());
+    }
+
+
+    bool Message::is_valid_header(Message::Const_iterator header_start)
+    {
+        using std::equal;
+
+        auto header = Header::overlay_onto(header_start);
 
         return (
-            is_signature_valid()                                  &&
-            is_version_valid()                                    &&
-            static_cast<unsigned>(type()) <= largest_valid_message &&
-            payload_size() < largest_payload
+            equal(valid_signature().begin(), valid_signature().end(), header->signature) &&
+            header->version == version                                                    &&
+            static_cast<unsigned>(header->id) <= largest_valid_message                    &&
+            ntohl(header->payload_size) < largest_payload
         );
     }
 
@@ -264,6 +274,13 @@ namespace Navtech::Networking::Colossus_protocol::TCP {
     }
 
 
+    std::size_t Message::payload_size(Message::Const_iterator header_start)
+    {
+        auto header = Header::overlay_onto(header_start);
+        return ntohl(header->payload_size);
+    }
+
+
     void Message::update_payload_size()
     {
         auto header = Header::overlay_onto(data.data());
@@ -332,12 +349,7 @@ namespace Navtech::Networking::Colossus_protocol::TCP {
     
     void Message::replace(Message::Const_iterator src_start, std::size_t src_size)
     {
-        using std::copy_n;
-        using std::back_inserter;
-
-        data.clear();
-        data.reserve(src_size);
-        copy_n(src_start, src_size, back_inserter(data));
+        data.assign(src_start, src_start + src_size);
     }
 
 
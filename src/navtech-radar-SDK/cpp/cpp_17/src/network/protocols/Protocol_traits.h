@@ -96,6 +96,13 @@ namespace Navtech::Networking {
         //
         // static bool is_valid(const Message& in_msg);
         //
+        // Stream-based protocols also inspect a header in place, in the
+        // receive buffer, and copy the complete message out of it
+        //
+        // static bool        is_valid_header(Const_iterator in_header);
+        // static std::size_t payload_size(Const_iterator in_header);
+        // static void        replace_data(Message& inout_msg, Const_iterator in_start, std::size_t in_sz);
+        //
         // Pointer dyn_alloc();
         //
         // static void add_ip_address(Message& inout_msg, const Networking::IP_address& in_addr);
@@ -48,7 +48,10 @@ namespace Navtech::Networking::Offline {
         event_handler.when_notified_invoke(
             [this](ID_Ty connection_id [[maybe_unused]])
             {
-                msg_dispatcher.stop();
+                // The end of the recording may arrive well before the
+                // messages read ahead of it have been handled
+                //
+                msg_dispatcher.stop_when_drained();
             }
         );
         event_dispatcher->template attach_to<Event_traits::Client_disconnected>(event_handler);
@@ -103,4 +106,22 @@ namespace Navtech::Networking::Offline {
     {
         msg_dispatcher.attach_to(type, [](Client&, TCP::Message&){ });
     }
+
+
+    void Client::playback_rate(double rate)
+    {
+        client.playback_rate(rate);
+    }
+
+
+    void Client::seek(const Time::Real_time::Observation& time)
+    {
+        client.seek(time);
+    }
+
+
+    void Client::seek(const Time::Duration& from_start)
+    {
+        client.seek(from_start);
+    }
 } // namespace Navtech::Utility::Offline
\ No newline at end of file
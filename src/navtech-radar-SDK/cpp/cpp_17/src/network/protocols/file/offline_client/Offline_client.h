@@ -54,6 +54,18 @@ namespace Navtech::Networking::Offline {
         void remove_handler(Colossus_protocol::TCP::Type type);
         void ignore(Colossus_protocol::TCP::Type type);
 
+        // Replay control.
+        // A rate of 1.0 replays the recording with its original timing, 2.0 at 
+        // twice the speed, and so on; as_fast_as_possible (the default) does not
+        // pace messages at all.
+        // seek() continues from the first message at, or after, the given time
+        // (or offset from the start of the recording).
+        // Both may be called before start().
+        //
+        void playback_rate(double rate);
+        void seek(const Time::Real_time::Observation& time);
+        void seek(const Time::Duration& from_start);
+
         Colossus_protocol::TCP::Configuration read_config_msg();
 
     private:
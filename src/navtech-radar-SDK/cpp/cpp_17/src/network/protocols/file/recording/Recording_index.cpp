@@ -0,0 +1,439 @@
+// ---------------------------------------------------------------------------------------------------------------------
+// Copyright 2025 Navtech Radar Limited
+// This file is part of IASDK which is released under The MIT License (MIT).
+// See file LICENSE.txt in project root or go to https://opensource.org/licenses/MIT
+// for full license details.
+//
+// Disclaimer:
+// Navtech Radar is furnishing this item "as is". Navtech Radar does not provide 
+// any warranty of the item whatsoever, whether express, implied, or statutory,
+// including, but not limited to, any warranty of merchantability or fitness
+// for a particular purpose or any warranty that the contents of the item will
+// be error-free.
+// In no respect shall Navtech Radar incur any liability for any damages, including,
+// but limited to, direct, indirect, special, or consequential damages arising
+// out of, resulting from, or any way connected to the use of the item, whether
+// or not based upon warranty, contract, tort, or otherwise; whether or not
+// injury was sustained by persons or property or otherwise; and whether or not
+// loss was sustained from, or arose out of, the results of, the item, or any
+// services that may be provided by Navtech Radar.
+// ---------------------------------------------------------------------------------------------------------------------
+#include "Recording_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+#include "Colossus_TCP_network_message.h"
+#include "Colossus_TCP_message_types.h"
+#include "Compression_utils.h"
+#include "Log.h"
+#include "net_conversion.h"
+
+
+namespace Navtech::Networking::Offline {
+
+    using Utility::syslog;
+    using Utility::Compression::Inflater;
+    using Networking::to_uint32_host;
+
+    namespace {
+
+        // Record layouts:
+        // Colraw: Length (4 bytes) | Type (1 byte) | Top (4 bytes) | Bottom (4 bytes)                | Message (<Length> bytes)
+        // Radar:  Type (1 byte)    | Timestamp (8 bytes)           | Length (4 bytes, network order) | Message (<Length> bytes)
+        // A record type of 255 means the message is compressed; a 
+        // type of zero is invalid.
+        //
+        constexpr std::size_t   record_header_size  { 13 };
+        constexpr std::uint8_t  compressed_record   { 255 };
+        constexpr std::uint8_t  invalid_record      { 0 };
+
+        // Colossus message layout:
+        // Signature (16 bytes) | Version (1 byte) | Type (1 byte) | Payload size (4 bytes) | Payload
+        // with FFT payloads starting:
+        // Offset (2 bytes) | Sweep (2 bytes) | Azimuth (2 bytes) | Seconds (4 bytes) | Nanoseconds (4 bytes)
+        //
+        using Colossus_protocol::TCP::Message;
+        using Colossus_protocol::TCP::Type;
+
+        constexpr std::size_t type_offset           { 17 };
+        constexpr std::size_t seconds_offset        { Message::header_size() + 3 * sizeof(std::uint16_t) };
+        constexpr std::size_t nanoseconds_offset    { seconds_offset + sizeof(std::uint32_t) };
+        constexpr std::size_t fft_header_end        { nanoseconds_offset + sizeof(std::uint32_t) };
+
+        constexpr Time::Tick_type no_time { std::numeric_limits<Time::Tick_type>::min() };
+
+        // Index cache layout (host byte order):
+        // Magic (4 bytes) | Version (4 bytes) | Format (1 byte) | File size (8 bytes) | Modified (8 bytes) | Count (8 bytes)
+        // then, per record:
+        // Offset (8 bytes) | Time (8 bytes) | Size (4 bytes) | Type (1 byte) | Compressed (1 byte)
+        //
+        constexpr char          cache_magic[4]      { 'N', 'R', 'I', 'X' };
+        constexpr std::uint32_t cache_version       { 1 };
+        constexpr std::size_t   cache_header_size   { 33 };
+        constexpr std::size_t   cache_record_size   { 22 };
+        constexpr std::size_t   cache_block         { 65536 };
+
+
+        template <typename T>
+        T load_from(const std::uint8_t* from)
+        {
+            T value { };
+            std::memcpy(&value, from, sizeof(T));
+            return value;
+        }
+
+
+        template <typename T>
+        std::uint8_t* store_to(std::uint8_t* to, const T& value)
+        {
+            std::memcpy(to, &value, sizeof(T));
+            return to + sizeof(T);
+        }
+
+
+        void read_message_header(const std::uint8_t* msg, std::size_t msg_size, Recording_index::Record& record)
+        {
+            if (msg_size <= type_offset) return;
+
+            record.type = msg[type_offset];
+
+            auto type = static_cast<Type>(record.type);
+            if (type != Type::fft_data && type != Type::high_precision_fft_data) return;
+            if (msg_size < fft_header_end) return;
+
+            auto sec  = load_from<std::uint32_t>(msg + seconds_offset);
+            auto nsec = load_from<std::uint32_t>(msg + nanoseconds_offset);
+
+            record.time = static_cast<Time::Tick_type>(sec) * 1'000'000 + nsec / 1'000;
+        }
+
+
+        std::int64_t modification_time(const std::string& filepath)
+        {
+            std::error_code err { };
+            auto modified = std::filesystem::last_write_time(filepath, err);
+            if (err) return 0;
+
+            return static_cast<std::int64_t>(modified.time_since_epoch().count());
+        }
+
+
+        std::uint64_t size_of(const std::string& filepath)
+        {
+            std::error_code err { };
+            auto sz = std::filesystem::file_size(filepath, err);
+            if (err) return 0;
+
+            return static_cast<std::uint64_t>(sz);
+        }
+
+    } // namespace
+
+
+    // ----------------------------------------------------------------------------------------------------------------
+    //
+    int Recording_index::window_bits(File_format format)
+    {
+        using namespace Utility::Compression;
+
+        return (format == File_format::colraw) ? GZIP::window_bits : ZLIB::window_bits;
+    }
+
+
+    std::size_t Recording_index::first_record(const Utility::Mapped_file& file, File_format format)
+    {
+        if (format != File_format::radar) return 0;
+        if (file.size() < sizeof(std::uint32_t)) return file.size();
+
+        // Radar recordings start with metadata. The first 4 bytes hold its size,
+        // which includes those 4 bytes
+        //
+        auto meta_size = to_uint32_host(load_from<std::uint32_t>(file.data()));
+
+        return std::min(static_cast<std::size_t>(meta_size), file.size());
+    }
+
+
+    Recording_index Recording_index::open(
+        const std::string&          filepath, 
+        const Utility::Mapped_file& file, 
+        File_format                 format,
+        std::size_t                 num_threads
+    )
+    {
+        if (auto cached = load(filepath, format); cached.has_value()) {
+            syslog.debug("Recording index - using cached index for [" + filepath + "]");
+            return std::move(*cached);
+        }
+
+        syslog.write("Recording index - indexing [" + filepath + "]...");
+
+        auto index = build(file, format, num_threads);
+
+        syslog.write("Recording index - [" + std::to_string(index.size()) + "] records");
+
+        if (!index.save(filepath)) {
+            syslog.warning("Recording index - unable to write [" + cache_path(filepath) + "]");
+        }
+
+        return index;
+    }
+
+
+    Recording_index Recording_index::build(const Utility::Mapped_file& file, File_format format, std::size_t num_threads)
+    {
+        Recording_index index { };
+        index.file_format = format;
+
+        if (format == File_format::invalid) return index;
+
+        // Pass 1: walk the record chain.  Only the record headers are
+        // touched, so this is little more than paging the file in.
+        //
+        const auto data = file.data();
+        const auto size = file.size();
+
+        auto pos = first_record(file, format);
+
+        while (pos + record_header_size <= size) {
+            Record record { };
+            std::uint8_t  record_type { };
+            std::uint32_t length { };
+
+            if (format == File_format::colraw) {
+                length      = load_from<std::uint32_t>(data + pos);
+                record_type = data[pos + sizeof(std::uint32_t)];
+            }
+            else {
+                record_type = data[pos];
+                length      = to_uint32_host(load_from<std::uint32_t>(data + pos + record_header_size - sizeof(std::uint32_t)));
+            }
+
+            pos += record_header_size;
+
+            if (record_type == invalid_record) break;
+            if (length > size - pos)           break;      // Truncated final record
+
+            record.offset       = pos;
+            record.size         = length;
+            record.compressed   = (record_type == compressed_record);
+            record.time         = no_time;
+
+            index.records.push_back(record);
+            pos += length;
+        }
+
+        // Pass 2: read each message's type and timestamp.  Compressed messages
+        // are inflated only as far as the end of the FFT header.  Records are 
+        // independent, so this is shared between threads.
+        //
+        auto read_headers = [&index, data, format](std::size_t first, std::size_t last)
+        {
+            Inflater inflater { window_bits(format) };
+            std::vector<std::uint8_t> peek { };
+
+            for (auto i { first }; i < last; ++i) {
+                auto& record = index.records[i];
+                auto  msg    = data + record.offset;
+
+                if (!record.compressed) {
+                    read_message_header(msg, record.size, record);
+                    continue;
+                }
+
+                inflater.decompress(msg, record.size, peek, inflated_header_size + fft_header_end);
+                if (peek.size() <= inflated_header_size) continue;
+
+                read_message_header(peek.data() + inflated_header_size, peek.size() - inflated_header_size, record);
+            }
+        };
+
+        const std::size_t min_records_per_thread { 4096 };
+        
+        auto num_records = index.records.size();
+        auto threads     = std::clamp<std::size_t>(num_records / min_records_per_thread, 1, std::max<std::size_t>(num_threads, 1));
+        auto per_thread  = (num_records + threads - 1) / threads;
+
+        std::vector<std::thread> workers { };
+        for (std::size_t t { 1 }; t < threads; ++t) {
+            workers.emplace_back(read_headers, t * per_thread, std::min(num_records, (t + 1) * per_thread));
+        }
+        read_headers(0, std::min(num_records, per_thread));
+
+        for (auto& worker : workers) worker.join();
+
+        // Pass 3: fill in times for records without one and 
+        // make times non-decreasing
+        //
+        auto first_timed = std::find_if(
+            index.records.begin(), 
+            index.records.end(), 
+            [](const Record& r) { return r.time != no_time; }
+        );
+        auto latest = (first_timed != index.records.end()) ? first_timed->time : 0;
+
+        for (auto& record : index.records) {
+            latest      = std::max(latest, record.time);
+            record.time = latest;
+        }
+
+        return index;
+    }
+
+
+    std::optional<Recording_index> Recording_index::load(const std::string& filepath, File_format format)
+    {
+        std::ifstream cache { cache_path(filepath), std::ios_base::in | std::ios_base::binary };
+        if (!cache.is_open()) return std::nullopt;
+
+        std::uint8_t header[cache_header_size] { };
+        cache.read(reinterpret_cast<char*>(header), cache_header_size);
+        if (!cache) return std::nullopt;
+
+        auto valid = (
+            std::memcmp(header, cache_magic, sizeof(cache_magic)) == 0                  &&
+            load_from<std::uint32_t>(header + 4)  == cache_version                      &&
+            header[8]                             == static_cast<std::uint8_t>(format)  &&
+            load_from<std::uint64_t>(header + 9)  == size_of(filepath)                  &&
+            load_from<std::int64_t>(header + 17)  == modification_time(filepath)
+        );
+        if (!valid) return std::nullopt;
+
+        auto count = load_from<std::uint64_t>(header + 25);
+
+        std::error_code err { };
+        auto cache_size = std::filesystem::file_size(cache_path(filepath), err);
+        if (err || cache_size != cache_header_size + count * cache_record_size) return std::nullopt;
+
+        Recording_index index { };
+        index.file_format = format;
+        index.records.resize(count);
+
+        std::vector<std::uint8_t> block(cache_block * cache_record_size);
+
+        for (std::size_t first { 0 }; first < count; first += cache_block) {
+            auto n = std::min<std::size_t>(cache_block, count - first);
+
+            cache.read(reinterpret_cast<char*>(block.data()), n * cache_record_size);
+            if (!cache) return std::nullopt;
+
+            auto from = block.data();
+            for (auto i { first }; i < first + n; ++i, from += cache_record_size) {
+                auto& record = index.records[i];
+
+                record.offset       = load_from<std::uint64_t>(from);
+                record.time         = load_from<Time::Tick_type>(from + 8);
+                record.size         = load_from<std::uint32_t>(from + 16);
+                record.type         = from[20];
+                record.compressed   = (from[21] != 0);
+            }
+        }
+
+        return index;
+    }
+
+
+    bool Recording_index::save(const std::string& filepath) const
+    {
+        auto path = cache_path(filepath);
+        auto temp = path + ".tmp";
+
+        {
+            std::ofstream cache { temp, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc };
+            if (!cache.is_open()) return false;
+
+            std::uint8_t header[cache_header_size] { };
+            auto to = header;
+
+            std::memcpy(to, cache_magic, sizeof(cache_magic));
+            to = store_to(to + sizeof(cache_magic), cache_version);
+            to = store_to(to, static_cast<std::uint8_t>(file_format));
+            to = store_to(to, size_of(filepath));
+            to = store_to(to, modification_time(filepath));
+            to = store_to(to, static_cast<std::uint64_t>(records.size()));
+
+            cache.write(reinterpret_cast<const char*>(header), cache_header_size);
+
+            std::vector<std::uint8_t> block(cache_block * cache_record_size);
+
+            for (std::size_t first { 0 }; first < records.size(); first += cache_block) {
+                auto n = std::min<std::size_t>(cache_block, records.size() - first);
+                
+                to = block.data();
+                for (auto i { first }; i < first + n; ++i) {
+                    to = store_to(to, records[i].offset);
+                    to = store_to(to, records[i].time);
+                    to = store_to(to, records[i].size);
+                    to = store_to(to, records[i].type);
+                    to = store_to(to, static_cast<std::uint8_t>(records[i].compressed));
+                }
+
+                cache.write(reinterpret_cast<const char*>(block.data()), n * cache_record_size);
+            }
+
+            if (!cache) {
+                cache.close();
+                std::error_code err { };
+                std::filesystem::remove(temp, err);
+                return false;
+            }
+        }
+
+        std::error_code err { };
+        std::filesystem::rename(temp, path, err);
+        if (err) std::filesystem::remove(temp, err);
+
+        return !err;
+    }
+
+
+    std::size_t Recording_index::find(const Time::Real_time::Observation& time) const
+    {
+        auto t = time.since_epoch().ticks();
+
+        auto itr = std::lower_bound(
+            records.begin(), 
+            records.end(), 
+            t, 
+            [](const Record& record, Time::Tick_type value) { return record.time < value; }
+        );
+
+        return static_cast<std::size_t>(itr - records.begin());
+    }
+
+
+    Time::Real_time::Observation Recording_index::time_of(std::size_t record) const
+    {
+        if (record >= records.size()) return end_time();
+
+        return Time::Real_time::Observation { Time::Duration { records[record].time } };
+    }
+
+
+    Time::Real_time::Observation Recording_index::start_time() const
+    {
+        if (records.empty()) return Time::Real_time::Observation { };
+        
+        return time_of(0);
+    }
+
+
+    Time::Real_time::Observation Recording_index::end_time() const
+    {
+        if (records.empty()) return Time::Real_time::Observation { };
+
+        return time_of(records.size() - 1);
+    }
+
+
+    Time::Duration Recording_index::duration() const
+    {
+        return end_time() - start_time();
+    }
+
+} // namespace Navtech::Networking::Offline
\ No newline at end of file
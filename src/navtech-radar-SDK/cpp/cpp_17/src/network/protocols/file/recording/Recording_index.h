@@ -0,0 +1,119 @@
+// ---------------------------------------------------------------------------------------------------------------------
+// Copyright 2025 Navtech Radar Limited
+// This file is part of IASDK which is released under The MIT License (MIT).
+// See file LICENSE.txt in project root or go to https://opensource.org/licenses/MIT
+// for full license details.
+//
+// Disclaimer:
+// Navtech Radar is furnishing this item "as is". Navtech Radar does not provide 
+// any warranty of the item whatsoever, whether express, implied, or statutory,
+// including, but not limited to, any warranty of merchantability or fitness
+// for a particular purpose or any warranty that the contents of the item will
+// be error-free.
+// In no respect shall Navtech Radar incur any liability for any damages, including,
+// but limited to, direct, indirect, special, or consequential damages arising
+// out of, resulting from, or any way connected to the use of the item, whether
+// or not based upon warranty, contract, tort, or otherwise; whether or not
+// injury was sustained by persons or property or otherwise; and whether or not
+// loss was sustained from, or arose out of, the results of, the item, or any
+// services that may be provided by Navtech Radar.
+// ---------------------------------------------------------------------------------------------------------------------
+#ifndef RECORDING_INDEX_H
+#define RECORDING_INDEX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Mapped_file.h"
+#include "Time_utils.h"
+
+
+namespace Navtech::Networking::Offline {
+
+    enum class File_format { colraw, radar, invalid };
+
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // A Recording_index locates every record in a recording, along with its
+    // message type and time.  With an index, any moment in a recording can be
+    // reached directly, rather than by reading through everything before it.
+    //
+    // Record times are taken from FFT messages (the only messages that carry
+    // a radar timestamp).  Other records take the time of the FFT before them;
+    // records before the first FFT take the time of the first FFT.  Times are
+    // forced to be non-decreasing, so a clock stepping backwards during a
+    // recording does not break seeking.
+    //
+    // Building an index means visiting every record (and partially inflating
+    // compressed ones) so, once built, it is cached beside the recording, in
+    // <recording>.index.  The cache is ignored if the recording's size or
+    // modification time no longer match.
+    //
+    class Recording_index {
+    public:
+        struct Record {
+            std::uint64_t   offset      { };    // Start of the (stored) message, in the file
+            Time::Tick_type time        { };    // Microseconds since the epoch
+            std::uint32_t   size        { };    // Size of the stored message, in bytes
+            std::uint8_t    type        { };    // Colossus message type
+            bool            compressed  { };
+        };
+
+        using Iterator = std::vector<Record>::const_iterator;
+
+        Recording_index() = default;
+
+        // Load the cached index for filepath if it is still valid; otherwise
+        // build (and try to cache) a new one.
+        //
+        static Recording_index open(
+            const std::string&          filepath, 
+            const Utility::Mapped_file& file, 
+            File_format                 format,
+            std::size_t                 num_threads = 1
+        );
+
+        static Recording_index build(const Utility::Mapped_file& file, File_format format, std::size_t num_threads = 1);
+        
+        static std::optional<Recording_index> load(const std::string& filepath, File_format format);
+        bool save(const std::string& filepath) const;
+
+        static std::string cache_path(const std::string& filepath) { return filepath + ".index"; }
+
+        // Record access
+        //
+        std::size_t     size() const                            { return records.size(); }
+        bool            empty() const                           { return records.empty(); }
+        const Record&   operator[](std::size_t i) const         { return records[i]; }
+        Iterator        begin() const                           { return records.begin(); }
+        Iterator        end() const                             { return records.end(); }
+
+        // The first record at, or after, the given time; size() if
+        // there is none.
+        //
+        std::size_t     find(const Time::Real_time::Observation& time) const;
+
+        Time::Real_time::Observation time_of(std::size_t record) const;
+        Time::Real_time::Observation start_time() const;
+        Time::Real_time::Observation end_time() const;
+        Time::Duration               duration() const;
+
+        File_format     format() const                          { return file_format; }
+
+        // Recording layout helpers
+        //
+        static int                   window_bits(File_format format);
+        static std::size_t           first_record(const Utility::Mapped_file& file, File_format format);
+        static constexpr std::size_t inflated_header_size { 13 };
+
+    private:
+        std::vector<Record> records     { };
+        File_format         file_format { File_format::invalid };
+    };
+
+} // namespace Navtech::Networking::Offline
+
+#endif // RECORDING_INDEX_H
\ No newline at end of file
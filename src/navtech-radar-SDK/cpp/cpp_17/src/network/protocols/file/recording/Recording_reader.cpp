@@ -0,0 +1,297 @@
+// ---------------------------------------------------------------------------------------------------------------------
+// Copyright 2025 Navtech Radar Limited
+// This file is part of IASDK which is released under The MIT License (MIT).
+// See file LICENSE.txt in project root or go to https://opensource.org/licenses/MIT
+// for full license details.
+//
+// Disclaimer:
+// Navtech Radar is furnishing this item "as is". Navtech Radar does not provide 
+// any warranty of the item whatsoever, whether express, implied, or statutory,
+// including, but not limited to, any warranty of merchantability or fitness
+// for a particular purpose or any warranty that the contents of the item will
+// be error-free.
+// In no respect shall Navtech Radar incur any liability for any damages, including,
+// but limited to, direct, indirect, special, or consequential damages arising
+// out of, resulting from, or any way connected to the use of the item, whether
+// or not based upon warranty, contract, tort, or otherwise; whether or not
+// injury was sustained by persons or property or otherwise; and whether or not
+// loss was sustained from, or arose out of, the results of, the item, or any
+// services that may be provided by Navtech Radar.
+// ---------------------------------------------------------------------------------------------------------------------
+#include "Recording_reader.h"
+
+#include <algorithm>
+#include <system_error>
+#include <utility>
+
+
+namespace Navtech::Networking::Offline {
+
+    using Utility::Compression::Inflater;
+
+    Recording_reader::Recording_reader() :
+        Recording_reader { std::clamp(std::thread::hardware_concurrency(), 1u, 4u) }
+    {
+    }
+
+
+    Recording_reader::Recording_reader(std::size_t num_threads) :
+        num_threads { std::max<std::size_t>(num_threads, 1) }
+    {
+    }
+
+
+    Recording_reader::~Recording_reader()
+    {
+        close();
+    }
+
+
+    void Recording_reader::set_threads(std::size_t threads)
+    {
+        stop_workers();
+        num_threads = std::max<std::size_t>(threads, 1);
+
+        if (!is_open()) return;
+        
+        reset_to(position());
+        start_workers();
+    }
+
+
+    void Recording_reader::open(const std::string& filepath, File_format file_format)
+    {
+        close();
+
+        if (file_format == File_format::invalid) {
+            throw std::system_error { 
+                std::make_error_code(std::errc::invalid_argument), 
+                "Recording reader - unknown recording format [" + filepath + "]" 
+            };
+        }
+
+        file.open(filepath);
+        format = file_format;
+
+        if (format == File_format::radar) {
+            meta = read_metadata();
+
+            if (!meta.has_value()) {
+                close();
+                throw std::system_error { 
+                    std::make_error_code(std::errc::illegal_byte_sequence), 
+                    "Recording reader - unexpected metadata size in [" + filepath + "]" 
+                };
+            }
+        }
+
+        idx = Recording_index::open(filepath, file, format, num_threads);
+
+        slots = std::vector<Slot>(read_ahead);
+        reset_to(0);
+        start_workers();
+    }
+
+
+    void Recording_reader::close()
+    {
+        stop_workers();
+
+        file.close();
+        idx     = Recording_index { };
+        meta    = std::nullopt;
+        format  = File_format::invalid;
+
+        std::lock_guard lock { mtx };
+        slots.clear();
+        pool.clear();
+        cursor          = 0;
+        next_to_decode  = 0;
+    }
+
+
+    bool Recording_reader::is_open() const
+    {
+        return file.is_open();
+    }
+
+
+    void Recording_reader::seek(std::size_t record)
+    {
+        reset_to(record);
+    }
+
+
+    void Recording_reader::seek(const Time::Real_time::Observation& time)
+    {
+        reset_to(idx.find(time));
+    }
+
+
+    void Recording_reader::seek(const Time::Duration& from_start)
+    {
+        seek(idx.start_time() + from_start);
+    }
+
+
+    std::size_t Recording_reader::position() const
+    {
+        std::lock_guard lock { mtx };
+        return cursor;
+    }
+
+
+    bool Recording_reader::next(Buffer& out)
+    {
+        std::unique_lock lock { mtx };
+
+        if (cursor >= idx.size()) return false;
+
+        auto& slot = slots[cursor % read_ahead];
+        slot_ready.wait(lock, [this, &slot] { return stopping || (slot.ready && slot.record == cursor); });
+
+        if (!slot.ready) return false;
+
+        std::swap(out, slot.buffer);
+        if (slot.buffer.capacity() != 0) pool.push_back(std::move(slot.buffer));
+        slot.buffer = Buffer { };
+        slot.ready  = false;
+        ++cursor;
+
+        lock.unlock();
+        work_available.notify_one();
+
+        return true;
+    }
+
+
+    void Recording_reader::reset_to(std::size_t record)
+    {
+        {
+            std::lock_guard lock { mtx };
+
+            ++generation;
+
+            for (auto& slot : slots) {
+                if (!slot.ready) continue;
+
+                pool.push_back(std::move(slot.buffer));
+                slot.buffer = Buffer { };
+                slot.ready  = false;
+            }
+
+            cursor          = std::min(record, idx.size());
+            next_to_decode  = cursor;
+        }
+
+        work_available.notify_all();
+    }
+
+
+    void Recording_reader::start_workers()
+    {
+        {
+            std::lock_guard lock { mtx };
+            stopping = false;
+        }
+
+        for (std::size_t i { 0 }; i < num_threads; ++i) {
+            workers.emplace_back(&Recording_reader::decode_records, this);
+        }
+    }
+
+
+    void Recording_reader::stop_workers()
+    {
+        {
+            std::lock_guard lock { mtx };
+            stopping = true;
+        }
+
+        work_available.notify_all();
+        slot_ready.notify_all();
+
+        for (auto& worker : workers) worker.join();
+        workers.clear();
+    }
+
+
+    void Recording_reader::decode_records()
+    {
+        Inflater inflater { Recording_index::window_bits(format) };
+
+        std::unique_lock lock { mtx };
+
+        while (true) {
+            work_available.wait(
+                lock, 
+                [this] { return stopping || (next_to_decode < idx.size() && next_to_decode < cursor + read_ahead); }
+            );
+            
+            if (stopping) return;
+
+            auto record = next_to_decode++;
+            auto gen    = generation;
+
+            Buffer buffer { };
+            if (!pool.empty()) {
+                buffer = std::move(pool.back());
+                pool.pop_back();
+            }
+
+            lock.unlock();
+            decode(record, buffer, inflater);
+            lock.lock();
+
+            // A seek happened while decoding; the
+            // record is no longer wanted
+            //
+            if (gen != generation) {
+                pool.push_back(std::move(buffer));
+                continue;
+            }
+
+            auto& slot  = slots[record % read_ahead];
+            slot.buffer = std::move(buffer);
+            slot.record = record;
+            slot.ready  = true;
+
+            if (record == cursor) slot_ready.notify_one();
+        }
+    }
+
+
+    void Recording_reader::decode(std::size_t record, Buffer& out, Inflater& inflater) const
+    {
+        const auto& rec = idx[record];
+        const auto  msg = file.data() + rec.offset;
+
+        if (!rec.compressed) {
+            out.assign(msg, msg + rec.size);
+            return;
+        }
+
+        // Compressed records inflate to a copy of the record
+        // header, followed by the message
+        //
+        if (!inflater.decompress_after(Recording_index::inflated_header_size, msg, rec.size, out)) {
+            out.clear();
+        }
+    }
+
+
+    std::optional<Metadata> Recording_reader::read_metadata() const
+    {
+        // Metadata format
+        // start_date   [8 bytes] | end data  [8 bytes] 
+        // start_ticks  [8 bytes] | end_ticks [8 bytes]
+        // ip_address   [4 bytes]
+        // preceded by its size (which includes the size field)
+        //
+        auto meta_end = Recording_index::first_record(file, format);
+        if (meta_end != sizeof(std::uint32_t) + Metadata::size()) return std::nullopt;
+
+        return Metadata { std::vector<std::uint8_t> { file.begin() + sizeof(std::uint32_t), file.begin() + meta_end } };
+    }
+
+} // namespace Navtech::Networking::Offline
\ No newline at end of file
@@ -0,0 +1,145 @@
+// ---------------------------------------------------------------------------------------------------------------------
+// Copyright 2025 Navtech Radar Limited
+// This file is part of IASDK which is released under The MIT License (MIT).
+// See file LICENSE.txt in project root or go to https://opensource.org/licenses/MIT
+// for full license details.
+//
+// Disclaimer:
+// Navtech Radar is furnishing this item "as is". Navtech Radar does not provide 
+// any warranty of the item whatsoever, whether express, implied, or statutory,
+// including, but not limited to, any warranty of merchantability or fitness
+// for a particular purpose or any warranty that the contents of the item will
+// be error-free.
+// In no respect shall Navtech Radar incur any liability for any damages, including,
+// but limited to, direct, indirect, special, or consequential damages arising
+// out of, resulting from, or any way connected to the use of the item, whether
+// or not based upon warranty, contract, tort, or otherwise; whether or not
+// injury was sustained by persons or property or otherwise; and whether or not
+// loss was sustained from, or arose out of, the results of, the item, or any
+// services that may be provided by Navtech Radar.
+// ---------------------------------------------------------------------------------------------------------------------
+#ifndef RECORDING_READER_H
+#define RECORDING_READER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Compression_utils.h"
+#include "Mapped_file.h"
+#include "Recording_index.h"
+#include "Recording_metadata.h"
+#include "Time_utils.h"
+
+
+namespace Navtech::Networking::Offline {
+
+    // Replay rate for playback as fast as messages can be decoded
+    // and dispatched (rather than in scaled real time)
+    //
+    constexpr double as_fast_as_possible { 0.0 };
+
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // A Recording_reader gives indexed, random access to the messages in a 
+    // recording.  The file is memory-mapped and indexed (see Recording_index)
+    // when opened.
+    // Records ahead of the read position are decoded (inflated, if compressed)
+    // by a pool of worker threads, into a ring of re-usable buffers.  Seeking
+    // discards the read-ahead and restarts it from the new position.
+    //
+    // The public interface is intended to be used from a single thread; 
+    // the worker threads are internal.
+    // Failing to open a recording throws std::system_error.
+    //
+    class Recording_reader {
+    public:
+        using Buffer = std::vector<std::uint8_t>;
+
+        Recording_reader();
+        Recording_reader(std::size_t num_threads);
+        ~Recording_reader();
+
+        Recording_reader(const Recording_reader&)             = delete;
+        Recording_reader& operator=(const Recording_reader&)  = delete;
+
+        void set_threads(std::size_t num_threads);
+        
+        void open(const std::string& filepath, File_format format);
+        void close();
+        bool is_open() const;
+
+        const Recording_index&  index() const       { return idx; }
+        std::optional<Metadata> metadata() const    { return meta; }
+
+        // Position the reader so that the next message read is the given 
+        // record; or the first record at (or after) the given time; or the 
+        // first record at (or after) an offset from the start of the recording.
+        //
+        void seek(std::size_t record);
+        void seek(const Time::Real_time::Observation& time);
+        void seek(const Time::Duration& from_start);
+
+        // The record that will be returned by the next call to next()
+        //
+        std::size_t position() const;
+
+        // Swap the next decoded message into out, and advance.  The buffer 
+        // passed in is returned to the reader's pool, so a caller that hands
+        // back its previous buffer avoids re-allocating each message.
+        // A record that cannot be decoded yields an empty buffer.
+        // Returns false at the end of the recording.
+        //
+        bool next(Buffer& out);
+
+    private:
+        static constexpr std::size_t read_ahead { 64 };
+
+        Utility::Mapped_file    file        { };
+        Recording_index         idx         { };
+        std::optional<Metadata> meta        { };
+        File_format             format      { File_format::invalid };
+        std::size_t             num_threads { };
+
+        // Read-ahead pipeline.
+        // Record r is decoded into slot r % read_ahead.  Workers only decode
+        // records in [cursor, cursor + read_ahead), so a slot is never written
+        // while its previous record is unread.  Work claimed before a seek
+        // (that is, of an older generation) is discarded on completion.
+        //
+        struct Slot {
+            Buffer      buffer  { };
+            std::size_t record  { };
+            bool        ready   { false };
+        };
+
+        mutable std::mutex          mtx             { };
+        std::condition_variable     work_available  { };
+        std::condition_variable     slot_ready      { };
+
+        std::vector<Slot>           slots           { };
+        std::vector<Buffer>         pool            { };
+        std::size_t                 cursor          { 0 };
+        std::size_t                 next_to_decode  { 0 };
+        std::size_t                 generation      { 0 };
+        bool                        stopping        { false };
+
+        std::vector<std::thread>    workers         { };
+
+        void start_workers();
+        void stop_workers();
+        void decode_records();
+        void decode(std::size_t record, Buffer& out, Utility::Compression::Inflater& inflater) const;
+        void reset_to(std::size_t record);
+
+        std::optional<Metadata> read_metadata() const;
+    };
+
+} // namespace Navtech::Networking::Offline
+
+#endif // RECORDING_READER_H
\ No newline at end of file
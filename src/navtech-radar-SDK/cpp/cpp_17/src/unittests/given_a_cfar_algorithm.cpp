@@ -1,6 +1,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <deque>
 #include <fstream>
 
 #include "CFAR_algorithms.h"
@@ -563,4 +564,97 @@ TEST_F(GivenACFARAlgorithm, ProcessRawAzimuthSubset)
     ASSERT_EQ(output.size(), 10);
     ASSERT_EQ(output[5], 90);
     ASSERT_EQ(output[0], 0);
+}
+
+TEST_F(GivenACFARAlgorithm, GreatestOfAtClutterEdge)
+{
+    //                ______________
+    // _____________--
+    // ------------------------------
+    //                      0                                      10                                      20
+    //                      |                                       |                                       |
+    vector<uint8_t> input { 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90 };
+
+    auto cell_average = process_as_raw(input, Window { 11, 2, 10.0_dB, Method::cell_average });
+    auto greatest_of  = process_as_raw(input, Window { 11, 2, 10.0_dB, Method::greatest_of });
+
+    ASSERT_EQ(cell_average[15], 90);
+    ASSERT_EQ(std::count(greatest_of.begin(), greatest_of.end(), 0), input.size());
+}
+
+
+TEST_F(GivenACFARAlgorithm, OrderedStatisticWithTargetInTrainingCells)
+{
+    //             |     |
+    // ____________|_____|___________
+    // ------------------------------
+    //                      0                                      10                                      20
+    //                      |                                       |                                       |
+    vector<uint8_t> input { 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 60, 10, 10, 10, 10, 10, 120, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10 };
+
+    Window window { 13, 1, 20.0_dB, Method::ordered_statistic };
+    window.order = 0.5f;
+
+    auto cell_average = process_as_raw(input, Window { 13, 1, 20.0_dB });
+    auto ordered      = process_as_raw(input, window);
+
+    ASSERT_EQ(cell_average[12], 0);
+    ASSERT_EQ(ordered[12], 60);
+    ASSERT_EQ(ordered[18], 120);
+}
+
+
+TEST_F(GivenACFARAlgorithm, EngineProcessesRotationIntoCallerBuffer)
+{
+    constexpr std::size_t azimuths { 16 };
+    constexpr std::size_t bins     { 30 };
+
+    vector<uint8_t> rotation(azimuths * bins, 10);
+    for (std::size_t azimuth { 0 }; azimuth < azimuths; ++azimuth) {
+        rotation[azimuth * bins + azimuth + 5] = 90;
+    }
+
+    Window          window { 11, 2, 30.0_dB };
+    Engine<uint8_t> engine { window, 4 };
+    vector<dB>      output(rotation.size());
+
+    engine.process_rotation(rotation.data(), azimuths, bins, output.data());
+
+    for (std::size_t azimuth { 0 }; azimuth < azimuths; ++azimuth) {
+        auto first = rotation.begin() + azimuth * bins;
+        auto expected = process(first, first + bins, window);
+
+        ASSERT_TRUE(std::equal(expected.begin(), expected.end(), output.begin() + azimuth * bins));
+        ASSERT_FLOAT_EQ(output[azimuth * bins + azimuth + 5], 45.0f);
+    }
+}
+
+
+TEST_F(GivenACFARAlgorithm, OnlyContiguousIteratorsAreAccepted)
+{
+    using Implementation::is_contiguous_v;
+
+    static_assert(is_contiguous_v<const uint8_t*>);
+    static_assert(is_contiguous_v<vector<uint8_t>::iterator>);
+    static_assert(is_contiguous_v<vector<float>::const_iterator>);
+    static_assert(!is_contiguous_v<deque<uint8_t>::iterator>);
+    static_assert(!is_contiguous_v<vector<bool>::iterator>);
+}
+
+
+TEST_F(GivenACFARAlgorithm, EngineKeepsItsThreadsBetweenRotations)
+{
+    Window          window { 11, 2, 30.0_dB };
+    Engine<uint8_t> engine { window, 2 };
+    vector<uint8_t> rotation(4 * 30, 10);
+    vector<dB>      first(rotation.size());
+    vector<dB>      second(rotation.size());
+
+    rotation[35] = 90;
+
+    engine.process_rotation(rotation.data(), 4, 30, first.data());
+    engine.process_rotation(rotation.data(), 4, 30, second.data());
+
+    ASSERT_EQ(first, second);
+    ASSERT_FLOAT_EQ(first[35], 45.0f);
 }
\ No newline at end of file
@@ -538,4 +538,14 @@ TEST_F(GivenAColossusMessage, IterationOverSignatureBehavesCorrectly)
     for (auto i [[maybe_unused]]: signature) ++count;
     
     ASSERT_EQ(count, 16);
-}
\ No newline at end of file
+}
+
+TEST_F(GivenAColossusMessage, HeaderCanBeInspectedInPlace)
+{
+    using Colossus_protocol::TCP::Message;
+
+    ASSERT_TRUE(Message::is_valid_header(header_and_protobuf.data()));
+    ASSERT_EQ(Message::payload_size(header_and_protobuf.data()), 31);
+
+    ASSERT_FALSE(Message::is_valid_header(message.data()));
+}
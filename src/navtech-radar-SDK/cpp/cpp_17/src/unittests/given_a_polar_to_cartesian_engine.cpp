@@ -0,0 +1,191 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "Polar_to_cartesian.h"
+#include "Polar_coordinate.h"
+#include "Cartesian_coordinate.h"
+
+
+using namespace Navtech;
+using namespace Navtech::Polar_to_cartesian;
+using namespace std;
+
+
+class GivenAPolarToCartesianEngine : public ::testing::Test {
+protected:
+    GivenAPolarToCartesianEngine()
+    {
+        engine.set_azimuths(azimuth_samples);
+        engine.set_ranges(num_bins, metres_per_bin);
+    }
+
+    static constexpr size_t azimuth_samples { 400 };
+    static constexpr size_t num_bins        { 100 };
+    static constexpr float  metres_per_bin  { 0.175f };
+
+    Engine engine { };
+};
+
+
+TEST_F(GivenAPolarToCartesianEngine, DefaultConstructedEngineIsEmpty)
+{
+    Engine empty_engine { };
+    vector<uint8_t> data(10, 255);
+
+    empty_engine.convert(0, data.data(), 0, data.size(), uint8_t { 0 });
+
+    ASSERT_TRUE(empty_engine.empty());
+    ASSERT_EQ(empty_engine.size(), 0);
+    ASSERT_TRUE(empty_engine.release().empty());
+}
+
+
+TEST_F(GivenAPolarToCartesianEngine, PointsMatchPolarCoordinates)
+{
+    vector<uint8_t> data(num_bins, 100);
+
+    for (size_t azimuth { 0 }; azimuth < azimuth_samples; azimuth += 37) {
+        engine.convert(azimuth, data.data(), 0, data.size(), uint8_t { 0 });
+    }
+
+    size_t i { 0 };
+    for (size_t azimuth { 0 }; azimuth < azimuth_samples; azimuth += 37) {
+        for (size_t bin { 0 }; bin < num_bins; ++bin, ++i) {
+            auto bearing  = static_cast<float>(azimuth) / azimuth_samples * 360.0f;
+            auto expected = Polar::Coordinate { bin * metres_per_bin, bearing }.to_cartesian();
+            auto point    = engine[i];
+
+            ASSERT_NEAR(point.x, expected.x, 0.001f);
+            ASSERT_NEAR(point.y, expected.y, 0.001f);
+            ASSERT_FLOAT_EQ(point.z, 0.0f);
+            ASSERT_FLOAT_EQ(point.intensity, 100.0f);
+        }
+    }
+
+    ASSERT_EQ(engine.size(), i);
+}
+
+
+TEST_F(GivenAPolarToCartesianEngine, OnlyBinsAboveThresholdAreKept)
+{
+    vector<uint8_t> data(num_bins, 10);
+    data[5]  = 51;
+    data[6]  = 50;
+    data[40] = 200;
+    data[99] = 60;
+
+    engine.convert(0, data.data(), 0, 60, uint8_t { 50 });
+
+    ASSERT_EQ(engine.size(), 2);
+    ASSERT_FLOAT_EQ(engine[0].intensity, 51.0f);
+    ASSERT_FLOAT_EQ(engine[0].y, 5 * metres_per_bin);
+    ASSERT_FLOAT_EQ(engine[1].intensity, 200.0f);
+    ASSERT_FLOAT_EQ(engine[1].y, 40 * metres_per_bin);
+}
+
+
+TEST_F(GivenAPolarToCartesianEngine, BinsCanBeSelectedByADetectionArray)
+{
+    vector<uint8_t> data(num_bins, 10);
+    vector<uint8_t> detection(num_bins, 0);
+    detection[20] = 1;
+    detection[21] = 1;
+
+    engine.convert(azimuth_samples / 4, data.data(), detection.data(), 0, data.size(), uint8_t { 0 });
+
+    ASSERT_EQ(engine.size(), 2);
+    ASSERT_NEAR(engine[0].x, 20 * metres_per_bin, 0.0001f);
+    ASSERT_NEAR(engine[0].y, 0.0f, 0.0001f);
+    ASSERT_NEAR(engine[1].x, 21 * metres_per_bin, 0.0001f);
+    ASSERT_FLOAT_EQ(engine[1].intensity, 10.0f);
+}
+
+
+TEST_F(GivenAPolarToCartesianEngine, AzimuthOffsetAndOriginMovePoints)
+{
+    vector<float> data(num_bins, 0.0f);
+    data[10] = 1.0f;
+
+    engine.set_azimuths(azimuth_samples, azimuth_samples / 2);
+    engine.set_origin(1.0f, 2.0f);
+    engine.convert(0, data.data(), 0, data.size(), 0.5f);
+
+    ASSERT_EQ(engine.size(), 1);
+    ASSERT_NEAR(engine[0].x, 1.0f, 0.0001f);
+    ASSERT_NEAR(engine[0].y, 2.0f - 10 * metres_per_bin, 0.0001f);
+}
+
+
+TEST_F(GivenAPolarToCartesianEngine, BinsBeyondTheConfiguredRangeAreConverted)
+{
+    vector<uint8_t> data(2 * num_bins, 100);
+
+    engine.convert(0, data.data(), num_bins, data.size(), uint8_t { 0 });
+
+    ASSERT_EQ(engine.size(), num_bins);
+    ASSERT_FLOAT_EQ(engine[num_bins - 1].y, (2 * num_bins - 1) * metres_per_bin);
+}
+
+
+TEST_F(GivenAPolarToCartesianEngine, SingleTargetsCanBeConverted)
+{
+    engine.set_ranges(num_bins, metres_per_bin, 1.5f);
+    engine.convert(azimuth_samples + azimuth_samples / 4, 10.0f, 42.5f);
+
+    ASSERT_EQ(engine.size(), 1);
+    ASSERT_NEAR(engine[0].x, 10.0f, 0.0001f);
+    ASSERT_NEAR(engine[0].y, 0.0f, 0.0001f);
+    ASSERT_FLOAT_EQ(engine[0].intensity, 42.5f);
+}
+
+
+TEST_F(GivenAPolarToCartesianEngine, ReleaseHandsOverTheRotationAsPointCloudBytes)
+{
+    vector<uint8_t> data(num_bins, 100);
+
+    for (size_t azimuth { 0 }; azimuth < azimuth_samples; ++azimuth) {
+        engine.convert(azimuth, data.data(), 0, data.size(), uint8_t { 0 });
+    }
+
+    auto bytes = engine.release();
+
+    ASSERT_EQ(bytes.size(), azimuth_samples * num_bins * 4 * sizeof(float));
+    ASSERT_TRUE(engine.empty());
+
+    float fields[4] { };
+    memcpy(fields, bytes.data() + sizeof(Point), sizeof(fields));
+    ASSERT_FLOAT_EQ(fields[0], 0.0f);
+    ASSERT_FLOAT_EQ(fields[1], metres_per_bin);
+    ASSERT_FLOAT_EQ(fields[2], 0.0f);
+    ASSERT_FLOAT_EQ(fields[3], 100.0f);
+
+    // The next rotation starts from the first point
+    //
+    engine.convert(0, data.data(), 0, 1, uint8_t { 0 });
+    ASSERT_EQ(engine.size(), 1);
+    ASSERT_EQ(engine.release().size(), sizeof(Point));
+}
+
+
+TEST_F(GivenAPolarToCartesianEngine, ASparseRotationDoesNotKeepTheCapacityOfADenseOne)
+{
+    vector<uint8_t> data(num_bins, 100);
+
+    for (size_t azimuth { 0 }; azimuth < azimuth_samples; ++azimuth) {
+        engine.convert(azimuth, data.data(), 0, data.size(), uint8_t { 0 });
+    }
+    engine.release();
+
+    data[0] = 200;
+    for (size_t azimuth { 0 }; azimuth < azimuth_samples; ++azimuth) {
+        engine.convert(azimuth, data.data(), 0, data.size(), uint8_t { 150 });
+    }
+    auto bytes = engine.release();
+
+    ASSERT_EQ(bytes.size(), azimuth_samples * sizeof(Point));
+    ASSERT_LE(bytes.capacity(), 2 * bytes.size());
+}
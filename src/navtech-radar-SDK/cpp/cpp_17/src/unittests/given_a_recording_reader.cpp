@@ -0,0 +1,386 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <zlib.h>
+
+#include "Recording_reader.h"
+#include "Recording_index.h"
+#include "Compression_utils.h"
+#include "Colossus_TCP_network_message.h"
+#include "Colossus_TCP_messages.h"
+#include "net_conversion.h"
+#include "Time_utils.h"
+
+
+using namespace Navtech;
+using namespace Navtech::Networking;
+using namespace Navtech::Networking::Offline;
+using namespace Navtech::Utility::Compression;
+using namespace std;
+
+namespace fs = std::filesystem;
+
+
+class GivenARecordingReader : public ::testing::Test {
+protected:
+    GivenARecordingReader()
+    {
+        for (size_t i { 0 }; i < num_records; ++i) {
+            messages.push_back(make_message(i));
+        }
+    }
+
+    ~GivenARecordingReader()
+    {
+        for (auto& path : { radar_path, colraw_path }) {
+            error_code err { };
+            fs::remove(path, err);
+            fs::remove(Recording_index::cache_path(path), err);
+        }
+    }
+
+    // Every third message is a keep-alive (which has no timestamp);
+    // the rest are FFTs, 10ms apart.
+    //
+    static bool is_fft(size_t i)        { return (i % 3) != 0; }
+    static bool is_compressed(size_t i) { return (i % 2) != 0; }
+
+    static Time::Real_time::Observation time_of(size_t i)
+    {
+        return start_time + Time::Duration { static_cast<Time::Tick_type>(i) * 10'000 };
+    }
+
+    vector<uint8_t> make_message(size_t i) const
+    {
+        using namespace Colossus_protocol;
+
+        TCP::Message msg { };
+
+        if (is_fft(i)) {
+            TCP::FFT_data fft { };
+            fft.azimuth(static_cast<uint16_t>(i));
+            fft.sweep_counter(static_cast<uint16_t>(i));
+            fft.timestamp(time_of(i));
+
+            msg.type(TCP::Type::fft_data);
+            msg.append(fft);
+            msg.append(vector<uint8_t>(200 + i, static_cast<uint8_t>(i)));
+        }
+        else {
+            msg.type(TCP::Type::keep_alive);
+        }
+
+        return msg.relinquish();
+    }
+
+    // Compressed records hold a 13-byte record header ahead of the message
+    //
+    static vector<uint8_t> compress(const vector<uint8_t>& msg, int wbits)
+    {
+        vector<uint8_t> in(Recording_index::inflated_header_size + msg.size(), 0xAA);
+        copy(msg.begin(), msg.end(), in.begin() + Recording_index::inflated_header_size);
+
+        z_stream stream { };
+        deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, wbits, 8, Z_DEFAULT_STRATEGY);
+
+        vector<uint8_t> out(deflateBound(&stream, static_cast<uLong>(in.size())));
+        stream.next_in   = in.data();
+        stream.avail_in  = static_cast<uInt>(in.size());
+        stream.next_out  = out.data();
+        stream.avail_out = static_cast<uInt>(out.size());
+
+        deflate(&stream, Z_FINISH);
+        out.resize(stream.total_out);
+        deflateEnd(&stream);
+
+        return out;
+    }
+
+    static void write_uint32(ofstream& file, uint32_t value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void write_radar(size_t truncate_by = 0) const
+    {
+        ofstream file { radar_path, ios::binary | ios::trunc };
+
+        // Metadata: size (including itself) then start/end dates,
+        // start/end ticks and radar IP address
+        //
+        write_uint32(file, to_uint32_network(static_cast<uint32_t>(sizeof(uint32_t) + Metadata::size())));
+        vector<uint8_t> metadata(Metadata::size(), 0);
+        file.write(reinterpret_cast<const char*>(metadata.data()), metadata.size());
+
+        for (size_t i { 0 }; i < num_records; ++i) {
+            auto type   = is_compressed(i) ? uint8_t { 255 } : messages[i][17];
+            auto stored = is_compressed(i) ? compress(messages[i], ZLIB::window_bits) : messages[i];
+
+            auto length = static_cast<uint32_t>(stored.size());
+
+            if (i == num_records - 1) stored.resize(stored.size() - truncate_by);
+
+            file.put(static_cast<char>(type));
+            file.write("timestmp", 8);
+            write_uint32(file, to_uint32_network(length));
+            file.write(reinterpret_cast<const char*>(stored.data()), stored.size());
+        }
+    }
+
+    void write_colraw() const
+    {
+        ofstream file { colraw_path, ios::binary | ios::trunc };
+
+        for (size_t i { 0 }; i < num_records; ++i) {
+            auto type   = is_compressed(i) ? uint8_t { 255 } : messages[i][17];
+            auto stored = is_compressed(i) ? compress(messages[i], GZIP::window_bits) : messages[i];
+
+            write_uint32(file, static_cast<uint32_t>(stored.size()));
+            file.put(static_cast<char>(type));
+            write_uint32(file, 0);
+            write_uint32(file, 0);
+            file.write(reinterpret_cast<const char*>(stored.data()), stored.size());
+        }
+    }
+
+    static constexpr size_t num_records { 300 };
+    static inline const Time::Real_time::Observation start_time { static_cast<time_t>(1'700'000'000) };
+
+    const string radar_path  { (fs::temp_directory_path() / "given_a_recording_reader.radar").string() };
+    const string colraw_path { (fs::temp_directory_path() / "given_a_recording_reader.colraw").string() };
+
+    vector<vector<uint8_t>> messages { };
+};
+
+
+TEST_F(GivenARecordingReader, EveryRecordIsIndexed)
+{
+    write_radar();
+
+    Recording_reader reader { 2 };
+    reader.open(radar_path, File_format::radar);
+
+    auto& index = reader.index();
+
+    ASSERT_EQ(index.size(), num_records);
+    for (size_t i { 0 }; i < num_records; ++i) {
+        ASSERT_EQ(index[i].type, messages[i][17]);
+        ASSERT_EQ(index[i].compressed, is_compressed(i));
+    }
+}
+
+
+TEST_F(GivenARecordingReader, RecordsWithoutATimestampTakeThePreviousOne)
+{
+    write_radar();
+
+    Recording_reader reader { 2 };
+    reader.open(radar_path, File_format::radar);
+
+    auto& index = reader.index();
+
+    // The first record is a keep-alive, so takes the time of the first FFT
+    //
+    ASSERT_EQ(index.time_of(0), time_of(1));
+    ASSERT_EQ(index.time_of(1), time_of(1));
+    ASSERT_EQ(index.time_of(3), time_of(2));
+    ASSERT_EQ(index.time_of(4), time_of(4));
+    ASSERT_EQ(index.start_time(), time_of(1));
+    ASSERT_EQ(index.end_time(), time_of(num_records - 1));
+}
+
+
+TEST_F(GivenARecordingReader, MessagesAreReadInOrder)
+{
+    write_radar();
+
+    Recording_reader reader { 3 };
+    reader.open(radar_path, File_format::radar);
+
+    ASSERT_TRUE(reader.metadata().has_value());
+
+    Recording_reader::Buffer buffer { };
+
+    for (size_t i { 0 }; i < num_records; ++i) {
+        ASSERT_EQ(reader.position(), i);
+        ASSERT_TRUE(reader.next(buffer));
+        ASSERT_EQ(buffer, messages[i]);
+    }
+
+    ASSERT_FALSE(reader.next(buffer));
+}
+
+
+TEST_F(GivenARecordingReader, SeekingToATimeFindsTheFirstRecordAtOrAfterIt)
+{
+    write_radar();
+
+    Recording_reader reader { 2 };
+    reader.open(radar_path, File_format::radar);
+
+    Recording_reader::Buffer buffer { };
+
+    reader.seek(time_of(100) - Time::Duration { 1 });
+    ASSERT_EQ(reader.position(), 100);
+    ASSERT_TRUE(reader.next(buffer));
+    ASSERT_EQ(buffer, messages[100]);
+
+    // Record 150 is a keep-alive, which shares its time with record 149
+    //
+    reader.seek(time_of(150));
+    ASSERT_EQ(reader.position(), 151);
+    ASSERT_TRUE(reader.next(buffer));
+    ASSERT_EQ(buffer, messages[151]);
+
+    reader.seek(Time::Duration { 499 * 10'000 });
+    ASSERT_EQ(reader.position(), num_records);
+    ASSERT_FALSE(reader.next(buffer));
+}
+
+
+TEST_F(GivenARecordingReader, SeekingBackDiscardsTheReadAhead)
+{
+    write_radar();
+
+    Recording_reader reader { 4 };
+    reader.open(radar_path, File_format::radar);
+
+    Recording_reader::Buffer buffer { };
+
+    for (size_t i { 0 }; i < 20; ++i) reader.next(buffer);
+
+    for (size_t record : { size_t { 5 }, size_t { 250 }, size_t { 0 } }) {
+        reader.seek(record);
+
+        for (auto i { record }; i < std::min(record + 70, num_records); ++i) {
+            ASSERT_TRUE(reader.next(buffer));
+            ASSERT_EQ(buffer, messages[i]);
+        }
+    }
+}
+
+
+TEST_F(GivenARecordingReader, TheIndexIsCachedBesideTheRecording)
+{
+    write_radar();
+
+    {
+        Recording_reader reader { 1 };
+        reader.open(radar_path, File_format::radar);
+    }
+
+    ASSERT_TRUE(fs::exists(Recording_index::cache_path(radar_path)));
+
+    auto cached = Recording_index::load(radar_path, File_format::radar);
+    auto built  = Recording_index::build(Utility::Mapped_file { radar_path }, File_format::radar);
+
+    ASSERT_TRUE(cached.has_value());
+    ASSERT_EQ(cached->size(), built.size());
+    for (size_t i { 0 }; i < built.size(); ++i) {
+        ASSERT_EQ((*cached)[i].offset, built[i].offset);
+        ASSERT_EQ((*cached)[i].time,   built[i].time);
+        ASSERT_EQ((*cached)[i].size,   built[i].size);
+        ASSERT_EQ((*cached)[i].type,   built[i].type);
+    }
+
+    // A cached index is only valid for the same recording and format
+    //
+    ASSERT_FALSE(Recording_index::load(radar_path, File_format::colraw).has_value());
+
+    ofstream { radar_path, ios::binary | ios::app }.put(0);
+    ASSERT_FALSE(Recording_index::load(radar_path, File_format::radar).has_value());
+}
+
+
+TEST_F(GivenARecordingReader, ATruncatedFinalRecordIsIgnored)
+{
+    write_radar(10);
+
+    Recording_reader reader { 2 };
+    reader.open(radar_path, File_format::radar);
+
+    ASSERT_EQ(reader.index().size(), num_records - 1);
+}
+
+
+TEST_F(GivenARecordingReader, ColrawRecordingsCanBeRead)
+{
+    write_colraw();
+
+    Recording_reader reader { 2 };
+    reader.open(colraw_path, File_format::colraw);
+
+    ASSERT_FALSE(reader.metadata().has_value());
+    ASSERT_EQ(reader.index().size(), num_records);
+
+    Recording_reader::Buffer buffer { };
+
+    reader.seek(time_of(61));
+    for (size_t i { 61 }; i < num_records; ++i) {
+        ASSERT_TRUE(reader.next(buffer));
+        ASSERT_EQ(buffer, messages[i]);
+    }
+}
+
+
+TEST_F(GivenARecordingReader, BadMetadataFailsToOpen)
+{
+    {
+        ofstream file { radar_path, ios::binary | ios::trunc };
+        write_uint32(file, to_uint32_network(uint32_t { 12 }));
+        write_uint32(file, 0);
+        write_uint32(file, 0);
+    }
+
+    Recording_reader reader { 1 };
+
+    ASSERT_THROW(reader.open(radar_path, File_format::radar), std::system_error);
+    ASSERT_THROW(reader.open(radar_path + ".missing", File_format::radar), std::system_error);
+    ASSERT_FALSE(reader.is_open());
+}
+
+
+TEST_F(GivenARecordingReader, AnInflaterCanStopAfterAHeader)
+{
+    auto compressed = compress(messages[1], ZLIB::window_bits);
+
+    Inflater inflater { ZLIB::window_bits };
+    vector<uint8_t> out { };
+
+    ASSERT_TRUE(inflater.decompress(compressed.data(), compressed.size(), out, 20));
+    ASSERT_EQ(out.size(), 20);
+
+    ASSERT_TRUE(inflater.decompress(compressed.data(), compressed.size(), out));
+    ASSERT_EQ(out.size(), Recording_index::inflated_header_size + messages[1].size());
+    ASSERT_TRUE(equal(messages[1].begin(), messages[1].end(), out.begin() + Recording_index::inflated_header_size));
+
+    ASSERT_FALSE(inflater.decompress(compressed.data(), compressed.size() / 2, out));
+}
+
+
+TEST_F(GivenARecordingReader, AnInflaterCanSkipAHeader)
+{
+    auto compressed = compress(messages[1], ZLIB::window_bits);
+
+    Inflater inflater { ZLIB::window_bits };
+    vector<uint8_t> out { };
+
+    ASSERT_TRUE(inflater.decompress_after(Recording_index::inflated_header_size, compressed.data(), compressed.size(), out));
+    ASSERT_EQ(out, messages[1]);
+
+    auto inflated_size = Recording_index::inflated_header_size + messages[1].size();
+
+    ASSERT_TRUE(inflater.decompress_after(inflated_size, compressed.data(), compressed.size(), out));
+    ASSERT_TRUE(out.empty());
+
+    ASSERT_FALSE(inflater.decompress_after(inflated_size + 1, compressed.data(), compressed.size(), out));
+    ASSERT_FALSE(inflater.decompress_after(Recording_index::inflated_header_size, compressed.data(), compressed.size() / 2, out));
+}
@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "Shape_extraction.h"
+
+using namespace Navtech::Shape_extraction;
+using namespace std;
+
+
+class GivenAShapeExtractionEngine : public ::testing::Test {
+protected:
+    GivenAShapeExtractionEngine() = default;
+
+    static Grid to_grid(const vector<vector<float>>& data)
+    {
+        Grid grid { data.size() };
+        for (size_t row { 0 }; row < data.size(); ++row) {
+            grid.set_row(row, data[row].data(), data[row].data() + data[row].size());
+        }
+        return grid;
+    }
+
+    // Cells, mass and column centre of each shape, by flood fill; in
+    // no particular order.
+    //
+    static vector<tuple<size_t, float, float>> flood_fill(const vector<vector<float>>& data)
+    {
+        vector<tuple<size_t, float, float>> shapes { };
+
+        auto rows = static_cast<int>(data.size());
+        auto cols = static_cast<int>(data[0].size());
+        vector<vector<bool>> visited(rows, vector<bool>(cols, false));
+
+        for (int r { 0 }; r < rows; ++r) {
+            for (int c { 0 }; c < cols; ++c) {
+                if (data[r][c] == 0.0f || visited[r][c]) continue;
+
+                size_t cells { 0 };
+                double mass  { 0.0 };
+                double col   { 0.0 };
+
+                deque<pair<int, int>> to_visit { { r, c } };
+                visited[r][c] = true;
+
+                while (!to_visit.empty()) {
+                    auto [vr, vc] = to_visit.front();
+                    to_visit.pop_front();
+
+                    ++cells;
+                    mass += data[vr][vc];
+                    col  += data[vr][vc] * vc;
+
+                    for (auto [dr, dc] : { pair { 0, 1 }, pair { 1, 0 }, pair { 0, -1 }, pair { -1, 0 } }) {
+                        int nr = (vr + dr + rows) % rows;
+                        int nc = vc + dc;
+                        if (nc < 0 || nc >= cols || data[nr][nc] == 0.0f || visited[nr][nc]) continue;
+                        visited[nr][nc] = true;
+                        to_visit.emplace_back(nr, nc);
+                    }
+                }
+
+                if (cells > 1) shapes.emplace_back(cells, static_cast<float>(mass), static_cast<float>(col / mass));
+            }
+        }
+
+        return shapes;
+    }
+
+    static vector<vector<float>> random_blobs(size_t rows, size_t cols, size_t num_blobs, unsigned seed)
+    {
+        vector<vector<float>> data(rows, vector<float>(cols, 0.0f));
+
+        mt19937 generator { seed };
+        uniform_int_distribution<size_t> row_dist  { 0, rows - 1 };
+        uniform_int_distribution<size_t> col_dist  { 0, cols - 8 };
+        uniform_int_distribution<int>    size_dist { 1, 6 };
+        uniform_real_distribution<float> value     { 1.0f, 50.0f };
+
+        for (size_t blob { 0 }; blob < num_blobs; ++blob) {
+            auto row    = row_dist(generator);
+            auto col    = col_dist(generator);
+            auto height = size_dist(generator);
+            auto width  = size_dist(generator);
+
+            for (int r { 0 }; r < height; ++r) {
+                for (int c { 0 }; c < width; ++c) {
+                    if (generator() % 4 == 0) continue;
+                    data[(row + r) % rows][col + c] = value(generator);
+                }
+            }
+        }
+
+        return data;
+    }
+};
+
+
+TEST_F(GivenAShapeExtractionEngine, RowsAreHeldAsRuns)
+{
+    vector<float> row { 0.0f, 2.0f, 4.0f, 0.0f, 0.0f, 1.0f, NAN, 3.0f };
+    Grid grid { 2 };
+
+    grid.set_row(1, row.data(), row.data() + row.size(), 10);
+
+    ASSERT_TRUE(grid[0].empty());
+    ASSERT_EQ(grid[1].size(), 3);
+    ASSERT_EQ(grid.num_runs(), 3);
+
+    ASSERT_EQ(grid[1][0].first, 11);
+    ASSERT_EQ(grid[1][0].last, 13);
+    ASSERT_FLOAT_EQ(grid[1][0].mass, 6.0f);
+    ASSERT_FLOAT_EQ(grid[1][0].moment, 2.0f * 11 + 4.0f * 12);
+
+    ASSERT_EQ(grid[1][1].first, 15);
+    ASSERT_EQ(grid[1][1].last, 16);
+    ASSERT_EQ(grid[1][2].first, 17);
+
+    grid.clear_row(1);
+    ASSERT_EQ(grid.num_runs(), 0);
+}
+
+
+TEST_F(GivenAShapeExtractionEngine, MultipleUnbalancedShapesShouldBeFound)
+{
+    vector<vector<float>> data {
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 6.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 6.0f, 6.0f, 0.0f, 15.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 6.0f, 8.0f, 0.0f, 12.0f, 0.0f, 12.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 8.0f, 0.0f, 12.0f, 15.0f, 12.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 6.0f, 0.0f, 0.0f, 0.0f, 15.0f, 0.0f, 0.0f, 0.0f, 5.0f, 5.0f },
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 15.0f, 0.0f, 0.0f, 0.0f, 8.0f, 5.0f },
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 8.0f, 8.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 8.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f }
+    };
+
+    Engine engine { };
+
+    auto& shapes = engine.find_shapes(to_grid(data));
+
+    ASSERT_EQ(shapes.size(), 3);
+
+    ASSERT_FLOAT_EQ(shapes[0].row, 2.913043f);
+    ASSERT_FLOAT_EQ(shapes[0].col, 1.608696f);
+
+    ASSERT_FLOAT_EQ(shapes[1].row, 3.916667f);
+    ASSERT_FLOAT_EQ(shapes[1].col, 5.138889f);
+
+    ASSERT_FLOAT_EQ(shapes[2].row, 6.468085f);
+    ASSERT_FLOAT_EQ(shapes[2].col, 10.042553f);
+}
+
+
+TEST_F(GivenAShapeExtractionEngine, SingleCellsAreIgnored)
+{
+    vector<vector<float>> data {
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 0.0f, 5.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 0.0f, 5.0f, 0.0f },
+    };
+
+    Engine engine { };
+
+    auto& shapes = engine.find_shapes(to_grid(data));
+
+    ASSERT_EQ(shapes.size(), 1);
+    ASSERT_EQ(shapes[0].cells, 2);
+    ASSERT_FLOAT_EQ(shapes[0].row, 2.5f);
+    ASSERT_FLOAT_EQ(shapes[0].col, 4.0f);
+}
+
+
+TEST_F(GivenAShapeExtractionEngine, ShapesShouldWrapCorrectly)
+{
+    vector<vector<float>> data {
+        { 0.0f, 2.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f }
+    };
+
+    Engine engine { };
+
+    auto& shapes = engine.find_shapes(to_grid(data));
+
+    ASSERT_EQ(shapes.size(), 1);
+    ASSERT_FLOAT_EQ(shapes[0].row, -0.2f);
+    ASSERT_FLOAT_EQ(shapes[0].col, 1.2f);
+}
+
+
+TEST_F(GivenAShapeExtractionEngine, ShapesJoinedOnlyBelowAreOneShape)
+{
+    // A U shape; its arms are only joined in the last row
+    //
+    vector<vector<float>> data {
+        { 1.0f, 0.0f, 1.0f },
+        { 1.0f, 0.0f, 1.0f },
+        { 1.0f, 1.0f, 1.0f },
+        { 0.0f, 0.0f, 0.0f },
+    };
+
+    Engine engine { };
+
+    auto& shapes = engine.find_shapes(to_grid(data));
+
+    ASSERT_EQ(shapes.size(), 1);
+    ASSERT_EQ(shapes[0].cells, 7);
+    ASSERT_FLOAT_EQ(shapes[0].col, 1.0f);
+}
+
+
+TEST_F(GivenAShapeExtractionEngine, ShapesMatchAFloodFill)
+{
+    auto data = random_blobs(400, 300, 300, 7);
+
+    Engine engine { };
+    auto shapes   = engine.find_shapes(to_grid(data));
+    auto expected = flood_fill(data);
+
+    ASSERT_EQ(shapes.size(), expected.size());
+
+    vector<tuple<size_t, float, float>> found { };
+    for (auto& shape : shapes) found.emplace_back(shape.cells, shape.mass, shape.col);
+
+    sort(found.begin(), found.end());
+    sort(expected.begin(), expected.end());
+
+    for (size_t i { 0 }; i < found.size(); ++i) {
+        ASSERT_EQ(get<0>(found[i]), get<0>(expected[i]));
+        ASSERT_NEAR(get<1>(found[i]), get<1>(expected[i]), 0.01f);
+        ASSERT_NEAR(get<2>(found[i]), get<2>(expected[i]), 0.001f);
+    }
+}
+
+
+TEST_F(GivenAShapeExtractionEngine, SectorsGiveTheSameShapesAsOneThread)
+{
+    auto data = random_blobs(400, 2856, 6000, 11);
+    auto grid = to_grid(data);
+
+    Engine single_thread { 1 };
+    Engine four_threads  { 4 };
+
+    auto& expected = single_thread.find_shapes(grid);
+
+    ASSERT_GT(grid.num_runs(), 4 * 4096);
+
+    // The engine's threads are kept between grids
+    //
+    for (int run { 0 }; run < 3; ++run) {
+        auto& shapes = four_threads.find_shapes(grid);
+
+        ASSERT_EQ(shapes.size(), expected.size());
+
+        for (size_t i { 0 }; i < shapes.size(); ++i) {
+            ASSERT_EQ(shapes[i].cells, expected[i].cells);
+            ASSERT_FLOAT_EQ(shapes[i].row, expected[i].row);
+            ASSERT_FLOAT_EQ(shapes[i].col, expected[i].col);
+        }
+    }
+}
+
+
+TEST_F(GivenAShapeExtractionEngine, AnEmptyGridHasNoShapes)
+{
+    Engine engine { 4 };
+
+    ASSERT_TRUE(engine.find_shapes(Grid { }).empty());
+    ASSERT_TRUE(engine.find_shapes(Grid { 400 }).empty());
+}
@@ -0,0 +1,127 @@
+#include <cstdint>
+#include <vector>
+#include <numeric>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "Stream_buffer.h"
+
+
+using Navtech::Utility::Stream_buffer;
+using namespace std;
+
+
+class GivenAStreamBuffer : public ::testing::Test {
+protected:
+    GivenAStreamBuffer()
+    {
+        iota(stream.begin(), stream.end(), 0);
+    }
+
+    // Reads from stream, no more than chunk_sz bytes at a time
+    //
+    size_t read(uint8_t* into, size_t max_bytes)
+    {
+        auto num_bytes = min({ max_bytes, chunk_sz, stream.size() - stream_pos });
+        copy_n(stream.begin() + stream_pos, num_bytes, into);
+        stream_pos += num_bytes;
+        ++num_reads;
+        return num_bytes;
+    }
+
+    auto reader() { return [this](uint8_t* into, size_t max_bytes) { return read(into, max_bytes); }; }
+
+    vector<uint8_t> stream     = vector<uint8_t>(200);
+    size_t          stream_pos { 0 };
+    size_t          chunk_sz   { 200 };
+    size_t          num_reads  { 0 };
+};
+
+
+TEST_F(GivenAStreamBuffer, DefaultConstructedBufferIsEmpty)
+{
+    Stream_buffer buffer { };
+
+    ASSERT_TRUE(buffer.empty());
+    ASSERT_EQ(buffer.size(), 0);
+}
+
+
+TEST_F(GivenAStreamBuffer, FillReadsAsMuchAsIsAvailable)
+{
+    Stream_buffer buffer { 64 };
+
+    auto sz = buffer.fill(10, reader());
+
+    ASSERT_EQ(sz, 64);
+    ASSERT_EQ(num_reads, 1);
+    ASSERT_EQ(*buffer.begin(), 0);
+    ASSERT_EQ(*(buffer.end() - 1), 63);
+}
+
+
+TEST_F(GivenAStreamBuffer, FillDoesNotReadIfEnoughBytesAreBuffered)
+{
+    Stream_buffer buffer { 64 };
+
+    buffer.fill(10, reader());
+    buffer.consume(20);
+    buffer.fill(44, reader());
+
+    ASSERT_EQ(num_reads, 1);
+    ASSERT_EQ(*buffer.begin(), 20);
+}
+
+
+TEST_F(GivenAStreamBuffer, FillReadsRepeatedlyUntilMinimumIsReached)
+{
+    Stream_buffer buffer { 64 };
+    chunk_sz = 7;
+
+    buffer.fill(30, reader());
+
+    ASSERT_EQ(buffer.size(), 35);
+    ASSERT_EQ(num_reads, 5);
+}
+
+
+TEST_F(GivenAStreamBuffer, UnreadBytesRemainContiguousAcrossTheEndOfStorage)
+{
+    Stream_buffer buffer { 64 };
+
+    buffer.fill(64, reader());
+    buffer.consume(60);
+    buffer.fill(20, reader());
+
+    ASSERT_GE(buffer.size(), 20);
+    ASSERT_EQ(buffer.capacity(), 64);
+    
+    for (uint8_t i { 0 }; i < 20; ++i) {
+        ASSERT_EQ(buffer.begin()[i], 60 + i);
+    }
+}
+
+
+TEST_F(GivenAStreamBuffer, StorageGrowsForAnOversizedMessage)
+{
+    Stream_buffer buffer { 64 };
+
+    buffer.fill(150, reader());
+
+    ASSERT_EQ(buffer.capacity(), 150);
+    ASSERT_EQ(buffer.size(), 150);
+    ASSERT_EQ(*(buffer.end() - 1), 149);
+}
+
+
+TEST_F(GivenAStreamBuffer, ConsumingEverythingEmptiesTheBuffer)
+{
+    Stream_buffer buffer { 64 };
+
+    buffer.fill(10, reader());
+    buffer.consume(100);
+
+    ASSERT_TRUE(buffer.empty());
+    ASSERT_EQ(buffer.capacity(), 64);
+}
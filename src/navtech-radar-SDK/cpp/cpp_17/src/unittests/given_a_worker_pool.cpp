@@ -0,0 +1,108 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "Worker_pool.h"
+
+using namespace Navtech;
+using namespace Navtech::Utility;
+using namespace std;
+
+
+class GivenAWorkerPool : public ::testing::Test {
+protected:
+    GivenAWorkerPool() = default;
+};
+
+
+TEST_F(GivenAWorkerPool, DefaultPoolRunsOnTheCallingThread)
+{
+    Worker_pool pool { };
+    thread::id  ran_on { };
+
+    pool.run(1, [&ran_on](size_t) { ran_on = this_thread::get_id(); });
+
+    ASSERT_EQ(pool.size(), 1);
+    ASSERT_EQ(ran_on, this_thread::get_id());
+}
+
+
+TEST_F(GivenAWorkerPool, EachJobRunsOnce)
+{
+    Worker_pool         pool { 4 };
+    vector<atomic<int>> runs(4);
+
+    for (int run { 0 }; run < 100; ++run) {
+        pool.run(4, [&runs](size_t job) { ++runs[job]; });
+    }
+
+    for (auto& count : runs) ASSERT_EQ(count.load(), 100);
+}
+
+
+TEST_F(GivenAWorkerPool, ThreadsAreKeptBetweenRuns)
+{
+    Worker_pool        pool { 3 };
+    vector<thread::id> first(3);
+    vector<thread::id> second(3);
+
+    pool.run(3, [&first](size_t job)  { first[job]  = this_thread::get_id(); });
+    pool.run(3, [&second](size_t job) { second[job] = this_thread::get_id(); });
+
+    ASSERT_EQ(first, second);
+    ASSERT_EQ(set<thread::id>(first.begin(), first.end()).size(), 3);
+    ASSERT_EQ(first[0], this_thread::get_id());
+}
+
+
+TEST_F(GivenAWorkerPool, FewerJobsThanWorkers)
+{
+    Worker_pool         pool { 4 };
+    vector<atomic<int>> runs(4);
+
+    pool.run(2, [&runs](size_t job) { ++runs[job]; });
+    pool.run(4, [&runs](size_t job) { ++runs[job]; });
+
+    ASSERT_EQ(runs[0].load(), 2);
+    ASSERT_EQ(runs[1].load(), 2);
+    ASSERT_EQ(runs[2].load(), 1);
+    ASSERT_EQ(runs[3].load(), 1);
+}
+
+
+TEST_F(GivenAWorkerPool, PoolCanBeResized)
+{
+    Worker_pool         pool { 2 };
+    vector<atomic<int>> runs(3);
+
+    pool.run(2, [&runs](size_t job) { ++runs[job]; });
+    pool.set_workers(3);
+    pool.run(3, [&runs](size_t job) { ++runs[job]; });
+
+    ASSERT_EQ(pool.size(), 3);
+    ASSERT_EQ(runs[0].load(), 2);
+    ASSERT_EQ(runs[1].load(), 2);
+    ASSERT_EQ(runs[2].load(), 1);
+}
+
+
+TEST_F(GivenAWorkerPool, ExceptionFromAWorkerIsRethrown)
+{
+    Worker_pool pool { 2 };
+
+    ASSERT_THROW(
+        pool.run(2, [](size_t job) { if (job == 1) throw runtime_error { "job failed" }; }),
+        runtime_error
+    );
+
+    // The pool is still usable
+    //
+    atomic<int> runs { };
+    pool.run(2, [&runs](size_t) { ++runs; });
+    ASSERT_EQ(runs.load(), 2);
+}
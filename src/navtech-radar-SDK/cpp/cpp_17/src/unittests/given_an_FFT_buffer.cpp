@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "FFT_Buffer.h"
+
+
+using namespace Navtech::Navigation;
+using namespace std;
+
+
+class GivenAnFFTBuffer : public ::testing::Test {
+protected:
+    GivenAnFFTBuffer()
+    {
+        mt19937 generator { 42 };
+        uniform_int_distribution<int> values { 0, 255 };
+
+        for (auto& r : rows) {
+            r.resize(num_bins);
+            generate(r.begin(), r.end(), [&] { return static_cast<uint8_t>(values(generator)); });
+        }
+    }
+
+    // Reference results, over rows [first, last)
+    //
+    vector<float> average_of(size_t first, size_t last) const
+    {
+        vector<float> result(num_bins);
+        for (size_t bin { 0 }; bin < num_bins; ++bin) {
+            double total { 0.0 };
+            for (auto r { first }; r < last; ++r) total += pow(10.0, rows[r][bin] * 0.5 / 10.0);
+            result[bin] = static_cast<float>(log10(total / (last - first)) * 10.0);
+        }
+        return result;
+    }
+
+    vector<float> max_of(size_t first, size_t last) const
+    {
+        vector<float> result(num_bins);
+        for (size_t bin { 0 }; bin < num_bins; ++bin) {
+            uint8_t max { 0 };
+            for (auto r { first }; r < last; ++r) max = std::max(max, rows[r][bin]);
+            result[bin] = max * 0.5f;
+        }
+        return result;
+    }
+
+    static constexpr size_t num_bins { 64 };
+    static constexpr size_t num_rows { 50 };
+
+    vector<vector<uint8_t>> rows = vector<vector<uint8_t>>(num_rows);
+};
+
+
+TEST_F(GivenAnFFTBuffer, RowsAreConvertedToDBWhenBufferingIsOff)
+{
+    FFT_Buffer buffer { Buffer_mode::off, 10 };
+
+    auto out = buffer.process_fft(rows[0]);
+
+    ASSERT_TRUE(out.has_value());
+    ASSERT_EQ(out->size(), num_bins);
+    for (size_t bin { 0 }; bin < num_bins; ++bin) {
+        ASSERT_FLOAT_EQ((*out)[bin], rows[0][bin] * 0.5f);
+    }
+}
+
+
+TEST_F(GivenAnFFTBuffer, BlockAverageIsTheMeanPowerOfEachBlock)
+{
+    const size_t samples { 8 };
+    FFT_Buffer buffer { Buffer_mode::average, samples };
+
+    for (size_t r { 0 }; r < 3 * samples; ++r) {
+        auto out = buffer.process_fft(rows[r]);
+
+        ASSERT_EQ(out.has_value(), (r + 1) % samples == 0);
+        if (!out.has_value()) continue;
+
+        auto expected = average_of(r + 1 - samples, r + 1);
+        for (size_t bin { 0 }; bin < num_bins; ++bin) {
+            ASSERT_NEAR((*out)[bin], expected[bin], 0.001f);
+        }
+    }
+}
+
+
+TEST_F(GivenAnFFTBuffer, SlidingAverageIsTheMeanPowerOfTheLastRows)
+{
+    const size_t samples { 7 };
+    FFT_Buffer buffer { Buffer_mode::average, samples, Buffer_window::sliding };
+    vector<float> out(num_bins);
+
+    for (size_t r { 0 }; r < num_rows; ++r) {
+        bool has_result = buffer.process_fft(rows[r].data(), rows[r].data() + num_bins, out.data());
+
+        ASSERT_EQ(has_result, r + 1 >= samples);
+        if (!has_result) continue;
+
+        auto expected = average_of(r + 1 - samples, r + 1);
+        for (size_t bin { 0 }; bin < num_bins; ++bin) {
+            ASSERT_NEAR(out[bin], expected[bin], 0.001f);
+        }
+    }
+}
+
+
+TEST_F(GivenAnFFTBuffer, BlockMaxIsTheMaximumOfEachBin)
+{
+    const size_t samples { 5 };
+    FFT_Buffer buffer { Buffer_mode::max, samples };
+
+    for (size_t r { 0 }; r < 4 * samples; ++r) {
+        auto out = buffer.process_fft(rows[r]);
+
+        ASSERT_EQ(out.has_value(), (r + 1) % samples == 0);
+        if (out.has_value()) {
+            ASSERT_EQ(*out, max_of(r + 1 - samples, r + 1));
+        }
+    }
+}
+
+
+TEST_F(GivenAnFFTBuffer, SlidingMaxIsTheMaximumOfTheLastRows)
+{
+    const size_t samples { 6 };
+    FFT_Buffer buffer { Buffer_mode::max, samples, Buffer_window::sliding };
+    vector<double> out(num_bins);
+
+    for (size_t r { 0 }; r < num_rows; ++r) {
+        bool has_result = buffer.process_fft(rows[r].data(), rows[r].data() + num_bins, out.data());
+
+        ASSERT_EQ(has_result, r + 1 >= samples);
+        if (!has_result) continue;
+
+        auto expected = max_of(r + 1 - samples, r + 1);
+        for (size_t bin { 0 }; bin < num_bins; ++bin) {
+            ASSERT_DOUBLE_EQ(out[bin], expected[bin]);
+        }
+    }
+}
+
+
+TEST_F(GivenAnFFTBuffer, FloatRowsAreInDB)
+{
+    FFT_Buffer buffer { Buffer_mode::average, 2 };
+
+    ASSERT_FALSE(buffer.process_fft(vector<float>(num_bins, 30.0f)).has_value());
+    auto out = buffer.process_fft(vector<float>(num_bins, 30.0f));
+
+    ASSERT_TRUE(out.has_value());
+    ASSERT_NEAR((*out)[0], 30.0f, 0.0001f);
+}
+
+
+TEST_F(GivenAnFFTBuffer, ARowOfADifferentSizeRestartsBuffering)
+{
+    FFT_Buffer buffer { Buffer_mode::max, 2, Buffer_window::sliding };
+
+    ASSERT_FALSE(buffer.process_fft(rows[0]).has_value());
+    ASSERT_TRUE(buffer.process_fft(rows[1]).has_value());
+    ASSERT_FALSE(buffer.process_fft(vector<uint8_t>(num_bins / 2, 10)).has_value());
+
+    auto out = buffer.process_fft(vector<uint8_t>(num_bins / 2, 20));
+
+    ASSERT_TRUE(out.has_value());
+    ASSERT_EQ(out->size(), num_bins / 2);
+    ASSERT_FLOAT_EQ((*out)[0], 10.0f);
+}
+
+
+TEST_F(GivenAnFFTBuffer, ClearRestartsBuffering)
+{
+    FFT_Buffer buffer { Buffer_mode::average, 3, Buffer_window::sliding };
+
+    for (size_t r { 0 }; r < 4; ++r) buffer.process_fft(rows[r]);
+    buffer.clear();
+
+    ASSERT_FALSE(buffer.process_fft(rows[10]).has_value());
+    ASSERT_FALSE(buffer.process_fft(rows[11]).has_value());
+
+    auto out      = buffer.process_fft(rows[12]);
+    auto expected = average_of(10, 13);
+
+    ASSERT_TRUE(out.has_value());
+    for (size_t bin { 0 }; bin < num_bins; ++bin) {
+        ASSERT_NEAR((*out)[bin], expected[bin], 0.001f);
+    }
+}
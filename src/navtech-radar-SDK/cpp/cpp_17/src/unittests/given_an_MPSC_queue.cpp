@@ -0,0 +1,130 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MPSC_queue.h"
+#include "Task.h"
+
+using namespace Navtech;
+using namespace Navtech::Utility;
+using namespace std;
+
+
+class GivenAnMPSCQueue : public ::testing::Test {
+protected:
+    GivenAnMPSCQueue() = default;
+};
+
+
+TEST_F(GivenAnMPSCQueue, DefaultConstructedQueue)
+{
+    MPSC_queue<int> q { };
+
+    ASSERT_EQ(q.size(), 0);
+    ASSERT_TRUE(q.empty());
+    ASSERT_FALSE(q.try_pop().has_value());
+}
+
+
+TEST_F(GivenAnMPSCQueue, ElementsAreFIFOed)
+{
+    MPSC_queue<string> q { };
+
+    q.push(string { "first" });
+    q.push(string { "second" });
+
+    ASSERT_EQ(q.size(), 2);
+    ASSERT_EQ(q.pop().value(), "first");
+    ASSERT_EQ(q.pop().value(), "second");
+    ASSERT_TRUE(q.empty());
+}
+
+
+TEST_F(GivenAnMPSCQueue, ElementsStayInOrderWhenTheRingOverflows)
+{
+    MPSC_queue<int> q { 4 };
+
+    for (int i { 0 }; i < 10; ++i) q.push(i);
+
+    // Pushes after some pops must still follow the overflowed items
+    //
+    ASSERT_EQ(q.pop().value(), 0);
+    ASSERT_EQ(q.pop().value(), 1);
+    q.push(10);
+
+    for (int i { 2 }; i <= 10; ++i) {
+        ASSERT_EQ(q.pop().value(), i);
+    }
+
+    auto stats = q.statistics();
+    ASSERT_EQ(stats.max_depth, 10);
+    ASSERT_EQ(stats.num_popped, 11);
+    ASSERT_EQ(stats.depth, 0);
+}
+
+
+TEST_F(GivenAnMPSCQueue, ItemsFromEachProducerArePoppedInOrder)
+{
+    constexpr int num_producers { 4 };
+    constexpr int num_items     { 20000 };
+
+    MPSC_queue<pair<int, int>> q { 8 };
+    vector<thread> producers { };
+
+    for (int p { 0 }; p < num_producers; ++p) {
+        producers.emplace_back([&q, p] { for (int i { 0 }; i < num_items; ++i) q.push(make_pair(p, i)); });
+    }
+
+    vector<int> next(num_producers, 0);
+
+    for (int n { 0 }; n < num_producers * num_items; ++n) {
+        auto [p, i] = q.pop().value();
+        ASSERT_EQ(i, next[p]);
+        ++next[p];
+    }
+
+    for (auto& t : producers) t.join();
+    ASSERT_TRUE(q.empty());
+}
+
+
+TEST_F(GivenAnMPSCQueue, CancelReleasesABlockedConsumer)
+{
+    MPSC_queue<int> q { };
+    q.wait_strategy(Wait_strategy::spin);
+
+    thread canceller { [&q] { this_thread::sleep_for(chrono::milliseconds { 10 }); q.cancel(); } };
+
+    auto result = q.pop();
+    canceller.join();
+
+    ASSERT_FALSE(result.has_value());
+    ASSERT_TRUE(q.is_cancelled());
+}
+
+
+TEST_F(GivenAnMPSCQueue, SmallTasksAreStoredInline)
+{
+    MPSC_queue<Task> q { };
+
+    int  total { 0 };
+    auto small          = [&total] { total += 1; };
+    auto large          = [&total, padding = array<char, 128> { }] { total += 100 + padding[0]; };
+    auto string_capture = [&total, value = string { "abc" }] { total += static_cast<int>(value.size()); };
+
+    static_assert(Task::is_inline<decltype(small)>());
+    static_assert(!Task::is_inline<decltype(large)>());
+    static_assert(Task::is_inline<decltype(string_capture)>());
+
+    q.push(Task { small });
+    q.push(Task { large });
+    q.push(Task { string_capture });
+
+    while (!q.empty()) q.pop().value()();
+
+    ASSERT_EQ(total, 104);
+}
@@ -0,0 +1,168 @@
+// ---------------------------------------------------------------------------------------------------------------------
+// Copyright 2025 Navtech Radar Limited
+// This file is part of IASDK which is released under The MIT License (MIT).
+// See file LICENSE.txt in project root or go to https://opensource.org/licenses/MIT
+// for full license details.
+//
+// Disclaimer:
+// Navtech Radar is furnishing this item "as is". Navtech Radar does not provide 
+// any warranty of the item whatsoever, whether express, implied, or statutory,
+// including, but not limited to, any warranty of merchantability or fitness
+// for a particular purpose or any warranty that the contents of the item will
+// be error-free.
+// In no respect shall Navtech Radar incur any liability for any damages, including,
+// but limited to, direct, indirect, special, or consequential damages arising
+// out of, resulting from, or any way connected to the use of the item, whether
+// or not based upon warranty, contract, tort, or otherwise; whether or not
+// injury was sustained by persons or property or otherwise; and whether or not
+// loss was sustained from, or arose out of, the results of, the item, or any
+// services that may be provided by Navtech Radar.
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+
+namespace Navtech::Utility {
+
+    // -------------------------------------------------------------------------------------------------------
+    // A Stream_buffer holds the bytes read, in bulk, from a byte stream (for
+    // example a TCP socket) until they have been parsed into messages.
+    //
+    // The unread bytes are always contiguous, from begin() to end(), so a message
+    // header can be inspected in place and a complete message copied out of the
+    // buffer in one go. 
+    // The buffer is filled by a reader function, which is given the free space at
+    // the end of the storage and returns the number of bytes it wrote:
+    //
+    //     std::size_t reader(std::uint8_t* into, std::size_t max_bytes);
+    //
+    // A reader that cannot make progress (for example, at end-of-stream) must
+    // throw rather than return zero.
+    // When the free space is too small for the next message the unread bytes
+    // (always less than one message) are moved to the front of the storage.  The
+    // storage only grows if a single message is larger than it.
+    //
+    class Stream_buffer {
+    public:
+        using Iterator       = std::uint8_t*;
+        using Const_iterator = const std::uint8_t*;
+
+        Stream_buffer() = default;
+        Stream_buffer(std::size_t initial_capacity);
+
+        // Read until at least min_bytes are unread.  The reader may
+        // be called several times, and may read more than min_bytes.
+        // Returns the number of unread bytes.
+        //
+        template <typename Reader_Ty> std::size_t fill(std::size_t min_bytes, Reader_Ty&& reader);
+
+        // Unread bytes
+        //
+        Const_iterator begin() const;
+        Const_iterator end()   const;
+
+        void consume(std::size_t num_bytes);
+        void clear();
+
+        std::size_t size()     const;
+        std::size_t capacity() const;
+        bool        empty()    const;
+
+    private:
+        std::vector<std::uint8_t> storage { };
+        std::size_t               read    { 0 };
+        std::size_t               write   { 0 };
+
+        void make_room_for(std::size_t num_bytes);
+    };
+
+
+    inline Stream_buffer::Stream_buffer(std::size_t initial_capacity) :
+        storage { std::vector<std::uint8_t>(initial_capacity) }
+    {
+    }
+
+
+    template <typename Reader_Ty>
+    std::size_t Stream_buffer::fill(std::size_t min_bytes, Reader_Ty&& reader)
+    {
+        if (size() >= min_bytes) return size();
+
+        make_room_for(min_bytes);
+
+        while (size() < min_bytes) {
+            write += reader(storage.data() + write, storage.size() - write);
+        }
+
+        return size();
+    }
+
+
+    inline Stream_buffer::Const_iterator Stream_buffer::begin() const
+    {
+        return storage.data() + read;
+    }
+
+
+    inline Stream_buffer::Const_iterator Stream_buffer::end() const
+    {
+        return storage.data() + write;
+    }
+
+
+    inline void Stream_buffer::consume(std::size_t num_bytes)
+    {
+        read += (num_bytes < size()) ? num_bytes : size();
+
+        // Once everything has been parsed the next read can
+        // start at the front of the storage, for free.
+        //
+        if (read == write) clear();
+    }
+
+
+    inline void Stream_buffer::clear()
+    {
+        read  = 0;
+        write = 0;
+    }
+
+
+    inline std::size_t Stream_buffer::size() const
+    {
+        return write - read;
+    }
+
+
+    inline std::size_t Stream_buffer::capacity() const
+    {
+        return storage.size();
+    }
+
+
+    inline bool Stream_buffer::empty() const
+    {
+        return read == write;
+    }
+
+
+    inline void Stream_buffer::make_room_for(std::size_t num_bytes)
+    {
+        if (read + num_bytes <= storage.size()) return;
+
+        if (num_bytes > storage.size()) storage.resize(num_bytes);
+
+        auto unread = size();
+
+        std::memmove(storage.data(), storage.data() + read, unread);
+        read  = 0;
+        write = unread;
+    }
+
+} // namespace Navtech::Utility
+
+#endif // STREAM_BUFFER_H
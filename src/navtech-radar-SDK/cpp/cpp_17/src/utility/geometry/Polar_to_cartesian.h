@@ -0,0 +1,298 @@
+// ---------------------------------------------------------------------------------------------------------------------
+// Copyright 2025 Navtech Radar Limited
+// This file is part of IASDK which is released under The MIT License (MIT).
+// See file LICENSE.txt in project root or go to https://opensource.org/licenses/MIT
+// for full license details.
+//
+// Disclaimer:
+// Navtech Radar is furnishing this item "as is". Navtech Radar does not provide 
+// any warranty of the item whatsoever, whether express, implied, or statutory,
+// including, but not limited to, any warranty of merchantability or fitness
+// for a particular purpose or any warranty that the contents of the item will
+// be error-free.
+// In no respect shall Navtech Radar incur any liability for any damages, including,
+// but limited to, direct, indirect, special, or consequential damages arising
+// out of, resulting from, or any way connected to the use of the item, whether
+// or not based upon warranty, contract, tort, or otherwise; whether or not
+// injury was sustained by persons or property or otherwise; and whether or not
+// loss was sustained from, or arose out of, the results of, the item, or any
+// services that may be provided by Navtech Radar.
+// ---------------------------------------------------------------------------------------------------------------------
+#ifndef POLAR_TO_CARTESIAN_H
+#define POLAR_TO_CARTESIAN_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Units.h"
+
+namespace Navtech::Polar_to_cartesian {
+
+    // -----------------------------------------------------------------------------------------------------------------
+    // Point (output)
+    // The layout of a ROS PointCloud2 point with float32 fields x, y, z
+    // and intensity, in host byte order.  Zero degrees is radar North (+y).
+    //
+    struct Point {
+        float x         { };
+        float y         { };
+        float z         { };
+        float intensity { };
+    };
+
+    static_assert(sizeof(Point) == 4 * sizeof(float));
+
+
+    // -----------------------------------------------------------------------------------------------------------------
+    // Engine - converts azimuths of polar data into a rotation of Cartesian points.
+    //
+    // The sine and cosine of every azimuth, and the range of every bin, are
+    // computed when the engine is configured; converting a bin costs two
+    // multiply-adds.  Points are written straight into the engine's byte
+    // buffer, which release() hands over (for example, as PointCloud2::data)
+    // at the end of a rotation.  The thresholding loop has no branches: every
+    // bin is written to the next free point, which is only kept if the bin
+    // is above threshold.
+    //
+    // The buffer only grows to the points kept so far, plus the bins of the
+    // azimuth being converted.  Once it has grown to the size of a rotation,
+    // converting does not allocate; release() reserves one new buffer, of the
+    // size of the rotation just released, without initialising it.
+    //
+    class Engine {
+    public:
+        Engine() = default;
+
+        // azimuth_offset rotates the output; azimuth index i is drawn at
+        // bearing (i + azimuth_offset) / azimuth_samples * 360 degrees.
+        //
+        void set_azimuths(std::size_t azimuth_samples, std::size_t azimuth_offset = 0);
+
+        // Bin n is at range (n * metres_per_bin) + range_offset
+        //
+        void set_ranges(std::size_t num_bins, float metres_per_bin, float range_offset = 0.0f);
+
+        // Added to the x and y of every point
+        //
+        void set_origin(float x, float y);
+
+        // Convert bins [first, last) of an azimuth, keeping the bins whose
+        // value is above threshold.  The value becomes the point's intensity.
+        //
+        template <typename T>
+        void convert(std::size_t azimuth, const T* data, std::size_t first, std::size_t last, T threshold);
+
+        // As above, but detection, rather than data, is compared to threshold;
+        // for example, the output of CFAR.
+        //
+        template <typename T, typename Detection_Ty>
+        void convert(
+            std::size_t         azimuth,
+            const T*            data,
+            const Detection_Ty* detection,
+            std::size_t         first,
+            std::size_t         last,
+            Detection_Ty        threshold
+        );
+
+        // Convert a single target
+        //
+        void convert(std::size_t azimuth, Unit::Metre range, float intensity);
+
+        std::size_t size() const;
+        bool        empty() const;
+        Point       operator[](std::size_t index) const;
+
+        // Hand over the bytes of this rotation's points (size() * sizeof(Point))
+        // and start a new rotation.
+        //
+        std::vector<std::uint8_t> release();
+
+    private:
+        std::vector<float>          sines       { };
+        std::vector<float>          cosines     { };
+        std::vector<float>          ranges      { };
+        float                       bin_size    { 0.0f };
+        float                       offset      { 0.0f };
+        float                       origin_x    { 0.0f };
+        float                       origin_y    { 0.0f };
+
+        std::vector<std::uint8_t>   buffer      { };
+        std::size_t                 num_points  { 0 };
+
+        std::size_t azimuth_index(std::size_t azimuth) const;
+        const float* ranges_to(std::size_t last);
+        std::uint8_t* reserve_points(std::size_t count);
+
+        static void write(std::uint8_t* into, const Point& point);
+    };
+
+
+    inline void Engine::set_azimuths(std::size_t azimuth_samples, std::size_t azimuth_offset)
+    {
+        sines.resize(azimuth_samples);
+        cosines.resize(azimuth_samples);
+
+        for (std::size_t i { 0 }; i < azimuth_samples; ++i) {
+            auto bearing = 2.0 * pi<double> * static_cast<double>((i + azimuth_offset) % azimuth_samples) / azimuth_samples;
+            sines[i]     = static_cast<float>(std::sin(bearing));
+            cosines[i]   = static_cast<float>(std::cos(bearing));
+        }
+    }
+
+
+    inline void Engine::set_ranges(std::size_t num_bins, float metres_per_bin, float range_offset)
+    {
+        bin_size = metres_per_bin;
+        offset   = range_offset;
+
+        ranges.clear();
+        ranges_to(num_bins);
+    }
+
+
+    inline void Engine::set_origin(float x, float y)
+    {
+        origin_x = x;
+        origin_y = y;
+    }
+
+
+    template <typename T>
+    void Engine::convert(std::size_t azimuth, const T* data, std::size_t first, std::size_t last, T threshold)
+    {
+        convert(azimuth, data, data, first, last, threshold);
+    }
+
+
+    template <typename T, typename Detection_Ty>
+    void Engine::convert(
+        std::size_t         azimuth,
+        const T*            data,
+        const Detection_Ty* detection,
+        std::size_t         first,
+        std::size_t         last,
+        Detection_Ty        threshold
+    )
+    {
+        if (first >= last || sines.empty()) return;
+
+        auto index = azimuth_index(azimuth);
+        auto sin_a = sines[index];
+        auto cos_a = cosines[index];
+        auto range = ranges_to(last);
+        auto out   = reserve_points(last - first);
+
+        std::size_t kept { 0 };
+
+        for (auto bin { first }; bin < last; ++bin) {
+            write(
+                out + kept * sizeof(Point),
+                Point { 
+                    range[bin] * sin_a + origin_x, 
+                    range[bin] * cos_a + origin_y, 
+                    0.0f, 
+                    static_cast<float>(data[bin]) 
+                }
+            );
+            kept += static_cast<std::size_t>(detection[bin] > threshold);
+        }
+
+        num_points += kept;
+    }
+
+
+    inline void Engine::convert(std::size_t azimuth, Unit::Metre range, float intensity)
+    {
+        if (sines.empty()) return;
+
+        auto index = azimuth_index(azimuth);
+
+        write(
+            reserve_points(1),
+            Point { range * sines[index] + origin_x, range * cosines[index] + origin_y, 0.0f, intensity }
+        );
+        ++num_points;
+    }
+
+
+    inline std::size_t Engine::size() const
+    {
+        return num_points;
+    }
+
+
+    inline bool Engine::empty() const
+    {
+        return num_points == 0;
+    }
+
+
+    inline Point Engine::operator[](std::size_t index) const
+    {
+        Point point { };
+        std::memcpy(&point, buffer.data() + index * sizeof(Point), sizeof(Point));
+        return point;
+    }
+
+
+    inline std::vector<std::uint8_t> Engine::release()
+    {
+        auto rotation_sz = buffer.size();
+
+        buffer.resize(num_points * sizeof(Point));
+        std::vector<std::uint8_t> out { std::move(buffer) };
+
+        // A rotation that kept far fewer points than the one before
+        // does not hand over the capacity reserved for it.
+        //
+        if (out.capacity() > 2 * out.size()) out.shrink_to_fit();
+
+        buffer = std::vector<std::uint8_t> { };
+        buffer.reserve(rotation_sz);
+        num_points = 0;
+
+        return out;
+    }
+
+
+    inline std::size_t Engine::azimuth_index(std::size_t azimuth) const
+    {
+        return azimuth < sines.size() ? azimuth : azimuth % sines.size();
+    }
+
+
+    inline const float* Engine::ranges_to(std::size_t last)
+    {
+        // Azimuths longer than the configured number of
+        // bins extend the table, rather than being cut short.
+        //
+        for (auto bin { ranges.size() }; bin < last; ++bin) {
+            ranges.push_back(static_cast<float>(bin) * bin_size + offset);
+        }
+
+        return ranges.data();
+    }
+
+
+    inline std::uint8_t* Engine::reserve_points(std::size_t count)
+    {
+        auto required = (num_points + count) * sizeof(Point);
+
+        if (buffer.size() < required) buffer.resize(required);
+
+        return buffer.data() + num_points * sizeof(Point);
+    }
+
+
+    inline void Engine::write(std::uint8_t* into, const Point& point)
+    {
+        std::memcpy(into, &point, sizeof(Point));
+    }
+
+} // namespace Navtech::Polar_to_cartesian
+
+#endif // POLAR_TO_CARTESIAN_H
@@ -0,0 +1,323 @@
+// ---------------------------------------------------------------------------------------------------------------------
+// Copyright 2025 Navtech Radar Limited
+// This file is part of IASDK which is released under The MIT License (MIT).
+// See file LICENSE.txt in project root or go to https://opensource.org/licenses/MIT
+// for full license details.
+//
+// Disclaimer:
+// Navtech Radar is furnishing this item "as is". Navtech Radar does not provide 
+// any warranty of the item whatsoever, whether express, implied, or statutory,
+// including, but not limited to, any warranty of merchantability or fitness
+// for a particular purpose or any warranty that the contents of the item will
+// be error-free.
+// In no respect shall Navtech Radar incur any liability for any damages, including,
+// but limited to, direct, indirect, special, or consequential damages arising
+// out of, resulting from, or any way connected to the use of the item, whether
+// or not based upon warranty, contract, tort, or otherwise; whether or not
+// injury was sustained by persons or property or otherwise; and whether or not
+// loss was sustained from, or arose out of, the results of, the item, or any
+// services that may be provided by Navtech Radar.
+// ---------------------------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "Shape_extraction.h"
+#include "float_equality.h"
+
+namespace Navtech::Shape_extraction {
+
+    // -----------------------------------------------------------------------------------------------------------------
+    // Grid
+    //
+    Grid::Grid(std::size_t num_rows)
+    {
+        resize(num_rows);
+    }
+
+
+    void Grid::resize(std::size_t num_rows)
+    {
+        clear();
+        row_runs.resize(num_rows);
+    }
+
+
+    void Grid::clear()
+    {
+        for (auto& runs : row_runs) runs.clear();
+    }
+
+
+    void Grid::set_row(std::size_t row, const float* first, const float* last, std::size_t first_col)
+    {
+        using Utility::essentially_equal;
+
+        auto& runs = row_runs[row];
+        runs.clear();
+
+        bool in_run { false };
+
+        for (auto cell { first }; cell < last; ++cell) {
+            auto value = *cell;
+
+            if (std::isnan(value) || essentially_equal(value, 0.0f)) {
+                in_run = false;
+                continue;
+            }
+
+            auto col = static_cast<std::uint32_t>(first_col + (cell - first));
+
+            if (!in_run) {
+                runs.push_back(Run { col, col, 0.0f, 0.0f });
+                in_run = true;
+            }
+
+            auto& run = runs.back();
+            run.last    = col + 1;
+            run.mass   += value;
+            run.moment += value * static_cast<float>(col);
+        }
+    }
+
+
+    void Grid::clear_row(std::size_t row)
+    {
+        row_runs[row].clear();
+    }
+
+
+    std::size_t Grid::rows() const
+    {
+        return row_runs.size();
+    }
+
+
+    std::size_t Grid::num_runs() const
+    {
+        std::size_t total { 0 };
+        for (auto& runs : row_runs) total += runs.size();
+        return total;
+    }
+
+
+    const std::vector<Run>& Grid::operator[](std::size_t row) const
+    {
+        return row_runs[row];
+    }
+
+
+    // -----------------------------------------------------------------------------------------------------------------
+    // Engine
+    //
+    Engine::Engine(std::size_t num_threads)
+    {
+        set_threads(num_threads);
+    }
+
+
+    void Engine::set_threads(std::size_t num_threads)
+    {
+        workers.set_workers(std::max(num_threads, std::size_t { 1 }));
+    }
+
+
+    const std::vector<Shape>& Engine::find_shapes(const Grid& grid)
+    {
+        found.clear();
+
+        const std::size_t num_rows { grid.rows() };
+
+        row_start.resize(num_rows + 1);
+        row_start[0] = 0;
+        for (std::size_t row { 0 }; row < num_rows; ++row) {
+            row_start[row + 1] = row_start[row] + grid[row].size();
+        }
+
+        const std::size_t num_runs { row_start[num_rows] };
+        if (num_runs == 0) return found;
+
+        parent.resize(num_runs);
+        std::iota(parent.begin(), parent.end(), std::uint32_t { 0 });
+        offset.assign(num_runs, 0);
+
+        label_sectors(grid);
+
+        // A run in the last row is one row before a run in the first
+        //
+        if (num_rows > 2) join_rows(grid, num_rows - 1, 0, -static_cast<std::int32_t>(num_rows));
+
+        collect(grid);
+        
+        return found;
+    }
+
+
+    const std::vector<Shape>& Engine::shapes() const
+    {
+        return found;
+    }
+
+
+    // -----------------------------------------------------------------------------------------------------------------
+    // Private member functions
+    //
+    std::pair<std::uint32_t, std::int32_t> Engine::find(std::uint32_t run)
+    {
+        std::uint32_t root       { run };
+        std::int32_t  row_offset { 0 };
+
+        while (parent[root] != root) {
+            row_offset += offset[root];
+            root        = parent[root];
+        }
+
+        // Point every run on the path straight at the root
+        //
+        std::int32_t remaining { row_offset };
+
+        while (parent[run] != root && run != root) {
+            auto next       = parent[run];
+            auto to_next    = offset[run];
+            parent[run]     = root;
+            offset[run]     = remaining;
+            remaining      -= to_next;
+            run             = next;
+        }
+
+        return { root, row_offset };
+    }
+
+
+    // Join the sets of runs a and b, where the rows of a are delta rows
+    // from the rows of b.  The root of a set is always its first run.
+    //
+    void Engine::join(std::uint32_t a, std::uint32_t b, std::int32_t delta)
+    {
+        auto [root_a, offset_a] = find(a);
+        auto [root_b, offset_b] = find(b);
+
+        // A shape that goes all the way round meets itself; it keeps
+        // the offsets it already has.
+        //
+        if (root_a == root_b) return;
+
+        if (root_a < root_b) {
+            parent[root_b] = root_a;
+            offset[root_b] = offset_a - offset_b - delta;
+        }
+        else {
+            parent[root_a] = root_b;
+            offset[root_a] = offset_b + delta - offset_a;
+        }
+    }
+
+
+    void Engine::join_rows(const Grid& grid, std::size_t previous, std::size_t current, std::int32_t delta)
+    {
+        auto& previous_runs = grid[previous];
+        auto& current_runs  = grid[current];
+
+        std::size_t p { 0 };
+        std::size_t c { 0 };
+
+        // Both rows are in column order; a pair of runs is joined if
+        // they share a column.
+        //
+        while (p < previous_runs.size() && c < current_runs.size()) {
+            auto& prev = previous_runs[p];
+            auto& curr = current_runs[c];
+
+            if (prev.first < curr.last && curr.first < prev.last) {
+                join(
+                    static_cast<std::uint32_t>(row_start[previous] + p),
+                    static_cast<std::uint32_t>(row_start[current] + c),
+                    delta
+                );
+            }
+
+            if (prev.last < curr.last) ++p;
+            else                       ++c;
+        }
+    }
+
+
+    void Engine::label_sectors(const Grid& grid)
+    {
+        const std::size_t num_rows    { grid.rows() };
+        const std::size_t num_runs    { row_start[num_rows] };
+        const std::size_t num_threads { std::max(std::min({ workers.size(), num_rows, num_runs / min_runs_per_thread }), std::size_t { 1 }) };
+
+        // Share the runs, rather than the rows, between the sectors
+        //
+        sectors.resize(num_threads + 1);
+        for (std::size_t sector { 0 }; sector < num_threads; ++sector) {
+            auto first_run  = num_runs * sector / num_threads;
+            sectors[sector] = static_cast<std::size_t>(
+                std::lower_bound(row_start.begin(), row_start.end() - 1, first_run) - row_start.begin()
+            );
+        }
+        sectors[num_threads] = num_rows;
+
+        // The runs of a sector are only ever joined to runs of the same
+        // sector, so the sectors can be labelled concurrently.
+        //
+        auto label_sector = [this, &grid](std::size_t sector)
+        {
+            for (auto row { sectors[sector] + 1 }; row < sectors[sector + 1]; ++row) {
+                join_rows(grid, row - 1, row, 0);
+            }
+        };
+
+        workers.run(num_threads, label_sector);
+
+        // Merge across the seams between sectors
+        //
+        for (std::size_t sector { 1 }; sector < num_threads; ++sector) {
+            auto row = sectors[sector];
+            if (row > 0 && row < num_rows) join_rows(grid, row - 1, row, 0);
+        }
+    }
+
+
+    void Engine::collect(const Grid& grid)
+    {
+        const std::size_t num_rows { grid.rows() };
+
+        components.assign(row_start[num_rows], Component { });
+
+        for (std::size_t row { 0 }; row < num_rows; ++row) {
+            auto run_index = static_cast<std::uint32_t>(row_start[row]);
+
+            for (auto& run : grid[row]) {
+                auto [root, row_offset] = find(run_index++);
+                auto& component = components[root];
+
+                component.mass       += run.mass;
+                component.row_moment += static_cast<double>(run.mass) * (static_cast<double>(row) + row_offset);
+                component.col_moment += run.moment;
+                component.cells      += run.last - run.first;
+            }
+        }
+
+        // A root is the first run of its shape, so the shapes come out
+        // in order of their first cell.
+        //
+        for (std::uint32_t run { 0 }; run < components.size(); ++run) {
+            if (parent[run] != run) continue;
+
+            auto& component = components[run];
+            if (component.cells < 2 || component.mass == 0.0) continue;
+
+            found.push_back(
+                Shape {
+                    static_cast<float>(component.row_moment / component.mass),
+                    static_cast<float>(component.col_moment / component.mass),
+                    static_cast<float>(component.mass),
+                    component.cells
+                }
+            );
+        }
+    }
+
+} // namespace Navtech::Shape_extraction
\ No newline at end of file
@@ -0,0 +1,148 @@
+// ---------------------------------------------------------------------------------------------------------------------
+// Copyright 2025 Navtech Radar Limited
+// This file is part of IASDK which is released under The MIT License (MIT).
+// See file LICENSE.txt in project root or go to https://opensource.org/licenses/MIT
+// for full license details.
+//
+// Disclaimer:
+// Navtech Radar is furnishing this item "as is". Navtech Radar does not provide 
+// any warranty of the item whatsoever, whether express, implied, or statutory,
+// including, but not limited to, any warranty of merchantability or fitness
+// for a particular purpose or any warranty that the contents of the item will
+// be error-free.
+// In no respect shall Navtech Radar incur any liability for any damages, including,
+// but limited to, direct, indirect, special, or consequential damages arising
+// out of, resulting from, or any way connected to the use of the item, whether
+// or not based upon warranty, contract, tort, or otherwise; whether or not
+// injury was sustained by persons or property or otherwise; and whether or not
+// loss was sustained from, or arose out of, the results of, the item, or any
+// services that may be provided by Navtech Radar.
+// ---------------------------------------------------------------------------------------------------------------------
+#ifndef SHAPE_EXTRACTION_H
+#define SHAPE_EXTRACTION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Worker_pool.h"
+
+namespace Navtech::Shape_extraction {
+
+    // -----------------------------------------------------------------------------------------------------------------
+    // Run - contiguous non-zero cells [first, last) of one row.
+    // mass is the sum of the cells' values; moment is the sum of
+    // value * column.
+    //
+    struct Run {
+        std::uint32_t first     { };
+        std::uint32_t last      { };
+        float         mass      { };
+        float         moment    { };
+    };
+
+
+    // -----------------------------------------------------------------------------------------------------------------
+    // Grid - a rotation of rows (azimuths), held as sparse run-length rows.
+    //
+    // Each row keeps its storage between rotations, so once a grid has
+    // seen a typical rotation, setting rows does not allocate.  Zero
+    // (and NaN) cells are empty.
+    //
+    class Grid {
+    public:
+        Grid() = default;
+        Grid(std::size_t num_rows);
+
+        // Resizing clears every row
+        //
+        void resize(std::size_t num_rows);
+        void clear();
+
+        // Replace a row with cells [first, last); first is column first_col.
+        //
+        void set_row(std::size_t row, const float* first, const float* last, std::size_t first_col = 0);
+        void clear_row(std::size_t row);
+
+        std::size_t             rows() const;
+        std::size_t             num_runs() const;
+        const std::vector<Run>& operator[](std::size_t row) const;
+
+    private:
+        std::vector<std::vector<Run>> row_runs { };
+    };
+
+
+    // -----------------------------------------------------------------------------------------------------------------
+    // Shape - a group of 4-connected cells, and its centre of mass.
+    // Rows wrap; the centre of a shape across the last and first rows is
+    // given relative to the row of its first cell, so may be negative (or
+    // beyond the last row).
+    //
+    struct Shape {
+        float       row     { };
+        float       col     { };
+        float       mass    { };
+        std::size_t cells   { };
+    };
+
+
+    // -----------------------------------------------------------------------------------------------------------------
+    // Engine - finds the shapes in a grid.
+    //
+    // Runs are labelled with a union-find over run indices, rather than by
+    // visiting cells, so the work depends on the number of runs, not on the
+    // size of the grid.  The rows are split into sectors, which are labelled
+    // on the engine's threads; the runs either side of each sector boundary,
+    // and of the wrap from the last row to the first, are then merged.  Each
+    // set remembers the row offset from a run to its parent, so that a shape
+    // joined across the wrap has a continuous row coordinate.
+    //
+    // Shapes of a single cell are ignored.  Shapes are given in the order of
+    // their first cell, row by row.
+    //
+    // The engine keeps its working buffers, and its threads, between calls.
+    // An engine must not be shared between threads; find_shapes() runs on the
+    // engine's own threads.
+    //
+    class Engine {
+    public:
+        Engine() = default;
+        Engine(std::size_t num_threads);
+
+        void set_threads(std::size_t num_threads);
+
+        const std::vector<Shape>& find_shapes(const Grid& grid);
+        const std::vector<Shape>& shapes() const;
+
+    private:
+        // Sectors smaller than this are not worth a thread
+        //
+        static constexpr std::size_t min_runs_per_thread { 4096 };
+
+        struct Component {
+            double      mass        { };
+            double      row_moment  { };
+            double      col_moment  { };
+            std::size_t cells       { };
+        };
+
+        Utility::Worker_pool        workers     { };
+        std::vector<std::size_t>    row_start   { };    // Index of the first run of each row
+        std::vector<std::size_t>    sectors     { };    // First row of each sector
+        std::vector<std::uint32_t>  parent      { };
+        std::vector<std::int32_t>   offset      { };    // Row offset from a run to its parent
+        std::vector<Component>      components  { };
+        std::vector<Shape>          found       { };
+
+        std::pair<std::uint32_t, std::int32_t> find(std::uint32_t run);
+        void join(std::uint32_t a, std::uint32_t b, std::int32_t delta);
+        void join_rows(const Grid& grid, std::size_t previous, std::size_t current, std::int32_t delta);
+        void label_sectors(const Grid& grid);
+        void collect(const Grid& grid);
+    };
+
+} // namespace Navtech::Shape_extraction
+
+#endif // SHAPE_EXTRACTION_H
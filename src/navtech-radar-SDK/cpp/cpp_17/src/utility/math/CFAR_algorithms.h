@@ -27,11 +27,28 @@
 #include <algorithm>
 #include <numeric>
 #include <iterator>
+#include <memory>
+#include <type_traits>
 
 #include "Units.h"
+#include "Worker_pool.h"
 
 namespace Navtech::CA_CFAR {
 
+    // -----------------------------------------------------------------------------------------------------------------
+    // CFAR method - how the noise level is estimated from the training cells
+    //
+    // cell_average         Mean of all the training cells (CA-CFAR)
+    // greatest_of          Greater of the lower and upper means (GO-CFAR); fewer false
+    //                      detections at the edges of clutter
+    // smallest_of          Smaller of the lower and upper means (SO-CFAR); better at
+    //                      separating closely-spaced targets
+    // ordered_statistic    The k-th smallest training cell, where k is order * training
+    //                      cells (OS-CFAR); not raised by targets in the training cells
+    //
+    enum class Method { cell_average, greatest_of, smallest_of, ordered_statistic };
+
+
     // -----------------------------------------------------------------------------------------------------------------
     // CFAR window (input)
     //
@@ -48,6 +65,8 @@ namespace Navtech::CA_CFAR {
         Unit::Bin   size;                                               // *Total* window size
         Unit::Bin   guard_cells;                                        // Guard cells on each side of cell-under-test
         Unit::dB    threshold_delta { 0.0_dB };                         // Signal level *above* local average
+        Method      method          { Method::cell_average };
+        float       order           { 0.75f };                          // OS-CFAR rank, as a fraction of the training cells
 
         Window() = default;
 
@@ -73,6 +92,20 @@ namespace Navtech::CA_CFAR {
             resize();
         }
 
+        Window(
+            Unit::Bin window_sz,
+            Unit::Bin num_guard_cells,
+            Unit::dB  delta,
+            Method    cfar_method
+        ) :
+            size            { window_sz },
+            guard_cells     { num_guard_cells },
+            threshold_delta { delta },
+            method          { cfar_method }
+        {
+            resize();
+        }
+
 
     private:
         static constexpr Unit::Bin force_odd(Unit::Bin sz)
@@ -151,6 +184,10 @@ namespace Navtech::CA_CFAR {
     // -----------------------------------------------------------------------------------------------------------------
     // Algorithms
     //
+    // The data must be contiguous (a pointer, or a vector/array iterator).
+    // These functions allocate their output on each call; for continuous
+    // processing use an Engine (below) with caller-owned buffers.
+    //
     // All points given a pointer-to-data
     //
     template <typename Iterator_Ty>    
@@ -237,12 +274,15 @@ namespace Navtech::CA_CFAR {
         // Traits.
         // When adding, for example, std::uint8_t values, overflow is a real possibility,
         // therefore use a type that can hold the largest sum.
+        // Prefix sums of floating-point data are held in double, so that the difference
+        // of two large sums does not lose the precision of the training cells.
         //
         template <typename T> 
         class Slider_traits {
         public:
             using Value_Ty  = T;
             using Sum_Ty    = T;
+            using Prefix_Ty = std::conditional_t<std::is_floating_point_v<T>, double, T>;
 
             static T from_dB(Unit::dB power)
             {
@@ -261,6 +301,7 @@ namespace Navtech::CA_CFAR {
         public:
             using Value_Ty  = std::uint8_t;
             using Sum_Ty    = std::uint32_t;
+            using Prefix_Ty = std::uint32_t;
 
             static std::uint8_t from_dB(Unit::dB power)
             {
@@ -279,6 +320,7 @@ namespace Navtech::CA_CFAR {
         public:
             using Value_Ty  = std::uint16_t;
             using Sum_Ty    = std::uint32_t;
+            using Prefix_Ty = std::uint32_t;
 
             // 16-bit FFT data is quantized differently to 8-bit.
             // The dynamic range is the same (96.5dB) but that value
@@ -303,41 +345,23 @@ namespace Navtech::CA_CFAR {
 
 
         // ------------------------
+        // Training cells of one cell-under-test, as [begin, end) indices
+        // into the processed range.
         //
-        template <typename Iterator_Ty>
-        class Window_slider {
-        public:
-            using Traits    = Slider_traits<typename std::iterator_traits<Iterator_Ty>::value_type>;
-            using Sum_Ty    = typename Traits::Sum_Ty;
-            using Value_Ty  = typename Traits::Value_Ty;
-
-            Window_slider() = default;
-            Window_slider(const Window& window_defn, Iterator_Ty min_bin, Iterator_Ty max_bin);
-
-            std::pair<Unit::dB, std::size_t> process_cell(Iterator_Ty elem_ptr);
-        
-        private:
-            Window      window;
-            Iterator_Ty range_start { };
-            Iterator_Ty range_end   { };
-
-            std::size_t threshold_exceeded_count { };
+        struct Training_cells {
+            std::ptrdiff_t lower_begin { };
+            std::ptrdiff_t lower_end   { };
+            std::ptrdiff_t upper_begin { };
+            std::ptrdiff_t upper_end   { };
+
+            std::ptrdiff_t lower_size() const { return lower_end - lower_begin; }
+            std::ptrdiff_t upper_size() const { return upper_end - upper_begin; }
         };
 
 
-        template <typename Iterator_Ty>
-        Window_slider<Iterator_Ty>::Window_slider(const Window& window_defn, Iterator_Ty min_bin, Iterator_Ty max_bin) :
-            window      { window_defn },
-            range_start { min_bin },
-            range_end   { max_bin }
+        inline Training_cells training_cells(std::ptrdiff_t cell, std::ptrdiff_t range_sz, const Window& window)
         {
-        }
-
-
-        template <typename Iterator_Ty>
-        std::pair<Unit::dB, std::size_t> Window_slider<Iterator_Ty>::process_cell(Iterator_Ty const elem_ptr)
-        {
-            //                               elem_ptr
+            //                                 cell
             //             guard_sz <----->  v
             // _____________________________________________________________
             // |   |   |   |   |   | X | X |   | X | X |   |   |   |   |   |
@@ -346,7 +370,7 @@ namespace Navtech::CA_CFAR {
             // lower_begin        lower_end         upper_begin       upper_end   
             //
             // At the beginning and end of the range the window must be 'slewed'
-            // to ensure that all elements (elem_ptr) are checked.
+            // to ensure that all cells are checked.
             // If the window extends below the start of the range, truncate the
             // lower set of training cells and extend the upper set.  That is, 
             // the training cell set always remains the same size. Similarly,
@@ -358,145 +382,450 @@ namespace Navtech::CA_CFAR {
             // middle of the window is reached; after which the entire window can slide
             // up the azimuth. When the window reaches the end of the azimuth, continue
             // moving the CUT until the last cell in the window is tested.                    
+            // If the range is shorter than the window, the training cells are
+            // limited to the range.
+            //
+            // As the CUT moves up the range, none of the four bounds ever moves down.
+            //
+            const std::ptrdiff_t half  { window.size / 2 };
+            const std::ptrdiff_t guard { window.guard_cells };
+            const std::ptrdiff_t sz    { window.size };
             
-            using namespace std;
-            using namespace Unit;
+            Training_cells training {
+                cell - half,
+                cell - guard,
+                cell + guard + 1,
+                cell + half + 1
+            };
+
+            if (training.lower_begin < 0) {
+                training.lower_begin = 0;
+                training.upper_end   = sz;
+            }
 
-            Iterator_Ty lower_begin { elem_ptr - (window.size / 2) };
-            Iterator_Ty lower_end   { elem_ptr - window.guard_cells };
+            if (training.upper_end > range_sz) {
+                training.upper_end   = range_sz;
+                training.lower_begin = std::max(range_sz - sz, std::ptrdiff_t { 0 });
+            }
 
-            Iterator_Ty upper_begin { elem_ptr + window.guard_cells + 1 };
-            Iterator_Ty upper_end   { elem_ptr + (window.size / 2) + 1 };
+            if (training.lower_end < 0) {
+                training.lower_end = 0;
+            }
 
+            if (training.lower_begin > training.lower_end) {
+                training.lower_begin = training.lower_end;
+            }
 
-            if (lower_begin < range_start) {
-                lower_begin = range_start;
-                upper_end   = lower_begin + window.size;
+            if (training.upper_begin > training.upper_end) {
+                training.upper_begin = training.upper_end;
             }
+            
+            return training;
+        }
+
 
-            if (upper_end > range_end) {
-                upper_end = range_end;
-                lower_begin = upper_end - window.size;
+        // ------------------------
+        // Training cells of OS-CFAR, in order. Unsigned 8-bit and 16-bit
+        // cells are counted in a histogram, in which the k-th cell moves
+        // little from one cell-under-test to the next. Other types are
+        // kept sorted.
+        //
+        template <typename T, typename = void>
+        class Ordered_cells {
+        public:
+            void insert(T value)
+            {
+                cells.insert(std::upper_bound(cells.begin(), cells.end(), value), value);
             }
 
-            if (lower_end < range_start) {
-                lower_end = range_start;
+            void remove(T value)
+            {
+                cells.erase(std::lower_bound(cells.begin(), cells.end(), value));
             }
 
-            if (lower_begin > lower_end) {
-                lower_begin = lower_end;
+            std::size_t size() const
+            {
+                return cells.size();
             }
 
-            if (upper_begin > upper_end) {
-                upper_begin = upper_end;
+            T kth(std::size_t k)
+            {
+                return cells[k];
             }
-            
-            Sum_Ty      lower_sum    { accumulate(lower_begin, lower_end, Value_Ty { }) };
-            Sum_Ty      upper_sum    { accumulate(upper_begin, upper_end, Value_Ty { }) };
-            auto        elems        { std::distance(lower_begin, lower_end) + std::distance(upper_begin, upper_end) };
-            Unit::dB    average      { static_cast<Unit::dB>(lower_sum + upper_sum) / elems };
-            Unit::dB    cell_value   { Traits::to_dB(*elem_ptr) };
-
-            if (cell_value > (average + window.threshold_delta)) {
-                ++threshold_exceeded_count;
-                return std::make_pair(cell_value, threshold_exceeded_count);
+
+        private:
+            std::vector<T> cells { };
+        };
+
+
+        template <typename T>
+        class Ordered_cells<T, std::enable_if_t<std::is_unsigned_v<T> && sizeof(T) <= 2>> {
+        public:
+            void insert(T value)
+            {
+                if (histogram.empty()) histogram.resize(std::size_t { 1 } << (8 * sizeof(T)));
+
+                ++histogram[value];
+                ++count;
+                if (value < current) ++below;
             }
-            else {
-                return std::make_pair(0.0f, threshold_exceeded_count);
+
+            void remove(T value)
+            {
+                --histogram[value];
+                --count;
+                if (value < current) --below;
             }
-        }
 
+            std::size_t size() const
+            {
+                return count;
+            }
 
-        // ------------------------
-        // As above, but works only with the 'raw' type - either 8-bit or 16-bit FFT
-        // data. That is, this window slider does not convert the output of the CFAR
-        // to dB
+            T kth(std::size_t k)
+            {
+                while (below > k) {
+                    --current;
+                    below -= histogram[current];
+                }
+
+                while (below + histogram[current] <= k) {
+                    below += histogram[current];
+                    ++current;
+                }
+
+                return current;
+            }
+
+        private:
+            std::vector<std::uint32_t> histogram { };
+            std::size_t count   { };
+            T           current { };    // The last k-th cell...
+            std::size_t below   { };    // ...and the number of cells below it
+        };
+
+
+
+        // The engine reads an azimuth through a pointer, so the free functions
+        // below only take iterators over contiguous storage: pointers and
+        // std::vector iterators.
         //
+        template <typename Iterator_Ty, typename = void>
+        struct is_contiguous : std::is_pointer<Iterator_Ty> { };
+
         template <typename Iterator_Ty>
-        class Raw_window_slider {
-        public:
-            using Traits    = Slider_traits<typename std::iterator_traits<Iterator_Ty>::value_type>;
-            using Sum_Ty    = typename Traits::Sum_Ty;
-            using Value_Ty  = typename Traits::Value_Ty;
+        struct is_contiguous<
+            Iterator_Ty,
+            std::enable_if_t<
+                !std::is_pointer_v<Iterator_Ty> &&
+                !std::is_same_v<typename std::iterator_traits<Iterator_Ty>::value_type, bool> && (
+                    std::is_same_v<Iterator_Ty, typename std::vector<typename std::iterator_traits<Iterator_Ty>::value_type>::iterator> ||
+                    std::is_same_v<Iterator_Ty, typename std::vector<typename std::iterator_traits<Iterator_Ty>::value_type>::const_iterator>
+                )
+            >
+        > : std::true_type { };
 
-            Raw_window_slider() = default;
-            Raw_window_slider(const Window& window_defn, Iterator_Ty min_bin, Iterator_Ty max_bin);
+        template <typename Iterator_Ty>
+        inline constexpr bool is_contiguous_v { is_contiguous<Iterator_Ty>::value };
 
-            std::pair<Raw_window_slider::Value_Ty, std::size_t> process_cell(Iterator_Ty elem_ptr);
-        
-        private:
-            Window      window;
-            Iterator_Ty range_start { };
-            Iterator_Ty range_end   { };
-            Value_Ty    threshold   { Traits::from_dB(window.threshold_delta) };
+    } // namespace Implementation
 
-            std::size_t threshold_exceeded_count { };
+
+    // -----------------------------------------------------------------------------------------------------------------
+    // Engine - runs CFAR over azimuths of float (dB), 8-bit or 16-bit FFT
+    // data, into caller-owned buffers.
+    //
+    // The training cell sums are taken from a prefix sum of the azimuth, so the
+    // cost per cell does not depend on the window size (OS-CFAR keeps a sorted
+    // copy of the training cells instead). The threshold comparison is a
+    // branch-free loop over the whole azimuth that the compiler can vectorise.
+    // A cell is detected if it is above noise + threshold_delta; for integer data
+    // the comparison is exact against the truncated average, with no division.
+    //
+    // The engine keeps its working buffers between calls, so that processing
+    // does not allocate once they have grown to the azimuth size. An engine
+    // must not be shared between threads; process_rotation() runs on the
+    // engine's own threads, which are started by set_threads() and wait
+    // between rotations.
+    //
+    template <typename T>
+    class Engine {
+    public:
+        using Traits    = Implementation::Slider_traits<T>;
+        using Sum_Ty    = typename Traits::Sum_Ty;
+        using Prefix_Ty = typename Traits::Prefix_Ty;
+
+        Engine() = default;
+        Engine(const Window& window_defn, std::size_t num_threads = 1);
+
+        void set_window(const Window& window_defn);
+        void set_threads(std::size_t num_threads);
+
+        // Process one azimuth, [first, last). Cells above the threshold keep their
+        // value (in dB, or raw); the others are zero. out holds (last - first) values.
+        //
+        void process(const T* first, const T* last, Unit::dB* out);
+        void process_as_raw(const T* first, const T* last, T* out);
+
+        // Process a rotation of num_azimuths x num_bins values, stored azimuth by
+        // azimuth, into out, of the same size. The azimuths are shared out between
+        // the engine's threads.
+        //
+        void process_rotation(const T* data, std::size_t num_azimuths, std::size_t num_bins, Unit::dB* out);
+        void process_rotation_as_raw(const T* data, std::size_t num_azimuths, std::size_t num_bins, T* out);
+
+    private:
+        struct Workspace {
+            std::vector<Prefix_Ty>              prefix  { };
+            std::vector<Sum_Ty>                 noise   { };    // Sum of the noise estimate of each cell...
+            std::vector<Sum_Ty>                 cells   { };    // ...and the number of cells it sums
+            Implementation::Ordered_cells<T>    ordered { };    // For OS-CFAR
         };
 
+        Window                  window      { 11, 2 };
+        Sum_Ty                  threshold   { };
+        std::vector<Workspace>  workspaces  = std::vector<Workspace>(1);
+        Utility::Worker_pool    workers     { };
 
-        template <typename Iterator_Ty>
-        Raw_window_slider<Iterator_Ty>::Raw_window_slider(const Window& window_defn, Iterator_Ty min_bin, Iterator_Ty max_bin) :
-            window      { window_defn },
-            range_start { min_bin },
-            range_end   { max_bin }
-        {
+        void estimate_mean(const T* data, std::size_t sz, Workspace& ws) const;
+        void estimate_ordered(const T* data, std::size_t sz, Workspace& ws) const;
+
+        template <typename Out_Ty, typename Convert_fn>
+        void process_azimuth(const T* data, std::size_t sz, Out_Ty* out, Workspace& ws, Convert_fn convert) const;
+
+        template <typename Out_Ty, typename Convert_fn>
+        void process_azimuths(const T* data, std::size_t num_azimuths, std::size_t num_bins, Out_Ty* out, Convert_fn convert);
+    };
+
+
+    template <typename T>
+    Engine<T>::Engine(const Window& window_defn, std::size_t num_threads)
+    {
+        set_window(window_defn);
+        set_threads(num_threads);
+    }
+
+
+    template <typename T>
+    void Engine<T>::set_window(const Window& window_defn)
+    {
+        window    = window_defn;
+        threshold = static_cast<Sum_Ty>(Traits::from_dB(window.threshold_delta));
+    }
+
+
+    template <typename T>
+    void Engine<T>::set_threads(std::size_t num_threads)
+    {
+        workspaces.resize(std::max(num_threads, std::size_t { 1 }));
+        workers.set_workers(workspaces.size());
+    }
+
+
+    template <typename T>
+    void Engine<T>::process(const T* first, const T* last, Unit::dB* out)
+    {
+        process_azimuth(first, last - first, out, workspaces[0], [](T value) { return Traits::to_dB(value); });
+    }
+
+
+    template <typename T>
+    void Engine<T>::process_as_raw(const T* first, const T* last, T* out)
+    {
+        process_azimuth(first, last - first, out, workspaces[0], [](T value) { return value; });
+    }
+
+
+    template <typename T>
+    void Engine<T>::process_rotation(const T* data, std::size_t num_azimuths, std::size_t num_bins, Unit::dB* out)
+    {
+        process_azimuths(data, num_azimuths, num_bins, out, [](T value) { return Traits::to_dB(value); });
+    }
+
+
+    template <typename T>
+    void Engine<T>::process_rotation_as_raw(const T* data, std::size_t num_azimuths, std::size_t num_bins, T* out)
+    {
+        process_azimuths(data, num_azimuths, num_bins, out, [](T value) { return value; });
+    }
+
+
+    template <typename T>
+    void Engine<T>::estimate_mean(const T* data, std::size_t sz, Workspace& ws) const
+    {
+        using Implementation::training_cells;
+
+        const std::ptrdiff_t n     { static_cast<std::ptrdiff_t>(sz) };
+        const std::ptrdiff_t half  { window.size / 2 };
+        const std::ptrdiff_t guard { window.guard_cells };
+
+        ws.prefix.resize(sz + 1);
+        Prefix_Ty* prefix { ws.prefix.data() };
+        Sum_Ty*    noise  { ws.noise.data() };
+        Sum_Ty*    cells  { ws.cells.data() };
+
+        prefix[0] = Prefix_Ty { };
+        for (std::ptrdiff_t i { 0 }; i < n; ++i) {
+            prefix[i + 1] = prefix[i] + data[i];
         }
 
+        auto sum = [prefix](std::ptrdiff_t begin, std::ptrdiff_t end)
+        {
+            return static_cast<Sum_Ty>(prefix[end] - prefix[begin]);
+        };
 
-        template <typename Iterator_Ty>
-        std::pair<typename Raw_window_slider<Iterator_Ty>::Value_Ty, std::size_t> 
-        Raw_window_slider<Iterator_Ty>::process_cell(Iterator_Ty const elem_ptr)
+        // Cells whose window is slewed, or has one empty side
+        //
+        auto estimate_cell = [&](std::ptrdiff_t cell)
         {
-            using namespace std;
-            using namespace Unit;
+            auto   training   { training_cells(cell, n, window) };
+            Sum_Ty lower      { sum(training.lower_begin, training.lower_end) };
+            Sum_Ty upper      { sum(training.upper_begin, training.upper_end) };
+            Sum_Ty lower_sz   { static_cast<Sum_Ty>(training.lower_size()) };
+            Sum_Ty upper_sz   { static_cast<Sum_Ty>(training.upper_size()) };
+
+            if (window.method == Method::cell_average || lower_sz == 0 || upper_sz == 0) {
+                noise[cell] = lower + upper;
+                cells[cell] = lower_sz + upper_sz;
+                return;
+            }
 
-            Iterator_Ty lower_begin { elem_ptr - (window.size / 2) };
-            Iterator_Ty lower_end   { elem_ptr - window.guard_cells };
+            // Compare the means without dividing
+            //
+            bool lower_is_greater { static_cast<double>(lower) * upper_sz > static_cast<double>(upper) * lower_sz };
+            bool use_lower        { (window.method == Method::greatest_of) == lower_is_greater };
 
-            Iterator_Ty upper_begin { elem_ptr + window.guard_cells + 1 };
-            Iterator_Ty upper_end   { elem_ptr + (window.size / 2) + 1 };
+            noise[cell] = use_lower ? lower    : upper;
+            cells[cell] = use_lower ? lower_sz : upper_sz;
+        };
 
+        const std::ptrdiff_t full_begin { std::min(half, n) };
+        const std::ptrdiff_t full_end   { std::max(n - half, full_begin) };
 
-            if (lower_begin < range_start) {
-                lower_begin = range_start;
-                upper_end   = lower_begin + window.size;
-            }
+        for (std::ptrdiff_t cell { 0 }; cell < full_begin; ++cell)  estimate_cell(cell);
+        for (std::ptrdiff_t cell { full_end }; cell < n; ++cell)    estimate_cell(cell);
 
-            if (upper_end > range_end) {
-                upper_end = range_end;
-                lower_begin = upper_end - window.size;
-            }
+        // Full windows; both sides have the same number of training cells
+        //
+        const Sum_Ty side_sz { static_cast<Sum_Ty>(half - guard) };
+
+        switch (window.method) {
+            case Method::greatest_of:
+                for (std::ptrdiff_t cell { full_begin }; cell < full_end; ++cell) {
+                    Sum_Ty lower { static_cast<Sum_Ty>(prefix[cell - guard] - prefix[cell - half]) };
+                    Sum_Ty upper { static_cast<Sum_Ty>(prefix[cell + half + 1] - prefix[cell + guard + 1]) };
+                    noise[cell] = std::max(lower, upper);
+                    cells[cell] = side_sz;
+                }
+                break;
+
+            case Method::smallest_of:
+                for (std::ptrdiff_t cell { full_begin }; cell < full_end; ++cell) {
+                    Sum_Ty lower { static_cast<Sum_Ty>(prefix[cell - guard] - prefix[cell - half]) };
+                    Sum_Ty upper { static_cast<Sum_Ty>(prefix[cell + half + 1] - prefix[cell + guard + 1]) };
+                    noise[cell] = std::min(lower, upper);
+                    cells[cell] = side_sz;
+                }
+                break;
+
+            default:
+                for (std::ptrdiff_t cell { full_begin }; cell < full_end; ++cell) {
+                    Sum_Ty lower { static_cast<Sum_Ty>(prefix[cell - guard] - prefix[cell - half]) };
+                    Sum_Ty upper { static_cast<Sum_Ty>(prefix[cell + half + 1] - prefix[cell + guard + 1]) };
+                    noise[cell] = lower + upper;
+                    cells[cell] = 2 * side_sz;
+                }
+                break;
+        }
+    }
 
-            if (lower_end < range_start) {
-                lower_end = range_start;
-            }
 
-            if (lower_begin > lower_end) {
-                lower_begin = lower_end;
-            }
+    template <typename T>
+    void Engine<T>::estimate_ordered(const T* data, std::size_t sz, Workspace& ws) const
+    {
+        using Implementation::training_cells;
 
-            if (upper_begin > upper_end) {
-                upper_begin = upper_end;
-            }
-            
-            Sum_Ty      lower_sum    { accumulate(lower_begin, lower_end, Value_Ty { }) };
-            Sum_Ty      upper_sum    { accumulate(upper_begin, upper_end, Value_Ty { }) };
-            auto        elems        { std::distance(lower_begin, lower_end) + std::distance(upper_begin, upper_end) };
-            Value_Ty    average      { static_cast<Value_Ty>((lower_sum + upper_sum) / elems) };
-            Value_Ty    cell_value   { *elem_ptr };
-
-            if (cell_value > (average + threshold)) {
-                ++threshold_exceeded_count;
-                return std::make_pair(cell_value, threshold_exceeded_count);
-            }
-            else {
-                return std::make_pair(0.0f, threshold_exceeded_count);
+        const std::ptrdiff_t n { static_cast<std::ptrdiff_t>(sz) };
+        auto&                ordered { ws.ordered };
+
+        // The training cells move up with the cell-under-test, so each cell
+        // is added to, and removed from, each side at most once.
+        //
+        Implementation::Training_cells current { };
+
+        for (std::ptrdiff_t cell { 0 }; cell < n; ++cell) {
+            auto training { training_cells(cell, n, window) };
+
+            while (current.lower_end < training.lower_end)      ordered.insert(data[current.lower_end++]);
+            while (current.lower_begin < training.lower_begin)  ordered.remove(data[current.lower_begin++]);
+            while (current.upper_end < training.upper_end)      ordered.insert(data[current.upper_end++]);
+            while (current.upper_begin < training.upper_begin)  ordered.remove(data[current.upper_begin++]);
+
+            if (ordered.size() == 0) {
+                ws.noise[cell] = Sum_Ty { };
+                ws.cells[cell] = Sum_Ty { };
+                continue;
             }
+
+            std::size_t k { std::min(static_cast<std::size_t>(window.order * ordered.size()), ordered.size() - 1) };
+            ws.noise[cell] = static_cast<Sum_Ty>(ordered.kth(k));
+            ws.cells[cell] = Sum_Ty { 1 };
         }
 
-    } // namespace Implementation
+        // Leave the workspace empty for the next azimuth
+        //
+        while (current.lower_begin < current.lower_end) ordered.remove(data[current.lower_begin++]);
+        while (current.upper_begin < current.upper_end) ordered.remove(data[current.upper_begin++]);
+    }
+
+
+    template <typename T>
+    template <typename Out_Ty, typename Convert_fn>
+    void Engine<T>::process_azimuth(const T* data, std::size_t sz, Out_Ty* out, Workspace& ws, Convert_fn convert) const
+    {
+        ws.noise.resize(sz);
+        ws.cells.resize(sz);
+
+        if (window.method == Method::ordered_statistic) estimate_ordered(data, sz, ws);
+        else                                            estimate_mean(data, sz, ws);
+
+        // value > noise / cells + threshold, as value * cells > noise + threshold * cells
+        // so that integer data needs no division. Cells with no training cells
+        // are never detected.
+        //
+        const Sum_Ty* noise { ws.noise.data() };
+        const Sum_Ty* cells { ws.cells.data() };
+
+        for (std::size_t i { 0 }; i < sz; ++i) {
+            bool detected { static_cast<Sum_Ty>(data[i]) * cells[i] > noise[i] + threshold * cells[i] };
+            out[i] = detected ? static_cast<Out_Ty>(convert(data[i])) : Out_Ty { };
+        }
+    }
+
+
+    template <typename T>
+    template <typename Out_Ty, typename Convert_fn>
+    void Engine<T>::process_azimuths(const T* data, std::size_t num_azimuths, std::size_t num_bins, Out_Ty* out, Convert_fn convert)
+    {
+        const std::size_t num_threads { std::min(workspaces.size(), num_azimuths) };
+
+        auto process_share = [&](std::size_t thread_idx)
+        {
+            std::size_t first { num_azimuths * thread_idx / num_threads };
+            std::size_t last  { num_azimuths * (thread_idx + 1) / num_threads };
+
+            for (std::size_t azimuth { first }; azimuth < last; ++azimuth) {
+                std::size_t offset { azimuth * num_bins };
+                process_azimuth(data + offset, num_bins, out + offset, workspaces[thread_idx], convert);
+            }
+        };
+
+        workers.run(num_threads, process_share);
+    }
 
 
+    // -----------------------------------------------------------------------------------------------------------------
+    //
     template <typename Iterator_Ty>    
     std::vector<Point> points(
         Iterator_Ty     data, 
@@ -554,24 +883,26 @@ namespace Navtech::CA_CFAR {
     )
     {
         using namespace Unit;
+        using Value_Ty = typename std::iterator_traits<Iterator_Ty>::value_type;
+
+        static_assert(Implementation::is_contiguous_v<Iterator_Ty>, "CFAR data must be a pointer or std::vector iterator");
 
         std::vector<Point> output { };
+        if (range.size() == 0) return output;
+
         output.reserve(max_points);
 
-        Iterator_Ty start  { data + range.start };
-        Iterator_Ty finish { data + range.end };
+        const Value_Ty* start { std::addressof(*(data + range.start)) };
+        std::vector<dB> power(range.size());
 
-        Implementation::Window_slider<Iterator_Ty> slider {
-            window,
-            start,
-            finish
-        };
+        Engine<Value_Ty> engine { window };
+        engine.process(start, start + range.size(), power.data());
 
         for (Bin bin { range.start }; bin < range.end; ++bin) {
-            auto [power, count] = slider.process_cell(data + bin);
+            if (power[bin - range.start] <= 0_dB) continue;
 
-            if (power > 0_dB)        output.emplace_back(to_metre(bin), power);
-            if (count == max_points) break;
+            output.emplace_back(to_metre(bin), power[bin - range.start]);
+            if (output.size() == max_points) break;
         }
 
         return output;
@@ -583,22 +914,18 @@ namespace Navtech::CA_CFAR {
     std::vector<Unit::dB> process(Iterator_Ty first, Iterator_Ty last, const Window& window)
     {
         using namespace Unit;
+        using Value_Ty = typename std::iterator_traits<Iterator_Ty>::value_type;
 
-        Implementation::Window_slider<Iterator_Ty> slider {
-            window,
-            first,
-            last
-        };
+        static_assert(Implementation::is_contiguous_v<Iterator_Ty>, "CFAR data must be a pointer or std::vector iterator");
 
         std::vector<dB> output { };
         output.resize(std::distance(first, last));
+        if (output.empty()) return output;
 
-        auto out_itr = output.begin();
+        const Value_Ty* start { std::addressof(*first) };
 
-        for (auto itr { first }; itr != last; ++itr) {
-            *out_itr = slider.process_cell(itr).first;
-            ++out_itr;
-        }
+        Engine<Value_Ty> engine { window };
+        engine.process(start, start + output.size(), output.data());
 
         return output;
     }
@@ -616,21 +943,16 @@ namespace Navtech::CA_CFAR {
     {
         using Value_Ty = typename std::iterator_traits<Iterator_Ty>::value_type;
 
-        Implementation::Raw_window_slider<Iterator_Ty> slider {
-            window,
-            first,
-            last
-        };
+        static_assert(Implementation::is_contiguous_v<Iterator_Ty>, "CFAR data must be a pointer or std::vector iterator");
 
         std::vector<Value_Ty> output { };
         output.resize(std::distance(first, last));
+        if (output.empty()) return output;
 
-        auto out_itr = output.begin();
+        const Value_Ty* start { std::addressof(*first) };
 
-        for (auto itr { first }; itr != last; ++itr) {
-            *out_itr = slider.process_cell(itr).first;
-            ++out_itr;
-        }
+        Engine<Value_Ty> engine { window };
+        engine.process_as_raw(start, start + output.size(), output.data());
 
         return output;
     }
@@ -32,7 +32,7 @@ namespace Navtech::Utility::Compression {
     {
         std::vector<std::uint8_t> decompress(std::vector<std::uint8_t>& compressed)
         {
-            return Compression::decompress(compressed, -MAX_WBITS);
+            return Compression::decompress(compressed, window_bits);
         }
     } // namespace ZLIB
     
@@ -41,48 +41,153 @@ namespace Navtech::Utility::Compression {
     {
         std::vector<std::uint8_t> decompress(std::vector<std::uint8_t>& compressed)
         {
-            return Compression::decompress(compressed, 16 + MAX_WBITS);
+            return Compression::decompress(compressed, window_bits);
         }        
     } // namespace ZLIB
 
 
     std::vector<std::uint8_t> decompress(std::vector<std::uint8_t>& compressed, int wbits) 
     {
-        // Adapted from https://www.zlib.net/zlib_how.html
-        //
-        const std::uint32_t chunk_size { 
-            std::min(std::uint32_t { 1024 }, static_cast<std::uint32_t>(compressed.size())) 
-        };
         std::vector<std::uint8_t> decompressed { };
 
-        z_stream stream { };
-        std::memset(&stream, 0, sizeof(z_stream));
+        Inflater { wbits }.decompress(compressed.data(), compressed.size(), decompressed);
+
+        return decompressed;
+    }
+
+
+    // ----------------------------------------------------------------------------------------------------------------
+    //
+    Inflater::Inflater(int wbits) :
+        stream  { std::make_unique<z_stream>() },
+        wbits   { wbits }
+    {
+    }
+
+
+    Inflater::~Inflater()
+    {
+        if (initialised) ::inflateEnd(stream.get());
+    }
+
 
-        stream.next_in = reinterpret_cast<Bytef*>(compressed.data());
-        stream.avail_in = static_cast<std::uint32_t>(compressed.size());
+    Inflater::Inflater(Inflater&& other) noexcept :
+        stream      { std::move(other.stream) },
+        wbits       { other.wbits },
+        initialised { other.initialised }
+    {
+        other.initialised = false;
+    }
 
-        if (::inflateInit2(&stream, wbits) != Z_OK) return decompressed;
+
+    Inflater& Inflater::operator=(Inflater&& rhs) noexcept
+    {
+        if (this == &rhs) return *this;
+        if (initialised) ::inflateEnd(stream.get());
+
+        stream          = std::move(rhs.stream);
+        wbits           = rhs.wbits;
+        initialised     = rhs.initialised;
+        rhs.initialised = false;
         
-        std::vector<std::uint8_t> out_buff(chunk_size);
+        return *this;
+    }
+
+
+    bool Inflater::decompress(
+        const std::uint8_t*         data, 
+        std::size_t                 size, 
+        std::vector<std::uint8_t>&  out, 
+        std::size_t                 max_size
+    )
+    {
+        out.clear();
+        if (max_size == 0) return false;
+
+        return inflate_into(data, size, 0, out, max_size);
+    }
+
+
+    bool Inflater::decompress_after(
+        std::size_t                 skip,
+        const std::uint8_t*         data, 
+        std::size_t                 size, 
+        std::vector<std::uint8_t>&  out
+    )
+    {
+        out.clear();
+
+        return inflate_into(data, size, skip, out, no_limit);
+    }
+
+
+    bool Inflater::inflate_into(
+        const std::uint8_t*         data, 
+        std::size_t                 size, 
+        std::size_t                 skip,
+        std::vector<std::uint8_t>&  out, 
+        std::size_t                 max_size
+    )
+    {
+        if (!stream) return false;
+
+        // Adapted from https://www.zlib.net/zlib_how.html, but inflating
+        // directly into the output rather than via an intermediate chunk
+        //
+        if (!initialised) {
+            *stream = z_stream { };
+            if (::inflateInit2(stream.get(), wbits) != Z_OK) return false;
+            initialised = true;
+        }
+        else if (::inflateReset2(stream.get(), wbits) != Z_OK) {
+            return false;
+        }
+
+        stream->next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data));
+        stream->avail_in = static_cast<uInt>(size);
 
         int ret { Z_OK };
 
-        do {
-            stream.avail_out = chunk_size;
-            stream.next_out = reinterpret_cast<Bytef*>(out_buff.data());
+        // Skipped bytes are inflated into a scratch buffer, rather than into out
+        //
+        std::uint8_t scratch[64];
 
-            ret = ::inflate(&stream, Z_NO_FLUSH);
+        while (stream->total_out < skip) {
+            stream->next_out  = scratch;
+            stream->avail_out = static_cast<uInt>(std::min(sizeof(scratch), skip - stream->total_out));
 
-            decompressed.insert(decompressed.end(), out_buff.begin(), out_buff.end());
-        } while (ret == Z_OK);
-        
+            ret = ::inflate(stream.get(), Z_NO_FLUSH);
 
-        ::inflateEnd(&stream);
-        
-        decompressed.resize(stream.total_out);
-        decompressed.erase(decompressed.begin() + stream.total_out, decompressed.end());
+            if (ret == Z_STREAM_END)    return stream->total_out == skip;
+            if (ret != Z_OK)            return false;
+        }
 
-        return decompressed;
+        // Radar data typically compresses around 3:1; start from there
+        // (or the buffer's existing capacity) and double as required.
+        //
+        const std::size_t min_chunk { 1024 };
+        std::size_t out_size { std::min(max_size, std::max({ out.capacity(), 4 * size, min_chunk })) };
+        out.resize(out_size);
+
+        while (true) {
+            std::size_t written { stream->total_out - skip };
+
+            stream->next_out  = reinterpret_cast<Bytef*>(out.data() + written);
+            stream->avail_out = static_cast<uInt>(out_size - written);
+
+            ret = ::inflate(stream.get(), Z_NO_FLUSH);
+
+            if (ret != Z_OK)                            break;
+            if (stream->avail_out != 0)                 break;
+            if (stream->total_out - skip >= max_size)   break;
+
+            out_size = std::min(max_size, 2 * out_size);
+            out.resize(out_size);
+        }
+
+        out.resize(stream->total_out - skip);
+
+        return (ret == Z_STREAM_END) || (out.size() == max_size);
     }
 
 } // namespace Navtech::Utility::Compression
\ No newline at end of file
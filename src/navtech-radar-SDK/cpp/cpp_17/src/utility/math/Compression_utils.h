@@ -23,11 +23,21 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <memory>
+
+struct z_stream_s;
 
 namespace Navtech::Utility::Compression {
 
     namespace GZIP 
     {
+        // Window bits for the raw deflate streams stored
+        // in colraw recordings (-MAX_WBITS)
+        //
+        constexpr int window_bits { -15 };
+
         // Decompress using the gzip format
         //
         std::vector<std::uint8_t> decompress(std::vector<std::uint8_t>& compressed);
@@ -37,6 +47,11 @@ namespace Navtech::Utility::Compression {
 
     namespace ZLIB 
     {
+        // Window bits for the gzip-wrapped streams stored
+        // in radar recordings (16 + MAX_WBITS)
+        //
+        constexpr int window_bits { 16 + 15 };
+
         // Decompress using the zlib format
         //
         std::vector<std::uint8_t> decompress(std::vector<std::uint8_t>& compressed);
@@ -46,6 +61,65 @@ namespace Navtech::Utility::Compression {
     // wbits represents the width bit of the compressed array
     // 
     std::vector<std::uint8_t> decompress(std::vector<std::uint8_t>& compressed, int wbits);
+
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // An Inflater keeps a single z_stream alive across calls, resetting
+    // rather than re-initialising it for each buffer.  Output is written
+    // straight into the caller's vector, re-using whatever capacity it
+    // already has.
+    // An Inflater is not thread-safe; give each thread its own.
+    //
+    class Inflater {
+    public:
+        static constexpr std::size_t no_limit { std::numeric_limits<std::size_t>::max() };
+
+        Inflater(int wbits);
+        ~Inflater();
+
+        Inflater(const Inflater&)               = delete;
+        Inflater& operator=(const Inflater&)    = delete;
+        Inflater(Inflater&&) noexcept;
+        Inflater& operator=(Inflater&&) noexcept;
+
+        // Replaces the contents of out with the inflated [data, data + size).
+        // Inflation stops after max_size bytes; this allows a header to be
+        // peeked without inflating the whole buffer.
+        // Returns false if the stream is corrupt or truncated (out holds
+        // whatever could be inflated).
+        //
+        bool decompress(
+            const std::uint8_t*         data, 
+            std::size_t                 size, 
+            std::vector<std::uint8_t>&  out, 
+            std::size_t                 max_size = no_limit
+        );
+
+        // As decompress(), but the first skip bytes of the inflated data are
+        // discarded rather than written to out; so a header can be dropped
+        // without moving the rest of the output down over it.
+        // Returns false if the data inflates to fewer than skip bytes.
+        //
+        bool decompress_after(
+            std::size_t                 skip,
+            const std::uint8_t*         data, 
+            std::size_t                 size, 
+            std::vector<std::uint8_t>&  out
+        );
+
+    private:
+        std::unique_ptr<z_stream_s> stream;
+        int  wbits;
+        bool initialised { false };
+
+        bool inflate_into(
+            const std::uint8_t*         data, 
+            std::size_t                 size, 
+            std::size_t                 skip,
+            std::vector<std::uint8_t>&  out, 
+            std::size_t                 max_size
+        );
+    };
     
 } // namespace Navtech::Utility::Compression
 #endif
\ No newline at end of file
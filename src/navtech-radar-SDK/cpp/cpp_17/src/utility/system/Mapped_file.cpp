@@ -0,0 +1,197 @@
+// ---------------------------------------------------------------------------------------------------------------------
+// Copyright 2025 Navtech Radar Limited
+// This file is part of IASDK which is released under The MIT License (MIT).
+// See file LICENSE.txt in project root or go to https://opensource.org/licenses/MIT
+// for full license details.
+//
+// Disclaimer:
+// Navtech Radar is furnishing this item "as is". Navtech Radar does not provide 
+// any warranty of the item whatsoever, whether express, implied, or statutory,
+// including, but not limited to, any warranty of merchantability or fitness
+// for a particular purpose or any warranty that the contents of the item will
+// be error-free.
+// In no respect shall Navtech Radar incur any liability for any damages, including,
+// but limited to, direct, indirect, special, or consequential damages arising
+// out of, resulting from, or any way connected to the use of the item, whether
+// or not based upon warranty, contract, tort, or otherwise; whether or not
+// injury was sustained by persons or property or otherwise; and whether or not
+// loss was sustained from, or arose out of, the results of, the item, or any
+// services that may be provided by Navtech Radar.
+// ---------------------------------------------------------------------------------------------------------------------
+#include "Mapped_file.h"
+
+#include <system_error>
+#include <utility>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif _WIN32
+#include <Windows.h>
+#endif
+
+
+namespace Navtech::Utility {
+
+    Mapped_file::Mapped_file(const std::string& filepath)
+    {
+        open(filepath);
+    }
+
+
+    Mapped_file::~Mapped_file()
+    {
+        close();
+    }
+
+
+    Mapped_file::Mapped_file(Mapped_file&& other) noexcept
+    {
+        swap(other);
+    }
+
+
+    Mapped_file& Mapped_file::operator=(Mapped_file&& rhs) noexcept
+    {
+        Mapped_file old { std::move(rhs) };
+        swap(old);
+        return *this;
+    }
+
+
+    bool Mapped_file::is_open() const
+    {
+        return opened;
+    }
+
+
+    void Mapped_file::swap(Mapped_file& other) noexcept
+    {
+        using std::swap;
+
+        swap(base,    other.base);
+        swap(length,  other.length);
+        swap(opened,  other.opened);
+        swap(file,    other.file);
+#ifdef _WIN32
+        swap(mapping, other.mapping);
+#endif
+    }
+
+
+#ifdef __linux__
+    void Mapped_file::open(const std::string& filepath)
+    {
+        close();
+
+        file = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0) throw std::system_error { errno, std::system_category(), "Mapped file open [" + filepath + "]" };
+
+        struct stat status { };
+        if (::fstat(file, &status) < 0) {
+            auto err = errno;
+            close();
+            throw std::system_error { err, std::system_category(), "Mapped file stat [" + filepath + "]" };
+        }
+
+        opened = true;
+        length = static_cast<std::size_t>(status.st_size);
+
+        // An empty file cannot be mapped; it is simply
+        // an open file with no data
+        //
+        if (length == 0) return;
+
+        auto addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+        if (addr == MAP_FAILED) {
+            auto err = errno;
+            close();
+            throw std::system_error { err, std::system_category(), "Mapped file mmap [" + filepath + "]" };
+        }
+
+        base = static_cast<const std::uint8_t*>(addr);
+
+        // Recordings are mostly replayed front-to-back, so ask
+        // for aggressive read-ahead.  This is only a hint.
+        //
+        ::madvise(addr, length, MADV_SEQUENTIAL);
+    }
+
+
+    void Mapped_file::close()
+    {
+        if (base)       ::munmap(const_cast<std::uint8_t*>(base), length);
+        if (file >= 0)  ::close(file);
+
+        base    = nullptr;
+        length  = 0;
+        file    = -1;
+        opened  = false;
+    }
+
+#elif _WIN32
+    void Mapped_file::open(const std::string& filepath)
+    {
+        close();
+
+        file = ::CreateFileA(
+            filepath.c_str(), 
+            GENERIC_READ, 
+            FILE_SHARE_READ, 
+            nullptr, 
+            OPEN_EXISTING, 
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 
+            nullptr
+        );
+        if (file == INVALID_HANDLE_VALUE) {
+            file = nullptr;
+            throw std::system_error { static_cast<int>(::GetLastError()), std::system_category(), "Mapped file open [" + filepath + "]" };
+        }
+
+        LARGE_INTEGER file_size { };
+        if (!::GetFileSizeEx(file, &file_size)) {
+            auto err = static_cast<int>(::GetLastError());
+            close();
+            throw std::system_error { err, std::system_category(), "Mapped file size [" + filepath + "]" };
+        }
+
+        opened = true;
+        length = static_cast<std::size_t>(file_size.QuadPart);
+
+        if (length == 0) return;
+
+        mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            auto err = static_cast<int>(::GetLastError());
+            close();
+            throw std::system_error { err, std::system_category(), "Mapped file mapping [" + filepath + "]" };
+        }
+
+        auto addr = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!addr) {
+            auto err = static_cast<int>(::GetLastError());
+            close();
+            throw std::system_error { err, std::system_category(), "Mapped file view [" + filepath + "]" };
+        }
+
+        base = static_cast<const std::uint8_t*>(addr);
+    }
+
+
+    void Mapped_file::close()
+    {
+        if (base)       ::UnmapViewOfFile(base);
+        if (mapping)    ::CloseHandle(mapping);
+        if (file)       ::CloseHandle(file);
+
+        base    = nullptr;
+        length  = 0;
+        mapping = nullptr;
+        file    = nullptr;
+        opened  = false;
+    }
+#endif
+
+} // namespace Navtech::Utility
\ No newline at end of file
@@ -0,0 +1,74 @@
+// ---------------------------------------------------------------------------------------------------------------------
+// Copyright 2025 Navtech Radar Limited
+// This file is part of IASDK which is released under The MIT License (MIT).
+// See file LICENSE.txt in project root or go to https://opensource.org/licenses/MIT
+// for full license details.
+//
+// Disclaimer:
+// Navtech Radar is furnishing this item "as is". Navtech Radar does not provide 
+// any warranty of the item whatsoever, whether express, implied, or statutory,
+// including, but not limited to, any warranty of merchantability or fitness
+// for a particular purpose or any warranty that the contents of the item will
+// be error-free.
+// In no respect shall Navtech Radar incur any liability for any damages, including,
+// but limited to, direct, indirect, special, or consequential damages arising
+// out of, resulting from, or any way connected to the use of the item, whether
+// or not based upon warranty, contract, tort, or otherwise; whether or not
+// injury was sustained by persons or property or otherwise; and whether or not
+// loss was sustained from, or arose out of, the results of, the item, or any
+// services that may be provided by Navtech Radar.
+// ---------------------------------------------------------------------------------------------------------------------
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace Navtech::Utility {
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // A Mapped_file maps the whole of a file, read-only, into the process's
+    // address space.  Pages are loaded on demand by the OS, so opening even a
+    // very large file is cheap, and any part of it can be reached without
+    // reading what comes before.
+    // Failing to open or map the file throws std::system_error.
+    //
+    class Mapped_file {
+    public:
+        Mapped_file() = default;
+        Mapped_file(const std::string& filepath);
+        ~Mapped_file();
+
+        Mapped_file(const Mapped_file&)             = delete;
+        Mapped_file& operator=(const Mapped_file&)  = delete;
+        Mapped_file(Mapped_file&& other) noexcept;
+        Mapped_file& operator=(Mapped_file&& rhs) noexcept;
+
+        void open(const std::string& filepath);
+        void close();
+        bool is_open() const;
+
+        const std::uint8_t* data() const    { return base; }
+        std::size_t         size() const    { return length; }
+
+        const std::uint8_t* begin() const   { return base; }
+        const std::uint8_t* end() const     { return base + length; }
+
+    private:
+        const std::uint8_t* base    { nullptr };
+        std::size_t         length  { 0 };
+        bool                opened  { false };
+
+#ifdef __linux__
+        int   file    { -1 };
+#elif _WIN32
+        void* file    { nullptr };
+        void* mapping { nullptr };
+#endif
+        void swap(Mapped_file& other) noexcept;
+    };
+
+} // namespace Navtech::Utility
+
+#endif // MAPPED_FILE_H
\ No newline at end of file
@@ -84,7 +84,7 @@ namespace Navtech::Utility {
     {
         if (!running) return;
         running = false;
-        msg_queue.clear();
+        msg_queue.cancel();
     }
 
 
@@ -108,16 +108,45 @@ namespace Navtech::Utility {
     void Active::dispatch_async()
     {
         auto msg { msg_queue.pop() };
-        if (msg.has_value()) msg.value()();
+        if (msg.has_value()) dispatch_batch(msg.value());
     }
 
 
     bool Active::try_dispatch_async()
     {
-        if (msg_queue.empty()) return false;
+        auto msg { msg_queue.try_pop() };
+        if (!msg.has_value()) return false;
 
-        dispatch_async();
+        dispatch_batch(msg.value());
         return true;
     }
 
+
+    void Active::dispatch_batch(Active::Impl_fn& first)
+    {
+        // Drain whatever else is already queued, rather than
+        // returning to the run policy after every call.
+        //
+        first();
+
+        for (std::size_t i { 1 }; i < max_batch_size && running; ++i) {
+            auto msg { msg_queue.try_pop() };
+            if (!msg.has_value()) break;
+            
+            msg.value()();
+        }
+    }
+
+
+    void Active::wait_strategy(Wait_strategy strategy)
+    {
+        msg_queue.wait_strategy(strategy);
+    }
+
+
+    Active::Queue_statistics Active::queue_statistics() const
+    {
+        return msg_queue.statistics();
+    }
+
 } // namespace Navtech::Utility
\ No newline at end of file
@@ -21,13 +21,16 @@
 #ifndef ACTIVE_H
 #define ACTIVE_H
 
+#include <atomic>
 #include <thread>
 #include <functional>
 #include <string>
 #include <string_view>
 #include <future>
+#include <tuple>
 
-#include "Threadsafe_queue.h"
+#include "MPSC_queue.h"
+#include "Task.h"
 
 namespace Navtech::Utility {
 
@@ -77,10 +80,18 @@ namespace Navtech::Utility {
     // - on_stop() is invoked before the stop() asynchronous handling.  Any messages
     //   on the message queue will still be available.
     //
+    // Asynchronous calls are queued on a lock-free MPSC_queue, as Tasks; a call whose
+    // arguments fit in a Task does not allocate.  Queued calls are dispatched in
+    // batches of up to max_batch_size before the run policy regains control.
+    // By default the thread parks when it has no work; a derived class that needs
+    // lower latency can select Wait_strategy::spin (before start() is called).
+    //
     class Active {
     public:
         enum class Task_state { not_finished, finished };
 
+        using Queue_statistics = MPSC_queue<Task>::Statistics;
+
         Active() = default;
         Active(std::string_view name_str);
         virtual ~Active();
@@ -92,11 +103,21 @@ namespace Navtech::Utility {
         virtual void on_start() { }
         virtual void on_stop()  { }
 
+        Queue_statistics queue_statistics() const;
+
     protected:
+        static constexpr std::size_t max_batch_size { 64 };
+
         template <typename Callable_Ty, typename... Arg_Ty>
         void async_call(Callable_Ty&& callable, Arg_Ty... arg)
         {
-            msg_queue.push(std::bind(callable, std::forward<Arg_Ty>(arg)...));
+            msg_queue.push(
+                Task { 
+                    [fn = std::forward<Callable_Ty>(callable), args = std::make_tuple(std::move(arg)...)]() mutable {
+                        std::apply(fn, args);
+                    }
+                }
+            );
         }
 
         template <typename Return_Ty, typename Callable_Ty, typename... Arg_Ty>
@@ -115,19 +136,22 @@ namespace Navtech::Utility {
         
         bool try_dispatch_async();
 
+        void wait_strategy(Wait_strategy strategy);
+
     private:
         std::thread t;
 
-        using Impl_fn = std::function<void()>;
-        using Queue   = Threadsafe_queue<Impl_fn>;
+        using Impl_fn = Task;
+        using Queue   = MPSC_queue<Impl_fn>;
         
         Queue msg_queue { };
         bool created { false };
-        bool running { false };
+        std::atomic<bool> running { false };
         std::string name { "unknown" };
 
         void stop_impl();
         void dispatch_async();
+        void dispatch_batch(Impl_fn& first);
     };
 
 } // namespace Navtech::Utility
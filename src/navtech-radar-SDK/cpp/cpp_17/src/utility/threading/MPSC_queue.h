@@ -0,0 +1,463 @@
+// ---------------------------------------------------------------------------------------------------------------------
+// Copyright 2025 Navtech Radar Limited
+// This file is part of IASDK which is released under The MIT License (MIT).
+// See file LICENSE.txt in project root or go to https://opensource.org/licenses/MIT
+// for full license details.
+//
+// Disclaimer:
+// Navtech Radar is furnishing this item "as is". Navtech Radar does not provide 
+// any warranty of the item whatsoever, whether express, implied, or statutory,
+// including, but not limited to, any warranty of merchantability or fitness
+// for a particular purpose or any warranty that the contents of the item will
+// be error-free.
+// In no respect shall Navtech Radar incur any liability for any damages, including,
+// but limited to, direct, indirect, special, or consequential damages arising
+// out of, resulting from, or any way connected to the use of the item, whether
+// or not based upon warranty, contract, tort, or otherwise; whether or not
+// injury was sustained by persons or property or otherwise; and whether or not
+// loss was sustained from, or arose out of, the results of, the item, or any
+// services that may be provided by Navtech Radar.
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+
+namespace Navtech::Utility {
+
+    // ---------------------------------------------------------------------------------------------------
+    // How the consumer of an MPSC_queue waits for data:
+    // - park: block on a condition variable as soon as the queue is empty.
+    // - spin: keep polling (yielding the processor) for a short while before
+    //   parking.  This trades some CPU for latency, when items are expected
+    //   in quick succession.
+    //
+    enum class Wait_strategy { park, spin };
+
+
+    // ---------------------------------------------------------------------------------------------------
+    // MPSC_queue is an unbounded, multiple-producer single-consumer, FIFO queue.
+    //
+    // Producers claim a cell of a fixed-size ring with a single atomic operation;
+    // there is no lock and no allocation.  Only if the ring is full are items
+    // pushed onto a mutex-protected overflow list.  Once that has happened, every
+    // push goes onto the overflow list until the consumer has emptied the ring and
+    // taken the list; so items from each producer are always popped in the order
+    // they were pushed.
+    // Producers only take a lock, to wake the consumer, if the consumer is parked.
+    //
+    // Reading the clock costs as much as a push, so latency is sampled: only
+    // one item in latency_sample_interval is timestamped.
+    //
+    // push(), cancel(), empty(), size() and statistics() may be called from any
+    // thread; pop() and try_pop() only from the (single) consumer thread.
+    //
+    template <typename T>
+    class MPSC_queue {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct Statistics {
+            std::size_t              depth;           // Items currently queued
+            std::size_t              max_depth;       // High-water mark
+            std::uint64_t            num_popped;
+            std::chrono::nanoseconds mean_latency;    // Time from push to pop, of sampled items
+            std::chrono::nanoseconds max_latency;
+        };
+
+        static constexpr std::size_t default_capacity        { 256 };
+        static constexpr std::size_t latency_sample_interval { 64 };
+
+        MPSC_queue(std::size_t ring_capacity = default_capacity);
+        ~MPSC_queue();
+
+        MPSC_queue(const MPSC_queue&)               = delete;
+        MPSC_queue& operator=(const MPSC_queue&)    = delete;
+
+        template <typename U> void push(U&& in_val);
+
+        // Blocks until an item is available, or the queue has been cancelled
+        //
+        std::optional<T> pop();
+        std::optional<T> try_pop();
+
+        // Wake the consumer; all subsequent pops return no value.
+        // Items still queued are destroyed with the queue.
+        //
+        void cancel();
+        bool is_cancelled() const;
+
+        void wait_strategy(Wait_strategy strategy);
+
+        bool        empty() const;
+        std::size_t size()  const;
+        Statistics  statistics() const;
+
+    private:
+        struct Cell {
+            std::atomic<std::size_t> sequence { };
+            Clock::time_point        enqueued { };
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+
+        struct Entry {
+            Clock::time_point enqueued;
+            T                 value;
+        };
+
+        static constexpr unsigned spin_limit { 2000 };
+
+        // Ring
+        //
+        std::unique_ptr<Cell[]>              cells { };
+        std::size_t                          mask  { };
+        alignas(64) std::atomic<std::size_t> enqueue_pos { 0 };
+        alignas(64) std::atomic<std::size_t> dequeue_pos { 0 };
+
+        // Overflow, when the ring is full.  drained holds
+        // overflow items taken by the consumer
+        //
+        std::mutex          overflow_mtx { };
+        std::deque<Entry>   overflow     { };
+        std::atomic<bool>   overflowed   { false };
+        std::deque<Entry>   drained      { };
+
+        // Consumer waiting
+        //
+        std::mutex              park_mtx    { };
+        std::condition_variable has_data    { };
+        std::atomic<bool>       parked      { false };
+        std::atomic<bool>       cancelled   { false };
+        Wait_strategy           strategy    { Wait_strategy::park };
+
+        // Statistics
+        //
+        std::atomic<std::uint64_t> num_pushed       { 0 };
+        std::atomic<std::uint64_t> num_popped       { 0 };
+        std::atomic<std::size_t>   max_depth        { 0 };
+        std::atomic<std::uint64_t> num_sampled      { 0 };
+        std::atomic<std::uint64_t> total_latency_ns { 0 };
+        std::atomic<std::uint64_t> max_latency_ns   { 0 };
+
+        template <typename U> bool try_push_ring(U&& in_val, Clock::time_point now);
+        std::optional<T> try_pop_ring();
+        bool ring_empty() const;
+        bool has_data_for_consumer() const;
+        void park();
+        void wake_consumer();
+        void popped(Clock::time_point enqueued);
+    };
+
+
+    template <typename T>
+    MPSC_queue<T>::MPSC_queue(std::size_t ring_capacity)
+    {
+        std::size_t sz { 2 };
+        while (sz < ring_capacity) sz <<= 1;
+
+        cells = std::make_unique<Cell[]>(sz);
+        mask  = sz - 1;
+
+        for (std::size_t i { 0 }; i < sz; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+
+    template <typename T>
+    MPSC_queue<T>::~MPSC_queue()
+    {
+        auto last = enqueue_pos.load(std::memory_order_acquire);
+
+        for (auto pos = dequeue_pos.load(std::memory_order_relaxed); pos != last; ++pos) {
+            Cell& cell = cells[pos & mask];
+            if (cell.sequence.load(std::memory_order_acquire) != pos + 1) break;
+            std::launder(reinterpret_cast<T*>(cell.storage))->~T();
+        }
+    }
+
+
+    template <typename T>
+    template <typename U>
+    void MPSC_queue<T>::push(U&& in_val)
+    {
+        auto ticket = num_pushed.fetch_add(1, std::memory_order_relaxed);
+        auto now    = (ticket % latency_sample_interval == 0) ? Clock::now() : Clock::time_point { };
+
+        // Items pushed after this one may already have been popped
+        //
+        auto num_out   = num_popped.load(std::memory_order_relaxed);
+        auto new_depth = static_cast<std::size_t>(num_out < ticket + 1 ? ticket + 1 - num_out : 0);
+        auto max_sz    = max_depth.load(std::memory_order_relaxed);
+
+        while (new_depth > max_sz && !max_depth.compare_exchange_weak(max_sz, new_depth, std::memory_order_relaxed)) { }
+
+        if (overflowed.load(std::memory_order_acquire) || !try_push_ring(std::forward<U>(in_val), now)) {
+            std::lock_guard lock { overflow_mtx };
+
+            overflow.push_back(Entry { now, T { std::forward<U>(in_val) } });
+            overflowed.store(true, std::memory_order_seq_cst);
+        }
+
+        wake_consumer();
+    }
+
+
+    template <typename T>
+    std::optional<T> MPSC_queue<T>::pop()
+    {
+        for (unsigned spins { 0 }; ; ++spins) {
+            auto out_val = try_pop();
+            if (out_val.has_value())                       return out_val;
+            if (cancelled.load(std::memory_order_acquire)) return std::nullopt;
+
+            // A producer has claimed a cell, but not yet written to it.
+            //
+            if (!ring_empty()) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            if (strategy == Wait_strategy::spin && spins < spin_limit) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            park();
+            spins = 0;
+        }
+    }
+
+
+    template <typename T>
+    std::optional<T> MPSC_queue<T>::try_pop()
+    {
+        if (cancelled.load(std::memory_order_acquire)) return std::nullopt;
+
+        // Overflow items, once taken, are older than anything
+        // subsequently pushed onto the ring.
+        //
+        if (drained.empty()) {
+            auto out_val = try_pop_ring();
+            if (out_val.has_value()) return out_val;
+
+            if (!overflowed.load(std::memory_order_acquire)) return std::nullopt;
+            
+            // The ring must be checked under the lock: a producer that pushed
+            // onto the overflow list has already claimed its earlier cells.
+            //
+            std::lock_guard lock { overflow_mtx };
+            
+            if (!ring_empty()) return std::nullopt;
+
+            drained.swap(overflow);
+            overflowed.store(false, std::memory_order_release);
+        }
+
+        if (drained.empty()) return std::nullopt;
+
+        std::optional<T> out_val { std::move(drained.front().value) };
+        popped(drained.front().enqueued);
+        drained.pop_front();
+
+        return out_val;
+    }
+
+
+    template <typename T>
+    void MPSC_queue<T>::cancel()
+    {
+        cancelled.store(true, std::memory_order_seq_cst);
+
+        std::lock_guard lock { park_mtx };
+        has_data.notify_all();
+    }
+
+
+    template <typename T>
+    bool MPSC_queue<T>::is_cancelled() const
+    {
+        return cancelled.load(std::memory_order_acquire);
+    }
+
+
+    template <typename T>
+    void MPSC_queue<T>::wait_strategy(Wait_strategy new_strategy)
+    {
+        strategy = new_strategy;
+    }
+
+
+    template <typename T>
+    bool MPSC_queue<T>::empty() const
+    {
+        return size() == 0;
+    }
+
+
+    template <typename T>
+    std::size_t MPSC_queue<T>::size() const
+    {
+        // Popped is read first; so, as both counts only
+        // increase, pushed can never be seen as the lesser.
+        //
+        auto popped = num_popped.load(std::memory_order_acquire);
+        auto pushed = num_pushed.load(std::memory_order_acquire);
+
+        return static_cast<std::size_t>(pushed - popped);
+    }
+
+
+    template <typename T>
+    typename MPSC_queue<T>::Statistics MPSC_queue<T>::statistics() const
+    {
+        auto sampled = num_sampled.load(std::memory_order_relaxed);
+        auto total   = total_latency_ns.load(std::memory_order_relaxed);
+
+        return Statistics {
+            size(),
+            max_depth.load(std::memory_order_relaxed),
+            num_popped.load(std::memory_order_relaxed),
+            std::chrono::nanoseconds { sampled > 0 ? total / sampled : 0 },
+            std::chrono::nanoseconds { max_latency_ns.load(std::memory_order_relaxed) }
+        };
+    }
+
+
+    template <typename T>
+    template <typename U>
+    bool MPSC_queue<T>::try_push_ring(U&& in_val, Clock::time_point now)
+    {
+        auto pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell { };
+
+        while (true) {
+            cell = &cells[pos & mask];
+            auto seq  = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (cell->storage) T(std::forward<U>(in_val));
+        cell->enqueued = now;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+
+        return true;
+    }
+
+
+    template <typename T>
+    std::optional<T> MPSC_queue<T>::try_pop_ring()
+    {
+        auto  pos  = dequeue_pos.load(std::memory_order_relaxed);
+        Cell& cell = cells[pos & mask];
+
+        if (cell.sequence.load(std::memory_order_acquire) != pos + 1) return std::nullopt;
+
+        auto ptr = std::launder(reinterpret_cast<T*>(cell.storage));
+        std::optional<T> out_val { std::move(*ptr) };
+        ptr->~T();
+        popped(cell.enqueued);
+
+        cell.sequence.store(pos + mask + 1, std::memory_order_release);
+        dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+
+        return out_val;
+    }
+
+
+    template <typename T>
+    bool MPSC_queue<T>::ring_empty() const
+    {
+        return enqueue_pos.load(std::memory_order_seq_cst) == dequeue_pos.load(std::memory_order_relaxed);
+    }
+
+
+    template <typename T>
+    bool MPSC_queue<T>::has_data_for_consumer() const
+    {
+        return (
+            !drained.empty()                                  ||
+            !ring_empty()                                     ||
+            overflowed.load(std::memory_order_seq_cst)        ||
+            cancelled.load(std::memory_order_seq_cst)
+        );
+    }
+
+
+    template <typename T>
+    void MPSC_queue<T>::park()
+    {
+        std::unique_lock lock { park_mtx };
+
+        // The claim of a cell (or the overflow flag), and the parked flag,
+        // are sequentially consistent: either the producer sees that the
+        // consumer is parked, or the consumer sees the producer's item.
+        // The flag is set again before each check, as the producer that
+        // wakes the consumer clears it.
+        //
+        has_data.wait(lock, [this] {
+            parked.store(true, std::memory_order_seq_cst);
+            return has_data_for_consumer();
+        });
+        
+        parked.store(false, std::memory_order_relaxed);
+    }
+
+
+    template <typename T>
+    void MPSC_queue<T>::wake_consumer()
+    {
+        // Only one producer need wake the consumer; the others
+        // may carry on without taking the lock.
+        //
+        if (!parked.load(std::memory_order_seq_cst))     return;
+        if (!parked.exchange(false, std::memory_order_seq_cst)) return;
+
+        std::lock_guard lock { park_mtx };
+        has_data.notify_one();
+    }
+
+
+    template <typename T>
+    void MPSC_queue<T>::popped(Clock::time_point enqueued)
+    {
+        // Only the consumer writes the pop counts
+        //
+        num_popped.store(num_popped.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+        if (enqueued == Clock::time_point { }) return;
+
+        auto latency = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - enqueued).count()
+        );
+
+        num_sampled.store(num_sampled.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        total_latency_ns.store(total_latency_ns.load(std::memory_order_relaxed) + latency, std::memory_order_relaxed);
+        
+        if (latency > max_latency_ns.load(std::memory_order_relaxed)) {
+            max_latency_ns.store(latency, std::memory_order_relaxed);
+        }
+    }
+
+} // namespace Navtech::Utility
+
+#endif // MPSC_QUEUE_H
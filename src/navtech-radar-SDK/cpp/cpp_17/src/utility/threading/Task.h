@@ -0,0 +1,181 @@
+// ---------------------------------------------------------------------------------------------------------------------
+// Copyright 2025 Navtech Radar Limited
+// This file is part of IASDK which is released under The MIT License (MIT).
+// See file LICENSE.txt in project root or go to https://opensource.org/licenses/MIT
+// for full license details.
+//
+// Disclaimer:
+// Navtech Radar is furnishing this item "as is". Navtech Radar does not provide 
+// any warranty of the item whatsoever, whether express, implied, or statutory,
+// including, but not limited to, any warranty of merchantability or fitness
+// for a particular purpose or any warranty that the contents of the item will
+// be error-free.
+// In no respect shall Navtech Radar incur any liability for any damages, including,
+// but limited to, direct, indirect, special, or consequential damages arising
+// out of, resulting from, or any way connected to the use of the item, whether
+// or not based upon warranty, contract, tort, or otherwise; whether or not
+// injury was sustained by persons or property or otherwise; and whether or not
+// loss was sustained from, or arose out of, the results of, the item, or any
+// services that may be provided by Navtech Radar.
+#ifndef TASK_H
+#define TASK_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Navtech::Utility {
+
+    // ---------------------------------------------------------------------------------------------------
+    // A Task is a move-only, type-erased, callable object with the signature void().
+    // It is the unit of work queued on an Active object.
+    //
+    // Unlike std::function, callables of up to inline_size bytes (for example, a 
+    // member function pointer, an object pointer and a few arguments) are stored 
+    // within the Task itself, so constructing a Task does not allocate.  Larger 
+    // callables are moved to the heap.
+    //
+    class Task {
+    public:
+        static constexpr std::size_t inline_size { 64 };
+
+        Task() = default;
+
+        template <
+            typename Callable_Ty, 
+            typename = std::enable_if_t<!std::is_same_v<std::decay_t<Callable_Ty>, Task>>
+        >
+        Task(Callable_Ty&& callable);
+
+        Task(Task&& other) noexcept;
+        Task& operator=(Task&& other) noexcept;
+
+        Task(const Task&)               = delete;
+        Task& operator=(const Task&)    = delete;
+
+        ~Task();
+
+        void operator()();
+        explicit operator bool() const;
+
+        // True if a Task constructed from Callable_Ty holds it inline, without allocating
+        //
+        template <typename Callable_Ty>
+        static constexpr bool is_inline();
+
+    private:
+        struct Operations {
+            void (*invoke)(void* storage);
+            void (*move)(void* from, void* to);
+            void (*destroy)(void* storage);
+        };
+
+        template <typename Fn_Ty>
+        static constexpr bool stored_inline { 
+            sizeof(Fn_Ty)  <= inline_size                 && 
+            alignof(Fn_Ty) <= alignof(std::max_align_t)   &&
+            std::is_nothrow_move_constructible_v<Fn_Ty>
+        };
+
+        template <typename Fn_Ty> static const Operations inline_operations;
+        template <typename Fn_Ty> static const Operations heap_operations;
+
+        alignas(std::max_align_t) unsigned char storage[inline_size];
+        const Operations* ops { nullptr };
+
+        void reset();
+    };
+
+
+    template <typename Fn_Ty>
+    const Task::Operations Task::inline_operations {
+        [](void* storage)           { (*std::launder(reinterpret_cast<Fn_Ty*>(storage)))(); },
+        [](void* from, void* to)    { 
+                                        auto fn = std::launder(reinterpret_cast<Fn_Ty*>(from));
+                                        new (to) Fn_Ty(std::move(*fn));
+                                        fn->~Fn_Ty();
+                                    },
+        [](void* storage)           { std::launder(reinterpret_cast<Fn_Ty*>(storage))->~Fn_Ty(); }
+    };
+
+
+    template <typename Fn_Ty>
+    const Task::Operations Task::heap_operations {
+        [](void* storage)           { (**reinterpret_cast<Fn_Ty**>(storage))(); },
+        [](void* from, void* to)    { *reinterpret_cast<Fn_Ty**>(to) = *reinterpret_cast<Fn_Ty**>(from); },
+        [](void* storage)           { delete *reinterpret_cast<Fn_Ty**>(storage); }
+    };
+
+
+    template <typename Callable_Ty, typename>
+    Task::Task(Callable_Ty&& callable)
+    {
+        using Fn_Ty = std::decay_t<Callable_Ty>;
+
+        if constexpr (stored_inline<Fn_Ty>) {
+            new (storage) Fn_Ty(std::forward<Callable_Ty>(callable));
+            ops = &inline_operations<Fn_Ty>;
+        }
+        else {
+            *reinterpret_cast<Fn_Ty**>(storage) = new Fn_Ty(std::forward<Callable_Ty>(callable));
+            ops = &heap_operations<Fn_Ty>;
+        }
+    }
+
+
+    template <typename Callable_Ty>
+    constexpr bool Task::is_inline()
+    {
+        return stored_inline<std::decay_t<Callable_Ty>>;
+    }
+
+
+    inline Task::Task(Task&& other) noexcept :
+        ops { other.ops }
+    {
+        if (ops) ops->move(other.storage, storage);
+        other.ops = nullptr;
+    }
+
+
+    inline Task& Task::operator=(Task&& other) noexcept
+    {
+        if (this == &other) return *this;
+
+        reset();
+        ops = other.ops;
+        if (ops) ops->move(other.storage, storage);
+        other.ops = nullptr;
+
+        return *this;
+    }
+
+
+    inline Task::~Task()
+    {
+        reset();
+    }
+
+
+    inline void Task::operator()()
+    {
+        ops->invoke(storage);
+    }
+
+
+    inline Task::operator bool() const
+    {
+        return ops != nullptr;
+    }
+
+
+    inline void Task::reset()
+    {
+        if (ops) ops->destroy(storage);
+        ops = nullptr;
+    }
+
+} // namespace Navtech::Utility
+
+#endif // TASK_H
@@ -73,7 +73,7 @@ namespace Navtech::Utility {
         if (Queue::size() == max_sz) return false;
 
         Queue::push(std::forward<U>(in_val));
-        has_data.notify_all();
+        has_data.notify_one();
 
         return true;
     }
@@ -0,0 +1,201 @@
+// ---------------------------------------------------------------------------------------------------------------------
+// Copyright 2025 Navtech Radar Limited
+// This file is part of IASDK which is released under The MIT License (MIT).
+// See file LICENSE.txt in project root or go to https://opensource.org/licenses/MIT
+// for full license details.
+//
+// Disclaimer:
+// Navtech Radar is furnishing this item "as is". Navtech Radar does not provide 
+// any warranty of the item whatsoever, whether express, implied, or statutory,
+// including, but not limited to, any warranty of merchantability or fitness
+// for a particular purpose or any warranty that the contents of the item will
+// be error-free.
+// In no respect shall Navtech Radar incur any liability for any damages, including,
+// but limited to, direct, indirect, special, or consequential damages arising
+// out of, resulting from, or any way connected to the use of the item, whether
+// or not based upon warranty, contract, tort, or otherwise; whether or not
+// injury was sustained by persons or property or otherwise; and whether or not
+// loss was sustained from, or arose out of, the results of, the item, or any
+// services that may be provided by Navtech Radar.
+// ---------------------------------------------------------------------------------------------------------------------
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Navtech::Utility {
+
+    // ---------------------------------------------------------------------------------------------------
+    // Worker_pool shares the jobs of a parallel loop between a fixed set of threads.
+    //
+    // run(num_jobs, fn) calls fn(0) .. fn(num_jobs - 1) and returns when they have
+    // all finished.  fn(0) runs on the calling thread, job n on the pool's n-th
+    // thread; so a pool of num_workers runs up to num_workers jobs at once.
+    // The threads are started by set_workers() and wait between runs, so a run
+    // costs a wake-up rather than the start and join of a thread.  The first
+    // exception thrown by a job is rethrown from run().
+    //
+    // A pool must only be run from one thread at a time.
+    //
+    class Worker_pool {
+    public:
+        Worker_pool() = default;
+        Worker_pool(std::size_t num_workers);
+        ~Worker_pool();
+
+        Worker_pool(const Worker_pool&)             = delete;
+        Worker_pool& operator=(const Worker_pool&)  = delete;
+        Worker_pool(Worker_pool&&)                  = delete;
+        Worker_pool& operator=(Worker_pool&&)       = delete;
+
+        void        set_workers(std::size_t num_workers);
+        std::size_t size() const;
+
+        template <typename Fn_Ty>
+        void run(std::size_t num_jobs, Fn_Ty&& fn);
+
+    private:
+        using Invoke_fn = void (*)(void*, std::size_t);
+
+        std::vector<std::thread>    threads     { };
+        std::mutex                  mtx         { };
+        std::condition_variable     job_ready   { };
+        std::condition_variable     job_done    { };
+        std::uint64_t               generation  { };
+        std::size_t                 jobs        { };
+        std::size_t                 pending     { };
+        Invoke_fn                   invoke      { };
+        void*                       context     { };
+        std::exception_ptr          error       { };
+        bool                        stopping    { };
+
+        void work(std::size_t job, std::uint64_t seen);
+        void stop();
+    };
+
+
+    inline Worker_pool::Worker_pool(std::size_t num_workers)
+    {
+        set_workers(num_workers);
+    }
+
+
+    inline Worker_pool::~Worker_pool()
+    {
+        stop();
+    }
+
+
+    inline void Worker_pool::set_workers(std::size_t num_workers)
+    {
+        if (num_workers == size()) return;
+
+        stop();
+
+        // New threads must not take up the job of a run that has finished
+        //
+        stopping = false;
+        for (std::size_t job { 1 }; job < num_workers; ++job) {
+            threads.emplace_back(&Worker_pool::work, this, job, generation);
+        }
+    }
+
+
+    inline std::size_t Worker_pool::size() const
+    {
+        return threads.size() + 1;
+    }
+
+
+    template <typename Fn_Ty>
+    void Worker_pool::run(std::size_t num_jobs, Fn_Ty&& fn)
+    {
+        using Callable_Ty = std::remove_reference_t<Fn_Ty>;
+
+        if (num_jobs == 0) return;
+        if (num_jobs > size()) num_jobs = size();
+
+        if (num_jobs > 1) {
+            std::lock_guard lock { mtx };
+            invoke  = [](void* callable, std::size_t job) { (*static_cast<Callable_Ty*>(callable))(job); };
+            context = const_cast<void*>(static_cast<const void*>(std::addressof(fn)));
+            jobs    = num_jobs;
+            pending = num_jobs - 1;
+            error   = nullptr;
+            ++generation;
+        }
+        if (num_jobs > 1) job_ready.notify_all();
+
+        std::exception_ptr caller_error { };
+        try {
+            fn(0);
+        }
+        catch (...) {
+            caller_error = std::current_exception();
+        }
+
+        if (num_jobs > 1) {
+            std::unique_lock lock { mtx };
+            job_done.wait(lock, [this] { return pending == 0; });
+            if (!caller_error) caller_error = error;
+        }
+
+        if (caller_error) std::rethrow_exception(caller_error);
+    }
+
+
+    inline void Worker_pool::work(std::size_t job, std::uint64_t seen)
+    {
+        while (true) {
+            Invoke_fn fn       { };
+            void*     callable { };
+            {
+                std::unique_lock lock { mtx };
+                job_ready.wait(lock, [this, seen] { return stopping || generation != seen; });
+                if (stopping) return;
+
+                seen = generation;
+                if (job >= jobs) continue;
+
+                fn       = invoke;
+                callable = context;
+            }
+
+            std::exception_ptr job_error { };
+            try {
+                fn(callable, job);
+            }
+            catch (...) {
+                job_error = std::current_exception();
+            }
+
+            std::lock_guard lock { mtx };
+            if (job_error && !error) error = job_error;
+            if (--pending == 0) job_done.notify_one();
+        }
+    }
+
+
+    inline void Worker_pool::stop()
+    {
+        {
+            std::lock_guard lock { mtx };
+            stopping = true;
+        }
+        job_ready.notify_all();
+
+        for (auto& thread : threads) thread.join();
+        threads.clear();
+    }
+
+} // namespace Navtech::Utility
+
+#endif // WORKER_POOL_H
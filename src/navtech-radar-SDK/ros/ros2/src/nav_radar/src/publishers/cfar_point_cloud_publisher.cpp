@@ -2,6 +2,7 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <algorithm>
 #include <rclcpp/rclcpp.hpp>
 #include <rclcpp/qos.hpp>
 #include <math.h>
@@ -30,13 +31,6 @@ using namespace Navtech::Unit;
 using namespace Navtech::Networking;
 using namespace Navtech::Networking::Colossus_protocol::TCP;
 
-struct ROS_pointcloud_point {
-  std::array<std::uint8_t, 4> x     { };
-  std::array<std::uint8_t, 4> y     { };
-  std::array<std::uint8_t, 4> z     { };
-  std::array<std::uint8_t, 4> power { };
-};
-
 bool Cfar_point_cloud_publisher::rotated_once(Azimuth_num azimuth)
 {
     static bool has_rotated_once { };
@@ -130,8 +124,6 @@ Cfar_point_cloud_publisher::Cfar_point_cloud_publisher():Node{ "cfar_point_cloud
         "radar_data/point_cloud",
         qos_cfar_point_cloud_publisher
     );
-
-    data_vector.reserve(max_possible_points);
 }
 
 
@@ -165,7 +157,7 @@ void Cfar_point_cloud_publisher::publish_point_cloud()
     message.header.frame_id = "point_cloud";
 
     message.height = 1;
-    message.width = points_this_rotation;
+    message.width = point_cloud.size();
     const uint8_t data_type = 7;
     const uint8_t num_bytes = 4; //float32 as bytes
 
@@ -173,33 +165,32 @@ void Cfar_point_cloud_publisher::publish_point_cloud()
     x_field.name = "x";
     x_field.offset = 0 * num_bytes;
     x_field.datatype = data_type;
-    x_field.count = points_this_rotation;
+    x_field.count = message.width;
 
     auto y_field = sensor_msgs::msg::PointField();
     y_field.name = "y";
     y_field.offset = 1 * num_bytes;
     y_field.datatype = data_type;
-    y_field.count = points_this_rotation;
+    y_field.count = message.width;
 
     auto z_field = sensor_msgs::msg::PointField();
     z_field.name = "z";
     z_field.offset = 2 * num_bytes;
     z_field.datatype = data_type;
-    z_field.count = points_this_rotation;
+    z_field.count = message.width;
 
     auto intensity_field = sensor_msgs::msg::PointField();
     intensity_field.name = "intensity";
     intensity_field.offset = 3 * num_bytes;
     intensity_field.datatype = data_type;
-    intensity_field.count = points_this_rotation;
+    intensity_field.count = message.width;
 
     message.fields = std::vector<sensor_msgs::msg::PointField>{x_field, y_field, z_field, intensity_field};
 
     message.is_bigendian = false;
     message.point_step = 4 * num_bytes;
     message.row_step = message.point_step * message.width;
-    data_vector.resize(message.row_step * message.height);
-    message.data = std::move(data_vector);
+    message.data = point_cloud.release();
     message.is_dense = true;
 
     cfar_point_cloud_publisher->publish(message);
@@ -217,28 +208,17 @@ void Cfar_point_cloud_publisher::fft_data_handler(Client& radar_client [[maybe_u
 
     int azimuth_index = (int)(fft->azimuth() / (encoder_size / azimuth_samples));
 
-    // To adjust radar start azimuth, for sake of visualisation
-    // Note - this value will be different for every setup!
-    // Values based on 0 angle of radar, and surrounding landscape
-    int adjusted_azimuth_index = azimuth_index + azimuth_offset;
-    if (adjusted_azimuth_index >= azimuth_samples) {
-        adjusted_azimuth_index = adjusted_azimuth_index - azimuth_samples;
-    }
-
-    auto bearing = static_cast<float>(adjusted_azimuth_index) / static_cast<float>(azimuth_samples) * 360.0;
     auto window_size = static_cast<short unsigned int>(num_train_cells + num_guard_cells + 1);
 
     // Run CFAR
     if ((azimuth_index >= start_azimuth) && (azimuth_index < end_azimuth)) {
-        auto cfar_output = process_as_raw(data, Window { window_size, static_cast<short unsigned int>(num_guard_cells), dB { static_cast<float>(threshold_delta * 2) } });
-        for (unsigned bin_index = start_bin; bin_index < data.size(); bin_index++) {
-            if ((bin_index >= start_bin) && (bin_index < end_bin) && (data[bin_index] > threshold_delta * 2)) {
-                auto range = ((bin_index * bin_size / 10000.0) * range_gain * combined_distance_scale_factor) + range_offset + combined_distance_offset;
-                auto vec = to_ros_format(bearing, range, data[bin_index]);
-                data_vector.insert(data_vector.end(), vec.begin(), vec.end());
-                points_this_rotation += 1;
-            }
-        }
+        cfar.set_window(Window { window_size, static_cast<short unsigned int>(num_guard_cells), dB { static_cast<float>(threshold_delta * 2) } });
+        cfar_output.resize(data.size());
+        cfar.process_as_raw(data.data(), data.data() + data.size(), cfar_output.data());
+
+        auto last_bin = std::min<std::size_t>(end_bin, data.size());
+        auto threshold = static_cast<uint8_t>(std::clamp(threshold_delta * 2, 0, 255));
+        point_cloud.convert(azimuth_index, data.data(), cfar_output.data(), start_bin, last_bin, threshold);
     }
     
     if (!completed_full_rotation(fft->azimuth())) {
@@ -247,8 +227,6 @@ void Cfar_point_cloud_publisher::fft_data_handler(Client& radar_client [[maybe_u
 
     rotation_count++;
     Cfar_point_cloud_publisher::publish_point_cloud();
-    data_vector.reserve(max_possible_points);
-    points_this_rotation = 0;
 
     if (rotation_count >= config_publish_count) {
 
@@ -352,6 +330,7 @@ void Cfar_point_cloud_publisher::fft_data_handler(Client& radar_client [[maybe_u
             threshold_delta = temp_threshold_delta;
         }
 
+        configure_point_cloud();
         configuration_data_publisher->publish(config_message);
         rotation_count = 0;
     }
@@ -406,24 +385,22 @@ void Cfar_point_cloud_publisher::configuration_data_handler(Client& radar_client
     RCLCPP_INFO(Node::get_logger(), "Num guard cells: %i", num_guard_cells);
     RCLCPP_INFO(Node::get_logger(), "Threshold delta: %i", threshold_delta);
 
+    configure_point_cloud();
     radar_client.send(Type::start_fft_data);
 }
 
 
-std::vector<std::uint8_t> Cfar_point_cloud_publisher::to_ros_format(const Degrees& bearing, const Metre& range, const Navtech::Unit::dB& power)
+void Cfar_point_cloud_publisher::configure_point_cloud()
 {
-    using namespace std;
-
-    vector<uint8_t> ros_field { };
-    ros_field.resize(sizeof(ROS_pointcloud_point));
-
-    auto pos = Navtech::Polar::Coordinate(range, bearing).to_cartesian();
-    ROS_pointcloud_point ros_point {};
-    ros_point.x = to_byte_array(static_cast<float> (pos.x + x_distance_offset));
-    ros_point.y = to_byte_array(static_cast<float> (pos.y + y_distance_offset));
-    ros_point.power = to_byte_array(power);
-
-    std::memcpy(ros_field.data(), &ros_point, sizeof(ROS_pointcloud_point));
-
-    return ros_field;
+    // To adjust radar start azimuth, for sake of visualisation
+    // Note - this value will be different for every setup!
+    // Values based on 0 angle of radar, and surrounding landscape
+    //
+    point_cloud.set_azimuths(azimuth_samples, azimuth_offset);
+    point_cloud.set_ranges(
+        range_in_bins,
+        (bin_size / 10000.0) * range_gain * combined_distance_scale_factor,
+        range_offset + combined_distance_offset
+    );
+    point_cloud.set_origin(x_distance_offset, y_distance_offset);
 }
\ No newline at end of file
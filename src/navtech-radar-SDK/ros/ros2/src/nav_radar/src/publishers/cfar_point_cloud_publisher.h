@@ -11,6 +11,8 @@
 #include "Units.h"
 #include "Polar_coordinate.h"
 #include "Cartesian_coordinate.h"
+#include "CFAR_algorithms.h"
+#include "Polar_to_cartesian.h"
 
 using Navtech::Networking::Colossus_protocol::TCP::Client;
 using Navtech::Networking::Colossus_protocol::TCP::Message;
@@ -60,8 +62,8 @@ private:
     //
     void configuration_data_handler(Client& radar_client [[maybe_unused]], Message& msg);
     void fft_data_handler(Client& radar_client [[maybe_unused]], Message& msg);
+    void configure_point_cloud();
     void publish_point_cloud();
-    std::vector<std::uint8_t> to_ros_format(const Degrees&, const Metre&, const Navtech::Unit::dB&);
 
     std::string radar_ip{ "" };
     uint16_t radar_port{ 0 };
@@ -79,13 +81,13 @@ private:
     double x_distance_offset{ 0.0 };
     double y_distance_offset{ 0.0 };
 
-    uint16_t points_this_rotation{ 0 };
-    uint16_t max_possible_points{ 16000 };   // 400 azimuths, 10 points per azimuth max, 4 values per point
-    std::vector<uint8_t> data_vector;
+    Navtech::Polar_to_cartesian::Engine point_cloud{};
 
     int threshold_delta{ 0 };
     int num_train_cells{ 0 };
     int num_guard_cells{ 0 };
+    Navtech::CA_CFAR::Engine<std::uint8_t> cfar{};
+    std::vector<std::uint8_t> cfar_output{};
 
     int azimuth_samples{ 0 };
     int encoder_size{ 0 };
@@ -160,8 +160,6 @@ Navigation_mode_point_cloud_publisher::Navigation_mode_point_cloud_publisher() :
         "radar_data/point_cloud",
         qos_point_cloud_publisher
     );
-
-    data_vector.reserve(max_possible_points);
 }
 
 
@@ -197,7 +195,7 @@ void Navigation_mode_point_cloud_publisher::publish_point_cloud()
     message.header.frame_id = "point_cloud";
 
     message.height = 1;
-    message.width = points_this_rotation;
+    message.width = point_cloud.size();
     const uint8_t data_type = 7;
     const uint8_t num_bytes = 4; //float32 as bytes
 
@@ -205,32 +203,32 @@ void Navigation_mode_point_cloud_publisher::publish_point_cloud()
     x_field.name = "x";
     x_field.offset = 0 * num_bytes;
     x_field.datatype = data_type;
-    x_field.count = points_this_rotation;
+    x_field.count = message.width;
 
     auto y_field = sensor_msgs::msg::PointField();
     y_field.name = "y";
     y_field.offset = 1 * num_bytes;
     y_field.datatype = data_type;
-    y_field.count = points_this_rotation;
+    y_field.count = message.width;
 
     auto z_field = sensor_msgs::msg::PointField();
     z_field.name = "z";
     z_field.offset = 2 * num_bytes;
     z_field.datatype = data_type;
-    z_field.count = points_this_rotation;
+    z_field.count = message.width;
 
     auto intensity_field = sensor_msgs::msg::PointField();
     intensity_field.name = "intensity";
     intensity_field.offset = 3 * num_bytes;
     intensity_field.datatype = data_type;
-    intensity_field.count = points_this_rotation;
+    intensity_field.count = message.width;
 
     message.fields = std::vector<sensor_msgs::msg::PointField>{x_field, y_field, z_field, intensity_field};
 
     message.is_bigendian = false;
     message.point_step = 4 * num_bytes;
     message.row_step = message.point_step * message.width;
-    message.data = std::move(data_vector);
+    message.data = point_cloud.release();
     message.is_dense = true;
 
     point_cloud_publisher->publish(message);
@@ -380,14 +378,6 @@ void Navigation_mode_point_cloud_publisher::navigation_data_handler(Client& rada
         nav_pair_sz             // Number of bytes to copy
     );
 
-    // To adjust radar start azimuth, for sake of visualisation
-    // Note - this value will be different for every setup!
-    // Values based on 0 angle of radar, and surrounding landscape
-    int adjusted_azimuth_index = azimuth_index + azimuth_offset;
-    if (adjusted_azimuth_index >= azimuth_samples) {
-        adjusted_azimuth_index = adjusted_azimuth_index - azimuth_samples;
-    }
-
     //RCLCPP_INFO(Node::get_logger(), "Azimuth index: %i", azimuth_index);
     if ((azimuth_index >= start_azimuth) && (azimuth_index < end_azimuth)) {
         for (const auto peak : nav_pairs) {
@@ -396,11 +386,8 @@ void Navigation_mode_point_cloud_publisher::navigation_data_handler(Client& rada
             auto bin_index = static_cast<int>(target_range / (bin_size / 10000.0));
 
             if ((bin_index >= start_bin) && (bin_index < end_bin)) {
-                auto bearing = static_cast<float>(adjusted_azimuth_index) / static_cast<float>(azimuth_samples) * 360.0;
                 auto range = (target_range * range_gain * combined_distance_scale_factor) + range_offset + combined_distance_offset;
-                auto vec = to_ros_format(bearing, range, target_power);
-                data_vector.insert(data_vector.end(), vec.begin(), vec.end());
-                points_this_rotation += 1;
+                point_cloud.convert(azimuth_index, range, target_power);
             }
         }
     }
@@ -411,9 +398,7 @@ void Navigation_mode_point_cloud_publisher::navigation_data_handler(Client& rada
 
     rotation_count++;
     publish_point_cloud();
-    data_vector.reserve(max_possible_points);
     check_config_publish();
-    points_this_rotation = 0;
 }
 
 
@@ -567,6 +552,7 @@ void Navigation_mode_point_cloud_publisher::check_config_publish()
             update_radar_navigation_config = true;
         }
 
+        configure_point_cloud();
         configuration_data_publisher->publish(config_message);
         rotation_count = 0;
 
@@ -626,6 +612,8 @@ void Navigation_mode_point_cloud_publisher::configuration_data_handler(Client& r
     RCLCPP_INFO(Node::get_logger(), "Azimuth offset: %i", azimuth_offset);
     RCLCPP_INFO(Node::get_logger(), "Processing locally: %s", process_locally ? "true" : "false");
 
+    configure_point_cloud();
+
     if (process_locally) {
         RCLCPP_INFO(Node::get_logger(), "Processing navigation data locally");
         update_local_navigation_config();
@@ -639,22 +627,12 @@ void Navigation_mode_point_cloud_publisher::configuration_data_handler(Client& r
 }
 
 
-std::vector<std::uint8_t> Navigation_mode_point_cloud_publisher::to_ros_format(const Degrees& bearing, const Metre& range, const Navtech::Unit::dB& power)
+void Navigation_mode_point_cloud_publisher::configure_point_cloud()
 {
-    using namespace std;
-
-    vector<uint8_t> ros_field { };
-    
-    auto pos = Navtech::Polar::Coordinate(range, bearing).to_cartesian();
-    auto x_vec = to_vector(static_cast<float> (pos.x + x_distance_offset));
-    auto y_vec = to_vector(static_cast<float> (pos.y + y_distance_offset));
-    auto z_vec = vector<uint8_t>(4);  // Always 0
-    auto power_vec = to_vector(power);
-
-    ros_field.insert(ros_field.end(), x_vec.begin(), x_vec.end());
-    ros_field.insert(ros_field.end(), y_vec.begin(), y_vec.end());
-    ros_field.insert(ros_field.end(), z_vec.begin(), z_vec.end());
-    ros_field.insert(ros_field.end(), power_vec.begin(), power_vec.end());
-
-    return ros_field;
+    // To adjust radar start azimuth, for sake of visualisation
+    // Note - this value will be different for every setup!
+    // Values based on 0 angle of radar, and surrounding landscape
+    //
+    point_cloud.set_azimuths(azimuth_samples, azimuth_offset);
+    point_cloud.set_origin(x_distance_offset, y_distance_offset);
 }
\ No newline at end of file
@@ -13,6 +13,7 @@
 #include "Units.h"
 #include "Polar_coordinate.h"
 #include "Cartesian_coordinate.h"
+#include "Polar_to_cartesian.h"
 
 using Navtech::Networking::Colossus_protocol::TCP::Client;
 using Navtech::Networking::Colossus_protocol::TCP::Message;
@@ -72,7 +73,6 @@ private:
     void fft_data_handler(Client& radar_client [[maybe_unused]], Message& msg);
     void navigation_config_data_handler(Client& radar_client [[maybe_unused]], Message& msg);
     void navigation_data_handler(Client& radar_client [[maybe_unused]], Message& msg);
-    std::vector<std::uint8_t> to_ros_format(const Degrees&, const Metre&, const Navtech::Unit::dB&);
 
     // Peak finder callback
     //
@@ -93,9 +93,7 @@ private:
     uint32_t max_peaks_per_azimuth{ 0 };
     bool process_locally{ false };
 
-    uint16_t points_this_rotation{ 0 };
-    uint16_t max_possible_points{ 16000 };   // 400 azimuths, 10 points per azimuth max, 4 values per point
-    std::vector<uint8_t> data_vector;
+    Navtech::Polar_to_cartesian::Engine point_cloud{};
 
     int azimuth_samples{ 0 };
     int encoder_size{ 0 };
@@ -113,6 +111,7 @@ private:
     double x_distance_offset{ 0.0 };
     double y_distance_offset{ 0.0 };
 
+    void configure_point_cloud();
     void publish_point_cloud();
     void update_navigation_config();
     void update_local_navigation_config();
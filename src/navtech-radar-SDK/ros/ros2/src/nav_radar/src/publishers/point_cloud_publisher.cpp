@@ -2,6 +2,7 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <algorithm>
 #include <rclcpp/rclcpp.hpp>
 #include <rclcpp/qos.hpp>
 #include <math.h>
@@ -117,8 +118,6 @@ Point_cloud_publisher::Point_cloud_publisher():Node{ "point_cloud_publisher" }
         "radar_data/point_cloud",
         qos_point_cloud_publisher
     );
-
-    data_vector.reserve(max_possible_points);
 }
 
 
@@ -152,7 +151,7 @@ void Point_cloud_publisher::publish_point_cloud()
     message.header.frame_id = "point_cloud";
 
     message.height = 1;
-    message.width = points_this_rotation;
+    message.width = point_cloud.size();
     const uint8_t data_type = 7;
     const uint8_t num_bytes = 4; //float32 as bytes
 
@@ -160,32 +159,32 @@ void Point_cloud_publisher::publish_point_cloud()
     x_field.name = "x";
     x_field.offset = 0 * num_bytes;
     x_field.datatype = data_type;
-    x_field.count = points_this_rotation;
+    x_field.count = message.width;
 
     auto y_field = sensor_msgs::msg::PointField();
     y_field.name = "y";
     y_field.offset = 1 * num_bytes;
     y_field.datatype = data_type;
-    y_field.count = points_this_rotation;
+    y_field.count = message.width;
 
     auto z_field = sensor_msgs::msg::PointField();
     z_field.name = "z";
     z_field.offset = 2 * num_bytes;
     z_field.datatype = data_type;
-    z_field.count = points_this_rotation;
+    z_field.count = message.width;
 
     auto intensity_field = sensor_msgs::msg::PointField();
     intensity_field.name = "intensity";
     intensity_field.offset = 3 * num_bytes;
     intensity_field.datatype = data_type;
-    intensity_field.count = points_this_rotation;
+    intensity_field.count = message.width;
 
     message.fields = std::vector<sensor_msgs::msg::PointField>{x_field, y_field, z_field, intensity_field};
 
     message.is_bigendian = false;
     message.point_step = 4 * num_bytes;
     message.row_step = message.point_step * message.width;
-    message.data = std::move(data_vector);
+    message.data = point_cloud.release();
     message.is_dense = true;
 
     point_cloud_publisher->publish(message);
@@ -203,26 +202,10 @@ void Point_cloud_publisher::fft_data_handler(Client& radar_client [[maybe_unused
 
     int azimuth_index = (int)(fft->azimuth() / (encoder_size / azimuth_samples));
 
-    // To adjust radar start azimuth, for sake of visualisation
-    // Note - this value will be different for every setup!
-    // Values based on 0 angle of radar, and surrounding landscape
-    int adjusted_azimuth_index = azimuth_index + azimuth_offset;
-    if (adjusted_azimuth_index >= azimuth_samples) {
-        adjusted_azimuth_index = adjusted_azimuth_index - azimuth_samples;
-    }
-
     if ((azimuth_index >= start_azimuth) && (azimuth_index < end_azimuth)) {
-        for (unsigned bin_index = start_bin; bin_index < data.size(); bin_index++) {
-            if ((bin_index >= start_bin) && (bin_index < end_bin)) {
-                if (data[bin_index] > power_threshold) {
-                    auto bearing = static_cast<float>(adjusted_azimuth_index) / static_cast<float>(azimuth_samples) * 360.0;
-                    auto range = ((bin_index * bin_size / 10000.0) * range_gain * combined_distance_scale_factor) + range_offset + combined_distance_offset;
-                    auto vec = to_ros_format(bearing, range, data[bin_index]);
-                    data_vector.insert(data_vector.end(), vec.begin(), vec.end());
-                    points_this_rotation += 1;
-                }
-            }
-        }
+        auto last_bin = std::min<std::size_t>(end_bin, data.size());
+        auto threshold = static_cast<uint8_t>(std::clamp<int>(power_threshold, 0, std::numeric_limits<uint8_t>::max()));
+        point_cloud.convert(azimuth_index, data.data(), start_bin, last_bin, threshold);
     }
 
     if (!completed_full_rotation(fft->azimuth())) {
@@ -231,8 +214,6 @@ void Point_cloud_publisher::fft_data_handler(Client& radar_client [[maybe_unused
 
     rotation_count++;
     Point_cloud_publisher::publish_point_cloud();
-    data_vector.reserve(max_possible_points);
-    points_this_rotation = 0;
 
     if (rotation_count >= config_publish_count) {
 
@@ -336,6 +317,7 @@ void Point_cloud_publisher::fft_data_handler(Client& radar_client [[maybe_unused
             y_distance_offset = temp_y_distance_offset;
         }
 
+        configure_point_cloud();
         configuration_data_publisher->publish(config_message);
         rotation_count = 0;
     }
@@ -387,26 +369,22 @@ void Point_cloud_publisher::configuration_data_handler(Client& radar_client [[ma
     RCLCPP_INFO(Node::get_logger(), "X distance offset: %f", x_distance_offset);
     RCLCPP_INFO(Node::get_logger(), "Y distance offset: %f", y_distance_offset);
 
+    configure_point_cloud();
     radar_client.send(Type::start_fft_data);
 }
 
 
-std::vector<std::uint8_t> Point_cloud_publisher::to_ros_format(const Degrees& bearing, const Metre& range, const Navtech::Unit::dB& power)
+void Point_cloud_publisher::configure_point_cloud()
 {
-    using namespace std;
-
-    vector<uint8_t> ros_field { };
-    
-    auto pos = Navtech::Polar::Coordinate(range, bearing).to_cartesian();
-    auto x_vec = to_vector(static_cast<float> (pos.x + x_distance_offset));
-    auto y_vec = to_vector(static_cast<float> (pos.y + y_distance_offset));
-    auto z_vec = vector<uint8_t>(4);  // Always 0
-    auto power_vec = to_vector(power);
-
-    ros_field.insert(ros_field.end(), x_vec.begin(), x_vec.end());
-    ros_field.insert(ros_field.end(), y_vec.begin(), y_vec.end());
-    ros_field.insert(ros_field.end(), z_vec.begin(), z_vec.end());
-    ros_field.insert(ros_field.end(), power_vec.begin(), power_vec.end());
-
-    return ros_field;
+    // To adjust radar start azimuth, for sake of visualisation
+    // Note - this value will be different for every setup!
+    // Values based on 0 angle of radar, and surrounding landscape
+    //
+    point_cloud.set_azimuths(azimuth_samples, azimuth_offset);
+    point_cloud.set_ranges(
+        range_in_bins,
+        (bin_size / 10000.0) * range_gain * combined_distance_scale_factor,
+        range_offset + combined_distance_offset
+    );
+    point_cloud.set_origin(x_distance_offset, y_distance_offset);
 }
\ No newline at end of file
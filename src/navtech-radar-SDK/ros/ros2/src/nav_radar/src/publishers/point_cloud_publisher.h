@@ -11,6 +11,7 @@
 #include "Units.h"
 #include "Polar_coordinate.h"
 #include "Cartesian_coordinate.h"
+#include "Polar_to_cartesian.h"
 
 using Navtech::Networking::Colossus_protocol::TCP::Client;
 using Navtech::Networking::Colossus_protocol::TCP::Message;
@@ -60,7 +61,7 @@ private:
     //
     void configuration_data_handler(Client& radar_client [[maybe_unused]], Message& msg);
     void fft_data_handler(Client& radar_client [[maybe_unused]], Message& msg);
-    std::vector<std::uint8_t> to_ros_format(const Degrees&, const Metre&, const Navtech::Unit::dB&);
+    void configure_point_cloud();
     void publish_point_cloud();
 
     std::string radar_ip{ "" };
@@ -80,9 +81,7 @@ private:
     double x_distance_offset{ 0.0 };
     double y_distance_offset{ 0.0 };
 
-    uint16_t points_this_rotation{ 0 };
-    uint16_t max_possible_points{ 16000 };   // 400 azimuths, 10 points per azimuth max, 4 values per point
-    std::vector<uint8_t> data_vector;
+    Navtech::Polar_to_cartesian::Engine point_cloud{};
 
     int azimuth_samples{ 0 };
     int encoder_size{ 0 };
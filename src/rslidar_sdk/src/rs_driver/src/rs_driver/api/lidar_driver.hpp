@@ -157,6 +157,16 @@ public:
     return driver_ptr_->getDeviceStatus(status);
   }
 
+  /**
+   * @brief Get statistics of point cloud buffers, e.g. how many of them are allocated by the driver
+   * @param stats The variable to store the statistics
+   * @return if the driver is initialized, return true; else return false
+   */
+  inline bool getCloudCapacityStats(CloudCapacityStats& stats)
+  {
+    return driver_ptr_->getCloudCapacityStats(stats);
+  }
+
   /**
    * @brief Stop all threads
    */
@@ -39,6 +39,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rs_driver/driver/decoder/section.hpp>
 #include <rs_driver/driver/decoder/basic_attr.hpp>
 #include <rs_driver/driver/decoder/split_strategy.hpp>
+#include <rs_driver/driver/decoder/seq_reorder.hpp>
 #include "rs_driver/msg/imu_data_msg.hpp"
 #ifndef _USE_MATH_DEFINES
 #define _USE_MATH_DEFINES  // for VC++, required to use const M_IP in <math.h>
@@ -274,6 +275,7 @@ public:
   bool getDeviceInfo(DeviceInfo& info);
   bool getDeviceStatus(DeviceStatus& status);
   double getPacketDuration();
+  virtual size_t pointsPerFrame();
   void enableWritePktTs(bool value);
   double prevPktTs();
   void transformPoint(float& x, float& y, float& z);
@@ -296,6 +298,7 @@ protected:
 #endif
 
   double cloudTs();
+  void enableSeqReorder();
 
   RSDecoderConstParam const_param_;  // const param
   RSDecoderParam param_;             // user param
@@ -325,6 +328,7 @@ protected:
   double prev_point_ts_;   // timestamp of previous point
   double first_point_ts_;  // timestamp of first point
   bool is_get_temperature_{ false };
+  std::shared_ptr<SeqReorder> seq_reorder_;  // reorder msop packets by sequence number
 };
 
 template <typename T_PointCloud>
@@ -365,6 +369,15 @@ inline Decoder<T_PointCloud>::Decoder(const RSDecoderConstParam& const_param, co
 #endif
 }
 
+template <typename T_PointCloud>
+inline void Decoder<T_PointCloud>::enableSeqReorder()
+{
+  if (param_.reorder_window_us > 0)
+  {
+    seq_reorder_.reset(new SeqReorder(param_.reorder_window_us));
+  }
+}
+
 template <typename T_PointCloud>
 inline void Decoder<T_PointCloud>::enableWritePktTs(bool value)
 {
@@ -412,6 +425,19 @@ inline double Decoder<T_PointCloud>::getPacketDuration()
   return packet_duration_;
 }
 
+template <typename T_PointCloud>
+inline size_t Decoder<T_PointCloud>::pointsPerFrame()
+{
+  if (packet_duration_ <= 0)
+  {
+    return 0;
+  }
+
+  // frame rate of solid-state lidars is 10Hz.
+  size_t pkts_per_frame = (size_t)std::round(0.1 / packet_duration_);
+  return pkts_per_frame * const_param_.BLOCKS_PER_PKT * const_param_.CHANNELS_PER_BLOCK;
+}
+
 template <typename T_PointCloud>
 inline double Decoder<T_PointCloud>::prevPktTs()
 {
@@ -508,6 +534,13 @@ inline bool Decoder<T_PointCloud>::processMsopPkt(const uint8_t* pkt, size_t siz
   }
 #endif
 
+  if (seq_reorder_)
+  {
+    uint16_t pkt_seq = static_cast<uint16_t>((pkt[PKT_SEQ_HIGH_BYTE_OFFSET] << 8) | pkt[PKT_SEQ_LOW_BYTE_OFFSET]);
+    return seq_reorder_->push(pkt_seq, getTimeHost(), pkt, size,
+                              [this](const uint8_t* p, size_t s) { return decodeMsopPkt(p, s); });
+  }
+
   return decodeMsopPkt(pkt, size);
 }
 
@@ -117,6 +117,7 @@ private:
   RSEchoMode getEchoMode(uint8_t mode);
 
   SplitStrategyBySeq split_strategy_;
+  SeqTracker seq_tracker_;
 };
 
 template <typename T_PointCloud>
@@ -148,6 +149,7 @@ inline DecoderRSE1<T_PointCloud>::DecoderRSE1(const RSDecoderParam& param)
   : Decoder<T_PointCloud>(getConstParam(), param)
 {
   this->packet_duration_ = FRAME_DURATION / SINGLE_PKT_NUM;
+  this->enableSeqReorder();
   this->angles_ready_ = true;
 }
 
@@ -230,10 +232,12 @@ inline bool DecoderRSE1<T_PointCloud>::decodeMsopPkt(const uint8_t* packet, size
   uint16_t pkt_seq = ntohs(pkt.header.pkt_seq);
   if (split_strategy_.newPacket(pkt_seq))
   {
+    seq_tracker_.finish(*this->point_cloud_, split_strategy_.maxSeq());
     this->cb_split_frame_(this->const_param_.LASER_NUM, this->cloudTs());
     this->first_point_ts_ = pkt_ts;
     ret = true;
   }
+  seq_tracker_.newPacket(pkt_seq);
 
   for (uint16_t blk = 0; blk < this->const_param_.BLOCKS_PER_PKT; blk++)
   {
@@ -153,6 +153,7 @@ private:
   RSEchoMode getEchoMode(uint8_t mode);
 
   SplitStrategyBySeq split_strategy_;
+  SeqTracker seq_tracker_;
 };
 
 template <typename T_PointCloud>
@@ -184,6 +185,7 @@ inline DecoderRSM1<T_PointCloud>::DecoderRSM1(const RSDecoderParam& param)
   : Decoder<T_PointCloud>(getConstParam(), param)
 {
   this->packet_duration_ = FRAME_DURATION / SINGLE_PKT_NUM;
+  this->enableSeqReorder();
   this->angles_ready_ = true;
 }
 
@@ -250,10 +252,12 @@ inline bool DecoderRSM1<T_PointCloud>::decodeMsopPkt(const uint8_t* packet, size
   uint16_t pkt_seq = ntohs(pkt.header.pkt_seq);
   if (split_strategy_.newPacket(pkt_seq))
   {
+    seq_tracker_.finish(*this->point_cloud_, split_strategy_.maxSeq());
     this->cb_split_frame_(this->const_param_.LASER_NUM, this->cloudTs());
     this->first_point_ts_ = pkt_ts;
     ret = true;
   }
+  seq_tracker_.newPacket(pkt_seq);
 
   for (uint16_t blk = 0; blk < this->const_param_.BLOCKS_PER_PKT; blk++)
   {
@@ -306,6 +310,7 @@ inline bool DecoderRSM1<T_PointCloud>::decodeMsopPkt(const uint8_t* packet, size
 
   if (split_strategy_.maxSeq() == pkt_seq)
   {
+    seq_tracker_.finish(*this->point_cloud_, split_strategy_.maxSeq());
     this->cb_split_frame_(this->const_param_.LASER_NUM, this->cloudTs());
   }
 
@@ -78,6 +78,7 @@ public:
   explicit DecoderMech(const RSDecoderMechConstParam& const_param, const RSDecoderParam& param);
 
   void print();
+  virtual size_t pointsPerFrame();
 
 #ifndef UNIT_TEST
 protected:
@@ -167,6 +168,19 @@ inline void DecoderMech<T_PointCloud>::print()
   this->chan_angles_.print();
 }
 
+template <typename T_PointCloud>
+inline size_t DecoderMech<T_PointCloud>::pointsPerFrame()
+{
+  size_t blks = this->blks_per_frame_;
+  if (this->param_.split_frame_mode == SplitFrameMode::SPLIT_BY_CUSTOM_BLKS)
+  {
+    blks = this->param_.num_blks_split;
+  }
+
+  size_t echo_num = (this->echo_mode_ == RSEchoMode::ECHO_DUAL) ? 2 : 1;
+  return blks * echo_num * this->const_param_.CHANNELS_PER_BLOCK;
+}
+
 template <typename T_PointCloud>
 template <typename T_Difop>
 inline void DecoderMech<T_PointCloud>::decodeDifopCommon(const T_Difop& pkt)
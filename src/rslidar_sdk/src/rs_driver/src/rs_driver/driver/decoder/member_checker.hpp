@@ -32,6 +32,9 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include <type_traits>
+#include <vector>
+
 #define DEFINE_MEMBER_CHECKER(member)                                                                                  \
   template <typename T, typename V = bool>                                                                             \
   struct has_##member : std::false_type                                                                                \
@@ -51,6 +54,8 @@ DEFINE_MEMBER_CHECKER(intensity)
 DEFINE_MEMBER_CHECKER(ring)
 DEFINE_MEMBER_CHECKER(timestamp)
 DEFINE_MEMBER_CHECKER(feature)
+DEFINE_MEMBER_CHECKER(lost_pkts)
+DEFINE_MEMBER_CHECKER(pkt_bitmap)
 
 #define RS_HAS_MEMBER(C, member) has_##member<C>::value
 
@@ -137,3 +142,28 @@ inline typename std::enable_if<RS_HAS_MEMBER(T_Point, feature)>::type setFeature
   point.feature = value;
 }
 
+template <typename T_PointCloud>
+inline typename std::enable_if<!RS_HAS_MEMBER(T_PointCloud, lost_pkts)>::type setLostPkts(T_PointCloud& cloud,
+                                                                                          const uint32_t& value)
+{
+}
+
+template <typename T_PointCloud>
+inline typename std::enable_if<RS_HAS_MEMBER(T_PointCloud, lost_pkts)>::type setLostPkts(T_PointCloud& cloud,
+                                                                                         const uint32_t& value)
+{
+  cloud.lost_pkts = value;
+}
+
+template <typename T_PointCloud>
+inline typename std::enable_if<!RS_HAS_MEMBER(T_PointCloud, pkt_bitmap)>::type setPktBitmap(T_PointCloud& cloud,
+                                                                                            const std::vector<uint8_t>& value)
+{
+}
+
+template <typename T_PointCloud>
+inline typename std::enable_if<RS_HAS_MEMBER(T_PointCloud, pkt_bitmap)>::type setPktBitmap(T_PointCloud& cloud,
+                                                                                           const std::vector<uint8_t>& value)
+{
+  cloud.pkt_bitmap.assign(value.begin(), value.end());
+}
@@ -0,0 +1,283 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/driver/decoder/member_checker.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// SeqTracker records which packets of the current frame are received, by the packet sequence number.
+// Bit (seq - 1) of the bitmap is set if the packet is received. Sequence number 0 is not tracked.
+//
+class SeqTracker
+{
+public:
+
+  SeqTracker()
+    : received_(0), max_seq_(0)
+  {
+  }
+
+  void newPacket(uint16_t seq)
+  {
+    if (seq == 0)
+    {
+      return;
+    }
+
+    size_t idx = seq - 1;
+    if ((idx >> 3) >= bitmap_.size())
+    {
+      bitmap_.resize((idx >> 3) + 1, 0);
+    }
+
+    uint8_t mask = (uint8_t)(1 << (idx & 0x07));
+    if (bitmap_[idx >> 3] & mask) // duplicated
+    {
+      return;
+    }
+
+    bitmap_[idx >> 3] |= mask;
+    received_++;
+    max_seq_ = std::max(max_seq_, seq);
+  }
+
+  //
+  // max_seq is the last sequence number of a complete frame. It is 0 if unknown yet.
+  //
+  uint32_t lostPkts(uint16_t max_seq) const
+  {
+    return (uint32_t)std::max(max_seq, max_seq_) - received_;
+  }
+
+  template <typename T_PointCloud>
+  void finish(T_PointCloud& cloud, uint16_t max_seq)
+  {
+    uint16_t expected = std::max(max_seq, max_seq_);
+    bitmap_.resize((expected + 7) >> 3, 0);
+
+    setLostPkts(cloud, lostPkts(max_seq));
+    setPktBitmap(cloud, bitmap_);
+    reset();
+  }
+
+  void reset()
+  {
+    std::fill(bitmap_.begin(), bitmap_.end(), 0);
+    received_ = 0;
+    max_seq_ = 0;
+  }
+
+#ifndef UNIT_TEST
+private:
+#endif
+
+  std::vector<uint8_t> bitmap_;
+  uint32_t received_;
+  uint16_t max_seq_;
+};
+
+//
+// SeqReorder holds out-of-order packets for at most window_us, and hands packets to the decoder in the
+// order of sequence number. A held packet is released when the missing ones arrive, when it expires,
+// or when the sequence number rewinds to a new frame. Packets too late to reorder are dropped, and so
+// are counted as lost by SeqTracker: decoded after the newer packets, they would be taken by
+// SplitStrategyBySeq for a rewind, and split the frame early.
+//
+class SeqReorder
+{
+public:
+
+  constexpr static uint16_t MAX_DISTANCE = 64;
+
+  explicit SeqReorder(uint32_t window_us)
+    : window_us_(window_us), started_(false), next_seq_(0), max_seq_(0), dropped_(0)
+  {
+  }
+
+  template <typename F>
+  bool push(uint16_t seq, uint64_t now_us, const uint8_t* pkt, size_t size, F decode)
+  {
+    bool ret = false;
+
+    if (!started_)
+    {
+      started_ = true;
+      next_seq_ = seq;
+      max_seq_ = seq;
+    }
+
+    if (seq == next_seq_)
+    {
+      ret |= decode(pkt, size);
+      next_seq_ = seq + 1;
+      ret |= releaseInOrder(decode);
+    }
+    else if ((seq > next_seq_) && (seq - next_seq_ <= MAX_DISTANCE))
+    {
+      hold(seq, now_us, pkt, size);
+    }
+    else if ((seq < next_seq_) && (max_seq_ - seq <= MAX_DISTANCE))
+    {
+      dropped_++; // too late
+    }
+    else // rewind, or too many lost
+    {
+      ret |= releaseAll(decode);
+      ret |= decode(pkt, size);
+      next_seq_ = seq + 1;
+      max_seq_ = seq;
+    }
+
+    max_seq_ = std::max(max_seq_, seq);
+
+    ret |= releaseExpired(now_us, decode);
+    return ret;
+  }
+
+  size_t held() const
+  {
+    return held_.size();
+  }
+
+  uint64_t dropped() const
+  {
+    return dropped_;
+  }
+
+#ifndef UNIT_TEST
+private:
+#endif
+
+  struct HeldPacket
+  {
+    uint64_t ts;
+    std::vector<uint8_t> buf;
+  };
+
+  void hold(uint16_t seq, uint64_t now_us, const uint8_t* pkt, size_t size)
+  {
+    if (held_.find(seq) != held_.end()) // duplicated
+    {
+      return;
+    }
+
+    HeldPacket& h = held_[seq];
+    h.ts = now_us;
+    h.buf.assign(pkt, pkt + size);
+  }
+
+  template <typename F>
+  bool release(std::map<uint16_t, HeldPacket>::iterator it, F& decode)
+  {
+    bool ret = decode(it->second.buf.data(), it->second.buf.size());
+    next_seq_ = it->first + 1;
+    held_.erase(it);
+    return ret;
+  }
+
+  template <typename F>
+  bool releaseInOrder(F& decode)
+  {
+    bool ret = false;
+
+    std::map<uint16_t, HeldPacket>::iterator it;
+    while (((it = held_.begin()) != held_.end()) && (it->first == next_seq_))
+    {
+      ret |= release(it, decode);
+    }
+
+    return ret;
+  }
+
+  template <typename F>
+  bool releaseAll(F& decode)
+  {
+    bool ret = false;
+
+    while (!held_.empty())
+    {
+      ret |= release(held_.begin(), decode);
+    }
+
+    return ret;
+  }
+
+  template <typename F>
+  bool releaseExpired(uint64_t now_us, F& decode)
+  {
+    // give up the missing packets before the latest expired one.
+    std::map<uint16_t, HeldPacket>::iterator last = held_.end();
+    for (auto it = held_.begin(); it != held_.end(); it++)
+    {
+      if (it->second.ts + window_us_ <= now_us)
+      {
+        last = it;
+      }
+    }
+
+    if (last == held_.end())
+    {
+      return false;
+    }
+
+    bool ret = false;
+    uint16_t last_seq = last->first;
+    while (!held_.empty() && (held_.begin()->first <= last_seq))
+    {
+      ret |= release(held_.begin(), decode);
+    }
+
+    return (ret | releaseInOrder(decode));
+  }
+
+  const uint32_t window_us_;
+  bool started_;
+  uint16_t next_seq_;
+  uint16_t max_seq_;
+  uint64_t dropped_;
+  std::map<uint16_t, HeldPacket> held_;
+};
+
+}  // namespace lidar
+}  // namespace robosense
@@ -235,6 +235,9 @@ struct RSDecoderParam  ///< LiDAR decoder parameter
   float split_angle = 0.0f;      ///< Split angle(degree) used to split frame, only be used when split_frame_mode=1
   uint16_t num_blks_split = 1;   ///< Number of packets in one frame, only be used when split_frame_mode=3
 
+  ///< Theses parameters are only for LiDARs which split frames by packet sequence number, i.e. RSM1/RSM2/RSE1.
+  uint32_t reorder_window_us = 0; ///< Time(us) to hold out-of-order packets before decoding. 0: decode at once
+
   void print() const
   {
     RS_INFO << "------------------------------------------------------" << RS_REND;
@@ -252,6 +255,7 @@ struct RSDecoderParam  ///< LiDAR decoder parameter
     RS_INFOL << "split_frame_mode: " << split_frame_mode << RS_REND;
     RS_INFOL << "split_angle: " << split_angle << RS_REND;
     RS_INFOL << "num_blks_split: " << num_blks_split << RS_REND;
+    RS_INFOL << "reorder_window_us: " << reorder_window_us << RS_REND;
     RS_INFO << "------------------------------------------------------" << RS_REND;
     transform_param.print();
   }
@@ -298,6 +302,21 @@ struct RSInputParam  ///< The LiDAR input parameter
 
 };
 
+struct RSReplayParam  ///< The parameter of decoding recorded packets in parallel
+{
+  uint16_t num_threads = 0;    ///< Number of decoding threads. 0 means the number of cpu cores
+  float replay_rate = 0.0f;    ///< Rate to deliver point clouds. 0 means as fast as possible (no sleep)
+
+  void print() const
+  {
+    RS_INFO << "------------------------------------------------------" << RS_REND;
+    RS_INFO << "             RoboSense Replay Parameters " << RS_REND;
+    RS_INFOL << "num_threads: " << num_threads << RS_REND;
+    RS_INFOL << "replay_rate: " << replay_rate << RS_REND;
+    RS_INFO << "------------------------------------------------------" << RS_REND;
+  }
+};
+
 struct RSDriverParam  ///< The LiDAR driver parameter
 {
   LidarType lidar_type = LidarType::RS16;  ///< Lidar type
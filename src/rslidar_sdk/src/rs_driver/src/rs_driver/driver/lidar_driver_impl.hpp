@@ -38,6 +38,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <rs_driver/macro/version.hpp>
 #include <rs_driver/utility/sync_queue.hpp>
 #include <rs_driver/utility/buffer.hpp>
+#include <rs_driver/utility/cloud_capacity.hpp>
 #include <rs_driver/driver/input/input_factory.hpp>
 #include <rs_driver/driver/decoder/decoder_factory.hpp>
 
@@ -77,6 +78,7 @@ public:
   bool getTemperature(float& temp);
   bool getDeviceInfo(DeviceInfo& info);
   bool getDeviceStatus(DeviceStatus& status);
+  bool getCloudCapacityStats(CloudCapacityStats& stats);
 
 private:
   void runPacketCallBack(uint8_t* data, size_t data_size, double timestamp, uint8_t is_difop, uint8_t is_frame_begin);
@@ -108,6 +110,8 @@ private:
 
   std::shared_ptr<Input> input_ptr_;
   std::shared_ptr<Decoder<T_PointCloud>> decoder_ptr_;
+  CloudCapacity cloud_capacity_;
+  size_t cloud_reserved_;
   SyncQueue<std::shared_ptr<Buffer>> free_pkt_queue_;
   SyncQueue<std::shared_ptr<Buffer>> pkt_queue_;
   std::thread handle_thread_;
@@ -131,7 +135,7 @@ const uint8_t LidarDriverImpl<T_PointCloud>::IMU_HEADER_ID[2] = { 0xAA, 0x55 };
 
 template <typename T_PointCloud>
 inline LidarDriverImpl<T_PointCloud>::LidarDriverImpl()
-  : pkt_seq_(0), point_cloud_seq_(0), init_flag_(false), start_flag_(false)
+  : cloud_reserved_(0), pkt_seq_(0), point_cloud_seq_(0), init_flag_(false), start_flag_(false)
 {
 }
 
@@ -165,6 +169,11 @@ std::shared_ptr<T_PointCloud> LidarDriverImpl<T_PointCloud>::getPointCloud()
     if (cloud)
     {
       cloud->points.resize(0);
+
+      // the prediction changes with DIFOP, e.g. rpm or echo mode.
+      cloud_capacity_.setPredicted(decoder_ptr_->pointsPerFrame());
+      cloud_capacity_.prepare(cloud->points);
+      cloud_reserved_ = cloud->points.capacity();
       return cloud;
     }
 
@@ -343,6 +352,18 @@ inline bool LidarDriverImpl<T_PointCloud>::getDeviceStatus(DeviceStatus& status)
   return decoder_ptr_->getDeviceStatus(status);
 }
 
+template <typename T_PointCloud>
+inline bool LidarDriverImpl<T_PointCloud>::getCloudCapacityStats(CloudCapacityStats& stats)
+{
+  if (decoder_ptr_ == nullptr)
+  {
+    return false;
+  }
+
+  stats = cloud_capacity_.stats();
+  return true;
+}
+
 template <typename T_PointCloud>
 inline void LidarDriverImpl<T_PointCloud>::runPacketCallBack(uint8_t* data, size_t data_size, double timestamp,
                                                              uint8_t is_difop, uint8_t is_frame_begin)
@@ -455,6 +476,7 @@ void LidarDriverImpl<T_PointCloud>::splitFrame(uint16_t height, double ts)
   std::shared_ptr<T_PointCloud> cloud = decoder_ptr_->point_cloud_;
   if (cloud->points.size() > 0)
   {
+    cloud_capacity_.update(cloud->points, cloud_reserved_);
     setPointCloudHeader(cloud, height, ts);
     cb_put_cloud_(cloud);
     decoder_ptr_->point_cloud_ = getPointCloud();
@@ -0,0 +1,539 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <rs_driver/driver/driver_param.hpp>
+#include <rs_driver/msg/packet.hpp>
+#include <rs_driver/common/error_code.hpp>
+#include <rs_driver/utility/sync_queue.hpp>
+#include <rs_driver/utility/cloud_capacity.hpp>
+#include <rs_driver/driver/decoder/decoder_factory.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+
+namespace robosense
+{
+namespace lidar
+{
+
+//
+// ReplayDecoder decodes recorded MSOP/DIFOP packets (e.g. from a rosbag) on a pool of threads.
+//
+// The packet stream is cut into frames by the is_frame_begin flags written while recording. Every frame is
+// decoded by a worker which owns its own decoder, and the point clouds are delivered in the original order.
+// A frame job covers the packets from its frame-begin packet up to (and including) the next frame-begin packet,
+// since the split may happen in the middle of the boundary packet.
+//
+template <typename T_PointCloud>
+class ReplayDecoder
+{
+public:
+  ReplayDecoder();
+  ~ReplayDecoder();
+
+  void regPointCloudCallback(const std::function<std::shared_ptr<T_PointCloud>(void)>& cb_get_cloud,
+                             const std::function<void(std::shared_ptr<T_PointCloud>)>& cb_put_cloud);
+  void regExceptionCallback(const std::function<void(const Error&)>& cb_excep);
+
+  bool init(const RSDriverParam& param, const RSReplayParam& replay_param);
+  bool start();
+  void stop();
+
+  void decodePacket(const Packet& pkt);
+  void decodePackets(const Packet* pkts, size_t num);
+  void feedPacket(const uint8_t* data, size_t size, bool is_frame_begin);
+  void flush();
+  CloudCapacityStats getCloudCapacityStats();
+
+private:
+  typedef std::vector<uint8_t> PacketBuf;
+
+  struct FrameJob
+  {
+    uint64_t index;
+    std::vector<PacketBuf> pkts;
+    std::shared_ptr<const PacketBuf> difop;
+    std::vector<std::shared_ptr<T_PointCloud>> clouds;
+  };
+
+  struct Worker
+  {
+    std::shared_ptr<Decoder<T_PointCloud>> decoder;
+    std::shared_ptr<const PacketBuf> difop;
+    FrameJob* job;
+    size_t cloud_reserved;
+    bool collect;
+    std::thread thread;
+  };
+
+  void runExceptionCallback(const Error& error);
+  std::shared_ptr<T_PointCloud> getPointCloud(Worker* worker);
+  void splitFrame(Worker* worker, uint16_t height, double ts);
+  void dispatchFrame();
+
+  void processFrame(Worker* worker);
+  void deliverFrame();
+  void setPointCloudHeader(std::shared_ptr<T_PointCloud> msg);
+
+  RSDriverParam driver_param_;
+  RSReplayParam replay_param_;
+  std::function<std::shared_ptr<T_PointCloud>(void)> cb_get_cloud_;
+  std::function<void(std::shared_ptr<T_PointCloud>)> cb_put_cloud_;
+  std::function<void(const Error&)> cb_excep_;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  CloudCapacity cloud_capacity_;
+  SyncQueue<std::shared_ptr<FrameJob>> job_queue_;
+  std::thread deliver_thread_;
+
+  std::mutex mtx_done_;
+  std::condition_variable cv_done_;
+  std::map<uint64_t, std::shared_ptr<FrameJob>> done_jobs_;
+  size_t jobs_in_flight_;
+
+  // producer side, only touched by the thread calling decodePacket()
+  std::vector<PacketBuf> pending_pkts_;
+  std::shared_ptr<const PacketBuf> difop_;
+  bool frame_begin_found_;
+  uint64_t next_job_index_;
+
+  uint64_t next_deliver_index_;
+  uint32_t point_cloud_seq_;
+  size_t raw_offset_;
+  size_t raw_tail_;
+  std::atomic<bool> to_exit_;
+  bool init_flag_;
+  bool start_flag_;
+
+  static const uint8_t MSOP_HEADER_ID[2];
+  static const uint8_t DIFOP_HEADER_ID[2];
+};
+
+template <typename T_PointCloud>
+const uint8_t ReplayDecoder<T_PointCloud>::MSOP_HEADER_ID[2] = { 0x55, 0xAA };
+template <typename T_PointCloud>
+const uint8_t ReplayDecoder<T_PointCloud>::DIFOP_HEADER_ID[2] = { 0xA5, 0xFF };
+
+template <typename T_PointCloud>
+inline ReplayDecoder<T_PointCloud>::ReplayDecoder()
+  : jobs_in_flight_(0)
+  , frame_begin_found_(false)
+  , next_job_index_(0)
+  , next_deliver_index_(0)
+  , point_cloud_seq_(0)
+  , raw_offset_(0)
+  , raw_tail_(0)
+  , to_exit_(false)
+  , init_flag_(false)
+  , start_flag_(false)
+{
+}
+
+template <typename T_PointCloud>
+inline ReplayDecoder<T_PointCloud>::~ReplayDecoder()
+{
+  stop();
+}
+
+template <typename T_PointCloud>
+inline void ReplayDecoder<T_PointCloud>::regPointCloudCallback(
+    const std::function<std::shared_ptr<T_PointCloud>(void)>& cb_get_cloud,
+    const std::function<void(std::shared_ptr<T_PointCloud>)>& cb_put_cloud)
+{
+  cb_get_cloud_ = cb_get_cloud;
+  cb_put_cloud_ = cb_put_cloud;
+}
+
+template <typename T_PointCloud>
+inline void ReplayDecoder<T_PointCloud>::regExceptionCallback(const std::function<void(const Error&)>& cb_excep)
+{
+  cb_excep_ = cb_excep;
+}
+
+template <typename T_PointCloud>
+inline void ReplayDecoder<T_PointCloud>::runExceptionCallback(const Error& error)
+{
+  if (cb_excep_)
+  {
+    cb_excep_(error);
+  }
+}
+
+template <typename T_PointCloud>
+inline std::shared_ptr<T_PointCloud> ReplayDecoder<T_PointCloud>::getPointCloud(Worker* worker)
+{
+  while (1)
+  {
+    std::shared_ptr<T_PointCloud> cloud = cb_get_cloud_();
+    if (cloud)
+    {
+      cloud->points.resize(0);
+
+      cloud_capacity_.setPredicted(worker->decoder->pointsPerFrame());
+      cloud_capacity_.prepare(cloud->points);
+      worker->cloud_reserved = cloud->points.capacity();
+      return cloud;
+    }
+
+    LIMIT_CALL(runExceptionCallback(Error(ERRCODE_POINTCLOUDNULL)), 1);
+  }
+}
+
+template <typename T_PointCloud>
+inline bool ReplayDecoder<T_PointCloud>::init(const RSDriverParam& param, const RSReplayParam& replay_param)
+{
+  if (init_flag_)
+  {
+    return true;
+  }
+
+  driver_param_ = param;
+  replay_param_ = replay_param;
+  raw_offset_ = param.input_param.user_layer_bytes;
+  raw_tail_ = param.input_param.tail_layer_bytes;
+
+  uint16_t num_threads = replay_param_.num_threads;
+  if (num_threads == 0)
+  {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  for (uint16_t i = 0; i < num_threads; i++)
+  {
+    std::unique_ptr<Worker> worker(new Worker());
+    worker->decoder = DecoderFactory<T_PointCloud>::createDecoder(param.lidar_type, param.decoder_param);
+    worker->decoder->enableWritePktTs(false);
+    worker->decoder->point_cloud_ = getPointCloud(worker.get());
+    worker->decoder->regCallback(
+        std::bind(&ReplayDecoder<T_PointCloud>::runExceptionCallback, this, std::placeholders::_1),
+        std::bind(&ReplayDecoder<T_PointCloud>::splitFrame, this, worker.get(), std::placeholders::_1,
+                  std::placeholders::_2));
+    worker->job = NULL;
+    worker->collect = false;
+    workers_.emplace_back(std::move(worker));
+  }
+
+  init_flag_ = true;
+  return true;
+}
+
+template <typename T_PointCloud>
+inline bool ReplayDecoder<T_PointCloud>::start()
+{
+  if (start_flag_)
+  {
+    return true;
+  }
+
+  if (!init_flag_)
+  {
+    return false;
+  }
+
+  to_exit_ = false;
+  for (auto& worker : workers_)
+  {
+    worker->thread = std::thread(std::bind(&ReplayDecoder<T_PointCloud>::processFrame, this, worker.get()));
+  }
+  deliver_thread_ = std::thread(std::bind(&ReplayDecoder<T_PointCloud>::deliverFrame, this));
+
+  start_flag_ = true;
+  return true;
+}
+
+template <typename T_PointCloud>
+inline void ReplayDecoder<T_PointCloud>::stop()
+{
+  if (!start_flag_)
+  {
+    return;
+  }
+
+  to_exit_ = true;
+  cv_done_.notify_all();
+
+  for (auto& worker : workers_)
+  {
+    worker->thread.join();
+  }
+  deliver_thread_.join();
+
+  job_queue_.clear();
+  done_jobs_.clear();
+  pending_pkts_.clear();
+  frame_begin_found_ = false;
+  jobs_in_flight_ = 0;
+  next_deliver_index_ = next_job_index_;
+
+  start_flag_ = false;
+}
+
+template <typename T_PointCloud>
+inline void ReplayDecoder<T_PointCloud>::decodePacket(const Packet& pkt)
+{
+  feedPacket(pkt.buf_.data(), pkt.buf_.size(), pkt.is_frame_begin);
+}
+
+template <typename T_PointCloud>
+inline void ReplayDecoder<T_PointCloud>::decodePackets(const Packet* pkts, size_t num)
+{
+  for (size_t i = 0; i < num; i++)
+  {
+    decodePacket(pkts[i]);
+  }
+}
+
+template <typename T_PointCloud>
+inline void ReplayDecoder<T_PointCloud>::feedPacket(const uint8_t* data, size_t size, bool is_frame_begin)
+{
+  constexpr static size_t PACKET_POOL_MAX = 10240;
+
+  if (size <= raw_offset_ + raw_tail_ + sizeof(MSOP_HEADER_ID))
+  {
+    return;
+  }
+
+  const uint8_t* id = data + raw_offset_;
+  size_t len = size - raw_offset_ - raw_tail_;
+
+  if (memcmp(id, DIFOP_HEADER_ID, sizeof(DIFOP_HEADER_ID)) == 0)
+  {
+    difop_ = std::make_shared<const PacketBuf>(id, id + len);
+    return;
+  }
+
+  if (memcmp(id, MSOP_HEADER_ID, sizeof(MSOP_HEADER_ID)) != 0)
+  {
+    return;
+  }
+
+  if (is_frame_begin)
+  {
+    if (frame_begin_found_)
+    {
+      pending_pkts_.emplace_back(id, id + len);
+      dispatchFrame();
+    }
+
+    frame_begin_found_ = true;
+    pending_pkts_.clear();
+  }
+  else if (!frame_begin_found_)
+  {
+    // packets before the first frame-begin belong to a partial frame.
+    return;
+  }
+
+  pending_pkts_.emplace_back(id, id + len);
+
+  if (pending_pkts_.size() > PACKET_POOL_MAX)
+  {
+    // no frame-begin flags in the recording ?
+    LIMIT_CALL(runExceptionCallback(Error(ERRCODE_PKTBUFOVERFLOW)), 1);
+    pending_pkts_.clear();
+    frame_begin_found_ = false;
+  }
+}
+
+template <typename T_PointCloud>
+inline void ReplayDecoder<T_PointCloud>::dispatchFrame()
+{
+  std::shared_ptr<FrameJob> job = std::make_shared<FrameJob>();
+  job->index = next_job_index_++;
+  job->pkts.swap(pending_pkts_);
+  job->difop = difop_;
+
+  {
+    // bound the memory of frames waiting to be decoded or delivered.
+    const size_t max_in_flight = workers_.size() * 2 + 2;
+
+    std::unique_lock<std::mutex> ul(mtx_done_);
+    cv_done_.wait(ul, [this, max_in_flight] { return (jobs_in_flight_ < max_in_flight) || to_exit_; });
+    jobs_in_flight_++;
+  }
+
+  job_queue_.push(job);
+}
+
+template <typename T_PointCloud>
+inline void ReplayDecoder<T_PointCloud>::flush()
+{
+  std::unique_lock<std::mutex> ul(mtx_done_);
+  cv_done_.wait(ul, [this] { return (jobs_in_flight_ == 0) || to_exit_; });
+}
+
+template <typename T_PointCloud>
+inline CloudCapacityStats ReplayDecoder<T_PointCloud>::getCloudCapacityStats()
+{
+  return cloud_capacity_.stats();
+}
+
+template <typename T_PointCloud>
+inline void ReplayDecoder<T_PointCloud>::splitFrame(Worker* worker, uint16_t height, double ts)
+{
+  std::shared_ptr<T_PointCloud> cloud = worker->decoder->point_cloud_;
+  if (cloud->points.size() == 0)
+  {
+    return;
+  }
+
+  if (!worker->collect)
+  {
+    // tail of the previous frame, decoded by another worker.
+    cloud->points.resize(0);
+    return;
+  }
+
+  cloud_capacity_.update(cloud->points, worker->cloud_reserved);
+  cloud->height = height;
+  cloud->timestamp = ts;
+  worker->job->clouds.emplace_back(cloud);
+  worker->decoder->point_cloud_ = getPointCloud(worker);
+}
+
+template <typename T_PointCloud>
+inline void ReplayDecoder<T_PointCloud>::processFrame(Worker* worker)
+{
+  while (!to_exit_)
+  {
+    std::shared_ptr<FrameJob> job = job_queue_.popWait(100000);
+    if (job.get() == NULL)
+    {
+      continue;
+    }
+
+    Decoder<T_PointCloud>& decoder = *(worker->decoder);
+    if (job->difop && (job->difop != worker->difop))
+    {
+      decoder.processDifopPkt(job->difop->data(), job->difop->size());
+      worker->difop = job->difop;
+    }
+
+    // drop points left from the previous job of this worker.
+    decoder.point_cloud_->points.resize(0);
+    worker->job = job.get();
+
+    for (size_t i = 0; i < job->pkts.size(); i++)
+    {
+      worker->collect = (i > 0);
+      decoder.processMsopPkt(job->pkts[i].data(), job->pkts[i].size());
+    }
+
+    worker->job = NULL;
+    job->pkts.clear();
+
+    {
+      std::lock_guard<std::mutex> lg(mtx_done_);
+      done_jobs_[job->index] = job;
+    }
+    cv_done_.notify_all();
+  }
+}
+
+template <typename T_PointCloud>
+inline void ReplayDecoder<T_PointCloud>::deliverFrame()
+{
+  bool paced = false;
+  double first_cloud_ts = 0.0;
+  std::chrono::steady_clock::time_point first_cloud_time;
+
+  while (!to_exit_)
+  {
+    std::shared_ptr<FrameJob> job;
+
+    {
+      std::unique_lock<std::mutex> ul(mtx_done_);
+      cv_done_.wait_for(ul, std::chrono::milliseconds(100),
+                        [this] { return (done_jobs_.count(next_deliver_index_) > 0) || to_exit_; });
+
+      auto iter = done_jobs_.find(next_deliver_index_);
+      if (iter == done_jobs_.end())
+      {
+        continue;
+      }
+
+      job = iter->second;
+      done_jobs_.erase(iter);
+      next_deliver_index_++;
+    }
+
+    for (auto& cloud : job->clouds)
+    {
+      if (replay_param_.replay_rate > 0)
+      {
+        if (!paced)
+        {
+          first_cloud_ts = cloud->timestamp;
+          first_cloud_time = std::chrono::steady_clock::now();
+          paced = true;
+        }
+
+        double elapsed = (cloud->timestamp - first_cloud_ts) / replay_param_.replay_rate;
+        std::this_thread::sleep_until(first_cloud_time +
+                                      std::chrono::microseconds(static_cast<int64_t>(elapsed * 1e6)));
+      }
+
+      setPointCloudHeader(cloud);
+      cb_put_cloud_(cloud);
+    }
+
+    {
+      std::lock_guard<std::mutex> lg(mtx_done_);
+      jobs_in_flight_--;
+    }
+    cv_done_.notify_all();
+  }
+}
+
+template <typename T_PointCloud>
+inline void ReplayDecoder<T_PointCloud>::setPointCloudHeader(std::shared_ptr<T_PointCloud> msg)
+{
+  msg->seq = point_cloud_seq_++;
+  msg->is_dense = driver_param_.decoder_param.dense_points;
+  if (msg->is_dense)
+  {
+    msg->height = 1;
+    msg->width = (uint32_t)msg->points.size();
+  }
+  else
+  {
+    msg->width = (uint32_t)msg->points.size() / msg->height;
+  }
+
+  msg->frame_id = driver_param_.frame_id;
+}
+
+}  // namespace lidar
+}  // namespace robosense
@@ -50,6 +50,8 @@ struct Packet
   std::string frame_id = "";  ///< Packet message frame id
 
   Packet(const Packet& msg)
+    : timestamp(msg.timestamp), seq(msg.seq), is_difop(msg.is_difop), is_frame_begin(msg.is_frame_begin),
+      frame_id(msg.frame_id)
   {
     buf_.assign(msg.buf_.begin(), msg.buf_.end());
   }
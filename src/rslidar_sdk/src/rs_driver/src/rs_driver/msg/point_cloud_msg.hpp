@@ -74,6 +74,8 @@ public:
   double timestamp = 0.0;
   uint32_t seq = 0;           ///< Sequence number of message
   std::string frame_id = "";  ///< Point cloud frame id
+  uint32_t lost_pkts = 0;     ///< Packets lost in this frame. Only for LiDARs with packet sequence number, e.g. RSM1/RSM2/RSE1
+  std::vector<uint8_t> pkt_bitmap;  ///< Bit (seq - 1) is set if the packet with sequence number seq is received
 
   VectorT points;
 };
@@ -0,0 +1,165 @@
+/*********************************************************************************************************************
+Copyright (c) 2020 RoboSense
+All rights reserved
+
+By downloading, copying, installing or using the software you agree to this license. If you do not agree to this
+license, do not download, install, copy or use the software.
+
+License Agreement
+For RoboSense LiDAR SDK Library
+(3-clause BSD License)
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following
+disclaimer in the documentation and/or other materials provided with the distribution.
+
+3. Neither the names of the RoboSense, nor Suteng Innovation Technology, nor the names of other contributors may be used
+to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#if defined(ENABLE_HUGE_PAGE_CLOUD) && defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace robosense
+{
+namespace lidar
+{
+
+struct CloudCapacityStats
+{
+  uint64_t clouds = 0;           ///< Point clouds handed to the decoder
+  uint64_t allocations = 0;      ///< Point clouds reserved before decoding, i.e. heap allocations by the driver
+  uint64_t overflows = 0;        ///< Frames which outgrew the reserved capacity while decoding
+  size_t predicted_points = 0;   ///< Points per frame predicted from the lidar type and DIFOP
+  size_t high_water_mark = 0;    ///< Moving maximum of points per frame
+  size_t capacity = 0;           ///< Points reserved for every point cloud now
+};
+
+//
+// CloudCapacity reserves the points of a point cloud before it is decoded, so that a frame never
+// grows through repeated reallocations. The capacity is the larger of the prediction and a moving high
+// water mark of the latest frames, so a recycled point cloud is not allocated again in steady state.
+//
+class CloudCapacity
+{
+public:
+
+  CloudCapacity()
+    : hwm_(0)
+  {
+  }
+
+  void setPredicted(size_t points)
+  {
+    std::lock_guard<std::mutex> lg(mtx_);
+    stats_.predicted_points = points;
+    updateCapacity();
+  }
+
+  template <typename T_Vector>
+  void prepare(T_Vector& points)
+  {
+    size_t capacity;
+
+    {
+      std::lock_guard<std::mutex> lg(mtx_);
+      stats_.clouds++;
+      capacity = stats_.capacity;
+      if (points.capacity() < capacity)
+      {
+        stats_.allocations++;
+      }
+    }
+
+    if (points.capacity() < capacity)
+    {
+      points.reserve(capacity);
+      adviseHugePage(points.data(), points.capacity() * sizeof(typename T_Vector::value_type));
+    }
+  }
+
+  template <typename T_Vector>
+  void update(const T_Vector& points, size_t reserved)
+  {
+    std::lock_guard<std::mutex> lg(mtx_);
+    if (points.capacity() > reserved)
+    {
+      stats_.overflows++;
+    }
+
+    // decay by 1/64 per frame, so that a single large frame is forgotten in some seconds.
+    hwm_ = std::max(points.size(), hwm_ - (hwm_ >> 6));
+    stats_.high_water_mark = hwm_;
+    updateCapacity();
+  }
+
+  size_t capacity()
+  {
+    std::lock_guard<std::mutex> lg(mtx_);
+    return stats_.capacity;
+  }
+
+  CloudCapacityStats stats()
+  {
+    std::lock_guard<std::mutex> lg(mtx_);
+    return stats_;
+  }
+
+#ifndef UNIT_TEST
+private:
+#endif
+
+  void updateCapacity()
+  {
+    // keep 1/8 headroom over the high water mark, and never shrink below the prediction.
+    size_t capacity = std::max(stats_.predicted_points, hwm_ + (hwm_ >> 3));
+
+    // grow at once, but shrink only if much smaller, to avoid reallocating on jitter.
+    if ((capacity > stats_.capacity) || (capacity < (stats_.capacity >> 1)))
+    {
+      stats_.capacity = capacity;
+    }
+  }
+
+  static void adviseHugePage(void* data, size_t size)
+  {
+#if defined(ENABLE_HUGE_PAGE_CLOUD) && defined(__linux__)
+    const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t begin = ((uintptr_t)data + page - 1) & ~(page - 1);
+    uintptr_t end = ((uintptr_t)data + size) & ~(page - 1);
+    if (end > begin)
+    {
+      madvise((void*)begin, end - begin, MADV_HUGEPAGE);
+    }
+#endif
+  }
+
+  std::mutex mtx_;
+  CloudCapacityStats stats_;
+  size_t hwm_;
+};
+
+}  // namespace lidar
+}  // namespace robosense
@@ -0,0 +1,77 @@
+
+#include <gtest/gtest.h>
+
+#include <rs_driver/utility/cloud_capacity.hpp>
+
+#include <vector>
+
+using namespace robosense::lidar;
+
+TEST(TestCloudCapacity, reserveByPrediction)
+{
+  CloudCapacity capacity;
+  capacity.setPredicted(1000);
+  ASSERT_EQ(capacity.capacity(), 1000u);
+
+  std::vector<int> points;
+  capacity.prepare(points);
+  ASSERT_GE(points.capacity(), 1000u);
+
+  CloudCapacityStats stats = capacity.stats();
+  ASSERT_EQ(stats.clouds, 1u);
+  ASSERT_EQ(stats.allocations, 1u);
+  ASSERT_EQ(stats.predicted_points, 1000u);
+
+  // a recycled cloud is not reserved again
+  points.resize(0);
+  capacity.prepare(points);
+  ASSERT_EQ(capacity.stats().allocations, 1u);
+}
+
+TEST(TestCloudCapacity, growByHighWaterMark)
+{
+  CloudCapacity capacity;
+  capacity.setPredicted(1000);
+
+  std::vector<int> points;
+  capacity.prepare(points);
+  size_t reserved = points.capacity();
+  points.resize(2000);
+  capacity.update(points, reserved);
+
+  CloudCapacityStats stats = capacity.stats();
+  ASSERT_EQ(stats.overflows, 1u);
+  ASSERT_EQ(stats.high_water_mark, 2000u);
+  ASSERT_EQ(stats.capacity, 2250u);
+
+  // the next frame fits
+  std::vector<int> points2;
+  capacity.prepare(points2);
+  reserved = points2.capacity();
+  points2.resize(2000);
+  capacity.update(points2, reserved);
+  ASSERT_EQ(capacity.stats().overflows, 1u);
+}
+
+TEST(TestCloudCapacity, shrinkSlowly)
+{
+  CloudCapacity capacity;
+  capacity.setPredicted(100);
+
+  std::vector<int> points(8000);
+  capacity.update(points, points.capacity());
+  ASSERT_EQ(capacity.capacity(), 9000u);
+
+  // small frames decay the high water mark, and shrink the capacity only below half.
+  points.resize(100);
+  capacity.update(points, points.capacity());
+  ASSERT_EQ(capacity.capacity(), 9000u);
+
+  for (int i = 0; i < 100; i++)
+  {
+    capacity.update(points, points.capacity());
+  }
+
+  ASSERT_LT(capacity.capacity(), 4500u);
+  ASSERT_GE(capacity.capacity(), 100u);
+}
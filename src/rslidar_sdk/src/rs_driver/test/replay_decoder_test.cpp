@@ -0,0 +1,113 @@
+
+#include <gtest/gtest.h>
+
+#include <rs_driver/driver/replay_decoder.hpp>
+#include <rs_driver/msg/point_cloud_msg.hpp>
+
+using namespace robosense::lidar;
+
+typedef PointXYZIRT PointT;
+typedef PointCloudT<PointT> PointCloud;
+
+static Packet makeRSM1Pkt(uint16_t seq, uint16_t distance, bool is_frame_begin)
+{
+  Packet pkt(sizeof(RSM1MsopPkt));
+  RSM1MsopPkt& msop = *(RSM1MsopPkt*)pkt.buf_.data();
+  memset(&msop, 0, sizeof(msop));
+
+  const uint8_t id[] = {0x55, 0xAA, 0x5A, 0xA5};
+  memcpy(msop.header.id, id, sizeof(id));
+  msop.header.pkt_seq = htons(seq);
+
+  for (uint16_t blk = 0; blk < 25; blk++)
+  {
+    for (uint16_t chan = 0; chan < 5; chan++)
+    {
+      RSM1Channel& channel = msop.blocks[blk].channel[chan];
+      channel.distance = htons(distance);
+      channel.pitch = htons(DecoderRSM1<PointCloud>::ANGLE_OFFSET);
+      channel.yaw = htons(DecoderRSM1<PointCloud>::ANGLE_OFFSET);
+    }
+  }
+
+  pkt.is_frame_begin = is_frame_begin;
+  return pkt;
+}
+
+TEST(TestReplayDecoder, decodeInOrder)
+{
+  constexpr uint16_t PKTS_PER_FRAME = 40;
+  constexpr uint16_t FRAMES = 6;
+
+  std::vector<std::shared_ptr<PointCloud>> clouds;
+  std::mutex mtx;
+
+  RSDriverParam param;
+  param.lidar_type = LidarType::RSM1;
+  param.decoder_param.use_lidar_clock = true;
+
+  RSReplayParam replay_param;
+  replay_param.num_threads = 3;
+
+  ReplayDecoder<PointCloud> decoder;
+  decoder.regPointCloudCallback(
+      []() { return std::make_shared<PointCloud>(); },
+      [&clouds, &mtx](std::shared_ptr<PointCloud> cloud) { 
+        std::lock_guard<std::mutex> lg(mtx);
+        clouds.emplace_back(cloud); 
+      });
+  ASSERT_TRUE(decoder.init(param, replay_param));
+  ASSERT_TRUE(decoder.start());
+
+  std::vector<Packet> pkts;
+
+  // partial frame ahead of the first frame-begin is dropped.
+  pkts.emplace_back(makeRSM1Pkt(PKTS_PER_FRAME, 100, false));
+
+  for (uint16_t frame = 0; frame < FRAMES; frame++)
+  {
+    for (uint16_t seq = 1; seq <= PKTS_PER_FRAME; seq++)
+    {
+      // distance of frame N is (N+1) meters.
+      pkts.emplace_back(makeRSM1Pkt(seq, (frame + 1) * 200, (seq == 1)));
+    }
+  }
+
+  decoder.decodePackets(pkts.data(), pkts.size());
+  decoder.flush();
+  decoder.stop();
+
+  // the last frame is incomplete until its successor begins.
+  ASSERT_EQ(clouds.size(), FRAMES - 1);
+  for (size_t i = 0; i < clouds.size(); i++)
+  {
+    ASSERT_EQ(clouds[i]->seq, i);
+    ASSERT_EQ(clouds[i]->points.size(), PKTS_PER_FRAME * 25 * 5);
+    ASSERT_EQ(clouds[i]->height, 5);
+    ASSERT_FLOAT_EQ(clouds[i]->points.front().x, i + 1);
+    ASSERT_FLOAT_EQ(clouds[i]->points.back().x, i + 1);
+  }
+}
+
+TEST(TestReplayDecoder, dropWithoutFrameBegin)
+{
+  std::vector<std::shared_ptr<PointCloud>> clouds;
+
+  RSDriverParam param;
+  param.lidar_type = LidarType::RSM1;
+
+  ReplayDecoder<PointCloud> decoder;
+  decoder.regPointCloudCallback(
+      []() { return std::make_shared<PointCloud>(); },
+      [&clouds](std::shared_ptr<PointCloud> cloud) { clouds.emplace_back(cloud); });
+  ASSERT_TRUE(decoder.init(param, RSReplayParam()));
+  ASSERT_TRUE(decoder.start());
+
+  for (uint16_t seq = 1; seq <= 100; seq++)
+  {
+    decoder.decodePacket(makeRSM1Pkt(seq, 200, false));
+  }
+
+  decoder.flush();
+  ASSERT_EQ(clouds.size(), 0);
+}
@@ -0,0 +1,223 @@
+
+#include <gtest/gtest.h>
+
+#include <rs_driver/driver/decoder/decoder_RSM1.hpp>
+#include <rs_driver/msg/point_cloud_msg.hpp>
+
+using namespace robosense::lidar;
+
+typedef PointXYZIRT PointT;
+typedef PointCloudT<PointT> PointCloud;
+
+TEST(TestSeqTracker, lostPkts)
+{
+  SeqTracker tracker;
+  tracker.newPacket(1);
+  tracker.newPacket(2);
+  tracker.newPacket(2); // duplicated
+  tracker.newPacket(4);
+  ASSERT_EQ(tracker.lostPkts(0), 1u);
+  ASSERT_EQ(tracker.lostPkts(10), 7u);
+
+  PointCloud cloud;
+  tracker.finish(cloud, 10);
+  ASSERT_EQ(cloud.lost_pkts, 7u);
+  ASSERT_EQ(cloud.pkt_bitmap.size(), 2u);
+  ASSERT_EQ(cloud.pkt_bitmap[0], 0x0B);
+  ASSERT_EQ(cloud.pkt_bitmap[1], 0x00);
+
+  // reset after finish
+  ASSERT_EQ(tracker.lostPkts(0), 0u);
+}
+
+static std::vector<uint16_t> decoded;
+
+static bool decodeSeq(const uint8_t* pkt, size_t size)
+{
+  decoded.emplace_back(*(const uint16_t*)pkt);
+  return false;
+}
+
+static void push(SeqReorder& reorder, uint16_t seq, uint64_t ts)
+{
+  reorder.push(seq, ts, (const uint8_t*)&seq, sizeof(seq), decodeSeq);
+}
+
+TEST(TestSeqReorder, reorder)
+{
+  decoded.clear();
+  SeqReorder reorder(1000);
+
+  push(reorder, 1, 0);
+  push(reorder, 3, 10);
+  push(reorder, 4, 20);
+  ASSERT_EQ(reorder.held(), 2u);
+  push(reorder, 2, 30);
+  ASSERT_EQ(reorder.held(), 0u);
+
+  std::vector<uint16_t> expected = {1, 2, 3, 4};
+  ASSERT_EQ(decoded, expected);
+}
+
+TEST(TestSeqReorder, expire)
+{
+  decoded.clear();
+  SeqReorder reorder(1000);
+
+  push(reorder, 1, 0);
+  push(reorder, 3, 10);
+  push(reorder, 5, 500);
+  push(reorder, 6, 1010); // 3 expires, and 2 is given up
+  ASSERT_EQ(reorder.held(), 2u);
+  push(reorder, 4, 1020);
+  ASSERT_EQ(reorder.held(), 0u);
+
+  push(reorder, 2, 1030); // too late
+  ASSERT_EQ(reorder.dropped(), 1u);
+
+  std::vector<uint16_t> expected = {1, 3, 4, 5, 6};
+  ASSERT_EQ(decoded, expected);
+}
+
+static SplitStrategyBySeq split_strategy;
+static int splits;
+
+static bool splitSeq(const uint8_t* pkt, size_t size)
+{
+  if (split_strategy.newPacket(*(const uint16_t*)pkt))
+  {
+    splits++;
+  }
+  return false;
+}
+
+TEST(TestSeqReorder, lateAfterExpireDoesNotSplit)
+{
+  split_strategy = SplitStrategyBySeq();
+  splits = 0;
+  SeqReorder reorder(1000);
+
+  // 2 is missing, so 3 to 30 are held until they expire
+  for (uint16_t seq = 1; seq <= 30; seq++)
+  {
+    if (seq != 2)
+      reorder.push(seq, seq, (const uint8_t*)&seq, sizeof(seq), splitSeq);
+  }
+  ASSERT_EQ(reorder.held(), 28u);
+
+  uint16_t seq = 31;
+  reorder.push(seq, 2000, (const uint8_t*)&seq, sizeof(seq), splitSeq);
+  ASSERT_EQ(reorder.held(), 0u);
+
+  // 2 is now more than SplitStrategyBySeq::RANGE behind
+  seq = 2;
+  reorder.push(seq, 2010, (const uint8_t*)&seq, sizeof(seq), splitSeq);
+  ASSERT_EQ(reorder.dropped(), 1u);
+  ASSERT_EQ(splits, 0);
+}
+
+TEST(TestSeqReorder, rewind)
+{
+  decoded.clear();
+  SeqReorder reorder(1000);
+
+  push(reorder, 298, 0);
+  push(reorder, 300, 10);
+  push(reorder, 1, 20); // new frame
+  push(reorder, 2, 30);
+
+  std::vector<uint16_t> expected = {298, 300, 1, 2};
+  ASSERT_EQ(decoded, expected);
+}
+
+static RSM1MsopPkt makeRSM1Pkt(uint16_t seq)
+{
+  RSM1MsopPkt pkt;
+  memset(&pkt, 0, sizeof(pkt));
+
+  const uint8_t id[] = {0x55, 0xAA, 0x5A, 0xA5};
+  memcpy(pkt.header.id, id, sizeof(id));
+  pkt.header.pkt_seq = htons(seq);
+
+  for (uint16_t blk = 0; blk < 25; blk++)
+  {
+    for (uint16_t chan = 0; chan < 5; chan++)
+    {
+      RSM1Channel& channel = pkt.blocks[blk].channel[chan];
+      channel.distance = htons(200);
+      channel.pitch = htons(DecoderRSM1<PointCloud>::ANGLE_OFFSET);
+      channel.yaw = htons(DecoderRSM1<PointCloud>::ANGLE_OFFSET);
+      channel.intensity = (uint8_t)seq;
+    }
+  }
+
+  return pkt;
+}
+
+static std::vector<std::shared_ptr<PointCloud>> clouds;
+static DecoderRSM1<PointCloud>* m1_decoder = nullptr;
+
+static void errCallback(const Error& err)
+{
+}
+
+static void splitFrame(uint16_t height, double ts)
+{
+  if (m1_decoder->point_cloud_->points.size() > 0)
+  {
+    clouds.emplace_back(m1_decoder->point_cloud_);
+    m1_decoder->point_cloud_ = std::make_shared<PointCloud>();
+  }
+}
+
+TEST(TestSeqReorder, decodeRSM1)
+{
+  RSDecoderParam param;
+  param.wait_for_difop = false;
+  param.dense_points = true;
+  param.reorder_window_us = 1000000;
+
+  DecoderRSM1<PointCloud> decoder(param);
+  decoder.regCallback(errCallback, splitFrame);
+  decoder.point_cloud_ = std::make_shared<PointCloud>();
+  m1_decoder = &decoder;
+  clouds.clear();
+
+  // seq 3 is lost in frame 1, and seq 5 arrives before seq 4 in frame 2.
+  const uint16_t PKTS_PER_FRAME = 100;
+  std::vector<uint16_t> seqs;
+  for (uint16_t seq = 1; seq <= PKTS_PER_FRAME; seq++)
+  {
+    if (seq != 3)
+      seqs.emplace_back(seq);
+  }
+  for (uint16_t seq = 1; seq <= PKTS_PER_FRAME; seq++)
+  {
+    seqs.emplace_back((seq == 4) ? 5 : ((seq == 5) ? 4 : seq));
+  }
+
+  for (auto seq : seqs)
+  {
+    RSM1MsopPkt pkt = makeRSM1Pkt(seq);
+    decoder.processMsopPkt((const uint8_t*)&pkt, sizeof(pkt));
+  }
+
+  ASSERT_EQ(clouds.size(), 2u);
+
+  ASSERT_EQ(clouds[0]->lost_pkts, 1u);
+  std::vector<uint8_t> bitmap(13, 0xFF);
+  bitmap[12] = 0x0F;
+  ASSERT_EQ(clouds[1]->lost_pkts, 0u);
+  ASSERT_EQ(clouds[1]->pkt_bitmap, bitmap);
+
+  bitmap[0] = 0xFB;
+  ASSERT_EQ(clouds[0]->pkt_bitmap, bitmap);
+
+  // points of frame 2 are decoded in order of sequence number
+  const std::vector<PointT>& points = clouds[1]->points;
+  ASSERT_EQ(points.size(), PKTS_PER_FRAME * 125u);
+  for (size_t i = 0; i < points.size(); i++)
+  {
+    ASSERT_EQ(points[i].intensity, i / 125 + 1);
+  }
+}
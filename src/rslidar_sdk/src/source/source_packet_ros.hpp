@@ -34,6 +34,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "source/source_driver.hpp"
 
+#include <rs_driver/driver/replay_decoder.hpp>
+
 #ifdef ROS_FOUND
 
 #ifdef ENABLE_SOURCE_PACKET_LEGACY
@@ -65,11 +67,28 @@ inline Packet toRsMsg(const rslidar_msg::RslidarPacket& ros_msg)
   return rs_msg;
 }
 
+inline bool readReplayParam(const YAML::Node& config, RSReplayParam& replay_param)
+{
+  bool replay_decode;
+  yamlRead<bool>(config["driver"], "replay_decode", replay_decode, false);
+  if (!replay_decode)
+  {
+    return false;
+  }
+
+  yamlRead<uint16_t>(config["driver"], "replay_threads", replay_param.num_threads, 0);
+  yamlRead<float>(config["driver"], "replay_rate", replay_param.replay_rate, 0);
+  replay_param.print();
+  return true;
+}
+
 class SourcePacketRos : public SourceDriver
 { 
 public: 
 
   virtual void init(const YAML::Node& config);
+  virtual void start();
+  virtual void stop();
 
   SourcePacketRos();
 
@@ -85,6 +104,7 @@ private:
 
   void putPacket(const rslidar_msg::RslidarPacket& msg);
   ros::Subscriber pkt_sub_;
+  std::shared_ptr<ReplayDecoder<LidarPointCloudMsg>> replay_ptr_;
 
   std::unique_ptr<ros::NodeHandle> nh_;
 };
@@ -117,10 +137,46 @@ void SourcePacketRos::init(const YAML::Node& config)
   yamlRead<std::string>(config["ros"], "ros_recv_packet_topic", 
       ros_recv_topic, "rslidar_packets");
 
-  pkt_sub_ = nh_->subscribe(ros_recv_topic, 100, &SourcePacketRos::putPacket, this);
+  RSReplayParam replay_param;
+  if (readReplayParam(config, replay_param))
+  {
+    replay_ptr_.reset(new ReplayDecoder<LidarPointCloudMsg>());
+    replay_ptr_->regPointCloudCallback(std::bind(&SourcePacketRos::getPointCloud, this), 
+        std::bind(&SourcePacketRos::putPointCloud, this, std::placeholders::_1));
+    replay_ptr_->regExceptionCallback(
+        std::bind(&SourcePacketRos::putException, this, std::placeholders::_1));
+
+    if (!replay_ptr_->init(driver_param_, replay_param))
+    {
+      RS_ERROR << "Replay Decoder Initialize Error...." << RS_REND;
+      exit(-1);
+    }
+  }
+
+  // no packet should be dropped while a bag is replayed faster than real time.
+  uint32_t queue_size = replay_ptr_ ? 0 : 100;
+  pkt_sub_ = nh_->subscribe(ros_recv_topic, queue_size, &SourcePacketRos::putPacket, this);
 
 } 
 
+inline void SourcePacketRos::start()
+{
+  SourceDriver::start();
+  if (replay_ptr_)
+  {
+    replay_ptr_->start();
+  }
+}
+
+inline void SourcePacketRos::stop()
+{
+  if (replay_ptr_)
+  {
+    replay_ptr_->stop();
+  }
+  SourceDriver::stop();
+}
+
 #ifdef ENABLE_SOURCE_PACKET_LEGACY
 inline Packet toRsMsg(const rslidar_msgs::rslidarPacket& ros_msg, LidarType lidar_type, bool isDifop)
 {
@@ -156,6 +212,12 @@ void SourcePacketRos::putPacketDifopLegacy(const rslidar_msgs::rslidarPacket& ms
 
 void SourcePacketRos::putPacket(const rslidar_msg::RslidarPacket& msg)
 {
+  if (replay_ptr_)
+  {
+    replay_ptr_->feedPacket(msg.data.data(), msg.data.size(), msg.is_frame_begin);
+    return;
+  }
+
   driver_ptr_->decodePacket(toRsMsg(msg));
 }
 
@@ -231,13 +293,24 @@ inline Packet toRsMsg(const rslidar_msg::msg::RslidarPacket& ros_msg)
   //rs_msg.seq = ros_msg.header.seq;
   rs_msg.is_difop = ros_msg.is_difop;
   rs_msg.is_frame_begin = ros_msg.is_frame_begin; 
+  rs_msg.buf_.assign(ros_msg.data.begin(), ros_msg.data.end());
 
-  for (size_t i = 0; i < ros_msg.data.size(); i++)
+  return rs_msg;
+}
+
+inline bool readReplayParam(const YAML::Node& config, RSReplayParam& replay_param)
+{
+  bool replay_decode;
+  yamlRead<bool>(config["driver"], "replay_decode", replay_decode, false);
+  if (!replay_decode)
   {
-    rs_msg.buf_.emplace_back(ros_msg.data[i]);
+    return false;
   }
 
-  return rs_msg;
+  yamlRead<uint16_t>(config["driver"], "replay_threads", replay_param.num_threads, 0);
+  yamlRead<float>(config["driver"], "replay_rate", replay_param.replay_rate, 0);
+  replay_param.print();
+  return true;
 }
 
 class SourcePacketRos : public SourceDriver
@@ -245,6 +318,8 @@ class SourcePacketRos : public SourceDriver
 public: 
 
   virtual void init(const YAML::Node& config);
+  virtual void start();
+  virtual void stop();
 
   SourcePacketRos();
 
@@ -254,6 +329,7 @@ private:
   std::thread subscription_spin_thread_;
   std::shared_ptr<rclcpp::Node> node_ptr_;
   rclcpp::Subscription<rslidar_msg::msg::RslidarPacket>::SharedPtr pkt_sub_;
+  std::shared_ptr<ReplayDecoder<LidarPointCloudMsg>> replay_ptr_;
 };
 
 SourcePacketRos::SourcePacketRos()
@@ -273,14 +349,61 @@ void SourcePacketRos::init(const YAML::Node& config)
   std::stringstream node_name;
   node_name << "rslidar_packets_source_" << node_index++;
 
+  RSReplayParam replay_param;
+  if (readReplayParam(config, replay_param))
+  {
+    replay_ptr_.reset(new ReplayDecoder<LidarPointCloudMsg>());
+    replay_ptr_->regPointCloudCallback(std::bind(&SourcePacketRos::getPointCloud, this), 
+        std::bind(&SourcePacketRos::putPointCloud, this, std::placeholders::_1));
+    replay_ptr_->regExceptionCallback(
+        std::bind(&SourcePacketRos::putException, this, std::placeholders::_1));
+
+    if (!replay_ptr_->init(driver_param_, replay_param))
+    {
+      RS_ERROR << "Replay Decoder Initialize Error...." << RS_REND;
+      exit(-1);
+    }
+  }
+
+  // no packet should be dropped while a bag is replayed faster than real time.
+  rclcpp::QoS qos(100);
+  if (replay_ptr_)
+  {
+    qos = rclcpp::QoS(rclcpp::KeepAll()).reliable();
+  }
+
   node_ptr_.reset(new rclcpp::Node(node_name.str()));
-  pkt_sub_ = node_ptr_->create_subscription<rslidar_msg::msg::RslidarPacket>(ros_recv_topic, 100, 
+  pkt_sub_ = node_ptr_->create_subscription<rslidar_msg::msg::RslidarPacket>(ros_recv_topic, qos, 
       std::bind(&SourcePacketRos::putPacket, this, std::placeholders::_1));
   subscription_spin_thread_ = std::thread(std::bind(&SourcePacketRos::spin,this));
 } 
 
+inline void SourcePacketRos::start()
+{
+  SourceDriver::start();
+  if (replay_ptr_)
+  {
+    replay_ptr_->start();
+  }
+}
+
+inline void SourcePacketRos::stop()
+{
+  if (replay_ptr_)
+  {
+    replay_ptr_->stop();
+  }
+  SourceDriver::stop();
+}
+
 void SourcePacketRos::putPacket(const rslidar_msg::msg::RslidarPacket::SharedPtr msg) const
 {
+  if (replay_ptr_)
+  {
+    replay_ptr_->feedPacket(msg->data.data(), msg->data.size(), msg->is_frame_begin);
+    return;
+  }
+
   driver_ptr_->decodePacket(toRsMsg(*msg));
 }
 